@@ -0,0 +1,78 @@
+/**
+ * Tests that mongos merges the results of a sharded aggregation itself when the merging half of the
+ * pipeline is simple enough, and that doing so returns the same results as merging on a shard.
+ */
+(function() {
+    "use strict";
+
+    load("jstests/aggregation/extras/utils.js");  // for arrayEq
+
+    const st = new ShardingTest({shards: 2});
+    const mongosDB = st.s0.getDB("test");
+    const coll = mongosDB.mongos_merge;
+
+    assert.commandWorked(st.s0.adminCommand({enableSharding: mongosDB.getName()}));
+    st.ensurePrimaryShard(mongosDB.getName(), "shard0000");
+    assert.commandWorked(st.s0.adminCommand({shardCollection: coll.getFullName(), key: {_id: 1}}));
+    assert.commandWorked(st.s0.adminCommand({split: coll.getFullName(), middle: {_id: 0}}));
+    assert.commandWorked(
+        st.s0.adminCommand({moveChunk: coll.getFullName(), find: {_id: 0}, to: "shard0001"}));
+
+    const values = [1, 2.5, NumberLong(3), "abc", null, [1, 3], {x: 1}, new Date(0), true];
+    const bulk = coll.initializeUnorderedBulkOp();
+    for (let i = -100; i < 100; ++i) {
+        const doc = {_id: i, group: i % 7, num: i % 13};
+        if (i % 11 !== 0) {
+            doc.key = values[Math.abs(i) % values.length];
+        }
+        bulk.insert(doc);
+    }
+    assert.writeOK(bulk.execute());
+
+    const pipelines = [
+        [{$sort: {key: 1, _id: -1}}],
+        [{$sort: {key: -1, num: 1, _id: 1}}, {$limit: 17}],
+        [{$sort: {num: 1, _id: 1}}, {$skip: 30}, {$limit: 20}, {$project: {num: 1, key: 1}}],
+        [
+          {$sort: {num: 1, _id: 1}},
+          {$unwind: "$key"},
+          {$addFields: {twice: {$multiply: [2, "$num"]}}}
+        ],
+        [{$group: {_id: "$group", total: {$sum: "$num"}, avg: {$avg: "$_id"}, n: {$sum: 1}}}],
+        [{$match: {num: {$gt: 3}}}, {$project: {num: 1}}],
+    ];
+
+    function runPipelines(mergeOnMongos) {
+        assert.commandWorked(
+            st.s0.adminCommand({setParameter: 1, internalQueryAggMergeOnMongos: mergeOnMongos}));
+        return pipelines.map(function(pipeline) {
+            const explain = coll.explain().aggregate(pipeline);
+            assert.eq(mergeOnMongos ? "mongos" : "anyShard", explain.mergeType, tojson(explain));
+
+            // Use a small batch size so that most results are returned by getMores.
+            return coll.aggregate(pipeline, {cursor: {batchSize: 3}}).toArray();
+        });
+    }
+
+    const mergedOnShard = runPipelines(false);
+    const mergedOnMongos = runPipelines(true);
+    for (let i = 0; i < pipelines.length; ++i) {
+        if (pipelines[i][0].hasOwnProperty("$sort")) {
+            assert.eq(mergedOnShard[i], mergedOnMongos[i], tojson(pipelines[i]));
+        } else {
+            assert(arrayEq(mergedOnShard[i], mergedOnMongos[i]), tojson(pipelines[i]));
+        }
+    }
+
+    // A merger side which needs to spill or to sort unsorted input is still sent to a shard.
+    assert.eq("anyShard",
+              coll.explain()
+                  .aggregate([{$group: {_id: "$group", n: {$sum: 1}}}], {allowDiskUse: true})
+                  .mergeType);
+    assert.eq("anyShard",
+              coll.explain()
+                  .aggregate([{$group: {_id: "$group", n: {$sum: 1}}}, {$sort: {n: 1}}])
+                  .mergeType);
+
+    st.stop();
+}());
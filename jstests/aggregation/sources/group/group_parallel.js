@@ -0,0 +1,52 @@
+/**
+ * Tests that a $group computed by several aggregation worker threads returns the same results as
+ * one computed on the command thread.
+ */
+(function() {
+    "use strict";
+
+    load("jstests/aggregation/extras/utils.js");  // for arrayEq
+
+    const coll = db.group_parallel;
+    coll.drop();
+
+    const bulk = coll.initializeUnorderedBulkOp();
+    for (let i = 0; i < 5000; ++i) {
+        bulk.insert({_id: i, a: i % 13, b: i, tags: [i % 2, i % 3]});
+    }
+    assert.writeOK(bulk.execute());
+
+    const pipelines = [
+        [{$group: {_id: "$a", total: {$sum: "$b"}, count: {$sum: 1}}}],
+        [
+          {$match: {b: {$gte: 100}}},
+          {$unwind: "$tags"},
+          {$group: {_id: "$tags", avg: {$avg: "$b"}, min: {$min: "$b"}, max: {$max: "$b"}}}
+        ],
+        [
+          {$addFields: {c: {$mod: ["$b", 5]}}},
+          {$group: {_id: {a: "$a", c: "$c"}, values: {$addToSet: "$c"}}}
+        ],
+    ];
+
+    function runAggregate(pipeline, parallelism) {
+        const res = db.runCommand(
+            {aggregate: coll.getName(), pipeline: pipeline, parallelism: parallelism, cursor: {}});
+        assert.commandWorked(res);
+        return new DBCommandCursor(db.getMongo(), res).toArray();
+    }
+
+    pipelines.forEach(function(pipeline) {
+        const serial = runAggregate(pipeline, 1);
+        const parallel = runAggregate(pipeline, 4);
+        assert(arrayEq(serial, parallel), tojson({serial: serial, parallel: parallel}));
+    });
+
+    // The option must be a number between 1 and 64.
+    assert.commandFailedWithCode(
+        db.runCommand({aggregate: coll.getName(), pipeline: [], parallelism: 0, cursor: {}}),
+        ErrorCodes.BadValue);
+    assert.commandFailedWithCode(
+        db.runCommand({aggregate: coll.getName(), pipeline: [], parallelism: "4", cursor: {}}),
+        ErrorCodes.TypeMismatch);
+}());
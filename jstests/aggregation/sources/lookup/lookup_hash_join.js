@@ -0,0 +1,111 @@
+/**
+ * Tests that a $lookup which builds a hash table of the foreign collection returns the same results
+ * as a $lookup which queries the foreign collection for every input document, including under a
+ * collation.
+ */
+(function() {
+    "use strict";
+
+    load("jstests/aggregation/extras/utils.js");  // for arrayEq
+
+    const kMaxMemoryBytes = 100 * 1024 * 1024;
+
+    const local = db.lookup_hash_join_local;
+    const foreign = db.lookup_hash_join_foreign;
+
+    local.drop();
+    foreign.drop();
+
+    const localValues =
+        [1, 1.5, "abc", "ABC", {x: 1}, null, [1, "abc"], [], [[1]], /abc/, true, new Date(0)];
+    for (let i = 0; i < localValues.length; ++i) {
+        assert.writeOK(local.insert({_id: i, key: localValues[i], nested: {key: localValues[i]}}));
+    }
+    assert.writeOK(local.insert({_id: localValues.length}));
+
+    const foreignValues = [
+        1,
+        NumberLong(1),
+        NumberDecimal("1.5"),
+        "abc",
+        "Abc",
+        {x: 1},
+        [1, 1, 2],
+        [[1]],
+        [{x: 1}, "abc", "ABC"],
+        null,
+        /abc/,
+        true,
+        new Date(0),
+    ];
+    for (let i = 0; i < foreignValues.length; ++i) {
+        assert.writeOK(foreign.insert({
+            _id: i,
+            key: foreignValues[i],
+            nested: [{key: foreignValues[i]}, {key: "other"}],
+            other: i % 3
+        }));
+    }
+    assert.writeOK(foreign.insert({_id: foreignValues.length}));
+
+    function runLookups(forceHashJoin, options) {
+        assert.commandWorked(db.adminCommand({
+            setParameter: 1,
+            internalDocumentSourceLookupForceHashJoin: forceHashJoin,
+            internalDocumentSourceLookupHashJoinMaxMemoryBytes: forceHashJoin ? kMaxMemoryBytes : 0
+        }));
+
+        function lookup(localField, foreignField) {
+            return {
+                $lookup: {
+                    from: foreign.getName(),
+                    localField: localField,
+                    foreignField: foreignField,
+                    as: "matched"
+                }
+            };
+        }
+        function sortMatches(results) {
+            results.forEach(function(doc) {
+                if (Array.isArray(doc.matched)) {
+                    doc.matched.sort(function(lhs, rhs) {
+                        return lhs._id - rhs._id;
+                    });
+                }
+            });
+            return results;
+        }
+
+        return {
+            joined: sortMatches(local.aggregate([lookup("key", "key")], options).toArray()),
+            nested: sortMatches(
+                local.aggregate([lookup("nested.key", "nested.key")], options).toArray()),
+            filtered: local
+                          .aggregate([
+                              lookup("key", "key"),
+                              {$unwind: "$matched"},
+                              {$match: {"matched.other": {$gt: 0}}}
+                          ],
+                                     options)
+                          .toArray(),
+        };
+    }
+
+    [{}, {collation: {locale: "en_US", strength: 2}}].forEach(function(options) {
+        const withQueries = runLookups(false, options);
+        const withHashJoin = runLookups(true, options);
+        assert.commandWorked(db.adminCommand({
+            setParameter: 1,
+            internalDocumentSourceLookupForceHashJoin: false,
+            internalDocumentSourceLookupHashJoinMaxMemoryBytes: kMaxMemoryBytes
+        }));
+
+        ["joined", "nested", "filtered"].forEach(function(name) {
+            assert(arrayEq(withQueries[name], withHashJoin[name]), tojson({
+                       options: options,
+                       withQueries: withQueries,
+                       withHashJoin: withHashJoin
+                   }));
+        });
+    });
+}());
@@ -0,0 +1,135 @@
+/**
+ * Tests that a $lookup answered by seeking an index on the foreign field returns the same results
+ * as a $lookup which queries the foreign collection for every input document.
+ */
+(function() {
+    "use strict";
+
+    load("jstests/aggregation/extras/utils.js");  // for arrayEq
+
+    const local = db.lookup_index_probe_local;
+    const foreign = db.lookup_index_probe_foreign;
+
+    local.drop();
+    foreign.drop();
+
+    const localValues = [
+        1,
+        NumberLong(1),
+        1.5,
+        NumberDecimal("2"),
+        "abc",
+        {x: 1},
+        null,
+        [1, "abc"],
+        /abc/,
+        ObjectId("582e3a3eb7a2c4e09fbc0c48"),
+        true,
+        new Date(0),
+        MinKey,
+        MaxKey,
+    ];
+    for (let i = 0; i < localValues.length; ++i) {
+        assert.writeOK(local.insert({_id: i, key: localValues[i]}));
+    }
+    assert.writeOK(local.insert({_id: localValues.length}));
+
+    const foreignValues = [
+        1,
+        1.0,
+        NumberDecimal("1.5"),
+        2,
+        "abc",
+        "ABC",
+        {x: 1},
+        [1, 1, 2],
+        [{x: 1}, "abc"],
+        null,
+        /abc/,
+        ObjectId("582e3a3eb7a2c4e09fbc0c48"),
+        true,
+        new Date(0),
+        MinKey,
+        MaxKey,
+    ];
+    for (let i = 0; i < foreignValues.length; ++i) {
+        assert.writeOK(foreign.insert({_id: i, key: foreignValues[i], other: i % 3}));
+    }
+    assert.writeOK(foreign.insert({_id: foreignValues.length}));
+    assert.commandWorked(foreign.createIndex({key: 1, other: -1}));
+
+    // Keep $lookup from switching to a hash join of the foreign collection.
+    assert.commandWorked(
+        db.adminCommand({setParameter: 1, internalDocumentSourceLookupHashJoinMaxMemoryBytes: 0}));
+
+    function runLookups(useIndexProbe) {
+        assert.commandWorked(db.adminCommand(
+            {setParameter: 1, internalDocumentSourceLookupUseIndexProbe: useIndexProbe}));
+
+        const lookup = {
+            $lookup:
+                {from: foreign.getName(), localField: "key", foreignField: "key", as: "matched"}
+        };
+        return {
+            joined: local.aggregate([lookup]).toArray(),
+            unwound: local.aggregate([lookup, {$unwind: "$matched"}]).toArray(),
+            filtered: local
+                          .aggregate([
+                              lookup,
+                              {$unwind: "$matched"},
+                              {$match: {"matched.other": {$gt: 0}}}
+                          ])
+                          .toArray(),
+        };
+    }
+
+    function sortMatches(results) {
+        results.forEach(function(doc) {
+            if (Array.isArray(doc.matched)) {
+                doc.matched.sort(function(lhs, rhs) {
+                    return lhs._id - rhs._id;
+                });
+            }
+        });
+        return results;
+    }
+
+    const withQueries = runLookups(false);
+    const withIndexProbe = runLookups(true);
+
+    assert(arrayEq(sortMatches(withQueries.joined), sortMatches(withIndexProbe.joined)),
+           tojson({withQueries: withQueries.joined, withIndexProbe: withIndexProbe.joined}));
+    assert(arrayEq(withQueries.unwound, withIndexProbe.unwound),
+           tojson({withQueries: withQueries.unwound, withIndexProbe: withIndexProbe.unwound}));
+    assert(arrayEq(withQueries.filtered, withIndexProbe.filtered),
+           tojson({withQueries: withQueries.filtered, withIndexProbe: withIndexProbe.filtered}));
+
+    // The probe gives up on the values it has not looked up within a query's yield interval and
+    // leaves them to queries, which must not change the results.
+    const yieldIterations =
+        assert
+            .commandWorked(db.adminCommand({getParameter: 1, internalQueryExecYieldIterations: 1}))
+            .internalQueryExecYieldIterations;
+    assert.commandWorked(db.adminCommand({setParameter: 1, internalQueryExecYieldIterations: 2}));
+    const budgeted = runLookups(true);
+    assert.commandWorked(db.adminCommand(
+        {setParameter: 1, internalQueryExecYieldIterations: yieldIterations}));
+
+    assert(arrayEq(sortMatches(withQueries.joined), sortMatches(budgeted.joined)),
+           tojson({withQueries: withQueries.joined, budgeted: budgeted.joined}));
+    assert(arrayEq(withQueries.unwound, budgeted.unwound),
+           tojson({withQueries: withQueries.unwound, budgeted: budgeted.unwound}));
+
+    assert.commandWorked(db.adminCommand(
+        {setParameter: 1, internalDocumentSourceLookupHashJoinMaxMemoryBytes: 100 * 1024 * 1024}));
+
+    // Explain reports how each lookup is answered.
+    const explain = local.explain().aggregate([
+        {$lookup: {from: foreign.getName(), localField: "key", foreignField: "key", as: "matched"}}
+    ]);
+    if (explain.hasOwnProperty("stages")) {
+        const lookupStats = explain.stages[1].$lookup.lookupStats;
+        assert.eq("indexProbe", lookupStats.strategy, tojson(explain));
+        assert.eq("key_1_other_-1", lookupStats.indexName, tojson(explain));
+    }
+}());
@@ -11,7 +11,7 @@
     testColl.drop();
 
     function getHistogramStats() {
-        return testDB.serverStatus().metrics.latency;
+        return testDB.serverStatus().opLatencies;
     }
 
     var lastHistogram = getHistogramStats();
@@ -165,4 +165,18 @@
     // Test non-command.
     assert.commandFailed(testColl.runCommand("IHopeNobodyEverMakesThisACommand"));
     lastHistogram = checkHistogramDiff(0, 0, 1);
+
+    // Percentiles are reported for each type of operation and each command, and the bucket counts
+    // only when requested.
+    ["reads", "writes", "commands"].forEach(function(key) {
+        var percentiles = lastHistogram[key].percentiles;
+        assert.lte(percentiles.p50, percentiles.p99, tojson(lastHistogram));
+        assert.lte(percentiles.p99, percentiles.p999, tojson(lastHistogram));
+        assert(!lastHistogram[key].hasOwnProperty("histogram"), tojson(lastHistogram));
+    });
+    assert.gte(lastHistogram.commandTypes.insert.ops, numRecords, tojson(lastHistogram));
+    assert(lastHistogram.commandTypes.whatsmyuri.percentiles.hasOwnProperty("p999"),
+           tojson(lastHistogram));
+    var withHistograms = testDB.serverStatus({opLatencies: {histograms: true}}).opLatencies;
+    assert(withHistograms.writes.hasOwnProperty("histogram"), tojson(withHistograms));
 }());
\ No newline at end of file
@@ -0,0 +1,43 @@
+/**
+ * Tests the serverStatus output of the WiredTiger ticket pools, and that setting the size of a pool
+ * explicitly stops the adaptive controller from resizing it.
+ */
+(function() {
+    'use strict';
+
+    if (jsTest.options().storageEngine && jsTest.options().storageEngine !== "wiredTiger") {
+        return;
+    }
+
+    var conn = MongoRunner.runMongod({storageEngine: "wiredTiger"});
+    assert.neq(null, conn, "mongod was unable to start up");
+    var admin = conn.getDB("admin");
+
+    function getTickets() {
+        var status = assert.commandWorked(admin.runCommand({serverStatus: 1}));
+        return status.wiredTiger.concurrentTransactions;
+    }
+
+    var tickets = getTickets();
+    ['read', 'write', 'priority'].forEach(function(pool) {
+        ['out', 'available', 'totalTickets', 'queued', 'totalQueued', 'totalQueueMicros']
+            .forEach(function(field) {
+                assert(tickets[pool].hasOwnProperty(field), tojson(tickets));
+            });
+    });
+    assert.eq(true, tickets.adaptive.enabled, tojson(tickets));
+    assert.eq(false, tickets.adaptive.write.pinned, tojson(tickets));
+    assert.eq(false, tickets.adaptive.read.pinned, tojson(tickets));
+
+    assert.commandWorked(
+        admin.runCommand({setParameter: 1, wiredTigerConcurrentWriteTransactions: 64}));
+    tickets = getTickets();
+    assert.eq(64, tickets.write.totalTickets, tojson(tickets));
+    assert.eq(true, tickets.adaptive.write.pinned, tojson(tickets));
+    assert.eq(false, tickets.adaptive.read.pinned, tojson(tickets));
+
+    assert.commandWorked(admin.runCommand({setParameter: 1, wiredTigerAdaptiveConcurrency: false}));
+    assert.eq(false, getTickets().adaptive.enabled);
+
+    MongoRunner.stopMongod(conn);
+})();
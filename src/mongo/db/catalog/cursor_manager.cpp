@@ -44,6 +44,7 @@
 #include "mongo/db/query/plan_executor.h"
 #include "mongo/db/service_context.h"
 #include "mongo/platform/random.h"
+#include "mongo/util/concurrency/rwlock.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/startup_test.h"
 
@@ -115,12 +116,16 @@ public:
     int64_t nextSeed();
 
 private:
-    SimpleMutex _mutex;
+    // Protects '_idToNS' and '_nextId'. Looking up the namespace of a cursor id is far more common
+    // than creating or destroying a CursorManager, so lookups only take the lock in shared mode.
+    SimpleRWLock _idToNSLock;
 
     typedef unordered_map<unsigned, string> Map;
     Map _idToNS;
     unsigned _nextId;
 
+    // Protects '_secureRandom'.
+    SimpleMutex _randomMutex;
     std::unique_ptr<SecureRandom> _secureRandom;
 };
 
@@ -145,7 +150,7 @@ GlobalCursorIdCache::GlobalCursorIdCache() : _nextId(0), _secureRandom() {}
 GlobalCursorIdCache::~GlobalCursorIdCache() {}
 
 int64_t GlobalCursorIdCache::nextSeed() {
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
+    stdx::lock_guard<SimpleMutex> lk(_randomMutex);
     if (!_secureRandom)
         _secureRandom.reset(SecureRandom::create());
     return _secureRandom->nextInt64();
@@ -154,7 +159,7 @@ int64_t GlobalCursorIdCache::nextSeed() {
 unsigned GlobalCursorIdCache::created(const std::string& ns) {
     static const unsigned MAX_IDS = 1000 * 1000 * 1000;
 
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
+    SimpleRWLock::Exclusive lk(_idToNSLock);
 
     fassert(17359, _idToNS.size() < MAX_IDS);
 
@@ -172,7 +177,7 @@ unsigned GlobalCursorIdCache::created(const std::string& ns) {
 }
 
 void GlobalCursorIdCache::destroyed(unsigned id, const std::string& ns) {
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
+    SimpleRWLock::Exclusive lk(_idToNSLock);
     invariant(ns == _idToNS[id]);
     _idToNS.erase(id);
 }
@@ -189,7 +194,7 @@ bool GlobalCursorIdCache::eraseCursor(OperationContext* txn, CursorId id, bool c
         }
         ns = pin.c()->ns();
     } else {
-        stdx::lock_guard<SimpleMutex> lk(_mutex);
+        SimpleRWLock::Shared lk(_idToNSLock);
         unsigned nsid = idFromCursorId(id);
         Map::const_iterator it = _idToNS.find(nsid);
         if (it == _idToNS.end()) {
@@ -249,7 +254,7 @@ std::size_t GlobalCursorIdCache::timeoutCursors(OperationContext* txn, int milli
     // Compute the set of collection names that we have to time out cursors for.
     vector<string> todo;
     {
-        stdx::lock_guard<SimpleMutex> lk(_mutex);
+        SimpleRWLock::Shared lk(_idToNSLock);
         for (Map::const_iterator i = _idToNS.begin(); i != _idToNS.end(); ++i) {
             if (globalCursorManager->ownsCursorId(cursorIdFromParts(i->first, 0))) {
                 // Skip the global cursor manager, since we handle it above (and it's not
@@ -324,64 +329,78 @@ CursorManager::~CursorManager() {
 }
 
 void CursorManager::invalidateAll(bool collectionGoingAway, const std::string& reason) {
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
-    fassert(28819, !BackgroundOperation::inProgForNs(_nss));
-
-    for (ExecSet::iterator it = _nonCachedExecutors.begin(); it != _nonCachedExecutors.end();
-         ++it) {
-        // we kill the executor, but it deletes itself
-        PlanExecutor* exec = *it;
-        exec->kill(reason);
+    // Lock every partition, always in the same order, so that the whole registry is invalidated
+    // atomically.
+    std::vector<stdx::unique_lock<SimpleMutex>> locks;
+    locks.reserve(kNumPartitions);
+    for (auto&& partition : _partitions) {
+        locks.emplace_back(partition.mutex);
     }
-    _nonCachedExecutors.clear();
-
-    if (collectionGoingAway) {
-        // we're going to wipe out the world
-        for (CursorMap::const_iterator i = _cursors.begin(); i != _cursors.end(); ++i) {
-            ClientCursor* cc = i->second;
 
-            cc->kill();
+    fassert(28819, !BackgroundOperation::inProgForNs(_nss));
 
-            // If the CC is pinned, somebody is actively using it and we do not delete it.
-            // Instead we notify the holder that we killed it.  The holder will then delete the
-            // CC.
-            //
-            // If the CC is not pinned, there is nobody actively holding it.  We can safely
-            // delete it.
-            if (!cc->isPinned()) {
-                delete cc;
-            }
+    for (auto&& partition : _partitions) {
+        for (ExecSet::iterator it = partition.nonCachedExecutors.begin();
+             it != partition.nonCachedExecutors.end();
+             ++it) {
+            // we kill the executor, but it deletes itself
+            PlanExecutor* exec = *it;
+            exec->kill(reason);
         }
-    } else {
-        CursorMap newMap;
+        partition.nonCachedExecutors.clear();
 
-        // collection will still be around, just all PlanExecutors are invalid
-        for (CursorMap::const_iterator i = _cursors.begin(); i != _cursors.end(); ++i) {
-            ClientCursor* cc = i->second;
-
-            // Note that a valid ClientCursor state is "no cursor no executor."  This is because
-            // the set of active cursor IDs in ClientCursor is used as representation of query
-            // state.  See sharding_block.h.  TODO(greg,hk): Move this out.
-            if (NULL == cc->getExecutor()) {
-                newMap.insert(*i);
-                continue;
-            }
+        if (collectionGoingAway) {
+            // we're going to wipe out the world
+            for (CursorMap::const_iterator i = partition.cursors.begin();
+                 i != partition.cursors.end();
+                 ++i) {
+                ClientCursor* cc = i->second;
 
-            if (cc->isPinned() || cc->isAggCursor()) {
-                // Pinned cursors need to stay alive, so we leave them around.  Aggregation
-                // cursors also can stay alive (since they don't have their lifetime bound to
-                // the underlying collection).  However, if they have an associated executor, we
-                // need to kill it, because it's now invalid.
-                if (cc->getExecutor())
-                    cc->getExecutor()->kill(reason);
-                newMap.insert(*i);
-            } else {
                 cc->kill();
-                delete cc;
+
+                // If the CC is pinned, somebody is actively using it and we do not delete it.
+                // Instead we notify the holder that we killed it.  The holder will then delete the
+                // CC.
+                //
+                // If the CC is not pinned, there is nobody actively holding it.  We can safely
+                // delete it.
+                if (!cc->isPinned()) {
+                    delete cc;
+                }
+            }
+        } else {
+            CursorMap newMap;
+
+            // collection will still be around, just all PlanExecutors are invalid
+            for (CursorMap::const_iterator i = partition.cursors.begin();
+                 i != partition.cursors.end();
+                 ++i) {
+                ClientCursor* cc = i->second;
+
+                // Note that a valid ClientCursor state is "no cursor no executor."  This is
+                // because the set of active cursor IDs in ClientCursor is used as representation
+                // of query state.  See sharding_block.h.  TODO(greg,hk): Move this out.
+                if (NULL == cc->getExecutor()) {
+                    newMap.insert(*i);
+                    continue;
+                }
+
+                if (cc->isPinned() || cc->isAggCursor()) {
+                    // Pinned cursors need to stay alive, so we leave them around.  Aggregation
+                    // cursors also can stay alive (since they don't have their lifetime bound to
+                    // the underlying collection).  However, if they have an associated executor,
+                    // we need to kill it, because it's now invalid.
+                    if (cc->getExecutor())
+                        cc->getExecutor()->kill(reason);
+                    newMap.insert(*i);
+                } else {
+                    cc->kill();
+                    delete cc;
+                }
             }
-        }
 
-        _cursors = newMap;
+            partition.cursors = newMap;
+        }
     }
 }
 
@@ -394,58 +413,73 @@ void CursorManager::invalidateDocument(OperationContext* txn,
         return;
     }
 
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
+    for (auto&& partition : _partitions) {
+        stdx::lock_guard<SimpleMutex> lk(partition.mutex);
 
-    for (ExecSet::iterator it = _nonCachedExecutors.begin(); it != _nonCachedExecutors.end();
-         ++it) {
-        PlanExecutor* exec = *it;
-        exec->invalidate(txn, dl, type);
-    }
-
-    for (CursorMap::const_iterator i = _cursors.begin(); i != _cursors.end(); ++i) {
-        PlanExecutor* exec = i->second->getExecutor();
-        if (exec) {
+        for (ExecSet::iterator it = partition.nonCachedExecutors.begin();
+             it != partition.nonCachedExecutors.end();
+             ++it) {
+            PlanExecutor* exec = *it;
             exec->invalidate(txn, dl, type);
         }
+
+        for (CursorMap::const_iterator i = partition.cursors.begin(); i != partition.cursors.end();
+             ++i) {
+            PlanExecutor* exec = i->second->getExecutor();
+            if (exec) {
+                exec->invalidate(txn, dl, type);
+            }
+        }
     }
 }
 
 std::size_t CursorManager::timeoutCursors(int millisSinceLastCall) {
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
+    std::size_t totalTimedOut = 0;
 
-    vector<ClientCursor*> toDelete;
+    for (auto&& partition : _partitions) {
+        stdx::lock_guard<SimpleMutex> lk(partition.mutex);
 
-    for (CursorMap::const_iterator i = _cursors.begin(); i != _cursors.end(); ++i) {
-        ClientCursor* cc = i->second;
-        if (cc->shouldTimeout(millisSinceLastCall))
-            toDelete.push_back(cc);
-    }
+        vector<ClientCursor*> toDelete;
 
-    for (vector<ClientCursor*>::const_iterator i = toDelete.begin(); i != toDelete.end(); ++i) {
-        ClientCursor* cc = *i;
-        _deregisterCursor_inlock(cc);
-        cc->kill();
-        delete cc;
+        for (CursorMap::const_iterator i = partition.cursors.begin(); i != partition.cursors.end();
+             ++i) {
+            ClientCursor* cc = i->second;
+            if (cc->shouldTimeout(millisSinceLastCall))
+                toDelete.push_back(cc);
+        }
+
+        for (vector<ClientCursor*>::const_iterator i = toDelete.begin(); i != toDelete.end();
+             ++i) {
+            ClientCursor* cc = *i;
+            _deregisterCursor_inlock(&partition, cc);
+            cc->kill();
+            delete cc;
+        }
+
+        totalTimedOut += toDelete.size();
     }
 
-    return toDelete.size();
+    return totalTimedOut;
 }
 
 void CursorManager::registerExecutor(PlanExecutor* exec) {
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
-    const std::pair<ExecSet::iterator, bool> result = _nonCachedExecutors.insert(exec);
+    Partition& partition = _getPartition(exec);
+    stdx::lock_guard<SimpleMutex> lk(partition.mutex);
+    const std::pair<ExecSet::iterator, bool> result = partition.nonCachedExecutors.insert(exec);
     invariant(result.second);  // make sure this was inserted
 }
 
 void CursorManager::deregisterExecutor(PlanExecutor* exec) {
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
-    _nonCachedExecutors.erase(exec);
+    Partition& partition = _getPartition(exec);
+    stdx::lock_guard<SimpleMutex> lk(partition.mutex);
+    partition.nonCachedExecutors.erase(exec);
 }
 
 ClientCursor* CursorManager::find(CursorId id, bool pin) {
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
-    CursorMap::const_iterator it = _cursors.find(id);
-    if (it == _cursors.end())
+    Partition& partition = _getPartition(id);
+    stdx::lock_guard<SimpleMutex> lk(partition.mutex);
+    CursorMap::const_iterator it = partition.cursors.find(id);
+    if (it == partition.cursors.end())
         return NULL;
 
     ClientCursor* cursor = it->second;
@@ -458,7 +492,8 @@ ClientCursor* CursorManager::find(CursorId id, bool pin) {
 }
 
 void CursorManager::unpin(ClientCursor* cursor) {
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
+    Partition& partition = _getPartition(cursor->cursorid());
+    stdx::lock_guard<SimpleMutex> lk(partition.mutex);
 
     invariant(cursor->isPinned());
     cursor->unsetPinned();
@@ -469,50 +504,69 @@ bool CursorManager::ownsCursorId(CursorId cursorId) const {
 }
 
 void CursorManager::getCursorIds(std::set<CursorId>* openCursors) const {
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
+    for (auto&& partition : _partitions) {
+        stdx::lock_guard<SimpleMutex> lk(partition.mutex);
 
-    for (CursorMap::const_iterator i = _cursors.begin(); i != _cursors.end(); ++i) {
-        ClientCursor* cc = i->second;
-        openCursors->insert(cc->cursorid());
+        for (CursorMap::const_iterator i = partition.cursors.begin(); i != partition.cursors.end();
+             ++i) {
+            ClientCursor* cc = i->second;
+            openCursors->insert(cc->cursorid());
+        }
     }
 }
 
 size_t CursorManager::numCursors() const {
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
-    return _cursors.size();
+    size_t total = 0;
+    for (auto&& partition : _partitions) {
+        stdx::lock_guard<SimpleMutex> lk(partition.mutex);
+        total += partition.cursors.size();
+    }
+    return total;
 }
 
-CursorId CursorManager::_allocateCursorId_inlock() {
-    for (int i = 0; i < 10000; i++) {
-        unsigned mypart = static_cast<unsigned>(_random->nextInt32());
-        CursorId id = cursorIdFromParts(_collectionCacheRuntimeId, mypart);
-        if (_cursors.count(id) == 0)
-            return id;
-    }
-    fassertFailed(17360);
+CursorManager::Partition& CursorManager::_getPartition(CursorId id) {
+    // The low bits of a cursor id are randomly generated.
+    return _partitions[static_cast<uint64_t>(id) & (kNumPartitions - 1)];
+}
+
+CursorManager::Partition& CursorManager::_getPartition(PlanExecutor* exec) {
+    // Skip the low bits of the address, which are the same for every executor due to alignment.
+    return _partitions[(reinterpret_cast<uintptr_t>(exec) >> 6) & (kNumPartitions - 1)];
+}
+
+CursorId CursorManager::_generateCursorId() {
+    stdx::lock_guard<SimpleMutex> lk(_randomMutex);
+    unsigned mypart = static_cast<unsigned>(_random->nextInt32());
+    return cursorIdFromParts(_collectionCacheRuntimeId, mypart);
 }
 
 CursorId CursorManager::registerCursor(ClientCursor* cc) {
     invariant(cc);
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
-    CursorId id = _allocateCursorId_inlock();
-    _cursors[id] = cc;
-    return id;
+    for (int i = 0; i < 10000; i++) {
+        CursorId id = _generateCursorId();
+        Partition& partition = _getPartition(id);
+        stdx::lock_guard<SimpleMutex> lk(partition.mutex);
+        if (partition.cursors.insert(std::make_pair(id, cc)).second)
+            return id;
+    }
+    fassertFailed(17360);
 }
 
 void CursorManager::deregisterCursor(ClientCursor* cc) {
-    stdx::lock_guard<SimpleMutex> lk(_mutex);
-    _deregisterCursor_inlock(cc);
+    Partition& partition = _getPartition(cc->cursorid());
+    stdx::lock_guard<SimpleMutex> lk(partition.mutex);
+    _deregisterCursor_inlock(&partition, cc);
 }
 
 Status CursorManager::eraseCursor(OperationContext* txn, CursorId id, bool shouldAudit) {
     ClientCursor* cursor;
 
     {
-        stdx::lock_guard<SimpleMutex> lk(_mutex);
+        Partition& partition = _getPartition(id);
+        stdx::lock_guard<SimpleMutex> lk(partition.mutex);
 
-        CursorMap::iterator it = _cursors.find(id);
-        if (it == _cursors.end()) {
+        CursorMap::iterator it = partition.cursors.find(id);
+        if (it == partition.cursors.end()) {
             if (shouldAudit) {
                 audit::logKillCursorsAuthzCheck(
                     txn->getClient(), _nss, id, ErrorCodes::CursorNotFound);
@@ -536,21 +590,21 @@ Status CursorManager::eraseCursor(OperationContext* txn, CursorId id, bool shoul
         }
 
         cursor->kill();
-        _deregisterCursor_inlock(cursor);
+        _deregisterCursor_inlock(&partition, cursor);
     }
 
     // If 'cursor' represents an aggregation cursor, then the destructor of the ClientCursor will
     // eventually cause the destructor of the underlying PlanExecutor to be called. Since the
     // underlying PlanExecutor is also registered on this CursorManager, we must destruct 'cursor'
-    // without holding '_mutex' so that it's possible to call CursorManager::deregisterCursor()
-    // without deadlocking ourselves.
+    // without holding the partition mutex so that it's possible to call
+    // CursorManager::deregisterCursor() without deadlocking ourselves.
     delete cursor;
     return Status::OK();
 }
 
-void CursorManager::_deregisterCursor_inlock(ClientCursor* cc) {
+void CursorManager::_deregisterCursor_inlock(Partition* partition, ClientCursor* cc) {
     invariant(cc);
     CursorId id = cc->cursorid();
-    _cursors.erase(id);
+    partition->cursors.erase(id);
 }
 }
@@ -31,6 +31,8 @@
 #pragma once
 
 
+#include <array>
+
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/invalidation_type.h"
 #include "mongo/db/namespace_string.h"
@@ -44,6 +46,16 @@ class OperationContext;
 class PseudoRandom;
 class PlanExecutor;
 
+/**
+ * Registry of the ClientCursors and non-cached PlanExecutors for one collection, plus a global
+ * instance for cursors which are not tied to a collection.
+ *
+ * The registry is split into a fixed number of partitions, each with its own mutex. A cursor lives
+ * in the partition selected by the low bits of its id and an executor in the partition selected
+ * by its address, so that operations on a single cursor (such as pinning it for a getMore) only
+ * contend with other operations in the same partition. Operations over the whole registry visit
+ * the partitions one at a time, except for invalidateAll(), which holds every partition's mutex.
+ */
 class CursorManager {
 public:
     CursorManager(StringData ns);
@@ -143,19 +155,31 @@ public:
     static std::size_t timeoutCursorsGlobal(OperationContext* txn, int millisSinceLastCall);
 
 private:
-    CursorId _allocateCursorId_inlock();
-    void _deregisterCursor_inlock(ClientCursor* cc);
+    typedef unordered_set<PlanExecutor*> ExecSet;
+    typedef std::map<CursorId, ClientCursor*> CursorMap;
+
+    // Must be a power of two.
+    static const size_t kNumPartitions = 16;
+
+    struct Partition {
+        mutable SimpleMutex mutex;
+        ExecSet nonCachedExecutors;
+        CursorMap cursors;
+    };
+
+    Partition& _getPartition(CursorId id);
+    Partition& _getPartition(PlanExecutor* exec);
+
+    CursorId _generateCursorId();
+    static void _deregisterCursor_inlock(Partition* partition, ClientCursor* cc);
 
     NamespaceString _nss;
     unsigned _collectionCacheRuntimeId;
-    std::unique_ptr<PseudoRandom> _random;
-
-    mutable SimpleMutex _mutex;
 
-    typedef unordered_set<PlanExecutor*> ExecSet;
-    ExecSet _nonCachedExecutors;
+    // Protects '_random'.
+    SimpleMutex _randomMutex;
+    std::unique_ptr<PseudoRandom> _random;
 
-    typedef std::map<CursorId, ClientCursor*> CursorMap;
-    CursorMap _cursors;
+    std::array<Partition, kNumPartitions> _partitions;
 };
 }
@@ -30,6 +30,7 @@
 
 #include "mongo/platform/basic.h"
 
+#include <algorithm>
 #include <deque>
 #include <vector>
 
@@ -56,6 +57,7 @@
 #include "mongo/db/query/find_common.h"
 #include "mongo/db/query/get_executor.h"
 #include "mongo/db/query/plan_summary_stats.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/storage/storage_options.h"
 #include "mongo/db/views/view.h"
@@ -325,6 +327,12 @@ public:
         // Set up the ExpressionContext.
         intrusive_ptr<ExpressionContext> expCtx = new ExpressionContext(txn, request.getValue());
         expCtx->tempDir = storageGlobalParams.dbpath + "/_tmp";
+        expCtx->compileExpressions = request.getValue().getCompileExpressions().value_or(
+            internalQueryCompileAggregationExpressions.load());
+        expCtx->parallelism = request.getValue().getParallelism().value_or(
+            std::max(1,
+                     std::min(internalQueryAggregationParallelism.load(),
+                              AggregationRequest::kMaxParallelism)));
 
         // Parse the pipeline.
         auto statusWithPipeline = Pipeline::parse(request.getValue().getPipeline(), expCtx);
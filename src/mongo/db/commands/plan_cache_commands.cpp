@@ -245,6 +245,15 @@ Status PlanCacheListQueryShapes::runPlanCacheCommand(OperationContext* txn,
                                                      const string& ns,
                                                      BSONObj& cmdObj,
                                                      BSONObjBuilder* bob) {
+    bool includeStats = false;
+    BSONElement statsElt = cmdObj.getField("stats");
+    if (!statsElt.eoo()) {
+        if (!statsElt.isBoolean()) {
+            return Status(ErrorCodes::BadValue, "stats must be a boolean");
+        }
+        includeStats = statsElt.Bool();
+    }
+
     // This is a read lock. The query cache is owned by the collection.
     AutoGetCollectionForRead ctx(txn, ns);
 
@@ -256,11 +265,13 @@ Status PlanCacheListQueryShapes::runPlanCacheCommand(OperationContext* txn,
         arrayBuilder.doneFast();
         return Status::OK();
     }
-    return list(*planCache, bob);
+    return list(*planCache, bob, includeStats);
 }
 
 // static
-Status PlanCacheListQueryShapes::list(const PlanCache& planCache, BSONObjBuilder* bob) {
+Status PlanCacheListQueryShapes::list(const PlanCache& planCache,
+                                      BSONObjBuilder* bob,
+                                      bool includeStats) {
     invariant(bob);
 
     // Fetch all cached solutions from plan cache.
@@ -278,6 +289,15 @@ Status PlanCacheListQueryShapes::list(const PlanCache& planCache, BSONObjBuilder
         if (!entry->collation.isEmpty()) {
             shapeBuilder.append("collation", entry->collation);
         }
+        if (includeStats) {
+            BSONObjBuilder statsBuilder(shapeBuilder.subobjStart("stats"));
+            statsBuilder.appendNumber("hits", entry->counters.hits);
+            statsBuilder.appendNumber("misses", entry->counters.misses);
+            statsBuilder.appendNumber("evictions", entry->counters.evictions);
+            statsBuilder.appendNumber("estimatedSizeBytes",
+                                      static_cast<long long>(entry->estimatedSizeBytes));
+            statsBuilder.doneFast();
+        }
         shapeBuilder.doneFast();
 
         // Release resources for cached solution after extracting query shape.
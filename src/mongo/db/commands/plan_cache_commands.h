@@ -106,8 +106,10 @@ private:
 /**
  * planCacheListQueryShapes
  *
- * { planCacheListQueryShapes: <collection> }
+ * { planCacheListQueryShapes: <collection>, stats: <bool> }
  *
+ * If 'stats' is true, each shape also reports its hit, miss and eviction counts and the
+ * estimated size of its cache entry.
  */
 class PlanCacheListQueryShapes : public PlanCacheCommand {
 public:
@@ -119,9 +121,11 @@ public:
 
     /**
      * Looks up cache keys for collection's plan cache.
-     * Inserts keys for query into BSON builder.
+     * Inserts keys for query into BSON builder, with the per-shape counters if 'includeStats'.
      */
-    static Status list(const PlanCache& planCache, BSONObjBuilder* bob);
+    static Status list(const PlanCache& planCache,
+                       BSONObjBuilder* bob,
+                       bool includeStats = false);
 };
 
 /**
@@ -48,53 +48,6 @@ using std::string;
 
 namespace {
 const int kMaxPerfThreads = 16;  // max number of threads to use for lock perf
-const int kMinPerfMillis = 30;   // min duration for reliable timing
-
-/**
- * Calls fn the given number of iterations, spread out over up to maxThreads threads.
- * The threadNr passed is an integer between 0 and maxThreads exclusive. Logs timing
- * statistics for for all power-of-two thread counts from 1 up to maxThreds.
- */
-void perfTest(stdx::function<void(int threadNr)> fn, int maxThreads) {
-    for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
-        std::vector<stdx::thread> threads;
-
-        AtomicInt32 ready{0};
-        AtomicInt64 elapsedNanos{0};
-        AtomicInt64 timedIters{0};
-
-        for (int threadId = 0; threadId < numThreads; threadId++)
-            threads.emplace_back([&, threadId]() {
-                // Busy-wait until everybody is ready
-                ready.fetchAndAdd(1);
-                while (ready.load() < numThreads) {
-                }
-
-                uint64_t micros = 0;
-                int iters;
-                // Ensure at least 16 iterations are done and at least 25 milliseconds is timed
-                for (iters = 16; iters < (1 << 30) && micros < kMinPerfMillis * 1000; iters *= 2) {
-                    // Measure the number of loops
-                    Timer t;
-
-                    for (int i = 0; i < iters; i++)
-                        fn(threadId);
-
-                    micros = t.micros();
-                }
-
-                elapsedNanos.fetchAndAdd(micros * 1000);
-                timedIters.fetchAndAdd(iters);
-            });
-
-        for (auto& thread : threads)
-            thread.join();
-
-        log() << numThreads
-              << " threads took: " << elapsedNanos.load() / static_cast<double>(timedIters.load())
-              << " ns per call" << (kDebugBuild ? " (DEBUG BUILD!)" : "");
-    }
-}
 }  // namespace
 
 TEST(DConcurrency, ResourceMutex) {
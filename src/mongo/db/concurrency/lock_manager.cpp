@@ -32,10 +32,13 @@
 
 #include "mongo/db/concurrency/lock_manager.h"
 
+#include <algorithm>
+
 #include "mongo/base/simple_string_data_comparator.h"
 #include "mongo/bson/bsonobjbuilder.h"
 #include "mongo/config.h"
 #include "mongo/db/concurrency/locker.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/log.h"
 #include "mongo/util/stringutils.h"
@@ -412,14 +415,33 @@ void LockHead::migratePartitionedLockHeads() {
 // LockManager
 //
 
-// Have more buckets than CPUs to reduce contention on lock and caches
-const unsigned LockManager::_numLockBuckets(128);
+namespace {
+
+/**
+ * Returns the smallest power of two which is at least 'minimum' and at least 'perCore' times the
+ * number of cores, up to a maximum of 1024.
+ */
+unsigned scaleToCores(unsigned minimum, unsigned perCore) {
+    // The global LockManager is constructed before the initializers run, so ask the standard
+    // library for the number of cores rather than ProcessInfo.
+    const unsigned target =
+        std::min(1024U, std::max(minimum, perCore * stdx::thread::hardware_concurrency()));
+    unsigned result = 1;
+    while (result < target) {
+        result <<= 1;
+    }
+    return result;
+}
 
-// Balance scalability of intent locks against potential added cost of conflicting locks.
-// The exact value doesn't appear very important, but should be power of two
-const unsigned LockManager::_numPartitions = 32;
+}  // namespace
 
-LockManager::LockManager() {
+LockManager::LockManager()
+    // Have more buckets than CPUs to reduce contention on lock and caches
+    : _numLockBuckets(scaleToCores(128, 4)),
+      // Balance scalability of intent locks against potential added cost of conflicting locks,
+      // which have to visit every partition used for the resource. With at least two partitions
+      // per core, concurrently running lockers rarely share one.
+      _numPartitions(scaleToCores(32, 2)) {
     _lockBuckets = new LockBucket[_numLockBuckets];
     _partitions = new Partition[_numPartitions];
 }
@@ -808,7 +830,7 @@ LockManager::LockBucket* LockManager::_getBucket(ResourceId resId) const {
 }
 
 LockManager::Partition* LockManager::_getPartition(LockRequest* request) const {
-    return &_partitions[request->locker->getId() % _numPartitions];
+    return &_partitions[request->locker->getId() & (_numPartitions - 1)];
 }
 
 void LockManager::dump() const {
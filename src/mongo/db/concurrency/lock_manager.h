@@ -156,6 +156,10 @@ private:
         typedef unordered_map<ResourceId, PartitionedLockHead*> Map;
         SimpleMutex mutex;
         Map data;
+
+        // Partitions are used by unrelated lockers, so keep the mutex of one partition off the
+        // cache line holding the previous partition's map.
+        char padding[64];
     };
 
     /**
@@ -211,10 +215,11 @@ private:
      */
     void _cleanupUnusedLocksInBucket(LockBucket* bucket);
 
-    static const unsigned _numLockBuckets;
+    // Both are powers of two, chosen from the number of cores when the LockManager is created.
+    const unsigned _numLockBuckets;
     LockBucket* _lockBuckets;
 
-    static const unsigned _numPartitions;
+    const unsigned _numPartitions;
     Partition* _partitions;
 };
 
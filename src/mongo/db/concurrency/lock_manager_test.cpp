@@ -26,8 +26,15 @@
  *    it in the license file.
  */
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include "mongo/db/concurrency/lock_manager_test_help.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/debug_util.h"
 
 namespace mongo {
 
@@ -932,4 +939,129 @@ TEST(LockManager, Fairness) {
     ASSERT(lockMgr.unlock(&requestIX1));
 }
 
+TEST(LockManager, ConflictingRequestWaitsForIntentLocksFromAllPartitions) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    // Enough lockers to use many different partitions.
+    const int kNumLockers = 200;
+    std::vector<std::unique_ptr<MMAPV1LockerImpl>> lockers;
+    std::vector<std::unique_ptr<LockRequestCombo>> requests;
+    for (int i = 0; i < kNumLockers; i++) {
+        lockers.push_back(stdx::make_unique<MMAPV1LockerImpl>());
+        requests.push_back(stdx::make_unique<LockRequestCombo>(lockers.back().get()));
+        ASSERT(LOCK_OK ==
+               lockMgr.lock(resId, requests.back().get(), (i % 2) ? MODE_IS : MODE_IX));
+    }
+
+    MMAPV1LockerImpl lockerX;
+    LockRequestCombo requestX(&lockerX);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestX, MODE_X));
+
+    // The X request is granted once the last intent lock, wherever it was granted, is released.
+    for (int i = 0; i < kNumLockers; i++) {
+        ASSERT_EQ(0, requestX.numNotifies);
+        ASSERT(lockMgr.unlock(requests[i].get()));
+    }
+    ASSERT_EQ(1, requestX.numNotifies);
+    ASSERT_EQ(LOCK_OK, requestX.lastResult);
+
+    // Intent locks wait behind the X lock, and may be partitioned again once it is released.
+    LockRequestCombo requestIS(lockers[0].get());
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestIS, MODE_IS));
+    ASSERT(lockMgr.unlock(&requestX));
+    ASSERT_EQ(LOCK_OK, requestIS.lastResult);
+
+    LockRequestCombo requestIX(lockers[1].get());
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestIX, MODE_IX));
+    ASSERT(lockMgr.unlock(&requestIX));
+    ASSERT(lockMgr.unlock(&requestIS));
+}
+
+// These tests measure how the lock manager scales when many threads acquire intent locks on the
+// same global and database resources, as every read and write operation does. It is neither
+// practical nor useful to run them on debug builds, so they return early there.
+namespace {
+int maxPerfThreads() {
+    return std::max(16, 2 * static_cast<int>(stdx::thread::hardware_concurrency()));
+}
+
+void lockManagerIntentPerfTest(LockMode globalMode, LockMode dbMode) {
+    if (kDebugBuild) {
+        return;
+    }
+
+    const int maxThreads = maxPerfThreads();
+    const ResourceId globalId(RESOURCE_GLOBAL, ResourceId::SINGLETON_GLOBAL);
+    const ResourceId dbId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    LockManager lockMgr;
+    std::vector<std::unique_ptr<MMAPV1LockerImpl>> lockers;
+    for (int i = 0; i < maxThreads; i++) {
+        lockers.push_back(stdx::make_unique<MMAPV1LockerImpl>());
+    }
+
+    perfTest(
+        [&](int threadId) {
+            TrackingLockGrantNotification notify;
+            LockRequest globalRequest;
+            LockRequest dbRequest;
+            globalRequest.initNew(lockers[threadId].get(), &notify);
+            dbRequest.initNew(lockers[threadId].get(), &notify);
+            invariant(LOCK_OK == lockMgr.lock(globalId, &globalRequest, globalMode));
+            invariant(LOCK_OK == lockMgr.lock(dbId, &dbRequest, dbMode));
+            lockMgr.unlock(&dbRequest);
+            lockMgr.unlock(&globalRequest);
+        },
+        maxThreads);
+}
+}  // namespace
+
+TEST(LockManager, PerformanceIntentSharedLocks) {
+    lockManagerIntentPerfTest(MODE_IS, MODE_IS);
+}
+
+TEST(LockManager, PerformanceIntentExclusiveLocks) {
+    lockManagerIntentPerfTest(MODE_IX, MODE_IX);
+}
+
+TEST(LockManager, PerformanceIntentLocksWithOccasionalConflicts) {
+    if (kDebugBuild) {
+        return;
+    }
+
+    const int maxThreads = maxPerfThreads();
+    const ResourceId globalId(RESOURCE_GLOBAL, ResourceId::SINGLETON_GLOBAL);
+    const ResourceId dbId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    LockManager lockMgr;
+    std::vector<std::unique_ptr<MMAPV1LockerImpl>> lockers;
+    for (int i = 0; i < maxThreads; i++) {
+        lockers.push_back(stdx::make_unique<MMAPV1LockerImpl>());
+    }
+
+    // Thread 0 takes the database lock in S mode every 64th time, which migrates all the
+    // partitioned intent locks on it back to its LockHead. The S mode does not conflict with the
+    // IS mode of the other threads, so nobody has to wait.
+    int conflictCountdown = 64;
+    perfTest(
+        [&](int threadId) {
+            const bool conflicting = threadId == 0 && --conflictCountdown == 0;
+            if (conflicting) {
+                conflictCountdown = 64;
+            }
+
+            TrackingLockGrantNotification notify;
+            LockRequest globalRequest;
+            LockRequest dbRequest;
+            globalRequest.initNew(lockers[threadId].get(), &notify);
+            dbRequest.initNew(lockers[threadId].get(), &notify);
+            invariant(LOCK_OK == lockMgr.lock(globalId, &globalRequest, MODE_IS));
+            invariant(LOCK_OK == lockMgr.lock(dbId, &dbRequest, conflicting ? MODE_S : MODE_IS));
+            lockMgr.unlock(&dbRequest);
+            lockMgr.unlock(&globalRequest);
+        },
+        maxThreads);
+}
+
 }  // namespace mongo
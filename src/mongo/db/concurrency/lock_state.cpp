@@ -255,6 +255,29 @@ void CondVarLockGrantNotification::notify(ResourceId resId, LockResult result) {
 
 namespace {
 TicketHolder* ticketHolders[LockModesCount] = {};
+TicketHolder* priorityTicketHolder = nullptr;
+
+// How often a locker with ticket priority, waiting for a priority ticket, checks whether a ticket
+// of its regular pool has been released.
+const Milliseconds kPriorityTicketPollPeriod(1);
+
+/**
+ * Takes a ticket from 'holder', or for lockers with ticket priority, from the priority pool when
+ * 'holder' has none left. If both pools are exhausted, takes the first ticket released to either
+ * of them. Returns the pool the ticket came from.
+ */
+TicketHolder* acquireTicket(TicketHolder* holder, bool hasPriority) {
+    if (hasPriority && priorityTicketHolder) {
+        while (!holder->tryAcquire()) {
+            if (priorityTicketHolder->waitForTicketUntil(Date_t::now() + kPriorityTicketPollPeriod))
+                return priorityTicketHolder;
+        }
+        return holder;
+    }
+
+    holder->waitForTicket();
+    return holder;
+}
 }  // namespace
 
 
@@ -263,10 +286,13 @@ TicketHolder* ticketHolders[LockModesCount] = {};
 //
 
 /* static */
-void Locker::setGlobalThrottling(class TicketHolder* reading, class TicketHolder* writing) {
+void Locker::setGlobalThrottling(class TicketHolder* reading,
+                                 class TicketHolder* writing,
+                                 class TicketHolder* priority) {
     ticketHolders[MODE_S] = reading;
     ticketHolders[MODE_IS] = reading;
     ticketHolders[MODE_IX] = writing;
+    priorityTicketHolder = priority;
 }
 
 template <bool IsForMMAPV1>
@@ -314,7 +340,7 @@ LockResult LockerImpl<IsForMMAPV1>::lockGlobalBegin(LockMode mode) {
         auto holder = ticketHolders[mode];
         if (holder) {
             _clientState.store(reader ? kQueuedReader : kQueuedWriter);
-            holder->waitForTicket();
+            _ticketHolder = acquireTicket(holder, _hasTicketPriority);
         }
         _clientState.store(reader ? kActiveReader : kActiveWriter);
         _modeForTicket = mode;
@@ -802,10 +828,10 @@ bool LockerImpl<IsForMMAPV1>::_unlockImpl(LockRequestsMap::Iterator* it) {
     if (globalLockManager.unlock(it->objAddr())) {
         if (it->key() == resourceIdGlobal) {
             invariant(_modeForTicket != MODE_NONE);
-            auto holder = ticketHolders[_modeForTicket];
             _modeForTicket = MODE_NONE;
-            if (holder) {
-                holder->release();
+            if (_ticketHolder) {
+                _ticketHolder->release();
+                _ticketHolder = nullptr;
             }
             _clientState.store(kInactive);
         }
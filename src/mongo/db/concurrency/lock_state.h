@@ -37,6 +37,8 @@
 
 namespace mongo {
 
+class TicketHolder;
+
 /**
  * Notfication callback, which stores the last notification result and signals a condition
  * variable, which can be waited on.
@@ -99,6 +101,14 @@ public:
         return _id;
     }
 
+    virtual void setTicketPriority(bool hasPriority) {
+        _hasTicketPriority = hasPriority;
+    }
+
+    virtual bool hasTicketPriority() const {
+        return _hasTicketPriority;
+    }
+
     virtual LockResult lockGlobal(LockMode mode, unsigned timeoutMs = UINT_MAX);
     virtual LockResult lockGlobalBegin(LockMode mode);
     virtual LockResult lockGlobalComplete(unsigned timeoutMs);
@@ -220,6 +230,11 @@ private:
     // Mode for which the Locker acquired a ticket, or MODE_NONE if no ticket was acquired.
     LockMode _modeForTicket = MODE_NONE;
 
+    // Pool the ticket was taken from, which for lockers with ticket priority may be the priority
+    // pool rather than the one for _modeForTicket. Null if no ticket is held.
+    TicketHolder* _ticketHolder = nullptr;
+    bool _hasTicketPriority = false;
+
     // Indicates whether the client is active reader/writer or is queued.
     AtomicWord<ClientState> _clientState{kInactive};
 
@@ -35,8 +35,11 @@
 
 #include "mongo/config.h"
 #include "mongo/db/concurrency/lock_manager_test_help.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/log.h"
+#include "mongo/util/time_support.h"
 #include "mongo/util/timer.h"
 
 namespace mongo {
@@ -296,4 +299,74 @@ TEST(LockerImpl, CanceledDeadlockUnblocks) {
     ASSERT(locker2.unlockGlobal());
     ASSERT(locker3.unlockGlobal());
 }
+
+TEST(LockerImpl, PriorityLockerUsesPriorityTicketsWhenPoolIsExhausted) {
+    TicketHolder reading(1);
+    TicketHolder writing(1);
+    TicketHolder priority(1);
+    Locker::setGlobalThrottling(&reading, &writing, &priority);
+
+    DefaultLockerImpl user;
+    DefaultLockerImpl internal;
+    internal.setTicketPriority(true);
+
+    // The regular pool is free, so the internal locker does not touch the priority pool.
+    ASSERT(LOCK_OK == internal.lockGlobal(MODE_IS));
+    ASSERT_EQ(reading.used(), 1);
+    ASSERT_EQ(priority.used(), 0);
+    ASSERT(internal.unlockGlobal());
+
+    // With the regular pool exhausted by the user, the internal locker gets a priority ticket.
+    ASSERT(LOCK_OK == user.lockGlobal(MODE_IS));
+    ASSERT(LOCK_OK == internal.lockGlobal(MODE_IS));
+    ASSERT_EQ(reading.used(), 1);
+    ASSERT_EQ(priority.used(), 1);
+
+    // Tickets go back to the pool they came from.
+    ASSERT(internal.unlockGlobal());
+    ASSERT_EQ(priority.used(), 0);
+    ASSERT(user.unlockGlobal());
+    ASSERT_EQ(reading.used(), 0);
+
+    Locker::setGlobalThrottling(nullptr, nullptr);
+}
+
+TEST(LockerImpl, PriorityLockerTakesRegularTicketReleasedWhilePriorityPoolIsExhausted) {
+    TicketHolder reading(1);
+    TicketHolder writing(1);
+    TicketHolder priority(1);
+    Locker::setGlobalThrottling(&reading, &writing, &priority);
+
+    DefaultLockerImpl user;
+    DefaultLockerImpl internal1;
+    DefaultLockerImpl internal2;
+    internal1.setTicketPriority(true);
+    internal2.setTicketPriority(true);
+
+    // Exhaust both the regular and the priority pool.
+    ASSERT(LOCK_OK == user.lockGlobal(MODE_IS));
+    ASSERT(LOCK_OK == internal1.lockGlobal(MODE_IS));
+    ASSERT_EQ(priority.used(), 1);
+
+    LockResult result = LOCK_INVALID;
+    stdx::thread waiter([&] { result = internal2.lockGlobal(MODE_IS); });
+    while (internal2.getClientState() != Locker::kQueuedReader) {
+        sleepmillis(1);
+    }
+
+    // The waiting locker picks up the regular ticket even though the priority pool stays
+    // exhausted.
+    ASSERT(user.unlockGlobal());
+    waiter.join();
+    ASSERT(LOCK_OK == result);
+    ASSERT_EQ(reading.used(), 1);
+    ASSERT_EQ(priority.used(), 1);
+
+    ASSERT(internal2.unlockGlobal());
+    ASSERT(internal1.unlockGlobal());
+    ASSERT_EQ(reading.used(), 0);
+    ASSERT_EQ(priority.used(), 0);
+
+    Locker::setGlobalThrottling(nullptr, nullptr);
+}
 }  // namespace mongo
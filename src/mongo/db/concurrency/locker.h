@@ -54,8 +54,22 @@ public:
      * for MODE_X, as there can only ever be a single locker using this mode. The throttling is
      * intended to defend against arge drops in throughput under high load due to too much
      * concurrency.
+     *
+     * If 'priority' is not null, lockers with ticket priority which find their regular pool
+     * exhausted wait for a ticket from 'priority' instead, so internal work is not queued behind
+     * user operations.
+     */
+    static void setGlobalThrottling(class TicketHolder* reading,
+                                    class TicketHolder* writing,
+                                    class TicketHolder* priority = nullptr);
+
+    /**
+     * Marks this locker as running work for the server itself (replication, balancing, ...)
+     * rather than for a user, which makes it eligible for the priority ticket pool. Takes effect
+     * on the next acquisition of the global lock.
      */
-    static void setGlobalThrottling(class TicketHolder* reading, class TicketHolder* writing);
+    virtual void setTicketPriority(bool hasPriority) = 0;
+    virtual bool hasTicketPriority() const = 0;
 
     /**
      * State for reporting the number of active and queued reader and writer clients.
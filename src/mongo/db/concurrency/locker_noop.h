@@ -49,6 +49,12 @@ public:
         invariant(false);
     }
 
+    virtual void setTicketPriority(bool hasPriority) {}
+
+    virtual bool hasTicketPriority() const {
+        return false;
+    }
+
     virtual LockResult lockGlobal(LockMode mode, unsigned timeoutMs) {
         invariant(false);
     }
@@ -32,6 +32,7 @@
 
 #include "mongo/db/index/btree_access_method.h"
 
+#include <deque>
 #include <utility>
 #include <vector>
 
@@ -46,7 +47,13 @@
 #include "mongo/db/repl/replication_coordinator.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/storage_options.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/util/concurrency/thread_name.h"
 #include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
 #include "mongo/util/progress_meter.h"
 
 namespace mongo {
@@ -68,8 +75,67 @@ bool isMultikeyFromPaths(const MultikeyPaths& multikeyPaths) {
                        [](const std::set<std::size_t>& components) { return !components.empty(); });
 }
 
+// Block compression for the files index builds spill their sorted keys to.
+std::string indexBuildSpillCompressor = "snappy";
+
+StatusWith<SorterSpillCompressor> parseSpillCompressor(const std::string& name) {
+    if (name == "snappy") {
+        return SorterSpillCompressor::kSnappy;
+    } else if (name == "zlib") {
+        return SorterSpillCompressor::kZlib;
+    } else if (name == "none") {
+        return SorterSpillCompressor::kNone;
+    }
+    return {ErrorCodes::BadValue,
+            str::stream() << "indexBuildSpillCompressor must be one of 'snappy', 'zlib' or 'none', "
+                          << "not '"
+                          << name
+                          << "'"};
+}
+
+class ExportedIndexBuildSpillCompressorParameter
+    : public ExportedServerParameter<std::string, ServerParameterType::kStartupOnly> {
+public:
+    ExportedIndexBuildSpillCompressorParameter()
+        : ExportedServerParameter<std::string, ServerParameterType::kStartupOnly>(
+              ServerParameterSet::getGlobal(),
+              "indexBuildSpillCompressor",
+              &indexBuildSpillCompressor) {}
+
+    virtual Status validate(const std::string& potentialNewValue) {
+        return parseSpillCompressor(potentialNewValue).getStatus();
+    }
+} exportedIndexBuildSpillCompressorParam;
+
+class ExportedIndexBuildKeyGenerationThreadsParameter
+    : public ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime> {
+public:
+    ExportedIndexBuildKeyGenerationThreadsParameter()
+        : ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime>(
+              ServerParameterSet::getGlobal(),
+              "indexBuildKeyGenerationThreads",
+              &indexBuildKeyGenerationThreads) {}
+
+    virtual Status validate(const int& potentialNewValue) {
+        if (potentialNewValue < 1 || potentialNewValue > 64) {
+            return Status(ErrorCodes::BadValue,
+                          "indexBuildKeyGenerationThreads must be between 1 and 64");
+        }
+
+        return Status::OK();
+    }
+} exportedIndexBuildKeyGenerationThreadsParam;
+
+// Memory budget for the external sort of a bulk index build, shared by all its key generation
+// threads.
+const size_t kBulkBuildMaxMemoryUsageBytes = 100 * 1024 * 1024;
+
 }  // namespace
 
+// Number of threads generating and sorting keys in a bulk index build. With a value of 1, keys are
+// generated on the thread scanning the collection.
+std::atomic<int> indexBuildKeyGenerationThreads(1);  // NOLINT
+
 MONGO_EXPORT_SERVER_PARAMETER(failIndexKeyTooLong, bool, true);
 
 //
@@ -391,55 +457,313 @@ Status IndexAccessMethod::compact(OperationContext* txn) {
     return this->_newInterface->compact(txn);
 }
 
+namespace {
+
+SortOptions makeBulkSortOptions(size_t maxMemoryUsageBytes,
+                                std::shared_ptr<SorterFileStats> spillStats) {
+    return SortOptions()
+        .TempDir(storageGlobalParams.dbpath + "/_tmp")
+        .ExtSortAllowed()
+        .MaxMemoryUsageBytes(maxMemoryUsageBytes)
+        .SpillCompressor(uassertStatusOK(parseSpillCompressor(indexBuildSpillCompressor)))
+        .FileStats(std::move(spillStats));
+}
+
+}  // namespace
+
+/**
+ * The thread scanning the collection copies documents into batches, which are queued for a fixed
+ * pool of worker threads. Any worker takes the next batch, generates its keys and adds them to
+ * a Sorter owned by that worker. Once the scan is done, the sorted output of all the workers is
+ * k-way merged into a single stream for the bulk loader.
+ *
+ * Since keys are ordered by (key, RecordId), the merged stream is the same no matter how the
+ * documents were spread over the workers.
+ */
+class IndexAccessMethod::BulkBuilder::KeyGenerationWorkers {
+    MONGO_DISALLOW_COPYING(KeyGenerationWorkers);
+
+public:
+    KeyGenerationWorkers(const BulkBuilder* bulk,
+                         const IndexDescriptor* descriptor,
+                         int numThreads)
+        : _bulk(bulk),
+          _comparator(descriptor->keyPattern(), descriptor->version()),
+          _maxQueuedBatches(2 * numThreads) {
+        const size_t maxMemoryUsageBytes = kBulkBuildMaxMemoryUsageBytes / numThreads;
+        for (int i = 0; i < numThreads; i++) {
+            auto worker = stdx::make_unique<Worker>();
+            worker->spillStats = std::make_shared<SorterFileStats>();
+            worker->sortOptions = makeBulkSortOptions(maxMemoryUsageBytes, worker->spillStats);
+            worker->sorter.reset(Sorter::make(worker->sortOptions, _comparator));
+            _workers.push_back(std::move(worker));
+        }
+
+        for (size_t i = 0; i < _workers.size(); i++) {
+            Worker* worker = _workers[i].get();
+            worker->thread = stdx::thread([this, worker, i] {
+                setThreadName(std::string(str::stream() << "indexKeyGen-" << i));
+                _run(worker);
+            });
+        }
+    }
+
+    ~KeyGenerationWorkers() {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _noMoreBatches = true;
+            if (_status.isOK()) {
+                // Abandoned before finish(), so don't bother with the remaining batches.
+                _status = Status(ErrorCodes::Interrupted, "index build abandoned");
+            }
+        }
+        _workAvailable.notify_all();
+        _joinAll();
+    }
+
+    /**
+     * Queues a copy of 'obj' for key generation. Blocks while the workers are too far behind.
+     * Returns the error of the first worker which failed, if any.
+     */
+    Status add(const BSONObj& obj, const RecordId& loc) {
+        _batchBytes += obj.objsize();
+        _batch.emplace_back(obj.getOwned(), loc);
+
+        if (_batch.size() < kMaxBatchDocs && _batchBytes < kMaxBatchBytes) {
+            return Status::OK();
+        }
+        return _queueBatch();
+    }
+
+    /**
+     * Queues the last batch, waits for all the keys to be generated and returns an iterator
+     * merging the output of the workers. Folds the per-worker counters into 'bulk'.
+     */
+    StatusWith<Sorter::Iterator*> finish(BulkBuilder* bulk) {
+        if (!_batch.empty()) {
+            Status status = _queueBatch();
+            if (!status.isOK()) {
+                return status;
+            }
+        }
+
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _noMoreBatches = true;
+        }
+        _workAvailable.notify_all();
+        _joinAll();
+
+        if (!_status.isOK()) {
+            return _status;
+        }
+
+        std::vector<std::shared_ptr<Sorter::Iterator>> iterators;
+        for (auto&& worker : _workers) {
+            bulk->_keysInserted += worker->keysInserted;
+            bulk->_everGeneratedMultipleKeys =
+                bulk->_everGeneratedMultipleKeys || worker->everGeneratedMultipleKeys;
+            _mergeMultikeyPaths(worker->indexMultikeyPaths, &bulk->_indexMultikeyPaths);
+
+            iterators.push_back(std::shared_ptr<Sorter::Iterator>(worker->sorter->done()));
+            worker->sorter.reset();
+        }
+
+        return Sorter::Iterator::merge(iterators, _workers.front()->sortOptions, _comparator);
+    }
+
+    /**
+     * Adds the spill statistics of all the workers to 'stats'. The spill files are read back by
+     * the merged iterator, so this should only be called once it is exhausted.
+     */
+    void addSpillStats(SorterFileStats* stats) const {
+        for (auto&& worker : _workers) {
+            stats->blocksWritten += worker->spillStats->blocksWritten;
+            stats->bytesSpilled += worker->spillStats->bytesSpilled;
+            stats->bytesWritten += worker->spillStats->bytesWritten;
+            stats->bytesRead += worker->spillStats->bytesRead;
+        }
+    }
+
+private:
+    using Batch = std::vector<std::pair<BSONObj, RecordId>>;
+
+    struct Worker {
+        std::shared_ptr<SorterFileStats> spillStats;
+        SortOptions sortOptions;
+        std::unique_ptr<Sorter> sorter;
+        int64_t keysInserted = 0;
+        bool everGeneratedMultipleKeys = false;
+        MultikeyPaths indexMultikeyPaths;
+        stdx::thread thread;
+    };
+
+    static const size_t kMaxBatchDocs = 1000;
+    static const size_t kMaxBatchBytes = 1024 * 1024;
+
+    static void _mergeMultikeyPaths(const MultikeyPaths& from, MultikeyPaths* into) {
+        if (from.empty()) {
+            return;
+        }
+        if (into->empty()) {
+            *into = from;
+            return;
+        }
+        invariant(into->size() == from.size());
+        for (size_t i = 0; i < from.size(); ++i) {
+            (*into)[i].insert(from[i].begin(), from[i].end());
+        }
+    }
+
+    Status _queueBatch() {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _spaceAvailable.wait(
+            lk, [this] { return !_status.isOK() || _queue.size() < _maxQueuedBatches; });
+        if (!_status.isOK()) {
+            return _status;
+        }
+
+        _queue.push_back(std::move(_batch));
+        lk.unlock();
+        _workAvailable.notify_one();
+
+        _batch = Batch();
+        _batchBytes = 0;
+        return Status::OK();
+    }
+
+    void _run(Worker* worker) {
+        while (true) {
+            Batch batch;
+            {
+                stdx::unique_lock<stdx::mutex> lk(_mutex);
+                _workAvailable.wait(
+                    lk, [this] { return !_status.isOK() || !_queue.empty() || _noMoreBatches; });
+                if (!_status.isOK() || _queue.empty()) {
+                    return;
+                }
+                batch = std::move(_queue.front());
+                _queue.pop_front();
+            }
+            _spaceAvailable.notify_one();
+
+            try {
+                for (auto&& doc : batch) {
+                    worker->keysInserted += _bulk->_addKeys(doc.first,
+                                                            doc.second,
+                                                            worker->sorter.get(),
+                                                            &worker->everGeneratedMultipleKeys,
+                                                            &worker->indexMultikeyPaths);
+                }
+            } catch (const DBException& ex) {
+                {
+                    stdx::lock_guard<stdx::mutex> lk(_mutex);
+                    if (_status.isOK()) {
+                        _status = ex.toStatus();
+                    }
+                }
+                _workAvailable.notify_all();
+                _spaceAvailable.notify_all();
+                return;
+            }
+        }
+    }
+
+    void _joinAll() {
+        for (auto&& worker : _workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+    const BulkBuilder* const _bulk;
+    const BtreeExternalSortComparison _comparator;
+    const size_t _maxQueuedBatches;
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    // Only used by the thread scanning the collection.
+    Batch _batch;
+    size_t _batchBytes = 0;
+
+    // Protects the members below.
+    stdx::mutex _mutex;
+    stdx::condition_variable _workAvailable;
+    stdx::condition_variable _spaceAvailable;
+    std::deque<Batch> _queue;
+    bool _noMoreBatches = false;
+    Status _status = Status::OK();
+};
+
 std::unique_ptr<IndexAccessMethod::BulkBuilder> IndexAccessMethod::initiateBulk() {
-    return std::unique_ptr<BulkBuilder>(new BulkBuilder(this, _descriptor));
+    return std::unique_ptr<BulkBuilder>(
+        new BulkBuilder(this, _descriptor, indexBuildKeyGenerationThreads.load()));
 }
 
 IndexAccessMethod::BulkBuilder::BulkBuilder(const IndexAccessMethod* index,
-                                            const IndexDescriptor* descriptor)
-    : _sorter(Sorter::make(
-          SortOptions()
-              .TempDir(storageGlobalParams.dbpath + "/_tmp")
-              .ExtSortAllowed()
-              .MaxMemoryUsageBytes(100 * 1024 * 1024),
-          BtreeExternalSortComparison(descriptor->keyPattern(), descriptor->version()))),
-      _real(index) {}
+                                            const IndexDescriptor* descriptor,
+                                            int numKeyGenerationThreads)
+    : _spillStats(std::make_shared<SorterFileStats>()), _real(index) {
+    if (numKeyGenerationThreads > 1) {
+        _workers = stdx::make_unique<KeyGenerationWorkers>(this, descriptor, numKeyGenerationThreads);
+    } else {
+        _sorter.reset(Sorter::make(
+            makeBulkSortOptions(kBulkBuildMaxMemoryUsageBytes, _spillStats),
+            BtreeExternalSortComparison(descriptor->keyPattern(), descriptor->version())));
+    }
+}
+
+IndexAccessMethod::BulkBuilder::~BulkBuilder() = default;
 
 Status IndexAccessMethod::BulkBuilder::insert(OperationContext* txn,
                                               const BSONObj& obj,
                                               const RecordId& loc,
                                               const InsertDeleteOptions& options,
                                               int64_t* numInserted) {
+    if (_workers) {
+        return _workers->add(obj, loc);
+    }
+
+    const int64_t numKeys = _addKeys(
+        obj, loc, _sorter.get(), &_everGeneratedMultipleKeys, &_indexMultikeyPaths);
+    _keysInserted += numKeys;
+
+    if (NULL != numInserted) {
+        *numInserted += numKeys;
+    }
+
+    return Status::OK();
+}
+
+int64_t IndexAccessMethod::BulkBuilder::_addKeys(const BSONObj& obj,
+                                                 const RecordId& loc,
+                                                 Sorter* sorter,
+                                                 bool* everGeneratedMultipleKeys,
+                                                 MultikeyPaths* indexMultikeyPaths) const {
     BSONObjSet keys;
     MultikeyPaths multikeyPaths;
     _real->getKeys(obj, &keys, &multikeyPaths);
 
-    _everGeneratedMultipleKeys = _everGeneratedMultipleKeys || (keys.size() > 1);
+    *everGeneratedMultipleKeys = *everGeneratedMultipleKeys || (keys.size() > 1);
 
     if (!multikeyPaths.empty()) {
-        if (_indexMultikeyPaths.empty()) {
-            _indexMultikeyPaths = multikeyPaths;
+        if (indexMultikeyPaths->empty()) {
+            *indexMultikeyPaths = multikeyPaths;
         } else {
-            invariant(_indexMultikeyPaths.size() == multikeyPaths.size());
+            invariant(indexMultikeyPaths->size() == multikeyPaths.size());
             for (size_t i = 0; i < multikeyPaths.size(); ++i) {
-                _indexMultikeyPaths[i].insert(multikeyPaths[i].begin(), multikeyPaths[i].end());
+                (*indexMultikeyPaths)[i].insert(multikeyPaths[i].begin(), multikeyPaths[i].end());
             }
         }
     }
 
     for (BSONObjSet::iterator it = keys.begin(); it != keys.end(); ++it) {
-        _sorter->add(*it, loc);
-        _keysInserted++;
+        sorter->add(*it, loc);
     }
 
-    if (NULL != numInserted) {
-        *numInserted += keys.size();
-    }
-
-    return Status::OK();
+    return keys.size();
 }
 
-
 Status IndexAccessMethod::commitBulk(OperationContext* txn,
                                      std::unique_ptr<BulkBuilder> bulk,
                                      bool mayInterrupt,
@@ -447,7 +771,22 @@ Status IndexAccessMethod::commitBulk(OperationContext* txn,
                                      set<RecordId>* dupsToDrop) {
     Timer timer;
 
-    std::unique_ptr<BulkBuilder::Sorter::Iterator> i(bulk->_sorter->done());
+    std::unique_ptr<BulkBuilder::Sorter::Iterator> i;
+    if (bulk->_workers) {
+        {
+            stdx::lock_guard<Client> lk(*txn->getClient());
+            CurOp::get(txn)->setMessage_inlock("Index Bulk Build: (1/3) waiting for key generation",
+                                               "Index: (1/3) Key Generation");
+        }
+
+        auto merged = bulk->_workers->finish(bulk.get());
+        if (!merged.isOK()) {
+            return merged.getStatus();
+        }
+        i.reset(merged.getValue());
+    } else {
+        i.reset(bulk->_sorter->done());
+    }
 
     stdx::unique_lock<Client> lk(*txn->getClient());
     ProgressMeterHolder pm(*txn->setMessage_inlock("Index Bulk Build: (2/3) btree bottom up",
@@ -513,6 +852,17 @@ Status IndexAccessMethod::commitBulk(OperationContext* txn,
 
     pm.finished();
 
+    if (bulk->_workers) {
+        bulk->_workers->addSpillStats(bulk->_spillStats.get());
+    }
+
+    if (bulk->_spillStats->blocksWritten > 0) {
+        const SorterFileStats& stats = *bulk->_spillStats;
+        log() << "\t external sort spilled " << stats.bytesSpilled << " bytes of keys in "
+              << stats.blocksWritten << " blocks, wrote " << stats.bytesWritten
+              << " bytes to disk and read back " << stats.bytesRead << " bytes";
+    }
+
     {
         stdx::lock_guard<Client> lk(*txn->getClient());
         CurOp::get(txn)->setMessage_inlock("Index Bulk Build: (3/3) btree-middle",
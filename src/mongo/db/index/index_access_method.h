@@ -42,6 +42,7 @@
 namespace mongo {
 
 extern std::atomic<bool> failIndexKeyTooLong;  // NOLINT
+extern std::atomic<int> indexBuildKeyGenerationThreads;  // NOLINT
 
 class BSONObjBuilder;
 class MatchExpression;
@@ -197,8 +198,14 @@ public:
 
     class BulkBuilder {
     public:
+        ~BulkBuilder();
+
         /**
          * Insert into the BulkBuilder as-if inserting into an IndexAccessMethod.
+         *
+         * If keys are generated by worker threads, this only queues a copy of 'obj': 'numInserted'
+         * is not updated and an error generating keys is returned by a later call to insert() or
+         * by commitBulk().
          */
         Status insert(OperationContext* txn,
                       const BSONObj& obj,
@@ -211,9 +218,30 @@ public:
 
         using Sorter = mongo::Sorter<BSONObj, RecordId>;
 
-        BulkBuilder(const IndexAccessMethod* index, const IndexDescriptor* descriptor);
+        // Generates and sorts keys on a pool of threads, each with its own Sorter.
+        class KeyGenerationWorkers;
+
+        BulkBuilder(const IndexAccessMethod* index,
+                    const IndexDescriptor* descriptor,
+                    int numKeyGenerationThreads);
 
+        /**
+         * Generates the keys for 'obj' and adds them to 'sorter'. Whether they make the index
+         * multikey is recorded in the remaining arguments. Returns the number of keys added.
+         */
+        int64_t _addKeys(const BSONObj& obj,
+                         const RecordId& loc,
+                         Sorter* sorter,
+                         bool* everGeneratedMultipleKeys,
+                         MultikeyPaths* indexMultikeyPaths) const;
+
+        // I/O done on the files '_sorter' spills to. Must be declared before '_sorter'.
+        const std::shared_ptr<SorterFileStats> _spillStats;
+
+        // Exactly one of '_sorter' and '_workers' is set.
         std::unique_ptr<Sorter> _sorter;
+        std::unique_ptr<KeyGenerationWorkers> _workers;
+
         const IndexAccessMethod* _real;
         int64_t _keysInserted = 0;
 
@@ -689,7 +689,10 @@ void assembleResponse(OperationContext* txn,
     logThreshold += currentOp.getExpectedLatencyMs();
     Top::get(txn->getServiceContext())
         .incrementGlobalLatencyStats(
-            txn, currentOp.totalTimeMicros(), currentOp.getReadWriteType());
+            txn,
+            currentOp.totalTimeMicros(),
+            currentOp.getReadWriteType(),
+            currentOp.getCommand() ? StringData(currentOp.getCommand()->getName()) : StringData());
 
     if (shouldLogOpDebug || debug.executionTime > logThreshold) {
         Locker::LockerInfo lockerInfo;
@@ -0,0 +1,260 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/matcher/compiled_match_expression.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "mongo/db/field_ref.h"
+#include "mongo/db/matcher/expression_leaf.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+namespace {
+
+/**
+ * Walks 'parts' down from 'doc' the way getFieldDottedOrArray() does: a missing field, or a
+ * non-object value before the last component, resolves to EOO. Returns false without setting 'out'
+ * if an array is found along the path, including at its end.
+ */
+bool resolvePath(const BSONObj& doc, const std::vector<std::string>& parts, BSONElement* out) {
+    BSONObj curr = doc;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        BSONElement elem = curr.getField(parts[i]);
+        if (elem.type() == Array) {
+            return false;
+        }
+
+        if (i + 1 == parts.size()) {
+            *out = elem;
+            return true;
+        }
+
+        if (elem.type() != Object) {
+            *out = BSONElement();
+            return true;
+        }
+        curr = elem.embeddedObject();
+    }
+
+    MONGO_UNREACHABLE;
+}
+
+bool comparisonResultMatches(MatchExpression::MatchType matchType, int cmp) {
+    switch (matchType) {
+        case MatchExpression::EQ:
+            return cmp == 0;
+        case MatchExpression::LT:
+            return cmp < 0;
+        case MatchExpression::LTE:
+            return cmp <= 0;
+        case MatchExpression::GT:
+            return cmp > 0;
+        case MatchExpression::GTE:
+            return cmp >= 0;
+        default:
+            MONGO_UNREACHABLE;
+    }
+}
+
+template <typename T>
+int compareValues(T lhs, T rhs) {
+    if (lhs < rhs) {
+        return -1;
+    }
+    return lhs == rhs ? 0 : 1;
+}
+
+}  // namespace
+
+std::unique_ptr<CompiledMatchExpression> CompiledMatchExpression::compile(
+    const MatchExpression* expr) {
+    std::unique_ptr<CompiledMatchExpression> compiled(new CompiledMatchExpression());
+
+    // Flatten nested $and so that all of their conjuncts can be compiled.
+    std::vector<const MatchExpression*> conjuncts{expr};
+    while (!conjuncts.empty()) {
+        const MatchExpression* conjunct = conjuncts.back();
+        conjuncts.pop_back();
+
+        if (conjunct->matchType() == MatchExpression::AND) {
+            for (size_t i = conjunct->numChildren(); i > 0; --i) {
+                conjuncts.push_back(conjunct->getChild(i - 1));
+            }
+        } else if (!compiled->_addLeaf(conjunct)) {
+            compiled->_residuals.push_back(conjunct);
+        }
+    }
+
+    if (compiled->_leaves.empty()) {
+        return nullptr;
+    }
+
+    // Conjuncts can be evaluated in any order. Keep the original order within a rank.
+    std::stable_sort(compiled->_leaves.begin(),
+                     compiled->_leaves.end(),
+                     [](const Leaf& lhs, const Leaf& rhs) { return lhs.rank < rhs.rank; });
+    return compiled;
+}
+
+bool CompiledMatchExpression::_addLeaf(const MatchExpression* expr) {
+    Leaf leaf;
+    leaf.expr = static_cast<const LeafMatchExpression*>(expr);
+    leaf.matchType = expr->matchType();
+
+    switch (expr->matchType()) {
+        case MatchExpression::EQ:
+        case MatchExpression::LT:
+        case MatchExpression::LTE:
+        case MatchExpression::GT:
+        case MatchExpression::GTE: {
+            const auto* comparison = static_cast<const ComparisonMatchExpression*>(expr);
+            if (comparison->getCollator()) {
+                return false;
+            }
+
+            leaf.rank = (expr->matchType() == MatchExpression::EQ) ? 0 : 1;
+            const BSONElement& rhs = comparison->getData();
+            switch (rhs.type()) {
+                case NumberInt:
+                case NumberLong:
+                    leaf.kernel = Kernel::kIntegral;
+                    leaf.integralOperand = rhs.numberLong();
+                    break;
+                case NumberDouble:
+                    leaf.kernel = std::isnan(rhs.Double()) ? Kernel::kGeneric : Kernel::kDouble;
+                    leaf.doubleOperand = rhs.Double();
+                    break;
+                case String:
+                    // Include the terminating NUL, as compareElementValues() does.
+                    leaf.kernel = Kernel::kString;
+                    leaf.stringOperand = StringData(rhs.valuestr(), rhs.valuestrsize());
+                    break;
+                default:
+                    leaf.kernel = Kernel::kGeneric;
+                    break;
+            }
+            break;
+        }
+        case MatchExpression::EXISTS:
+            leaf.rank = 2;
+            leaf.kernel = Kernel::kExists;
+            break;
+        default:
+            return false;
+    }
+
+    FieldRef path(leaf.expr->path());
+    if (path.numParts() == 0) {
+        return false;
+    }
+
+    std::vector<std::string> parts;
+    for (size_t i = 0; i < path.numParts(); ++i) {
+        parts.push_back(path.getPart(i).toString());
+    }
+
+    auto it = std::find(_paths.begin(), _paths.end(), parts);
+    if (it == _paths.end()) {
+        if (_paths.size() == kMaxPaths) {
+            return false;
+        }
+        it = _paths.insert(_paths.end(), std::move(parts));
+    }
+    leaf.pathIndex = it - _paths.begin();
+
+    _leaves.push_back(leaf);
+    return true;
+}
+
+bool CompiledMatchExpression::_matchesLeaf(const Leaf& leaf, const BSONElement& elem) const {
+    switch (leaf.kernel) {
+        case Kernel::kIntegral:
+            if (elem.type() == NumberInt || elem.type() == NumberLong) {
+                return comparisonResultMatches(
+                    leaf.matchType, compareValues(elem.numberLong(), leaf.integralOperand));
+            }
+            break;
+        case Kernel::kDouble:
+            if (elem.type() == NumberDouble && !std::isnan(elem._numberDouble())) {
+                return comparisonResultMatches(
+                    leaf.matchType, compareValues(elem._numberDouble(), leaf.doubleOperand));
+            }
+            break;
+        case Kernel::kString:
+            if (elem.type() == String) {
+                StringData value(elem.valuestr(), elem.valuestrsize());
+                return comparisonResultMatches(leaf.matchType, value.compare(leaf.stringOperand));
+            }
+            break;
+        case Kernel::kExists:
+            return !elem.eoo();
+        case Kernel::kGeneric:
+            break;
+    }
+
+    return leaf.expr->matchesSingleElement(elem);
+}
+
+bool CompiledMatchExpression::matchesBSON(const BSONObj& doc) const {
+    enum class PathState : char { kUnresolved, kResolved, kHasArray };
+    std::array<PathState, kMaxPaths> states;
+    states.fill(PathState::kUnresolved);
+    std::array<BSONElement, kMaxPaths> elements;
+
+    for (auto&& leaf : _leaves) {
+        PathState& state = states[leaf.pathIndex];
+        if (state == PathState::kUnresolved) {
+            state = resolvePath(doc, _paths[leaf.pathIndex], &elements[leaf.pathIndex])
+                ? PathState::kResolved
+                : PathState::kHasArray;
+        }
+
+        const bool matches = (state == PathState::kResolved)
+            ? _matchesLeaf(leaf, elements[leaf.pathIndex])
+            : leaf.expr->matchesBSON(doc);
+        if (!matches) {
+            return false;
+        }
+    }
+
+    for (auto&& residual : _residuals) {
+        if (!residual->matchesBSON(doc)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}  // namespace mongo
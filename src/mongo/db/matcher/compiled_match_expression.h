@@ -0,0 +1,133 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/db/matcher/expression.h"
+
+namespace mongo {
+
+class LeafMatchExpression;
+
+/**
+ * A flat program equivalent to a MatchExpression, for evaluating the same filter against many BSON
+ * documents.
+ *
+ * The top-level conjuncts of the expression are split into leaves this class knows how to evaluate
+ * ($eq, $lt, $lte, $gt, $gte without a collator, and $exists) and residual expressions which are
+ * evaluated through MatchExpression::matchesBSON(). For each document:
+ *
+ *  - Each distinct leaf path is resolved at most once, and only if a leaf needs it, by walking the
+ *    path components split at compile time. Leaves on the same field share that walk.
+ *  - Leaves run cheapest and most selective first (equality, then ranges, then $exists) and
+ *    evaluation stops at the first one which fails. Residual expressions run last.
+ *  - Comparisons between values of the same numeric or string type use kernels specialized for
+ *    that type, which skip the generic canonical type and NaN handling.
+ *
+ * A path which runs into an array needs the implicit array traversal rules of ElementPath, so the
+ * leaves on it fall back to the original expression for that document.
+ *
+ * The compiled program points into the expression it was compiled from, which must outlive it and
+ * must not be modified.
+ */
+class CompiledMatchExpression {
+    MONGO_DISALLOW_COPYING(CompiledMatchExpression);
+
+public:
+    /**
+     * Compiles 'expr'. Returns nullptr if no part of 'expr' can be compiled, in which case it
+     * should be evaluated as is.
+     */
+    static std::unique_ptr<CompiledMatchExpression> compile(const MatchExpression* expr);
+
+    /**
+     * Returns the same result as expr->matchesBSON(doc) for the expression this was compiled from.
+     */
+    bool matchesBSON(const BSONObj& doc) const;
+
+    size_t numCompiledLeaves() const {
+        return _leaves.size();
+    }
+
+    size_t numResidualExpressions() const {
+        return _residuals.size();
+    }
+
+private:
+    // Upper bound on the number of distinct paths, so that per-document state fits on the stack.
+    static const size_t kMaxPaths = 16;
+
+    enum class Kernel {
+        // LeafMatchExpression::matchesSingleElement() on the resolved element.
+        kGeneric,
+        // Comparison to an integral number, when the element is an int or a long.
+        kIntegral,
+        // Comparison to a double other than NaN, when the element is a double other than NaN.
+        kDouble,
+        // Simple binary comparison to a string, when the element is a string.
+        kString,
+        // $exists: true.
+        kExists,
+    };
+
+    struct Leaf {
+        const LeafMatchExpression* expr;
+        MatchExpression::MatchType matchType;
+        size_t pathIndex;
+        Kernel kernel;
+        // Lower runs first.
+        int rank;
+
+        long long integralOperand = 0;
+        double doubleOperand = 0;
+        StringData stringOperand;
+    };
+
+    CompiledMatchExpression() = default;
+
+    /**
+     * Adds 'expr' as a compiled leaf. Returns false if it cannot be compiled.
+     */
+    bool _addLeaf(const MatchExpression* expr);
+
+    bool _matchesLeaf(const Leaf& leaf, const BSONElement& elem) const;
+
+    // The components of each distinct path used by a leaf.
+    std::vector<std::vector<std::string>> _paths;
+    std::vector<Leaf> _leaves;
+    std::vector<const MatchExpression*> _residuals;
+};
+
+}  // namespace mongo
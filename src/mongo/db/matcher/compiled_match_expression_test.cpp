@@ -0,0 +1,236 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/matcher/compiled_match_expression.h"
+
+#include <limits>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/db/matcher/extensions_callback_disallow_extensions.h"
+#include "mongo/db/query/collation/collator_interface_mock.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+/**
+ * Documents covering the cases the compiled kernels special-case: every numeric type, NaN, strings
+ * with embedded NULs, null and missing values, MinKey and MaxKey, nested paths and arrays.
+ */
+std::vector<BSONObj> testDocuments() {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<BSONObj> docs{
+        BSONObj(),
+        fromjson("{a: 1}"),
+        fromjson("{a: 2}"),
+        fromjson("{a: -1}"),
+        fromjson("{a: 1.0}"),
+        fromjson("{a: 1.5}"),
+        fromjson("{a: 'a'}"),
+        fromjson("{a: 'ab'}"),
+        fromjson("{a: 'b'}"),
+        fromjson("{a: ''}"),
+        fromjson("{a: null}"),
+        fromjson("{a: true}"),
+        fromjson("{a: {b: 1}}"),
+        fromjson("{a: {b: 'a'}}"),
+        fromjson("{a: {b: {c: 2}}}"),
+        fromjson("{a: {b: [1, 2]}}"),
+        fromjson("{a: {b: null}}"),
+        fromjson("{a: {c: 1}}"),
+        fromjson("{a: [1, 2, 3]}"),
+        fromjson("{a: [{b: 1}, {b: 2}]}"),
+        fromjson("{a: [[1]]}"),
+        fromjson("{a: []}"),
+        fromjson("{a: 1, b: 'a'}"),
+        fromjson("{a: 2, b: 'b', c: 1}"),
+        fromjson("{a: 1, b: 2.5, c: null}"),
+        fromjson("{a: 'xyz', b: [1, 'a']}"),
+        fromjson("{a: {$minKey: 1}}"),
+        fromjson("{a: {$maxKey: 1}}"),
+        fromjson("{a: {$numberDecimal: '1'}}"),
+        fromjson("{a: {$numberDecimal: '1.5'}}"),
+        fromjson("{a: {$date: 0}}"),
+        BSON("a" << 1LL),
+        BSON("a" << std::numeric_limits<long long>::max()),
+        BSON("a" << std::numeric_limits<long long>::min()),
+        BSON("a" << static_cast<double>(std::numeric_limits<long long>::max())),
+        BSON("a" << nan),
+        BSON("a" << BSON("b" << nan)),
+        BSON("a" << BSON_ARRAY(nan << 1)),
+        BSON("a" << std::numeric_limits<double>::infinity()),
+        BSON("a" << -std::numeric_limits<double>::infinity()),
+        BSONObjBuilder().append("a", StringData("a\0b", 3)).obj(),
+        BSONObjBuilder().append("a", StringData("a\0", 2)).obj(),
+        BSONObjBuilder().append("a", StringData("\0", 1)).obj(),
+        BSON("a" << BSONUndefined),
+    };
+    return docs;
+}
+
+struct CompileResult {
+    bool compiled = false;
+    size_t numCompiledLeaves = 0;
+    size_t numResidualExpressions = 0;
+};
+
+/**
+ * Parses 'filter', compiles it and checks that the compiled program agrees with the parsed
+ * expression on every test document.
+ */
+CompileResult assertSameResults(const BSONObj& filter,
+                                const CollatorInterface* collator = nullptr) {
+    StatusWithMatchExpression parsed =
+        MatchExpressionParser::parse(filter, ExtensionsCallbackDisallowExtensions(), collator);
+    ASSERT_OK(parsed.getStatus());
+    const MatchExpression* expr = parsed.getValue().get();
+
+    CompileResult result;
+    std::unique_ptr<CompiledMatchExpression> compiled = CompiledMatchExpression::compile(expr);
+    if (!compiled) {
+        return result;
+    }
+
+    for (auto&& doc : testDocuments()) {
+        ASSERT_EQUALS(expr->matchesBSON(doc), compiled->matchesBSON(doc))
+            << "filter: " << filter << ", document: " << doc;
+    }
+
+    result.compiled = true;
+    result.numCompiledLeaves = compiled->numCompiledLeaves();
+    result.numResidualExpressions = compiled->numResidualExpressions();
+    return result;
+}
+
+TEST(CompiledMatchExpressionTest, ComparisonsToNumbersMatchOriginalExpression) {
+    const long long maxLong = std::numeric_limits<long long>::max();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double inf = std::numeric_limits<double>::infinity();
+    for (auto&& op : {"$eq", "$lt", "$lte", "$gt", "$gte"}) {
+        ASSERT(assertSameResults(BSON("a" << BSON(op << 1))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << 1LL))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << 1.0))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << 1.5))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << -2))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << maxLong))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << nan))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << inf))).compiled);
+        ASSERT(assertSameResults(BSON("a.b" << BSON(op << 1))).compiled);
+        ASSERT(assertSameResults(BSON("a.b.c" << BSON(op << 2))).compiled);
+    }
+}
+
+TEST(CompiledMatchExpressionTest, ComparisonsToStringsMatchOriginalExpression) {
+    for (auto&& op : {"$eq", "$lt", "$lte", "$gt", "$gte"}) {
+        ASSERT(assertSameResults(BSON("a" << BSON(op << "a"))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << ""))).compiled);
+        ASSERT(assertSameResults(BSON("a.b" << BSON(op << "a"))).compiled);
+        BSONObj withNul = BSONObjBuilder().append(op, StringData("a\0", 2)).obj();
+        ASSERT(assertSameResults(BSON("a" << withNul)).compiled);
+    }
+}
+
+TEST(CompiledMatchExpressionTest, ComparisonsToOtherTypesMatchOriginalExpression) {
+    for (auto&& op : {"$eq", "$lt", "$lte", "$gt", "$gte"}) {
+        ASSERT(assertSameResults(BSON("a" << BSON(op << BSONNULL))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << true))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << MINKEY))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << MAXKEY))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << Decimal128("1")))).compiled);
+        ASSERT(assertSameResults(BSON("a" << BSON(op << BSON("b" << 1)))).compiled);
+        ASSERT(assertSameResults(BSON("a.b" << BSON(op << BSONNULL))).compiled);
+    }
+}
+
+TEST(CompiledMatchExpressionTest, ExistsMatchesOriginalExpression) {
+    ASSERT(assertSameResults(fromjson("{a: {$exists: true}}")).compiled);
+    ASSERT(assertSameResults(fromjson("{'a.b': {$exists: true}}")).compiled);
+    ASSERT(assertSameResults(fromjson("{'a.b.c': {$exists: true}}")).compiled);
+}
+
+TEST(CompiledMatchExpressionTest, ConjunctionsMatchOriginalExpression) {
+    auto compiled = assertSameResults(fromjson("{a: {$gte: 1, $lt: 2}, b: 'a'}"));
+    ASSERT(compiled.compiled);
+    ASSERT_EQUALS(3U, compiled.numCompiledLeaves);
+    ASSERT_EQUALS(0U, compiled.numResidualExpressions);
+
+    ASSERT(assertSameResults(fromjson("{a: {$exists: true}, b: {$gt: 2}, c: null}")).compiled);
+    ASSERT(assertSameResults(fromjson("{'a.b': 1, a: {$exists: true}}")).compiled);
+    ASSERT(assertSameResults(fromjson("{$and: [{a: {$gt: 0}}, {a: {$lt: 3}}]}")).compiled);
+
+    auto nested =
+        assertSameResults(fromjson("{$and: [{a: 1}, {$and: [{b: 2}, {c: {$exists: true}}]}]}"));
+    ASSERT(nested.compiled);
+    ASSERT_EQUALS(3U, nested.numCompiledLeaves);
+    ASSERT_EQUALS(0U, nested.numResidualExpressions);
+}
+
+TEST(CompiledMatchExpressionTest, UncompiledConjunctsAreEvaluatedAsResiduals) {
+    auto compiled = assertSameResults(fromjson("{a: {$gt: 0}, b: {$regex: '^a'}}"));
+    ASSERT(compiled.compiled);
+    ASSERT_EQUALS(1U, compiled.numCompiledLeaves);
+    ASSERT_EQUALS(1U, compiled.numResidualExpressions);
+
+    ASSERT(assertSameResults(fromjson("{a: 1, $or: [{b: 'a'}, {c: 1}]}")).compiled);
+    ASSERT(assertSameResults(fromjson("{a: {$lte: 2}, b: {$in: [1, 'a']}}")).compiled);
+    ASSERT(assertSameResults(fromjson("{a: {$ne: 1}, b: {$exists: true}}")).compiled);
+    ASSERT(assertSameResults(fromjson("{'a.b': {$gte: 1}, a: {$elemMatch: {b: 2}}}")).compiled);
+}
+
+TEST(CompiledMatchExpressionTest, NothingToCompileReturnsNull) {
+    ASSERT_FALSE(assertSameResults(fromjson("{a: {$regex: '^a'}}")).compiled);
+    ASSERT_FALSE(assertSameResults(fromjson("{$or: [{a: 1}, {b: 1}]}")).compiled);
+    ASSERT_FALSE(assertSameResults(fromjson("{a: {$exists: false}}")).compiled);
+    ASSERT_FALSE(assertSameResults(fromjson("{}")).compiled);
+}
+
+TEST(CompiledMatchExpressionTest, ComparisonsWithCollatorAreNotCompiled) {
+    CollatorInterfaceMock collator(CollatorInterfaceMock::MockType::kReverseString);
+    auto compiled = assertSameResults(fromjson("{a: 'a', b: {$exists: true}}"), &collator);
+    ASSERT(compiled.compiled);
+    ASSERT_EQUALS(1U, compiled.numCompiledLeaves);
+    ASSERT_EQUALS(1U, compiled.numResidualExpressions);
+}
+
+TEST(CompiledMatchExpressionTest, PathsBeyondLimitAreEvaluatedAsResiduals) {
+    BSONObjBuilder filter;
+    for (int i = 0; i < 20; ++i) {
+        filter.append(std::string(str::stream() << "f" << i), BSON("$gte" << 0));
+    }
+    auto compiled = assertSameResults(filter.obj());
+    ASSERT(compiled.compiled);
+    ASSERT_EQUALS(16U, compiled.numCompiledLeaves);
+    ASSERT_EQUALS(4U, compiled.numResidualExpressions);
+}
+
+}  // namespace
+}  // namespace mongo
@@ -70,6 +70,9 @@ using std::string;
 OperationContextImpl::OperationContextImpl(Client* client, unsigned opId)
     : OperationContext(client, opId) {
     setLockState(std::move(clientOperationInfoDecoration(client).locker()));
+    // Operations run by the server's own threads rather than on behalf of a connection may use
+    // the priority ticket pool.
+    lockState()->setTicketPriority(!client->isFromUserConnection());
     StorageEngine* storageEngine = getServiceContext()->getGlobalStorageEngine();
     setRecoveryUnit(storageEngine->newRecoveryUnit(), kNotInUnitOfWork);
 }
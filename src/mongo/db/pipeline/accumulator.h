@@ -59,6 +59,25 @@ namespace mongo {
         return Status::OK();                                                   \
     }
 
+/**
+ * When a $group is split for a sharded aggregation, the shards output, for every group and every
+ * accumulator, the partial aggregate returned by getValue(true). The merging $group combines these
+ * with process(partial, true), reading them straight from its input rather than re-evaluating the
+ * accumulated expressions.
+ *
+ * Accumulators whose result is enough to continue accumulating ($sum, $min, $max, $first, $last,
+ * $push and $addToSet) use the result itself as their partial aggregate. The others send their
+ * combiner state as a positional array, which is compact on the wire and cheap to combine, when
+ * the ExpressionContext says the merger accepts it (mergerAcceptsArrayPartials):
+ *
+ *   $avg                      [count, total, totalError], or [count, decimalTotal] once a decimal
+ *                             has been seen.
+ *   $stdDevPop, $stdDevSamp   [count, mean, m2], the state of Welford's online algorithm.
+ *
+ * Otherwise they send the documents earlier versions used as partial aggregates, {subTotal, count,
+ * subTotalError} and {m2, mean, count} respectively, which a merger from an earlier version can
+ * read during a rolling upgrade. Both forms are accepted when merging.
+ */
 class Accumulator : public RefCountable {
 public:
     using Factory = boost::intrusive_ptr<Accumulator> (*)();
@@ -73,7 +92,8 @@ public:
     }
 
     /** Marks the end of the evaluate() phase and return accumulated result.
-     *  toBeMerged should be true when the outputs will be merged by process().
+     *  toBeMerged should be true when the outputs will be merged by process(), in which case the
+     *  partial aggregate described above is returned.
      */
     virtual Value getValue(bool toBeMerged) const = 0;
 
@@ -313,6 +333,12 @@ private:
      */
     Decimal128 _getDecimalTotal() const;
 
+    /**
+     * Combines the partial aggregate of 'count' values adding up to 'total' plus 'error', which is
+     * missing if there is no error term.
+     */
+    void _mergePartial(long long count, const Value& total, const Value& error);
+
     bool _isDecimal;
     DoubleDoubleSummation _nonDecimalTotal;
     Decimal128 _decimalTotal;
@@ -330,6 +356,12 @@ public:
     void reset() final;
 
 private:
+    /**
+     * Combines the partial aggregate of 'count' values with the given mean and sum of squared
+     * deltas from it.
+     */
+    void _mergePartial(long long count, double mean, double m2);
+
     const bool _isSamp;
     long long _count;
     double _mean;
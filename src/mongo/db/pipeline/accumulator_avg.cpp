@@ -54,19 +54,20 @@ const char countName[] = "count";
 
 void AccumulatorAvg::processInternal(const Value& input, bool merging) {
     if (merging) {
-        // We expect an object that contains both a subtotal and a count. Additionally there may
-        // be an error value, that allows for additional precision.
-        // 'input' is what getValue(true) produced below.
-        verify(input.getType() == Object);
-        // We're recursively adding the subtotal to get the proper type treatment, but this only
-        // increments the count by one, so adjust the count afterwards. Similarly for 'error'.
-        processInternal(input[subTotalName], false);
-        _count += input[countName].getLong() - 1;
-        Value error = input[subTotalErrorName];
-        if (!error.missing()) {
-            processInternal(error, false);
-            _count--;  // The error correction only adjusts the total, not the number of items.
+        // 'input' is what getValue(true) produced below: the count, the subtotal and, unless the
+        // subtotal is a decimal, an error value that allows for additional precision. These come
+        // as an array when the merger said it accepts one, and as the fields of a document
+        // otherwise or from earlier versions.
+        if (input.getType() == Array) {
+            const auto& partial = input.getArray();
+            verify(partial.size() == 2 || partial.size() == 3);
+            _mergePartial(
+                partial[0].getLong(), partial[1], partial.size() == 3 ? partial[2] : Value());
+            return;
         }
+
+        verify(input.getType() == Object);
+        _mergePartial(input[countName].getLong(), input[subTotalName], input[subTotalErrorName]);
         return;
     }
 
@@ -90,6 +91,17 @@ void AccumulatorAvg::processInternal(const Value& input, bool merging) {
     _count++;
 }
 
+void AccumulatorAvg::_mergePartial(long long count, const Value& total, const Value& error) {
+    // We're recursively adding the subtotal to get the proper type treatment, but this only
+    // increments the count by one, so adjust the count afterwards. Similarly for 'error'.
+    processInternal(total, false);
+    _count += count - 1;
+    if (!error.missing()) {
+        processInternal(error, false);
+        _count--;  // The error correction only adjusts the total, not the number of items.
+    }
+}
+
 intrusive_ptr<Accumulator> AccumulatorAvg::create() {
     return new AccumulatorAvg();
 }
@@ -100,11 +112,18 @@ Decimal128 AccumulatorAvg::_getDecimalTotal() const {
 
 Value AccumulatorAvg::getValue(bool toBeMerged) const {
     if (toBeMerged) {
-        if (_isDecimal)
+        // Mergers from earlier versions only accept the document form.
+        const bool asArray = getExpressionContext()->mergerAcceptsArrayPartials;
+        if (_isDecimal) {
+            if (asArray)
+                return Value(std::vector<Value>{Value(_count), Value(_getDecimalTotal())});
             return Value(Document{{subTotalName, _getDecimalTotal()}, {countName, _count}});
+        }
 
         double total, error;
         std::tie(total, error) = _nonDecimalTotal.getDoubleDouble();
+        if (asArray)
+            return Value(std::vector<Value>{Value(_count), Value(total), Value(error)});
         return Value(
             Document{{subTotalName, total}, {countName, _count}, {subTotalErrorName, error}});
     }
@@ -60,25 +60,31 @@ void AccumulatorStdDev::processInternal(const Value& input, bool merging) {
         const double delta = val - _mean;
         _mean += delta / _count;
         _m2 += delta * (val - _mean);
-    } else {
+    } else if (input.getType() == Array) {
         // This is what getValue(true) produced below.
+        const auto& partial = input.getArray();
+        verify(partial.size() == 3);
+        _mergePartial(partial[0].getLong(), partial[1].getDouble(), partial[2].getDouble());
+    } else {
+        // Sent to mergers that do not accept the array form, and by earlier versions.
         verify(input.getType() == Object);
-        const double m2 = input["m2"].getDouble();
-        const double mean = input["mean"].getDouble();
-        const long long count = input["count"].getLong();
+        _mergePartial(
+            input["count"].getLong(), input["mean"].getDouble(), input["m2"].getDouble());
+    }
+}
 
-        if (count == 0)
-            return;  // This partition had no data to contribute.
+void AccumulatorStdDev::_mergePartial(long long count, double mean, double m2) {
+    if (count == 0)
+        return;  // This partition had no data to contribute.
 
-        // This is an implementation of the following algorithm:
-        // http://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Parallel_algorithm
-        const double delta = mean - _mean;
-        const long long newCount = count + _count;
+    // This is an implementation of the following algorithm:
+    // http://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Parallel_algorithm
+    const double delta = mean - _mean;
+    const long long newCount = count + _count;
 
-        _mean = ((_count * _mean) + (count * mean)) / newCount;
-        _m2 += m2 + (delta * delta * (double(_count) * count / newCount));
-        _count = newCount;
-    }
+    _mean = ((_count * _mean) + (count * mean)) / newCount;
+    _m2 += m2 + (delta * delta * (double(_count) * count / newCount));
+    _count = newCount;
 }
 
 Value AccumulatorStdDev::getValue(bool toBeMerged) const {
@@ -89,6 +95,9 @@ Value AccumulatorStdDev::getValue(bool toBeMerged) const {
 
         return Value(sqrt(_m2 / adjustedCount));
     } else {
+        // Mergers from earlier versions only accept the document form.
+        if (getExpressionContext()->mergerAcceptsArrayPartials)
+            return Value(std::vector<Value>{Value(_count), Value(_mean), Value(_m2)});
         return Value(DOC("m2" << _m2 << "mean" << _mean << "count" << _count));
     }
 }
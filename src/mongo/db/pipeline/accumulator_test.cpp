@@ -157,6 +157,98 @@ TEST(Accumulators, Avg) {
         });
 }
 
+TEST(Accumulators, AvgSendsDocumentPartialUnlessMergerAcceptsArrays) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    intrusive_ptr<Accumulator> shard = AccumulatorAvg::create();
+    shard->injectExpressionContext(expCtx);
+    shard->process(Value(3), false);
+
+    // A merger from an earlier version only reads the document form.
+    ASSERT_VALUE_EQ(Value(DOC("subTotal" << 3.0 << "count" << 1LL << "subTotalError" << 0.0)),
+                    shard->getValue(true));
+
+    expCtx->mergerAcceptsArrayPartials = true;
+    ASSERT_VALUE_EQ(Value(std::vector<Value>{Value(1LL), Value(3.0), Value(0.0)}),
+                    shard->getValue(true));
+}
+
+TEST(Accumulators, AvgMergesArrayAndDocumentPartials) {
+    intrusive_ptr<ExpressionContext> shardExpCtx(new ExpressionContext());
+    shardExpCtx->mergerAcceptsArrayPartials = true;
+    intrusive_ptr<Accumulator> shard = AccumulatorAvg::create();
+    shard->injectExpressionContext(shardExpCtx);
+    shard->process(Value(3), false);
+    Value partial = shard->getValue(true);
+    ASSERT_EQUALS(Array, partial.getType());
+
+    // Shards of an earlier version send the partial aggregate as a document.
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    intrusive_ptr<Accumulator> accum = AccumulatorAvg::create();
+    accum->injectExpressionContext(expCtx);
+    accum->process(partial, true);
+    accum->process(Value(DOC("subTotal" << 6.0 << "count" << 2LL << "subTotalError" << 0.0)), true);
+    ASSERT_VALUE_EQ(Value(3.0), accum->getValue(false));
+}
+
+TEST(Accumulators, StdDevPop) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    assertExpectedResults(
+        "$stdDevPop",
+        expCtx,
+        {// No documents evaluated.
+         {{}, Value(BSONNULL)},
+         // One value has no deviation.
+         {{Value(5)}, Value(0.0)},
+         // Two values.
+         {{Value(1), Value(3)}, Value(1.0)},
+         // Non-numeric values are ignored.
+         {{Value("a"), Value(1), Value(BSONNULL), Value(3.0)}, Value(1.0)}});
+}
+
+TEST(Accumulators, StdDevSamp) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    assertExpectedResults("$stdDevSamp",
+                          expCtx,
+                          {// Not defined for fewer than two values.
+                           {{}, Value(BSONNULL)},
+                           {{Value(5)}, Value(BSONNULL)},
+                           // Two values.
+                           {{Value(1), Value(3)}, Value(sqrt(2.0))}});
+}
+
+TEST(Accumulators, StdDevSendsDocumentPartialUnlessMergerAcceptsArrays) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    intrusive_ptr<Accumulator> shard = AccumulatorStdDevPop::create();
+    shard->injectExpressionContext(expCtx);
+    shard->process(Value(3), false);
+
+    // A merger from an earlier version only reads the document form.
+    ASSERT_VALUE_EQ(Value(DOC("m2" << 0.0 << "mean" << 3.0 << "count" << 1LL)),
+                    shard->getValue(true));
+
+    expCtx->mergerAcceptsArrayPartials = true;
+    ASSERT_VALUE_EQ(Value(std::vector<Value>{Value(1LL), Value(3.0), Value(0.0)}),
+                    shard->getValue(true));
+}
+
+TEST(Accumulators, StdDevMergesArrayAndDocumentPartials) {
+    intrusive_ptr<ExpressionContext> shardExpCtx(new ExpressionContext());
+    shardExpCtx->mergerAcceptsArrayPartials = true;
+    intrusive_ptr<Accumulator> shard = AccumulatorStdDevPop::create();
+    shard->injectExpressionContext(shardExpCtx);
+    shard->process(Value(3), false);
+    Value partial = shard->getValue(true);
+    ASSERT_EQUALS(Array, partial.getType());
+
+    // Shards of an earlier version send the partial aggregate as a document.
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    intrusive_ptr<Accumulator> accum = AccumulatorStdDevPop::create();
+    accum->injectExpressionContext(expCtx);
+    accum->process(partial, true);
+    accum->process(Value(DOC("m2" << 0.0 << "mean" << 1.0 << "count" << 1LL)), true);
+    ASSERT_VALUE_EQ(Value(1.0), accum->getValue(false));
+}
+
 TEST(Accumulators, First) {
     intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
     assertExpectedResults(
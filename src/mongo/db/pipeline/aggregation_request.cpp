@@ -50,12 +50,17 @@ const StringData AggregationRequest::kCommandName = "aggregate"_sd;
 const StringData AggregationRequest::kCursorName = "cursor"_sd;
 const StringData AggregationRequest::kBatchSizeName = "batchSize"_sd;
 const StringData AggregationRequest::kFromRouterName = "fromRouter"_sd;
+const StringData AggregationRequest::kMergerAcceptsArrayPartialsName =
+    "mergerAcceptsArrayPartials"_sd;
 const StringData AggregationRequest::kPipelineName = "pipeline"_sd;
 const StringData AggregationRequest::kCollationName = "collation"_sd;
 const StringData AggregationRequest::kExplainName = "explain"_sd;
 const StringData AggregationRequest::kAllowDiskUseName = "allowDiskUse"_sd;
+const StringData AggregationRequest::kCompileExpressionsName = "compileExpressions"_sd;
+const StringData AggregationRequest::kParallelismName = "parallelism"_sd;
 
 const long long AggregationRequest::kDefaultBatchSize = 101;
+const int AggregationRequest::kMaxParallelism = 64;
 
 AggregationRequest::AggregationRequest(NamespaceString nss, std::vector<BSONObj> pipeline)
     : _nss(std::move(nss)), _pipeline(std::move(pipeline)) {}
@@ -131,6 +136,14 @@ StatusWith<AggregationRequest> AggregationRequest::parseFromBSON(NamespaceString
                                       << typeName(elem.type())};
             }
             request.setFromRouter(elem.Bool());
+        } else if (kMergerAcceptsArrayPartialsName == fieldName) {
+            if (elem.type() != BSONType::Bool) {
+                return {ErrorCodes::TypeMismatch,
+                        str::stream() << kMergerAcceptsArrayPartialsName
+                                      << " must be a boolean, not a "
+                                      << typeName(elem.type())};
+            }
+            request.setMergerAcceptsArrayPartials(elem.Bool());
         } else if (kAllowDiskUseName == fieldName) {
             if (storageGlobalParams.readOnly) {
                 return {ErrorCodes::IllegalOperation,
@@ -144,6 +157,28 @@ StatusWith<AggregationRequest> AggregationRequest::parseFromBSON(NamespaceString
             request.setAllowDiskUse(elem.Bool());
         } else if (bypassDocumentValidationCommandOption() == fieldName) {
             request.setBypassDocumentValidation(elem.trueValue());
+        } else if (kCompileExpressionsName == fieldName) {
+            if (elem.type() != BSONType::Bool) {
+                return {ErrorCodes::TypeMismatch,
+                        str::stream() << kCompileExpressionsName << " must be a boolean, not a "
+                                      << typeName(elem.type())};
+            }
+            request.setCompileExpressions(elem.Bool());
+        } else if (kParallelismName == fieldName) {
+            if (!elem.isNumber()) {
+                return {ErrorCodes::TypeMismatch,
+                        str::stream() << kParallelismName << " must be a number, not a "
+                                      << typeName(elem.type())};
+            }
+            const long long parallelism = elem.safeNumberLong();
+            if (parallelism < 1 || parallelism > kMaxParallelism) {
+                return {ErrorCodes::BadValue,
+                        str::stream() << kParallelismName << " must be between 1 and "
+                                      << kMaxParallelism
+                                      << ", not "
+                                      << parallelism};
+            }
+            request.setParallelism(static_cast<int>(parallelism));
         } else {
             return {ErrorCodes::FailedToParse,
                     str::stream() << "unrecognized field '" << elem.fieldName() << "'"};
@@ -161,8 +196,12 @@ Document AggregationRequest::serializeToCommandObj() const {
         {kExplainName, _explain ? Value(true) : Value()},
         {kAllowDiskUseName, _allowDiskUse ? Value(true) : Value()},
         {kFromRouterName, _fromRouter ? Value(true) : Value()},
+        {kMergerAcceptsArrayPartialsName, _mergerAcceptsArrayPartials ? Value(true) : Value()},
         {bypassDocumentValidationCommandOption(),
          _bypassDocumentValidation ? Value(true) : Value()},
+        {kCompileExpressionsName,
+         _compileExpressions ? Value(_compileExpressions.get()) : Value()},
+        {kParallelismName, _parallelism ? Value(_parallelism.get()) : Value()},
         // Only serialize a collation if one was specified.
         {kCollationName, _collation.isEmpty() ? Value() : Value(_collation)},
         {kCursorName, _batchSize ? Value(Document{{kBatchSizeName, _batchSize.get()}}) : Value()}};
@@ -50,12 +50,16 @@ public:
     static const StringData kCursorName;
     static const StringData kBatchSizeName;
     static const StringData kFromRouterName;
+    static const StringData kMergerAcceptsArrayPartialsName;
     static const StringData kPipelineName;
     static const StringData kCollationName;
     static const StringData kExplainName;
     static const StringData kAllowDiskUseName;
+    static const StringData kCompileExpressionsName;
+    static const StringData kParallelismName;
 
     static const long long kDefaultBatchSize;
+    static const int kMaxParallelism;
 
     /**
      * Create a new instance of AggregationRequest by parsing the raw command object. Returns a
@@ -108,6 +112,14 @@ public:
         return _fromRouter;
     }
 
+    /**
+     * Returns true if the router that sent this request merges the output itself and understands
+     * the positional array form of the $avg and $stdDev partial aggregates.
+     */
+    bool mergerAcceptsArrayPartials() const {
+        return _mergerAcceptsArrayPartials;
+    }
+
     bool shouldAllowDiskUse() const {
         return _allowDiskUse;
     }
@@ -116,6 +128,21 @@ public:
         return _bypassDocumentValidation;
     }
 
+    /**
+     * Returns boost::none if the request leaves it to the server whether to compile expressions.
+     */
+    boost::optional<bool> getCompileExpressions() const {
+        return _compileExpressions;
+    }
+
+    /**
+     * Returns boost::none if the request leaves it to the server how many threads may run the
+     * leading stages of the pipeline.
+     */
+    boost::optional<int> getParallelism() const {
+        return _parallelism;
+    }
+
     /**
      * Returns an empty object if no collation was specified.
      */
@@ -156,10 +183,28 @@ public:
         _fromRouter = isFromRouter;
     }
 
+    void setMergerAcceptsArrayPartials(bool mergerAcceptsArrayPartials) {
+        _mergerAcceptsArrayPartials = mergerAcceptsArrayPartials;
+    }
+
     void setBypassDocumentValidation(bool shouldBypassDocumentValidation) {
         _bypassDocumentValidation = shouldBypassDocumentValidation;
     }
 
+    void setCompileExpressions(bool compileExpressions) {
+        _compileExpressions = compileExpressions;
+    }
+
+    /**
+     * Must be between 1 and kMaxParallelism.
+     */
+    void setParallelism(int parallelism) {
+        uassert(40404,
+                "parallelism must be between 1 and 64",
+                parallelism >= 1 && parallelism <= kMaxParallelism);
+        _parallelism = parallelism;
+    }
+
 private:
     // Required fields.
 
@@ -179,7 +224,11 @@ private:
     bool _explain = false;
     bool _allowDiskUse = false;
     bool _fromRouter = false;
+    bool _mergerAcceptsArrayPartials = false;
     bool _bypassDocumentValidation = false;
     bool _cursorCommand = false;
+
+    boost::optional<bool> _compileExpressions;
+    boost::optional<int> _parallelism;
 };
 }  // namespace mongo
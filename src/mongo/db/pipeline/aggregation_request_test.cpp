@@ -52,14 +52,20 @@ TEST(AggregationRequestTest, ShouldParseAllKnownOptions) {
     NamespaceString nss("a.collection");
     const BSONObj inputBson = fromjson(
         "{pipeline: [{$match: {a: 'abc'}}], explain: true, allowDiskUse: true, fromRouter: true, "
-        "bypassDocumentValidation: true, collation: {locale: 'en_US'}, cursor: {batchSize: 10}}");
+        "mergerAcceptsArrayPartials: true, bypassDocumentValidation: true, "
+        "collation: {locale: 'en_US'}, cursor: {batchSize: 10}, compileExpressions: false, "
+        "parallelism: 4}");
     auto request = unittest::assertGet(AggregationRequest::parseFromBSON(nss, inputBson));
     ASSERT_TRUE(request.isExplain());
     ASSERT_TRUE(request.shouldAllowDiskUse());
     ASSERT_TRUE(request.isFromRouter());
+    ASSERT_TRUE(request.mergerAcceptsArrayPartials());
     ASSERT_TRUE(request.shouldBypassDocumentValidation());
     ASSERT_TRUE(request.isCursorCommand());
     ASSERT_EQ(request.getBatchSize().get(), 10);
+    ASSERT_TRUE(request.getCompileExpressions());
+    ASSERT_FALSE(*request.getCompileExpressions());
+    ASSERT_EQ(request.getParallelism().get(), 4);
     ASSERT_EQ(request.getCollation(),
               BSON("locale"
                    << "en_US"));
@@ -85,6 +91,7 @@ TEST(AggregationRequestTest, ShouldNotSerializeOptionalValuesIfEquivalentToDefau
     request.setExplain(false);
     request.setAllowDiskUse(false);
     request.setFromRouter(false);
+    request.setMergerAcceptsArrayPartials(false);
     request.setBypassDocumentValidation(false);
     request.setCollation(BSONObj());
 
@@ -100,7 +107,10 @@ TEST(AggregationRequestTest, ShouldSerializeOptionalValuesIfSet) {
     request.setExplain(true);
     request.setAllowDiskUse(true);
     request.setFromRouter(true);
+    request.setMergerAcceptsArrayPartials(true);
     request.setBypassDocumentValidation(true);
+    request.setCompileExpressions(false);
+    request.setParallelism(4);
     const auto collationObj = BSON("locale"
                                    << "en_US");
     request.setCollation(collationObj);
@@ -111,7 +121,10 @@ TEST(AggregationRequestTest, ShouldSerializeOptionalValuesIfSet) {
                  {AggregationRequest::kExplainName, true},
                  {AggregationRequest::kAllowDiskUseName, true},
                  {AggregationRequest::kFromRouterName, true},
+                 {AggregationRequest::kMergerAcceptsArrayPartialsName, true},
                  {bypassDocumentValidationCommandOption(), true},
+                 {AggregationRequest::kCompileExpressionsName, false},
+                 {AggregationRequest::kParallelismName, 4},
                  {AggregationRequest::kCollationName, collationObj}};
     ASSERT_DOCUMENT_EQ(request.serializeToCommandObj(), expectedSerialization);
 }
@@ -173,12 +186,42 @@ TEST(AggregationRequestTest, ShouldRejectNonBoolFromRouter) {
     ASSERT_NOT_OK(AggregationRequest::parseFromBSON(nss, inputBson).getStatus());
 }
 
+TEST(AggregationRequestTest, ShouldRejectNonBoolMergerAcceptsArrayPartials) {
+    NamespaceString nss("a.collection");
+    const BSONObj inputBson =
+        fromjson("{pipeline: [{$match: {a: 'abc'}}], mergerAcceptsArrayPartials: 1}");
+    ASSERT_NOT_OK(AggregationRequest::parseFromBSON(nss, inputBson).getStatus());
+}
+
 TEST(AggregationRequestTest, ShouldRejectNonBoolAllowDiskUse) {
     NamespaceString nss("a.collection");
     const BSONObj inputBson = fromjson("{pipeline: [{$match: {a: 'abc'}}], allowDiskUse: 1}");
     ASSERT_NOT_OK(AggregationRequest::parseFromBSON(nss, inputBson).getStatus());
 }
 
+TEST(AggregationRequestTest, ShouldRejectNonBoolCompileExpressions) {
+    NamespaceString nss("a.collection");
+    const BSONObj inputBson =
+        fromjson("{pipeline: [{$match: {a: 'abc'}}], compileExpressions: 1}");
+    ASSERT_NOT_OK(AggregationRequest::parseFromBSON(nss, inputBson).getStatus());
+}
+
+TEST(AggregationRequestTest, ShouldRejectNonNumericParallelism) {
+    NamespaceString nss("a.collection");
+    const BSONObj inputBson = fromjson("{pipeline: [{$match: {a: 'abc'}}], parallelism: '4'}");
+    ASSERT_NOT_OK(AggregationRequest::parseFromBSON(nss, inputBson).getStatus());
+}
+
+TEST(AggregationRequestTest, ShouldRejectParallelismOutOfRange) {
+    NamespaceString nss("a.collection");
+    ASSERT_NOT_OK(AggregationRequest::parseFromBSON(
+                      nss, fromjson("{pipeline: [{$match: {a: 'abc'}}], parallelism: 0}"))
+                      .getStatus());
+    ASSERT_NOT_OK(AggregationRequest::parseFromBSON(
+                      nss, fromjson("{pipeline: [{$match: {a: 'abc'}}], parallelism: 65}"))
+                      .getStatus());
+}
+
 //
 // Ignore fields parsed elsewhere.
 //
@@ -0,0 +1,343 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/compiled_expression.h"
+
+#include <cmath>
+
+#include "mongo/platform/decimal128.h"
+#include "mongo/platform/overflow_arithmetic.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/summation.h"
+
+namespace mongo {
+
+namespace {
+
+/**
+ * Mirrors ExpressionAdd::evaluateInternal() for int, long and double operands. Returns false
+ * without setting 'out' if it finds an operand of another type before any nullish one.
+ */
+bool addNumbers(const std::vector<Value>& registers,
+                const size_t* operands,
+                size_t numOperands,
+                Value* out) {
+    // A sum of ints cannot overflow a long, so it does not need the compensated summation.
+    long long intTotal = 0;
+    size_t i = 0;
+    for (; i < numOperands && registers[operands[i]].getType() == NumberInt; ++i) {
+        intTotal += registers[operands[i]].getInt();
+    }
+    if (i == numOperands) {
+        *out = Value::createIntOrLong(intTotal);
+        return true;
+    }
+
+    DoubleDoubleSummation total;
+    BSONType totalType = NumberInt;
+    for (i = 0; i < numOperands; ++i) {
+        const Value& val = registers[operands[i]];
+        switch (val.getType()) {
+            case NumberDouble:
+                total.addDouble(val.getDouble());
+                totalType = NumberDouble;
+                break;
+            case NumberLong:
+                total.addLong(val.getLong());
+                if (totalType == NumberInt)
+                    totalType = NumberLong;
+                break;
+            case NumberInt:
+                total.addDouble(val.getInt());
+                break;
+            default:
+                if (val.nullish()) {
+                    *out = Value(BSONNULL);
+                    return true;
+                }
+                return false;
+        }
+    }
+
+    switch (totalType) {
+        case NumberLong:
+            if (total.fitsLong()) {
+                *out = Value(total.getLong());
+                return true;
+            }
+        // Fallthrough.
+        case NumberInt:
+            if (total.fitsLong()) {
+                *out = Value::createIntOrLong(total.getLong());
+                return true;
+            }
+        // Fallthrough.
+        default:
+            *out = Value(total.getDouble());
+            return true;
+    }
+}
+
+/**
+ * Mirrors ExpressionMultiply::evaluateInternal() for int, long and double operands. Returns false
+ * without setting 'out' if it finds an operand of another type before any nullish one.
+ */
+bool multiplyNumbers(const std::vector<Value>& registers,
+                     const size_t* operands,
+                     size_t numOperands,
+                     Value* out) {
+    double doubleProduct = 1;
+    long long longProduct = 1;
+    BSONType productType = NumberInt;
+
+    for (size_t i = 0; i < numOperands; ++i) {
+        const Value& val = registers[operands[i]];
+        switch (val.getType()) {
+            case NumberInt:
+            case NumberLong:
+            case NumberDouble:
+                productType = Value::getWidestNumeric(productType, val.getType());
+                doubleProduct *= val.coerceToDouble();
+                if (mongoSignedMultiplyOverflow64(longProduct, val.coerceToLong(), &longProduct)) {
+                    productType = NumberDouble;
+                }
+                break;
+            default:
+                if (val.nullish()) {
+                    *out = Value(BSONNULL);
+                    return true;
+                }
+                return false;
+        }
+    }
+
+    if (productType == NumberDouble) {
+        *out = Value(doubleProduct);
+    } else if (productType == NumberLong) {
+        *out = Value(longProduct);
+    } else {
+        *out = Value::createIntOrLong(longProduct);
+    }
+    return true;
+}
+
+Value subtractValues(const Value& lhs, const Value& rhs) {
+    if (lhs.getType() == rhs.getType()) {
+        switch (lhs.getType()) {
+            case NumberInt:
+                return Value::createIntOrLong(static_cast<long long>(lhs.getInt()) - rhs.getInt());
+            case NumberLong:
+                return Value(lhs.getLong() - rhs.getLong());
+            case NumberDouble:
+                return Value(lhs.getDouble() - rhs.getDouble());
+            case NumberDecimal:
+                return Value(lhs.getDecimal().subtract(rhs.getDecimal()));
+            default:
+                break;
+        }
+    }
+    return ExpressionSubtract::apply(lhs, rhs);
+}
+
+Value divideValues(const Value& lhs, const Value& rhs) {
+    const BSONType lhsType = lhs.getType();
+    const BSONType rhsType = rhs.getType();
+    if (lhsType == NumberDecimal && rhsType == NumberDecimal) {
+        if (!rhs.getDecimal().isZero()) {
+            return Value(lhs.getDecimal().divide(rhs.getDecimal()));
+        }
+    } else if (lhs.numeric() && rhs.numeric() && lhsType != NumberDecimal &&
+               rhsType != NumberDecimal) {
+        const double denom = rhs.coerceToDouble();
+        if (denom != 0.0) {
+            return Value(lhs.coerceToDouble() / denom);
+        }
+    }
+    return ExpressionDivide::apply(lhs, rhs);
+}
+
+template <typename T>
+int compareNumbers(T lhs, T rhs) {
+    if (lhs < rhs) {
+        return -1;
+    }
+    return lhs == rhs ? 0 : 1;
+}
+
+Value compareValues(const ExpressionCompare* expr, const Value& lhs, const Value& rhs) {
+    // Values of the same numeric type compare the same way under any collation.
+    int cmp;
+    if (lhs.getType() == NumberInt && rhs.getType() == NumberInt) {
+        cmp = compareNumbers(lhs.getInt(), rhs.getInt());
+    } else if (lhs.getType() == NumberLong && rhs.getType() == NumberLong) {
+        cmp = compareNumbers(lhs.getLong(), rhs.getLong());
+    } else if (lhs.getType() == NumberDouble && rhs.getType() == NumberDouble &&
+               !std::isnan(lhs.getDouble()) && !std::isnan(rhs.getDouble())) {
+        cmp = compareNumbers(lhs.getDouble(), rhs.getDouble());
+    } else {
+        return expr->apply(lhs, rhs);
+    }
+
+    switch (expr->getOp()) {
+        case ExpressionCompare::EQ:
+            return Value(cmp == 0);
+        case ExpressionCompare::NE:
+            return Value(cmp != 0);
+        case ExpressionCompare::GT:
+            return Value(cmp > 0);
+        case ExpressionCompare::GTE:
+            return Value(cmp >= 0);
+        case ExpressionCompare::LT:
+            return Value(cmp < 0);
+        case ExpressionCompare::LTE:
+            return Value(cmp <= 0);
+        case ExpressionCompare::CMP:
+            return Value(cmp);
+    }
+    MONGO_UNREACHABLE;
+}
+
+}  // namespace
+
+CompiledExpression::CompiledExpression(boost::intrusive_ptr<Expression> expr)
+    : _expr(std::move(expr)) {}
+
+std::unique_ptr<CompiledExpression> CompiledExpression::compile(
+    const boost::intrusive_ptr<Expression>& expr) {
+    std::unique_ptr<CompiledExpression> compiled(new CompiledExpression(expr));
+    compiled->_resultRegister = compiled->_compileNode(expr.get());
+    if (compiled->_numCompiledOperators == 0) {
+        return nullptr;
+    }
+    return compiled;
+}
+
+size_t CompiledExpression::_newRegister(Value initialValue) {
+    _registers.push_back(std::move(initialValue));
+    return _registers.size() - 1;
+}
+
+size_t CompiledExpression::_compileNode(const Expression* expr) {
+    if (auto constant = dynamic_cast<const ExpressionConstant*>(expr)) {
+        return _newRegister(constant->getValue());
+    }
+
+    Instruction instruction;
+    instruction.op = OpCode::kEvaluate;
+    instruction.expr = expr;
+    instruction.firstOperand = _operandRegisters.size();
+    instruction.numOperands = 0;
+
+    if (auto fieldPath = dynamic_cast<const ExpressionFieldPath*>(expr)) {
+        const std::string path = fieldPath->getFieldPath().fullPath();
+        for (auto&& loaded : _fieldPathRegisters) {
+            if (loaded.first->getVariableId() == fieldPath->getVariableId() &&
+                loaded.first->getFieldPath().fullPath() == path) {
+                return loaded.second;
+            }
+        }
+        instruction.destRegister = _newRegister();
+        _fieldPathRegisters.emplace_back(fieldPath, instruction.destRegister);
+        _program.push_back(instruction);
+        return instruction.destRegister;
+    }
+
+    if (dynamic_cast<const ExpressionAdd*>(expr)) {
+        instruction.op = OpCode::kAdd;
+    } else if (dynamic_cast<const ExpressionSubtract*>(expr)) {
+        instruction.op = OpCode::kSubtract;
+    } else if (dynamic_cast<const ExpressionMultiply*>(expr)) {
+        instruction.op = OpCode::kMultiply;
+    } else if (dynamic_cast<const ExpressionDivide*>(expr)) {
+        instruction.op = OpCode::kDivide;
+    } else if (dynamic_cast<const ExpressionCompare*>(expr)) {
+        instruction.op = OpCode::kCompare;
+    }
+
+    if (instruction.op != OpCode::kEvaluate) {
+        // Compile the operands first, so that their registers are written before this
+        // instruction reads them.
+        std::vector<size_t> operands;
+        for (auto&& operand : static_cast<const ExpressionNary*>(expr)->getOperandList()) {
+            operands.push_back(_compileNode(operand.get()));
+        }
+        instruction.firstOperand = _operandRegisters.size();
+        instruction.numOperands = operands.size();
+        _operandRegisters.insert(_operandRegisters.end(), operands.begin(), operands.end());
+        ++_numCompiledOperators;
+    }
+
+    instruction.destRegister = _newRegister();
+    _program.push_back(instruction);
+    return instruction.destRegister;
+}
+
+Value CompiledExpression::_execute(const Instruction& instruction, Variables* vars) const {
+    const size_t* operands = _operandRegisters.data() + instruction.firstOperand;
+    Value result;
+    switch (instruction.op) {
+        case OpCode::kEvaluate:
+            return instruction.expr->evaluateInternal(vars);
+        case OpCode::kAdd:
+            if (addNumbers(_registers, operands, instruction.numOperands, &result)) {
+                return result;
+            }
+            return instruction.expr->evaluateInternal(vars);
+        case OpCode::kMultiply:
+            if (multiplyNumbers(_registers, operands, instruction.numOperands, &result)) {
+                return result;
+            }
+            return instruction.expr->evaluateInternal(vars);
+        case OpCode::kSubtract:
+            return subtractValues(_registers[operands[0]], _registers[operands[1]]);
+        case OpCode::kDivide:
+            return divideValues(_registers[operands[0]], _registers[operands[1]]);
+        case OpCode::kCompare:
+            return compareValues(static_cast<const ExpressionCompare*>(instruction.expr),
+                                 _registers[operands[0]],
+                                 _registers[operands[1]]);
+    }
+    MONGO_UNREACHABLE;
+}
+
+Value CompiledExpression::evaluate(Variables* vars) const {
+    try {
+        for (auto&& instruction : _program) {
+            _registers[instruction.destRegister] = _execute(instruction, vars);
+        }
+    } catch (const DBException&) {
+        // The program evaluates every operand, where the tree may stop at an operand which decides
+        // the result, such as a null operand of $add. Let the tree decide whether to fail.
+        return _expr->evaluate(vars);
+    }
+    return _registers[_resultRegister];
+}
+
+}  // namespace mongo
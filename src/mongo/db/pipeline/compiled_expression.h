@@ -0,0 +1,137 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/intrusive_ptr.hpp>
+#include <memory>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+/**
+ * A register-based program equivalent to an optimized Expression tree, for evaluating the same
+ * expression against many documents without a virtual call and a recursive descent per node.
+ *
+ * The tree is flattened in post-order into instructions which each write one register:
+ *
+ *  - Constants are stored in their registers once, when the program is compiled.
+ *  - Each distinct field path is looked up once per evaluation, however many times the tree
+ *    refers to it.
+ *  - $add, $subtract, $multiply, $divide and the comparison operators read their operands from
+ *    registers and have kernels specialized for int, long, double and, where the arithmetic does
+ *    not depend on intermediate results, Decimal128 operands.
+ *  - Any other subtree is evaluated through Expression::evaluateInternal() as a single
+ *    instruction.
+ *
+ * An arithmetic instruction whose operands are not of a type its kernel handles evaluates its node
+ * of the original tree instead. If evaluation throws, the whole original tree is evaluated, since
+ * the program evaluates operands which the tree may have skipped. Results and errors are therefore
+ * the same as those of Expression::evaluate().
+ *
+ * Evaluation uses registers owned by the program, so a program must not be evaluated by more than
+ * one thread at a time.
+ */
+class CompiledExpression {
+    MONGO_DISALLOW_COPYING(CompiledExpression);
+
+public:
+    /**
+     * Compiles 'expr', which should already have been optimized. Returns nullptr if no operator in
+     * 'expr' can be compiled, in which case it should be evaluated as is.
+     */
+    static std::unique_ptr<CompiledExpression> compile(
+        const boost::intrusive_ptr<Expression>& expr);
+
+    /**
+     * Returns the same result as Expression::evaluate(vars) for the expression this was compiled
+     * from.
+     */
+    Value evaluate(Variables* vars) const;
+
+    /**
+     * Returns the number of operators in the tree which run as specialized instructions.
+     */
+    size_t numCompiledOperators() const {
+        return _numCompiledOperators;
+    }
+
+    const boost::intrusive_ptr<Expression>& getExpression() const {
+        return _expr;
+    }
+
+private:
+    enum class OpCode {
+        // Evaluates a field path, or a subtree which is not compiled, through the original tree.
+        kEvaluate,
+        kAdd,
+        kSubtract,
+        kMultiply,
+        kDivide,
+        kCompare,
+    };
+
+    struct Instruction {
+        OpCode op;
+        // The node of the original tree which this instruction evaluates.
+        const Expression* expr;
+        size_t destRegister;
+        // Range of '_operandRegisters' holding the registers of the operands.
+        size_t firstOperand;
+        size_t numOperands;
+    };
+
+    explicit CompiledExpression(boost::intrusive_ptr<Expression> expr);
+
+    /**
+     * Appends the instructions evaluating 'expr' and returns the register holding its result.
+     */
+    size_t _compileNode(const Expression* expr);
+
+    size_t _newRegister(Value initialValue = Value());
+
+    Value _execute(const Instruction& instruction, Variables* vars) const;
+
+    const boost::intrusive_ptr<Expression> _expr;
+
+    std::vector<Instruction> _program;
+    std::vector<size_t> _operandRegisters;
+    size_t _resultRegister = 0;
+    size_t _numCompiledOperators = 0;
+
+    // The register holding each distinct field path loaded by the program.
+    std::vector<std::pair<const ExpressionFieldPath*, size_t>> _fieldPathRegisters;
+
+    mutable std::vector<Value> _registers;
+};
+
+}  // namespace mongo
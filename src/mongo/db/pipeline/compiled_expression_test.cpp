@@ -0,0 +1,221 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/compiled_expression.h"
+
+#include <cmath>
+#include <limits>
+
+#include "mongo/bson/json.h"
+#include "mongo/db/pipeline/document_value_test_util.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/query/collation/collator_interface_mock.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+using boost::intrusive_ptr;
+
+/**
+ * Values covering the cases the compiled kernels special-case: every numeric type, overflow,
+ * NaN, infinities and signed zeros, null, undefined and missing values, and the non-numeric types
+ * the arithmetic operators accept or reject.
+ */
+std::vector<Value> testValues() {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double inf = std::numeric_limits<double>::infinity();
+    return {
+        Value(),
+        Value(BSONNULL),
+        Value(BSONUndefined),
+        Value(0),
+        Value(1),
+        Value(-3),
+        Value(std::numeric_limits<int>::max()),
+        Value(5LL),
+        Value(std::numeric_limits<long long>::max()),
+        Value(std::numeric_limits<long long>::min()),
+        Value(1.5),
+        Value(0.1),
+        Value(0.0),
+        Value(-0.0),
+        Value(nan),
+        Value(inf),
+        Value(-inf),
+        Value(Decimal128("2.5")),
+        Value(Decimal128("0")),
+        Value("abc"_sd),
+        Value("abd"_sd),
+        Value(Date_t::fromMillisSinceEpoch(1000)),
+        Value(std::vector<Value>{Value(1), Value(2)}),
+        Value(Document{{"x", 1}}),
+    };
+}
+
+/**
+ * Documents holding every pair of test values in 'a' and 'b'. Every other document also has a
+ * string 's'.
+ */
+std::vector<Document> testDocuments() {
+    std::vector<Document> docs;
+    for (auto&& a : testValues()) {
+        for (auto&& b : testValues()) {
+            MutableDocument doc;
+            doc.addField("a", a);
+            doc.addField("b", b);
+            if (docs.size() % 2 == 0) {
+                doc.addField("s", Value("str"_sd));
+            }
+            docs.push_back(doc.freeze());
+        }
+    }
+    return docs;
+}
+
+struct Outcome {
+    Value value;
+    int errorCode = 0;
+};
+
+Outcome evaluate(stdx::function<Value()> fn) {
+    Outcome outcome;
+    try {
+        outcome.value = fn();
+    } catch (const DBException& ex) {
+        outcome.errorCode = ex.getCode();
+    }
+    return outcome;
+}
+
+intrusive_ptr<Expression> parse(const std::string& json,
+                                const intrusive_ptr<ExpressionContext>& expCtx) {
+    VariablesIdGenerator idGenerator;
+    VariablesParseState vps(&idGenerator);
+    BSONObj spec = fromjson("{expr: " + json + "}");
+    intrusive_ptr<Expression> expr = Expression::parseOperand(spec.firstElement(), vps);
+    expr->injectExpressionContext(expCtx);
+    return expr->optimize();
+}
+
+/**
+ * Parses and compiles 'json' and checks that the compiled program returns the same value or error
+ * as the expression on every test document. Returns the number of compiled operators.
+ */
+size_t assertSameResults(const std::string& json,
+                         intrusive_ptr<ExpressionContext> expCtx = new ExpressionContext()) {
+    intrusive_ptr<Expression> expr = parse(json, expCtx);
+    std::unique_ptr<CompiledExpression> compiled = CompiledExpression::compile(expr);
+    ASSERT(compiled);
+
+    for (auto&& doc : testDocuments()) {
+        Variables vars(0, doc);
+        Outcome expected = evaluate([&] { return expr->evaluate(&vars); });
+        Outcome actual = evaluate([&] { return compiled->evaluate(&vars); });
+
+        const std::string context = json + " on " + doc.toString();
+        ASSERT_EQUALS(expected.errorCode, actual.errorCode) << context;
+        ASSERT_EQUALS(expected.value.getType(), actual.value.getType()) << context;
+        ASSERT_VALUE_EQ(expected.value, actual.value);
+        if (expected.value.getType() == NumberDouble) {
+            ASSERT_EQUALS(std::signbit(expected.value.getDouble()),
+                          std::signbit(actual.value.getDouble()))
+                << context;
+        }
+    }
+    return compiled->numCompiledOperators();
+}
+
+TEST(CompiledExpressionTest, Add) {
+    ASSERT_EQUALS(1U, assertSameResults("{$add: ['$a', '$b']}"));
+    ASSERT_EQUALS(1U, assertSameResults("{$add: ['$a', '$b', 1]}"));
+    ASSERT_EQUALS(1U, assertSameResults("{$add: ['$a', 0.1, '$b']}"));
+    ASSERT_EQUALS(1U, assertSameResults("{$add: ['$a', {$numberLong: '1'}]}"));
+}
+
+TEST(CompiledExpressionTest, Subtract) {
+    ASSERT_EQUALS(1U, assertSameResults("{$subtract: ['$a', '$b']}"));
+    ASSERT_EQUALS(1U, assertSameResults("{$subtract: ['$a', 1]}"));
+}
+
+TEST(CompiledExpressionTest, Multiply) {
+    ASSERT_EQUALS(1U, assertSameResults("{$multiply: ['$a', '$b']}"));
+    ASSERT_EQUALS(1U, assertSameResults("{$multiply: ['$a', '$b', 2]}"));
+}
+
+TEST(CompiledExpressionTest, Divide) {
+    ASSERT_EQUALS(1U, assertSameResults("{$divide: ['$a', '$b']}"));
+    ASSERT_EQUALS(1U, assertSameResults("{$divide: ['$a', 2]}"));
+}
+
+TEST(CompiledExpressionTest, Compare) {
+    for (auto&& op : {"$eq", "$ne", "$gt", "$gte", "$lt", "$lte", "$cmp"}) {
+        ASSERT_EQUALS(1U, assertSameResults(std::string("{") + op + ": ['$a', '$b']}"));
+    }
+}
+
+TEST(CompiledExpressionTest, CompareUsesCollation) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    expCtx->setCollator(
+        stdx::make_unique<CollatorInterfaceMock>(CollatorInterfaceMock::MockType::kReverseString));
+    ASSERT_EQUALS(1U, assertSameResults("{$lt: ['$a', '$b']}", expCtx));
+}
+
+TEST(CompiledExpressionTest, NestedOperatorsShareFieldPaths) {
+    ASSERT_EQUALS(2U, assertSameResults("{$add: ['$a', {$multiply: ['$a', '$b']}]}"));
+    ASSERT_EQUALS(3U,
+                  assertSameResults("{$gt: [{$subtract: ['$a', '$b']}, {$divide: ['$b', 3]}]}"));
+    ASSERT_EQUALS(1U, assertSameResults("{$add: ['$$CURRENT.a', '$a', '$$ROOT.a']}"));
+}
+
+TEST(CompiledExpressionTest, UncompiledOperandsAreEvaluatedByTheTree) {
+    ASSERT_EQUALS(1U, assertSameResults("{$add: ['$a', {$strLenCP: '$s'}]}"));
+    ASSERT_EQUALS(1U, assertSameResults("{$subtract: [{$size: '$b'}, '$a']}"));
+    ASSERT_EQUALS(2U,
+                  assertSameResults("{$add: [{$cond: [{$eq: ['$a', 1]}, '$b', 0]}, '$b']}"));
+}
+
+TEST(CompiledExpressionTest, ErrorsInOperandsTheTreeSkipsAreNotReported) {
+    // $add stops at a null operand, so it never evaluates $strLenCP for documents without 's'.
+    ASSERT_EQUALS(1U, assertSameResults("{$add: ['$a', {$strLenCP: '$s'}, '$b']}"));
+    ASSERT_EQUALS(1U, assertSameResults("{$multiply: ['$b', {$concat: ['$a']}]}"));
+}
+
+TEST(CompiledExpressionTest, DoesNotCompileExpressionsWithoutOperators) {
+    intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    ASSERT_FALSE(CompiledExpression::compile(parse("'$a'", expCtx)));
+    ASSERT_FALSE(CompiledExpression::compile(parse("{$add: [1, 2]}", expCtx)));
+    ASSERT_FALSE(CompiledExpression::compile(parse("{$concat: ['$s', 'x']}", expCtx)));
+    ASSERT_FALSE(CompiledExpression::compile(parse("{$strLenCP: {$concat: ['$s']}}", expCtx)));
+}
+
+}  // namespace
+}  // namespace mongo
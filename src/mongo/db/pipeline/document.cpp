@@ -45,6 +45,24 @@ using std::vector;
 const DocumentStorage DocumentStorage::kEmptyDoc;
 
 Position DocumentStorage::findField(StringData requested) const {
+    Position pos = findConvertedField(requested);
+    if (pos.found() || !hasLazyFields()) {
+        return pos;
+    }
+
+    // Look for the field by name before converting anything, so that looking up a field which is
+    // not in the document does not convert all of it.
+    for (int offset = _lazyBsonOffset; offset < _bson.objsize() - 1;) {
+        BSONElement elem(_bson.objdata() + offset);
+        if (elem.fieldNameStringData() == requested && !isStrippedMetadataField(requested)) {
+            return loadLazyFields(offset);
+        }
+        offset += elem.size();
+    }
+    return Position();
+}
+
+Position DocumentStorage::findConvertedField(StringData requested) const {
     int reqSize = requested.size();  // get size calculation out of the way if needed
 
     if (_numFields >= HASH_TAB_MIN) {  // hash lookup
@@ -61,7 +79,7 @@ Position DocumentStorage::findField(StringData requested) const {
             pos = elem.nextCollision;
         }
     } else {  // linear scan
-        for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
+        for (DocumentStorageIterator it = convertedFields(); !it.atEnd(); it.advance()) {
             if (it->nameLen == reqSize && memcmp(requested.rawData(), it->_name, reqSize) == 0) {
                 return it.position();
             }
@@ -73,7 +91,12 @@ Position DocumentStorage::findField(StringData requested) const {
 }
 
 Value& DocumentStorage::appendField(StringData name) {
-    Position pos = getNextPosition();
+    loadAllLazyFields();
+    return appendConvertedField(name);
+}
+
+Value& DocumentStorage::appendConvertedField(StringData name) {
+    Position pos(_usedBytes);
     const int nameSize = name.size();
 
     // these are the same for everyone
@@ -182,6 +205,7 @@ void DocumentStorage::reserveFields(size_t expectedFields) {
 }
 
 intrusive_ptr<DocumentStorage> DocumentStorage::clone() const {
+    loadAllLazyFields();
     intrusive_ptr<DocumentStorage> out(new DocumentStorage());
 
     // Make a copy of the buffer.
@@ -210,11 +234,80 @@ intrusive_ptr<DocumentStorage> DocumentStorage::clone() const {
 DocumentStorage::~DocumentStorage() {
     std::unique_ptr<char[]> deleteBufferAtScopeEnd(_buffer);
 
-    for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance()) {
+    for (DocumentStorageIterator it = convertedFields(); !it.atEnd(); it.advance()) {
         it->val.~Value();  // explicit destructor call
     }
 }
 
+intrusive_ptr<DocumentStorage> DocumentStorage::fromBsonLazily(const BSONObj& bson,
+                                                               bool stripMetadata) {
+    dassert(bson.isOwned());
+    intrusive_ptr<DocumentStorage> out(new DocumentStorage());
+    if (bson.isEmpty()) {
+        return out;
+    }
+
+    out->_bson = bson;
+    out->_lazyBsonOffset = 4;  // skip the object size
+
+    if (stripMetadata) {
+        // Metadata must be available before any field is converted, but only the field names need
+        // to be read to find it.
+        BSONObjIterator it(bson);
+        while (it.more()) {
+            BSONElement elem(it.next());
+            auto fieldName = elem.fieldNameStringData();
+            if (fieldName[0] != '$') {
+                continue;
+            }
+            if (fieldName == Document::metaFieldTextScore) {
+                out->setTextScore(elem.Double());
+                out->_stripMetadata = true;
+            } else if (fieldName == Document::metaFieldRandVal) {
+                out->setRandMetaField(elem.Double());
+                out->_stripMetadata = true;
+            }
+        }
+    }
+
+    return out;
+}
+
+bool DocumentStorage::isStrippedMetadataField(StringData name) const {
+    return _stripMetadata && name[0] == '$' &&
+        (name == Document::metaFieldTextScore || name == Document::metaFieldRandVal);
+}
+
+Position DocumentStorage::loadLazyFields(int lastOffset) const {
+    // Converting fields only appends them to the buffer, which does not change the Document this
+    // storage represents.
+    DocumentStorage* self = const_cast<DocumentStorage*>(this);
+
+    Position pos;
+    while (hasLazyFields()) {
+        const int offset = _lazyBsonOffset;
+        BSONElement elem(_bson.objdata() + offset);
+        if (elem.eoo()) {
+            // Everything has been converted, so the buffer no longer needs the BSONObj.
+            self->_lazyBsonOffset = 0;
+            self->_bson = BSONObj();
+            break;
+        }
+        self->_lazyBsonOffset += elem.size();
+
+        auto fieldName = elem.fieldNameStringData();
+        if (!isStrippedMetadataField(fieldName)) {
+            pos = Position(_usedBytes);
+            self->appendConvertedField(fieldName) = Value(elem);
+        }
+
+        if (offset == lastOffset) {
+            break;
+        }
+    }
+    return pos;
+}
+
 Document::Document(const BSONObj& bson) {
     MutableDocument md(bson.nFields());
 
@@ -245,6 +338,18 @@ BSONObjBuilder& operator<<(BSONObjBuilderValueStream& builder, const Document& d
 }
 
 void Document::toBson(BSONObjBuilder* pBuilder) const {
+    if (storage().hasLazyFields()) {
+        // The fields are those of the BSONObj this was created from, so copy them directly.
+        BSONObjIterator it(storage().lazyBson());
+        while (it.more()) {
+            BSONElement elem(it.next());
+            if (!storage().isStrippedMetadataField(elem.fieldNameStringData())) {
+                pBuilder->append(elem);
+            }
+        }
+        return;
+    }
+
     for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
         *pBuilder << it->nameSD() << it->val;
     }
@@ -293,6 +398,14 @@ Document Document::fromBsonWithMetaData(const BSONObj& bson) {
     return md.freeze();
 }
 
+Document Document::fromBsonLazily(const BSONObj& bson) {
+    return Document(DocumentStorage::fromBsonLazily(bson.getOwned(), false).get());
+}
+
+Document Document::fromBsonWithMetaDataLazily(const BSONObj& bson) {
+    return Document(DocumentStorage::fromBsonLazily(bson.getOwned(), true).get());
+}
+
 MutableDocument::MutableDocument(size_t expectedFields)
     : _storageHolder(NULL), _storage(_storageHolder) {
     if (expectedFields) {
@@ -365,7 +478,8 @@ size_t Document::getApproximateSize() const {
     size_t size = sizeof(DocumentStorage);
     size += storage().allocatedBytes();
 
-    for (DocumentStorageIterator it = storage().iterator(); !it.atEnd(); it.advance()) {
+    // Fields which have not been converted yet are included in allocatedBytes().
+    for (DocumentStorageIterator it = storage().convertedIterator(); !it.atEnd(); it.advance()) {
         size += it->val.getApproximateSize();
         size -= sizeof(Value);  // already accounted for above
     }
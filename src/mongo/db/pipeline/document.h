@@ -211,6 +211,22 @@ public:
      */
     static Document fromBsonWithMetaData(const BSONObj& bson);
 
+    /**
+     * Like Document(BSONObj), but keeps a reference to 'bson' and only converts its fields when
+     * they are looked up, in order up to the field requested. Iterating over or modifying the
+     * Document converts all fields. This is cheaper when only fields near the start of a wide
+     * object are used. 'bson' is copied if it is not owned.
+     *
+     * Lookups may modify the returned Document's storage, so it must not be read from several
+     * threads at once.
+     */
+    static Document fromBsonLazily(const BSONObj& bson);
+
+    /**
+     * Like fromBsonWithMetaData(), but converts fields lazily as fromBsonLazily() does.
+     */
+    static Document fromBsonWithMetaDataLazily(const BSONObj& bson);
+
     // Support BSONObjBuilder and BSONArrayBuilder "stream" API
     friend BSONObjBuilder& operator<<(BSONObjBuilderValueStream& builder, const Document& d);
 
@@ -33,6 +33,7 @@
 #include <bitset>
 #include <boost/intrusive_ptr.hpp>
 
+#include "mongo/bson/bsonobj.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/util/intrusive_counter.h"
 
@@ -178,7 +179,14 @@ private:
     bool _includeMissing;
 };
 
-/// Storage class used by both Document and MutableDocument
+/** Storage class used by both Document and MutableDocument
+ *
+ *  Storage created by fromBsonLazily() keeps the BSONObj it was created from and converts its
+ *  fields into the buffer in order, only as far as the last field looked up so far. Everything
+ *  else converts the remaining fields first, so Positions and iteration order are the same as for
+ *  storage built eagerly. Because lookups may convert fields, lazily loaded storage must not be
+ *  read from several threads at once.
+ */
 class DocumentStorage : public RefCountable {
 public:
     DocumentStorage()
@@ -189,7 +197,9 @@ public:
           _hashTabMask(0),
           _metaFields(),
           _textScore(0),
-          _randVal(0) {}
+          _randVal(0),
+          _lazyBsonOffset(0),
+          _stripMetadata(false) {}
 
     ~DocumentStorage();
 
@@ -204,6 +214,30 @@ public:
         return kEmptyDoc;
     }
 
+    /**
+     * Returns storage whose fields are converted from 'bson' the first time they are needed. If
+     * 'stripMetadata' is true, top-level metadata fields are read as by
+     * Document::fromBsonWithMetaData(). 'bson' must be owned.
+     */
+    static boost::intrusive_ptr<DocumentStorage> fromBsonLazily(const BSONObj& bson,
+                                                                bool stripMetadata);
+
+    /// True if some fields of the BSONObj this was created from have not been converted yet.
+    bool hasLazyFields() const {
+        return _lazyBsonOffset != 0;
+    }
+
+    /**
+     * If this has lazy fields, returns the BSONObj this was created from, which then has the same
+     * fields as this apart from metadata. Returns an empty BSONObj otherwise.
+     */
+    const BSONObj& lazyBson() const {
+        return _bson;
+    }
+
+    /// True if 'name' is a field of the BSONObj this was created from which holds metadata.
+    bool isStrippedMetadataField(StringData name) const;
+
     size_t size() const {
         // can't use _numFields because it includes removed Fields
         size_t count = 0;
@@ -214,6 +248,7 @@ public:
 
     /// Returns the position of the next field to be inserted
     Position getNextPosition() const {
+        loadAllLazyFields();
         return Position(_usedBytes);
     }
 
@@ -235,9 +270,11 @@ public:
     // MutableDocument uses these
     ValueElement& getField(Position pos) {
         verify(pos.found());
+        loadAllLazyFields();
         return *(_firstElement->plusBytes(pos.index));
     }
     Value& getField(StringData name) {
+        loadAllLazyFields();
         Position pos = findField(name);
         if (!pos.found())
             return appendField(name);  // TODO: find a way to avoid hashing name twice
@@ -254,19 +291,27 @@ public:
 
     /// This skips missing values
     DocumentStorageIterator iterator() const {
+        loadAllLazyFields();
         return DocumentStorageIterator(_firstElement, end(), false);
     }
 
     /// This includes missing values
     DocumentStorageIterator iteratorAll() const {
+        loadAllLazyFields();
         return DocumentStorageIterator(_firstElement, end(), true);
     }
 
+    /// Like iterator(), but only over the fields which have been converted from lazy BSON so far.
+    DocumentStorageIterator convertedIterator() const {
+        return DocumentStorageIterator(_firstElement, end(), false);
+    }
+
     /// Shallow copy of this. Caller owns memory.
     boost::intrusive_ptr<DocumentStorage> clone() const;
 
     size_t allocatedBytes() const {
-        return !_buffer ? 0 : (_bufferEnd - _buffer + hashTabBytes());
+        return (!_buffer ? 0 : (_bufferEnd - _buffer + hashTabBytes())) +
+            (hasLazyFields() ? _bson.objsize() - _lazyBsonOffset : 0);
     }
 
     /**
@@ -305,6 +350,32 @@ public:
     }
 
 private:
+    /// Fields already in the buffer, including missing values. Does not convert lazy fields.
+    DocumentStorageIterator convertedFields() const {
+        return DocumentStorageIterator(_firstElement, end(), true);
+    }
+
+    /// Position of the named field among those already in the buffer, or Position().
+    Position findConvertedField(StringData name) const;
+
+    /// Appends a field with missing Value without converting lazy fields first.
+    Value& appendConvertedField(StringData name);
+
+    /**
+     * Converts the lazy fields up to and including the one at 'lastOffset' in _bson, or all of
+     * them if 'lastOffset' is 0. Returns the position of the last field converted.
+     *
+     * Converting fields does not change the logical contents of the document, so this is const
+     * like the lookups which call it.
+     */
+    Position loadLazyFields(int lastOffset = 0) const;
+
+    void loadAllLazyFields() const {
+        if (MONGO_unlikely(hasLazyFields())) {
+            loadLazyFields();
+        }
+    }
+
     /// Same as lastElement->next() or firstElement() if empty.
     const ValueElement* end() const {
         return _firstElement ? _firstElement->plusBytes(_usedBytes) : nullptr;
@@ -348,7 +419,7 @@ private:
     /// Adds all fields to the hash table
     void rehash() {
         hashTabInit();
-        for (DocumentStorageIterator it = iteratorAll(); !it.atEnd(); it.advance())
+        for (DocumentStorageIterator it = convertedFields(); !it.atEnd(); it.advance())
             addFieldToHashTable(it.position());
     }
 
@@ -387,6 +458,11 @@ private:
     double _randVal;
     // When adding a field, make sure to update clone() method
 
+    // The BSONObj lazily loaded storage was created from, until all of its fields are converted.
+    BSONObj _bson;
+    int _lazyBsonOffset;  // offset in _bson of the first field not yet converted, 0 if none
+    bool _stripMetadata;  // _bson has top-level metadata fields which are not converted
+
     // Defined in document.cpp
     static const DocumentStorage kEmptyDoc;
 };
@@ -344,6 +344,30 @@ public:
     // Wraps mongod-specific functions to allow linking into mongos.
     class MongodInterface {
     public:
+        /**
+         * Finds the documents of a collection whose value at some field equals a given value, by
+         * seeking an index on that field. The index is chosen once, when the probe is made, so a
+         * lookup does not parse, canonicalize or plan a query.
+         */
+        class LookupIndexProbe {
+        public:
+            virtual ~LookupIndexProbe() = default;
+
+            /**
+             * Looks up each of 'values', seeking the index in key order, and returns the matching
+             * documents for each value at the same position. A position is boost::none if that
+             * value cannot be looked up in the index, or its matches would exceed the maximum
+             * document size; the caller must then query the collection instead.
+             */
+            virtual std::vector<boost::optional<std::vector<Document>>> lookup(
+                const std::vector<Value>& values) = 0;
+
+            virtual const std::string& getIndexName() const = 0;
+
+            long long keysExamined = 0;
+            long long docsExamined = 0;
+        };
+
         virtual ~MongodInterface(){};
 
         /**
@@ -404,6 +428,22 @@ public:
             const std::vector<BSONObj>& rawPipeline,
             const boost::intrusive_ptr<ExpressionContext>& expCtx) = 0;
 
+        /**
+         * Returns the number of documents in the collection 'nss' and their total size in bytes, as
+         * tracked by the storage engine. Both are zero if the collection does not exist.
+         */
+        virtual std::pair<long long, long long> getCollectionSize(const NamespaceString& nss) = 0;
+
+        /**
+         * Returns a probe for documents in 'expCtx->ns' whose 'field' equals a given value and
+         * which also match 'filter', or nullptr if there is no index which can answer such lookups
+         * with the same results as a query.
+         */
+        virtual std::unique_ptr<LookupIndexProbe> makeLookupIndexProbe(
+            const boost::intrusive_ptr<ExpressionContext>& expCtx,
+            const FieldPath& field,
+            const BSONObj& filter) = 0;
+
         // Add new methods as needed.
     };
 
@@ -624,6 +664,55 @@ public:
         return _streaming;
     }
 
+    bool isDoingMerge() const {
+        return _doingMerge;
+    }
+
+    /**
+     * Overrides the approximate memory this stage may use before it spills, which defaults to
+     * internalDocumentSourceGroupMaxMemoryBytes.
+     */
+    void setMaxMemoryUsageBytes(int maxMemoryUsageBytes) {
+        _maxMemoryUsageBytes = maxMemoryUsageBytes;
+    }
+
+    /**
+     * Returns true if every accumulator produces the same result no matter in which order the
+     * documents of a group, or the partial aggregates built from disjoint subsets of them, are
+     * added. The partial groups of such a stage can be built from any split of its input.
+     */
+    bool accumulatorsIgnoreInputOrder() const;
+
+    /**
+     * Counters describing how much work this $group did on disk. Reported in explain output once
+     * the stage has spilled.
+     */
+    struct SpillStats {
+        // Number of times the in-memory groups were written out to disk, at any partition level.
+        long long spills = 0;
+
+        // Size of the serialized group keys and accumulator states handed to the spill files.
+        long long spilledBytes = 0;
+
+        // Bytes which actually went to and came back from disk, after compression.
+        long long bytesWritten = 0;
+        long long bytesRead = 0;
+
+        // Number of spill partitions which were read back and re-aggregated.
+        long long partitionsProcessed = 0;
+
+        // Deepest level of recursive partitioning required for a partition to fit in memory.
+        int maxPartitionLevel = 0;
+    };
+
+    SpillStats getSpillStats() const {
+        SpillStats stats = _spillStats;
+        stats.spilledBytes = _spillFileStats->bytesSpilled;
+        stats.bytesWritten = _spillFileStats->bytesWritten;
+        stats.bytesRead = _spillFileStats->bytesRead;
+        return stats;
+    }
+
     // Virtuals for SplittableDocumentSource.
     boost::intrusive_ptr<DocumentSource> getShardSource() final;
     boost::intrusive_ptr<DocumentSource> getMergeSource() final;
@@ -658,11 +747,46 @@ private:
     void initialize();
 
     /**
-     * Spill groups map to disk and returns an iterator to the file. Note: Since a sorted $group
-     * does not exhaust the previous stage before returning, and thus does not maintain as large a
-     * store of documents at any one time, only an unsorted group can spill to disk.
+     * A run of spilled groups which all hash to the same partition at 'level'. Partitions are
+     * re-aggregated one at a time; a partition that still doesn't fit in memory is split again at
+     * 'level' + 1.
+     */
+    struct SpilledPartition {
+        std::shared_ptr<Sorter<Value, Value>::Iterator> iterator;
+        int level;
+    };
+
+    /**
+     * Writes every group in the groups map to the partition its _id hashes to at 'level', then
+     * clears the map. Note: Since a sorted $group does not exhaust the previous stage before
+     * returning, and thus does not maintain as large a store of documents at any one time, only an
+     * unsorted group can spill to disk.
+     */
+    void spill(int level);
+
+    /**
+     * Closes the partitions written by spill() and queues them up to be re-aggregated by
+     * getNextSpilled().
+     */
+    void finishSpilledPartitions(int level);
+
+    /**
+     * Reads back all of the groups in 'partition', merging those with equal _ids into the groups
+     * map. Recursively partitions the data if it exceeds the memory limit.
+     */
+    void loadSpilledPartition(const SpilledPartition& partition);
+
+    /**
+     * Returns which of the spill partitions at 'level' the group key 'id' belongs to.
+     */
+    size_t getSpillPartition(const Value& id, int level) const;
+
+    /**
+     * Converts the accumulators of one group to the Value that is written to disk when spilling,
+     * and merges such a Value back into 'accums'.
      */
-    std::shared_ptr<Sorter<Value, Value>::Iterator> spill();
+    Value getSpillState(const Accumulators& accums) const;
+    void mergeSpillState(const Value& state, const Accumulators& accums) const;
 
     Document makeDocument(const Value& id, const Accumulators& accums, bool mergeableOutput);
 
@@ -676,6 +800,13 @@ private:
      */
     Value computeId(Variables* vars);
 
+    /**
+     * Returns true if this stage merges partial aggregates whose group key and accumulator inputs
+     * are the top-level fields of the same names, as is the case for a stage built by
+     * getMergeSource(). Such a stage can read them from its input without evaluating expressions.
+     */
+    bool readsPartialsByFieldName() const;
+
     /**
      * Converts the internal representation of the group key to the _id shape specified by the
      * user.
@@ -712,14 +843,20 @@ private:
 
     bool _spilled;
 
-    // Only used when '_spilled' is false.
+    // Iterates over the groups map, which holds either all groups or, once we have spilled, the
+    // groups of the partition currently being returned.
     GroupsMap::iterator groupsIterator;
 
-    // Only used when '_spilled' is true.
-    std::unique_ptr<Sorter<Value, Value>::Iterator> _sorterIterator;
+    // Only used when '_spilled' is true. The writers for the partitions currently being spilled,
+    // indexed by partition number and created lazily, and the partitions which have been fully
+    // written but not yet re-aggregated. The latter is processed as a stack so that a partition
+    // which had to be split is finished before any of its siblings are opened.
+    std::vector<std::unique_ptr<SortedFileWriter<Value, Value>>> _partitionWriters;
+    std::vector<SpilledPartition> _spilledPartitions;
+    SpillStats _spillStats;
+    const std::shared_ptr<SorterFileStats> _spillFileStats;
     const bool _extSortAllowed;
 
-    std::pair<Value, Value> _firstPartOfNextGroup;
     // Only used when '_sorted' is true.
     boost::optional<Document> _firstDocOfNextGroup;
 };
@@ -1392,6 +1529,21 @@ public:
         return limitSrc;
     }
 
+    /**
+     * Returns true if this stage merges the pre-sorted output of the shards rather than sorting
+     * its input itself.
+     */
+    bool isMergingPresorted() const {
+        return _mergingPresorted;
+    }
+
+    /**
+     * Extracts the sort key from 'd'. For a compound sort the key is an array with one entry per
+     * component of the sort pattern, in order; missing components are represented by a missing
+     * Value.
+     */
+    Value extractKey(const Document& d) const;
+
 private:
     explicit DocumentSourceSort(const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
 
@@ -1420,9 +1572,6 @@ private:
     SortKey vSortKey;
     std::vector<char> vAscending;  // used like std::vector<bool> but without specialization
 
-    /// Extracts the fields in vSortKey from the Document;
-    Value extractKey(const Document& d) const;
-
     /// Compare two Values according to the specified sort key.
     int compare(const Value& lhs, const Value& rhs) const;
 
@@ -1456,6 +1605,13 @@ private:
     bool _mergingPresorted;
     std::unique_ptr<MySorter> _sorter;
     std::unique_ptr<MySorter::Iterator> _output;
+
+    // I/O done on the files the sorter spills to, reported in explain output once it has spilled.
+    const std::shared_ptr<SorterFileStats> _spillFileStats;
+
+    // Documents a top-k sort threw away because they could not make the limit, reported in explain
+    // output once any were discarded.
+    const std::shared_ptr<SorterTopKStats> _topKStats;
 };
 
 class DocumentSourceSkip final : public DocumentSource, public SplittableDocumentSource {
@@ -1725,6 +1881,51 @@ private:
 
     boost::optional<Document> unwindResult();
 
+    /**
+     * Returns the next input document joined with its matches, looking up the matches for a batch
+     * of input documents at a time through '_indexProbe'.
+     */
+    boost::optional<Document> probedResult();
+
+    /**
+     * Returns the next input document joined with its matches from '_hashJoinTable'.
+     */
+    boost::optional<Document> hashJoinResult();
+
+    /**
+     * Returns 'input' with 'matches' as its '_as' field.
+     */
+    Document joinResult(Document input, std::vector<Document> matches) const;
+
+    /**
+     * Builds '_hashJoinTable' once the input documents looked up so far suggest that reading the
+     * whole foreign side once costs less than looking up the remaining input documents one by one.
+     */
+    void maybeBuildHashJoinTable();
+
+    /**
+     * Returns the foreign documents which a query for 'localValue' would match, from
+     * '_hashJoinTable', or boost::none if that query must be run instead.
+     */
+    boost::optional<std::vector<Document>> hashJoinMatches(const Value& localValue) const;
+
+    /**
+     * Returns the next match for '_input' when handling an $unwind, from either '_pipeline' or
+     * '_probedMatches'.
+     */
+    boost::optional<Document> nextMatch();
+
+    /**
+     * Returns 'input' joined with the result of querying the foreign collection.
+     */
+    Document queryResult(Document input);
+
+    /**
+     * Returns a probe which answers this $lookup's queries from an index on the foreign field, or
+     * nullptr if they must be run as queries.
+     */
+    std::unique_ptr<MongodInterface::LookupIndexProbe> makeIndexProbe(const BSONObj& filter) const;
+
     NamespaceString _fromNs;
     FieldPath _as;
     FieldPath _localField;
@@ -1751,6 +1952,42 @@ private:
     boost::intrusive_ptr<Pipeline> _pipeline;
     boost::optional<Document> _input;
     boost::optional<Document> _nextValue;
+
+    // Used instead of '_pipeline' when the matches for '_input' were found through '_indexProbe'.
+    std::vector<Document> _probedMatches;
+    size_t _probedMatchIndex = 0;
+
+    // Made on the first call to getNext(), if the foreign collection has a suitable index.
+    std::unique_ptr<MongodInterface::LookupIndexProbe> _indexProbe;
+    bool _madeIndexProbe = false;
+
+    // Input documents which have been joined with their matches but not yet returned.
+    std::deque<Document> _probedResults;
+
+    // Every document on the foreign side, and the positions of the documents with each value of
+    // the foreign field, hashed with the collation of the foreign side.
+    struct HashJoinTable {
+        explicit HashJoinTable(const ValueComparator& comparator)
+            : buckets(comparator.makeUnorderedValueMap<std::vector<size_t>>()) {}
+
+        std::vector<Document> documents;
+        ValueUnorderedMap<std::vector<size_t>> buckets;
+        size_t memoryUsageBytes = 0;
+    };
+    std::unique_ptr<HashJoinTable> _hashJoinTable;
+
+    // Set if the foreign side is known to be too big for '_hashJoinTable'.
+    bool _hashJoinRejected = false;
+
+    // The number of documents and bytes in the foreign collection, once they have been needed.
+    boost::optional<std::pair<long long, long long>> _foreignCollectionSize;
+
+    // Reported by explain.
+    long long _numLookups = 0;
+    long long _numIndexLookups = 0;
+    long long _numHashJoinLookups = 0;
+    long long _hashJoinBuildMicros = 0;
+    long long _lookupMicros = 0;
 };
 
 class DocumentSourceGraphLookUp final : public DocumentSourceNeedsMongod {
@@ -1818,15 +2055,37 @@ private:
     }
 
     /**
-     * Prepares the query to execute on the 'from' collection wrapped in a $match by using the
-     * contents of '_frontier'.
-     *
-     * Fills 'cached' with any values that were retrieved from the cache.
-     *
-     * Returns boost::none if no query is necessary, i.e., all values were retrieved from the cache.
-     * Otherwise, returns a query object.
+     * Removes the values of '_frontier' which are in the cache, and fills 'cached' with the
+     * documents cached for them.
+     */
+    void takeCachedValuesFromFrontier(BSONObjSet* cached);
+
+    /**
+     * Prepares the query to execute on the 'from' collection for the values in 'batch', wrapped in
+     * a $match.
+     */
+    BSONObj makeMatchStageFromBatch(const ValueUnorderedSet& batch) const;
+
+    /**
+     * Adjusts '_batchSize' after a query for 'numValues' values found documents totalling
+     * 'resultBytes', so that the next query finds about a tenth of the memory limit.
+     */
+    void updateBatchSize(size_t numValues, size_t resultBytes);
+
+    /**
+     * Writes the documents in '_visited' to '_visitedWriter', keeping only their '_id's in memory.
      */
-    boost::optional<BSONObj> makeMatchStageFromFrontier(BSONObjSet* cached);
+    void spillVisited();
+
+    /**
+     * Returns whether there are documents found for '_input' that have not been returned yet.
+     */
+    bool hasVisitedLeft() const;
+
+    /**
+     * Removes and returns one of the documents found for '_input', whether in memory or spilled.
+     */
+    Value takeVisited();
 
     /**
      * If we have internalized a $unwind, getNext() dispatches to this function.
@@ -1883,7 +2142,7 @@ private:
     // The aggregation pipeline to perform against the '_from' namespace.
     std::vector<BSONObj> _fromPipeline;
 
-    size_t _maxMemoryUsageBytes = 100 * 1024 * 1024;
+    size_t _maxMemoryUsageBytes;
 
     // Track memory usage to ensure we don't exceed '_maxMemoryUsageBytes'.
     size_t _visitedUsageBytes = 0;
@@ -1899,6 +2158,20 @@ private:
     // using the simple collation.
     ValueUnorderedMap<BSONObj> _visited;
 
+    // The '_id's of the nodes discovered for a given input which have been spilled to disk, and
+    // the file they are spilled to while the search is running. The file is read back through
+    // '_spilledVisited' once the search is done.
+    ValueUnorderedSet _spilledVisitedIds;
+    std::unique_ptr<SortedFileWriter<Value, Value>> _visitedWriter;
+    std::unique_ptr<Sorter<Value, Value>::Iterator> _spilledVisited;
+    std::shared_ptr<SorterFileStats> _spillFileStats;
+    bool _extSortAllowed;
+    long long _numSpills = 0;
+
+    // How many frontier values to query for at once.
+    size_t _batchSize;
+    long long _numQueries = 0;
+
     // Caches query results to avoid repeating any work. This structure is maintained across calls
     // to getNext().
     LookupSetCache _cache;
@@ -37,6 +37,7 @@
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/query/explain.h"
 #include "mongo/db/query/find_common.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/storage_options.h"
 #include "mongo/util/scopeguard.h"
@@ -103,6 +104,8 @@ void DocumentSourceCursor::loadBatch() {
                 _currentBatch.push_back(Document());
             } else if (_dependencies) {
                 _currentBatch.push_back(_dependencies->extractFields(obj));
+            } else if (internalDocumentSourceCursorLazyDocuments.load()) {
+                _currentBatch.push_back(Document::fromBsonWithMetaDataLazily(obj));
             } else {
                 _currentBatch.push_back(Document::fromBsonWithMetaData(obj));
             }
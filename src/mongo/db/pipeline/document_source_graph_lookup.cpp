@@ -38,6 +38,7 @@
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_planner_common.h"
 #include "mongo/stdx/memory.h"
 
@@ -70,11 +71,9 @@ boost::optional<Document> DocumentSourceGraphLookUp::getNext() {
     performSearch();
 
     std::vector<Value> results;
-    while (!_visited.empty()) {
+    while (hasVisitedLeft()) {
         // Remove elements one at a time to avoid consuming more memory.
-        auto it = _visited.begin();
-        results.push_back(Value(it->second));
-        _visited.erase(it);
+        results.push_back(takeVisited());
     }
 
     MutableDocument output(*_input);
@@ -93,7 +92,7 @@ boost::optional<Document> DocumentSourceGraphLookUp::getNextUnwound() {
     // If the unwind is not preserving empty arrays, we might have to process multiple inputs before
     // we get one that will produce an output.
     while (true) {
-        if (_visited.empty()) {
+        if (!hasVisitedLeft()) {
             // No results are left for the current input, so we should move on to the next one and
             // perform a new search.
             if (!(_input = pSource->getNext())) {
@@ -107,7 +106,7 @@ boost::optional<Document> DocumentSourceGraphLookUp::getNextUnwound() {
         }
         MutableDocument unwound(*_input);
 
-        if (_visited.empty()) {
+        if (!hasVisitedLeft()) {
             if ((*_unwind)->preserveNullAndEmptyArrays()) {
                 // Since "preserveNullAndEmptyArrays" was specified, output a document even though
                 // we had no result.
@@ -121,23 +120,40 @@ boost::optional<Document> DocumentSourceGraphLookUp::getNextUnwound() {
                 continue;
             }
         } else {
-            auto it = _visited.begin();
-            unwound.setNestedField(_as, Value(it->second));
+            unwound.setNestedField(_as, takeVisited());
             if (indexPath) {
                 unwound.setNestedField(*indexPath, Value(_outputIndex));
                 ++_outputIndex;
             }
-            _visited.erase(it);
         }
 
         return unwound.freeze();
     }
 }
 
+bool DocumentSourceGraphLookUp::hasVisitedLeft() const {
+    return !_visited.empty() || (_spilledVisited && _spilledVisited->more());
+}
+
+Value DocumentSourceGraphLookUp::takeVisited() {
+    if (!_visited.empty()) {
+        auto it = _visited.begin();
+        Value result(it->second);
+        _visited.erase(it);
+        return result;
+    }
+
+    invariant(_spilledVisited && _spilledVisited->more());
+    return _spilledVisited->next().second;
+}
+
 void DocumentSourceGraphLookUp::dispose() {
     _cache.clear();
     _frontier->clear();
     _visited.clear();
+    _spilledVisitedIds.clear();
+    _visitedWriter.reset();
+    _spilledVisited.reset();
     pSource->dispose();
 }
 
@@ -149,7 +165,7 @@ void DocumentSourceGraphLookUp::doBreadthFirstSearch() {
 
         // Check whether each key in the frontier exists in the cache or needs to be queried.
         BSONObjSet cached;
-        auto matchStage = makeMatchStageFromFrontier(&cached);
+        takeCachedValuesFromFrontier(&cached);
 
         ValueUnorderedSet queried = pExpCtx->getValueComparator().makeUnorderedValueSet();
         _frontier->swap(queried);
@@ -164,13 +180,26 @@ void DocumentSourceGraphLookUp::doBreadthFirstSearch() {
             checkMemoryUsage();
         }
 
-        if (matchStage) {
-            // Query for all keys that were in the frontier and not in the cache, populating
-            // '_frontier' for the next iteration of search.
+        // Query for all keys that were in the frontier and not in the cache, populating '_frontier'
+        // for the next iteration of search. The keys are queried for in batches, so that the size
+        // of each query stays bounded and the cache can be trimmed between them.
+        auto queriedIt = queried.begin();
+        while (queriedIt != queried.end()) {
+            ValueUnorderedSet batch = pExpCtx->getValueComparator().makeUnorderedValueSet();
+            size_t batchBytes = 0;
+            while (queriedIt != queried.end() && batch.size() < _batchSize &&
+                   batchBytes < BSONObjMaxUserSize / 2) {
+                batchBytes += queriedIt->getApproximateSize();
+                batch.insert(*queriedIt);
+                ++queriedIt;
+            }
 
             // We've already allocated space for the trailing $match stage in '_fromPipeline'.
-            _fromPipeline.back() = *matchStage;
+            _fromPipeline.back() = makeMatchStageFromBatch(batch);
             auto pipeline = uassertStatusOK(_mongod->makePipeline(_fromPipeline, _fromExpCtx));
+            ++_numQueries;
+
+            size_t resultBytes = 0;
             while (auto next = pipeline->output()->getNext()) {
                 uassert(40271,
                         str::stream()
@@ -180,11 +209,13 @@ void DocumentSourceGraphLookUp::doBreadthFirstSearch() {
                         !(*next)["_id"].missing());
 
                 BSONObj result = next->toBson();
+                resultBytes += static_cast<size_t>(result.objsize());
                 shouldPerformAnotherQuery =
                     addToVisitedAndFrontier(result.getOwned(), depth) || shouldPerformAnotherQuery;
-                addToCache(result, queried);
+                addToCache(result, batch);
             }
             checkMemoryUsage();
+            updateBatchSize(batch.size(), resultBytes);
         }
 
         ++depth;
@@ -195,6 +226,21 @@ void DocumentSourceGraphLookUp::doBreadthFirstSearch() {
     _frontierUsageBytes = 0;
 }
 
+void DocumentSourceGraphLookUp::updateBatchSize(size_t numValues, size_t resultBytes) {
+    const size_t maxBatchSize =
+        static_cast<size_t>(std::max(1, internalDocumentSourceGraphLookupMaxBatchSize.load()));
+    const size_t targetBytes = std::max<size_t>(_maxMemoryUsageBytes / 10, 1);
+
+    if (resultBytes == 0) {
+        _batchSize = std::min(maxBatchSize, std::max<size_t>(_batchSize, 1) * 2);
+        return;
+    }
+
+    const double bytesPerValue = static_cast<double>(resultBytes) / numValues;
+    _batchSize = static_cast<size_t>(std::max(
+        1.0, std::min(static_cast<double>(maxBatchSize), targetBytes / bytesPerValue)));
+}
+
 namespace {
 
 BSONObj addDepthFieldToObject(const std::string& field, long long depth, BSONObj object) {
@@ -209,7 +255,8 @@ BSONObj addDepthFieldToObject(const std::string& field, long long depth, BSONObj
 bool DocumentSourceGraphLookUp::addToVisitedAndFrontier(BSONObj result, long long depth) {
     Value _id = Value(result.getField("_id"));
 
-    if (_visited.find(_id) != _visited.end()) {
+    if (_visited.find(_id) != _visited.end() ||
+        _spilledVisitedIds.find(_id) != _spilledVisitedIds.end()) {
         // We've already seen this object, don't repeat any work.
         return false;
     }
@@ -274,7 +321,7 @@ void DocumentSourceGraphLookUp::addToCache(const BSONObj& result,
     }
 }
 
-boost::optional<BSONObj> DocumentSourceGraphLookUp::makeMatchStageFromFrontier(BSONObjSet* cached) {
+void DocumentSourceGraphLookUp::takeCachedValuesFromFrontier(BSONObjSet* cached) {
     // Add any cached values to 'cached' and remove them from '_frontier'.
     for (auto it = _frontier->begin(); it != _frontier->end();) {
         if (auto entry = _cache[*it]) {
@@ -292,7 +339,9 @@ boost::optional<BSONObj> DocumentSourceGraphLookUp::makeMatchStageFromFrontier(B
             it = std::next(it);
         }
     }
+}
 
+BSONObj DocumentSourceGraphLookUp::makeMatchStageFromBatch(const ValueUnorderedSet& batch) const {
     // Create a query of the form {$and: [_additionalFilter, {_connectToField: {$in: [...]}}]}.
     //
     // We wrap the query in a $match so that it can be parsed into a DocumentSourceMatch when
@@ -312,7 +361,7 @@ boost::optional<BSONObj> DocumentSourceGraphLookUp::makeMatchStageFromFrontier(B
                     BSONObjBuilder subObj(connectToObj.subobjStart(_connectToField.fullPath()));
                     {
                         BSONArrayBuilder in(subObj.subarrayStart("$in"));
-                        for (auto&& value : *_frontier) {
+                        for (auto&& value : batch) {
                             in << value;
                         }
                     }
@@ -321,13 +370,17 @@ boost::optional<BSONObj> DocumentSourceGraphLookUp::makeMatchStageFromFrontier(B
         }
     }
 
-    return _frontier->empty() ? boost::none : boost::optional<BSONObj>(match.obj());
+    return match.obj();
 }
 
 void DocumentSourceGraphLookUp::performSearch() {
     // Make sure _input is set before calling performSearch().
     invariant(_input);
 
+    // The documents found for the previous input have all been returned.
+    _spilledVisitedIds.clear();
+    _spilledVisited.reset();
+
     _variables->setRoot(*_input);
     Value startingValue = _startWith->evaluateInternal(_variables.get());
     _variables->clearRoot();
@@ -344,6 +397,11 @@ void DocumentSourceGraphLookUp::performSearch() {
     }
 
     doBreadthFirstSearch();
+
+    if (_visitedWriter) {
+        _spilledVisited.reset(_visitedWriter->done());
+        _visitedWriter.reset();
+    }
 }
 
 Pipeline::SourceContainer::iterator DocumentSourceGraphLookUp::optimizeAt(
@@ -374,13 +432,39 @@ BSONObjSet DocumentSourceGraphLookUp::getOutputSorts() {
 }
 
 void DocumentSourceGraphLookUp::checkMemoryUsage() {
-    // TODO SERVER-23980: Implement spilling to disk if allowDiskUse is specified.
+    if (_extSortAllowed && !_visited.empty() &&
+        (_visitedUsageBytes + _frontierUsageBytes) >= _maxMemoryUsageBytes) {
+        spillVisited();
+    }
+
     uassert(40099,
             "$graphLookup reached maximum memory consumption",
             (_visitedUsageBytes + _frontierUsageBytes) < _maxMemoryUsageBytes);
     _cache.evictDownTo(_maxMemoryUsageBytes - _frontierUsageBytes - _visitedUsageBytes);
 }
 
+void DocumentSourceGraphLookUp::spillVisited() {
+    if (!_visitedWriter) {
+        _visitedWriter = stdx::make_unique<SortedFileWriter<Value, Value>>(
+            SortOptions().TempDir(pExpCtx->tempDir).FileStats(_spillFileStats));
+    }
+
+    // Found documents are returned in no particular order, so their order on disk does not
+    // matter. Only the '_id's stay in memory, to recognize documents which are found again.
+    size_t idUsageBytes = 0;
+    for (auto&& id : _spilledVisitedIds) {
+        idUsageBytes += id.getApproximateSize();
+    }
+    for (auto&& idAndDoc : _visited) {
+        _visitedWriter->addAlreadySorted(idAndDoc.first, Value(idAndDoc.second));
+        idUsageBytes += idAndDoc.first.getApproximateSize();
+        _spilledVisitedIds.insert(idAndDoc.first);
+    }
+    _visited.clear();
+    _visitedUsageBytes = idUsageBytes;
+    ++_numSpills;
+}
+
 void DocumentSourceGraphLookUp::serializeToArray(std::vector<Value>& array, bool explain) const {
     // Serialize default options.
     MutableDocument spec(DOC("from" << _from.coll() << "as" << _as.fullPath() << "connectToField"
@@ -403,6 +487,17 @@ void DocumentSourceGraphLookUp::serializeToArray(std::vector<Value>& array, bool
         spec["restrictSearchWithMatch"] = Value(*_additionalFilter);
     }
 
+    if (explain && _numQueries > 0) {
+        spec["searchStats"] =
+            Value(DOC("nQueries" << _numQueries << "batchSize" << static_cast<long long>(_batchSize)
+                                 << "cacheMemoryUsageBytes"
+                                 << static_cast<long long>(_cache.getMemoryUsage())
+                                 << "spills"
+                                 << _numSpills
+                                 << "spilledBytes"
+                                 << _spillFileStats->bytesSpilled));
+    }
+
     // If we are explaining, include an absorbed $unwind inside the $graphLookup specification.
     if (_unwind && explain) {
         const boost::optional<FieldPath> indexPath = (*_unwind)->indexPath();
@@ -464,7 +559,13 @@ DocumentSourceGraphLookUp::DocumentSourceGraphLookUp(
       _additionalFilter(additionalFilter),
       _depthField(depthField),
       _maxDepth(maxDepth),
+      _maxMemoryUsageBytes(internalDocumentSourceGraphLookupMaxMemoryBytes.load()),
       _visited(ValueComparator::kInstance.makeUnorderedValueMap<BSONObj>()),
+      _spilledVisitedIds(ValueComparator::kInstance.makeUnorderedValueSet()),
+      _spillFileStats(std::make_shared<SorterFileStats>()),
+      _extSortAllowed(expCtx->extSortAllowed && !expCtx->inRouter),
+      _batchSize(static_cast<size_t>(
+          std::max(1, internalDocumentSourceGraphLookupMaxBatchSize.load()))),
       _cache(expCtx->getValueComparator()) {}
 
 intrusive_ptr<DocumentSourceGraphLookUp> DocumentSourceGraphLookUp::create(
@@ -606,3 +707,6 @@ intrusive_ptr<DocumentSource> DocumentSourceGraphLookUp::createFromBson(
     return std::move(newSource);
 }
 }  // namespace mongo
+
+#include "mongo/db/sorter/sorter.cpp"
+// Explicit instantiation unneeded since we aren't exposing Sorter outside of this file.
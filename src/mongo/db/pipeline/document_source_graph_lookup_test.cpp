@@ -36,9 +36,12 @@
 #include "mongo/db/pipeline/aggregation_context_fixture.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/document_value_test_util.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/unittest/temp_dir.h"
 #include "mongo/unittest/unittest.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/scopeguard.h"
 
 namespace mongo {
 
@@ -116,6 +119,17 @@ public:
         return pipeline;
     }
 
+    std::pair<long long, long long> getCollectionSize(const NamespaceString& nss) final {
+        MONGO_UNREACHABLE;
+    }
+
+    std::unique_ptr<LookupIndexProbe> makeLookupIndexProbe(
+        const boost::intrusive_ptr<ExpressionContext>& expCtx,
+        const FieldPath& field,
+        const BSONObj& filter) final {
+        MONGO_UNREACHABLE;
+    }
+
 private:
     std::deque<Document> _documents;
 };
@@ -279,5 +293,89 @@ TEST_F(DocumentSourceGraphLookUpTest,
     }
 }
 
+/**
+ * Runs a $graphLookup from {_id: 0} over a tree where each node 'n' connects to the nodes '2n + 1'
+ * and '2n + 2', and returns the '_id's of the nodes found.
+ */
+std::vector<int> findTreeNodes(const boost::intrusive_ptr<ExpressionContext>& expCtx,
+                               int numNodes) {
+    std::deque<Document> inputs{Document{{"_id", 0}}};
+    auto inputMock = DocumentSourceMock::create(std::move(inputs));
+
+    std::deque<Document> fromContents;
+    for (int i = 0; i < numNodes; ++i) {
+        fromContents.push_back(Document{{"_id", i},
+                                        {"to", i},
+                                        {"from", Value(std::vector<Value>{Value(2 * i + 1),
+                                                                          Value(2 * i + 2)})},
+                                        {"padding", std::string(100, 'x')}});
+    }
+
+    NamespaceString fromNs("test", "graph_lookup");
+    expCtx->resolvedNamespaces[fromNs.coll()] = {fromNs, std::vector<BSONObj>{}};
+    auto graphLookupStage = DocumentSourceGraphLookUp::create(expCtx,
+                                                              fromNs,
+                                                              "results",
+                                                              "from",
+                                                              "to",
+                                                              ExpressionFieldPath::create("_id"),
+                                                              boost::none,
+                                                              boost::none,
+                                                              boost::none);
+    graphLookupStage->injectMongodInterface(
+        std::make_shared<MockMongodImplementation>(std::move(fromContents)));
+
+    auto unwindStage = DocumentSourceUnwind::create(expCtx, "results", false, boost::none);
+    auto pipeline =
+        unittest::assertGet(Pipeline::create({inputMock, graphLookupStage, unwindStage}, expCtx));
+    pipeline->optimizePipeline();
+
+    std::vector<int> found;
+    while (auto next = pipeline->output()->getNext()) {
+        found.push_back(next->getNestedField(FieldPath("results._id")).getInt());
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+std::vector<int> allNodes(int numNodes) {
+    std::vector<int> nodes;
+    for (int i = 0; i < numNodes; ++i) {
+        nodes.push_back(i);
+    }
+    return nodes;
+}
+
+TEST_F(DocumentSourceGraphLookUpTest, ShouldFindAllNodesWhenQueryingForOneValueAtATime) {
+    const int originalBatchSize = internalDocumentSourceGraphLookupMaxBatchSize.load();
+    internalDocumentSourceGraphLookupMaxBatchSize.store(1);
+    ON_BLOCK_EXIT([&] { internalDocumentSourceGraphLookupMaxBatchSize.store(originalBatchSize); });
+
+    ASSERT(findTreeNodes(getExpCtx(), 31) == allNodes(31));
+}
+
+TEST_F(DocumentSourceGraphLookUpTest, ShouldSpillFoundDocumentsWhenDiskUseIsAllowed) {
+    unittest::TempDir tempDir("DocumentSourceGraphLookUpSpillTest");
+    auto expCtx = getExpCtx();
+    expCtx->extSortAllowed = true;
+    expCtx->tempDir = tempDir.path();
+
+    const int originalMaxMemoryBytes = internalDocumentSourceGraphLookupMaxMemoryBytes.load();
+    internalDocumentSourceGraphLookupMaxMemoryBytes.store(10 * 1024);
+    ON_BLOCK_EXIT(
+        [&] { internalDocumentSourceGraphLookupMaxMemoryBytes.store(originalMaxMemoryBytes); });
+
+    ASSERT(findTreeNodes(expCtx, 255) == allNodes(255));
+}
+
+TEST_F(DocumentSourceGraphLookUpTest, ShouldFailWhenOutOfMemoryAndDiskUseIsNotAllowed) {
+    const int originalMaxMemoryBytes = internalDocumentSourceGraphLookupMaxMemoryBytes.load();
+    internalDocumentSourceGraphLookupMaxMemoryBytes.store(10 * 1024);
+    ON_BLOCK_EXIT(
+        [&] { internalDocumentSourceGraphLookupMaxMemoryBytes.store(originalMaxMemoryBytes); });
+
+    ASSERT_THROWS_CODE(findTreeNodes(getExpCtx(), 255), UserException, 40099);
+}
+
 }  // namespace
 }  // namespace mongo
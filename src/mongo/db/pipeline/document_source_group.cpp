@@ -28,6 +28,8 @@
 
 #include "mongo/platform/basic.h"
 
+#include <set>
+
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/accumulator.h"
 #include "mongo/db/pipeline/document.h"
@@ -36,6 +38,7 @@
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/value.h"
 #include "mongo/db/pipeline/value_comparator.h"
+#include "mongo/db/query/query_knobs.h"
 
 namespace mongo {
 
@@ -46,6 +49,17 @@ using std::vector;
 
 REGISTER_DOCUMENT_SOURCE(group, DocumentSourceGroup::createFromBson);
 
+namespace {
+
+// The number of partitions the groups are hashed into each time we spill.
+const size_t kNumSpillPartitions = 16;
+
+// A partition which still exceeds the memory limit after this many levels of partitioning holds
+// a large number of keys with colliding hashes, so we stop splitting it and aggregate it in memory.
+const int kMaxSpillPartitionLevel = 8;
+
+}  // namespace
+
 const char* DocumentSourceGroup::getSourceName() const {
     return "$group";
 }
@@ -70,37 +84,26 @@ boost::optional<Document> DocumentSourceGroup::getNext() {
 }
 
 boost::optional<Document> DocumentSourceGroup::getNextSpilled() {
-    // We aren't streaming, and we have spilled to disk.
-    if (!_sorterIterator)
-        return boost::none;
+    // We aren't streaming, and we have spilled to disk. Return the groups of one partition at a
+    // time, loading the next partition once the current one is exhausted.
+    while (groupsIterator == _groups->end()) {
+        _groups->clear();
 
-    _currentId = _firstPartOfNextGroup.first;
-    const size_t numAccumulators = vpAccumulatorFactory.size();
-    while (pExpCtx->getValueComparator().evaluate(_currentId == _firstPartOfNextGroup.first)) {
-        // Inside of this loop, _firstPartOfNextGroup is the current data being processed.
-        // At loop exit, it is the first value to be processed in the next group.
-        switch (numAccumulators) {  // mirrors switch in spill()
-            case 1:                 // Single accumulators serialize as a single Value.
-                _currentAccumulators[0]->process(_firstPartOfNextGroup.second, true);
-            case 0:  // No accumulators so no Values.
-                break;
-            default: {  // Multiple accumulators serialize as an array of Values.
-                const vector<Value>& accumulatorStates = _firstPartOfNextGroup.second.getArray();
-                for (size_t i = 0; i < numAccumulators; i++) {
-                    _currentAccumulators[i]->process(accumulatorStates[i], true);
-                }
-            }
-        }
-
-        if (!_sorterIterator->more()) {
+        if (_spilledPartitions.empty()) {
             dispose();
-            break;
+            return boost::none;
         }
 
-        _firstPartOfNextGroup = _sorterIterator->next();
+        SpilledPartition partition = std::move(_spilledPartitions.back());
+        _spilledPartitions.pop_back();
+        loadSpilledPartition(partition);
+
+        groupsIterator = _groups->begin();
     }
 
-    return makeDocument(_currentId, _currentAccumulators, pExpCtx->inShard);
+    Document out = makeDocument(groupsIterator->first, groupsIterator->second, pExpCtx->inShard);
+    ++groupsIterator;
+    return out;
 }
 
 boost::optional<Document> DocumentSourceGroup::getNextStandard() {
@@ -158,7 +161,8 @@ boost::optional<Document> DocumentSourceGroup::getNextStreaming() {
 void DocumentSourceGroup::dispose() {
     // Free our resources.
     _groups = pExpCtx->getValueComparator().makeUnorderedValueMap<Accumulators>();
-    _sorterIterator.reset();
+    _partitionWriters.clear();
+    _spilledPartitions.clear();
 
     // Make us look done.
     groupsIterator = _groups->end();
@@ -232,6 +236,20 @@ Value DocumentSourceGroup::serialize(bool explain) const {
         insides["$doingMerge"] = Value(true);
     }
 
+    if (explain && _spilled) {
+        const SpillStats stats = getSpillStats();
+        insides["$spillStats"] =
+            Value(DOC("spills" << stats.spills << "spilledBytes" << stats.spilledBytes
+                               << "bytesWritten"
+                               << stats.bytesWritten
+                               << "bytesRead"
+                               << stats.bytesRead
+                               << "partitionsProcessed"
+                               << stats.partitionsProcessed
+                               << "maxPartitionLevel"
+                               << stats.maxPartitionLevel));
+    }
+
     if (explain && findRelevantInputSort()) {
         return Value(DOC("$streamingGroup" << insides.freeze()));
     }
@@ -263,11 +281,12 @@ intrusive_ptr<DocumentSourceGroup> DocumentSourceGroup::create(
 DocumentSourceGroup::DocumentSourceGroup(const intrusive_ptr<ExpressionContext>& pExpCtx)
     : DocumentSource(pExpCtx),
       _doingMerge(false),
-      _maxMemoryUsageBytes(100 * 1024 * 1024),
+      _maxMemoryUsageBytes(internalDocumentSourceGroupMaxMemoryBytes.load()),
       _inputSort(BSONObj()),
       _streaming(false),
       _initialized(false),
       _spilled(false),
+      _spillFileStats(std::make_shared<SorterFileStats>()),
       _extSortAllowed(pExpCtx->extSortAllowed && !pExpCtx->inRouter) {}
 
 void DocumentSourceGroup::addAccumulator(const std::string& fieldName,
@@ -325,34 +344,6 @@ intrusive_ptr<DocumentSource> DocumentSourceGroup::createFromBson(
 
 namespace {
 
-using GroupsMap = DocumentSourceGroup::GroupsMap;
-
-class SorterComparator {
-public:
-    typedef pair<Value, Value> Data;
-
-    SorterComparator(ValueComparator valueComparator) : _valueComparator(valueComparator) {}
-
-    int operator()(const Data& lhs, const Data& rhs) const {
-        return _valueComparator.compare(lhs.first, rhs.first);
-    }
-
-private:
-    ValueComparator _valueComparator;
-};
-
-class SpillSTLComparator {
-public:
-    SpillSTLComparator(ValueComparator valueComparator) : _valueComparator(valueComparator) {}
-
-    bool operator()(const GroupsMap::value_type* lhs, const GroupsMap::value_type* rhs) const {
-        return _valueComparator.evaluate(lhs->first < rhs->first);
-    }
-
-private:
-    ValueComparator _valueComparator;
-};
-
 bool containsOnlyFieldPathsAndConstants(ExpressionObject* expressionObj) {
     for (auto&& it : expressionObj->getChildExpressions()) {
         const intrusive_ptr<Expression>& childExp = it.second;
@@ -395,26 +386,35 @@ void getFieldPathMap(ExpressionObject* expressionObj,
     }
 }
 
-void getFieldPathListForSpilled(ExpressionObject* expressionObj,
-                                std::string prefix,
-                                std::vector<std::string>* fields) {
-    // Given an expression, attempt to compute a vector of strings, each representing the path
-    // through the object to a leaf. For example, for the expression represented by
-    // {x: 2, y: {z: "$a.b"}}, the output would be ["x", "y.z"].
-    for (auto&& it : expressionObj->getChildExpressions()) {
-        intrusive_ptr<Expression> childExp = it.second;
-        ExpressionObject* expObj = dynamic_cast<ExpressionObject*>(childExp.get());
+/**
+ * Returns true if 'expression' evaluates to the top-level field 'fieldName' of the input document.
+ */
+bool isTopLevelFieldPath(const intrusive_ptr<Expression>& expression, StringData fieldName) {
+    auto fieldPathExpr = dynamic_cast<ExpressionFieldPath*>(expression.get());
+    if (!fieldPathExpr) {
+        return false;
+    }
+
+    const FieldPath& fieldPath = fieldPathExpr->getFieldPath();
+    return fieldPath.getPathLength() == 2 &&
+        (fieldPath.getFieldName(0) == "ROOT" || fieldPath.getFieldName(0) == "CURRENT") &&
+        fieldPath.getFieldName(1) == fieldName;
+}
+}  // namespace
 
-        std::string newPrefix = prefix.empty() ? it.first : prefix + "." + it.first;
+bool DocumentSourceGroup::readsPartialsByFieldName() const {
+    if (!_doingMerge || _idExpressions.size() != 1 || !_idFieldNames.empty() ||
+        !isTopLevelFieldPath(_idExpressions[0], "_id")) {
+        return false;
+    }
 
-        if (expObj) {
-            getFieldPathListForSpilled(expObj, newPrefix, fields);
-        } else {
-            fields->push_back(newPrefix);
+    for (size_t i = 0; i < vFieldName.size(); ++i) {
+        if (!isTopLevelFieldPath(vpExpression[i], vFieldName[i])) {
+            return false;
         }
     }
+    return true;
 }
-}  // namespace
 
 void DocumentSourceGroup::initialize() {
     _initialized = true;
@@ -449,8 +449,10 @@ void DocumentSourceGroup::initialize() {
 
     dassert(numAccumulators == vpExpression.size());
 
-    // pushed to on spill()
-    vector<shared_ptr<Sorter<Value, Value>::Iterator>> sortedFiles;
+    // When combining the partial aggregates of the shards, take the group key and the partials
+    // straight from the input documents rather than evaluating field paths for each of them.
+    const bool readPartialsByFieldName = readsPartialsByFieldName();
+
     int memoryUsageBytes = 0;
 
     // This loop consumes all input from pSource and buckets it based on pIdExpression.
@@ -460,14 +462,22 @@ void DocumentSourceGroup::initialize() {
                     "Exceeded memory limit for $group, but didn't allow external sort."
                     " Pass allowDiskUse:true to opt in.",
                     _extSortAllowed);
-            sortedFiles.push_back(spill());
+            _spilled = true;
+            spill(0);
             memoryUsageBytes = 0;
         }
 
-        _variables->setRoot(*input);
-
         /* get the _id value */
-        Value id = computeId(_variables.get());
+        Value id;
+        if (readPartialsByFieldName) {
+            id = input->getField("_id");
+            if (id.missing()) {
+                id = Value(BSONNULL);
+            }
+        } else {
+            _variables->setRoot(*input);
+            id = computeId(_variables.get());
+        }
 
         /*
           Look for the _id value in the map; if it's not there, add a
@@ -496,7 +506,10 @@ void DocumentSourceGroup::initialize() {
         /* tickle all the accumulators for the group we found */
         dassert(numAccumulators == group.size());
         for (size_t i = 0; i < numAccumulators; i++) {
-            group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
+            group[i]->process(readPartialsByFieldName
+                                  ? input->getField(vFieldName[i])
+                                  : vpExpression[i]->evaluate(_variables.get()),
+                              _doingMerge);
             memoryUsageBytes += group[i]->memUsageForSorter();
         }
 
@@ -511,79 +524,172 @@ void DocumentSourceGroup::initialize() {
                 &&
                 !_extSortAllowed  // don't change behavior when testing external sort
                 &&
-                sortedFiles.size() < 20  // don't open too many FDs
+                _spillStats.spills < 20  // don't do too much IO
                 ) {
-                sortedFiles.push_back(spill());
+                _spilled = true;
+                spill(0);
             }
         }
     }
 
     // These blocks do any final steps necessary to prepare to output results.
-    if (!sortedFiles.empty()) {
-        _spilled = true;
+    if (_spilled) {
         if (!_groups->empty()) {
-            sortedFiles.push_back(spill());
+            spill(0);
         }
+        finishSpilledPartitions(0);
 
-        // We won't be using groups again so free its memory.
+        // We won't be using the groups for anything other than the spilled partitions, so free
+        // its memory. getNextSpilled() will load the first partition.
         _groups = pExpCtx->getValueComparator().makeUnorderedValueMap<Accumulators>();
+        groupsIterator = _groups->end();
+    } else {
+        // start the group iterator
+        groupsIterator = _groups->begin();
+    }
+}
 
-        _sorterIterator.reset(Sorter<Value, Value>::Iterator::merge(
-            sortedFiles, SortOptions(), SorterComparator(pExpCtx->getValueComparator())));
+void DocumentSourceGroup::spill(int level) {
+    if (_partitionWriters.empty()) {
+        _partitionWriters.resize(kNumSpillPartitions);
+    }
 
-        // prepare current to accumulate data
-        _currentAccumulators.reserve(numAccumulators);
-        for (size_t i = 0; i < numAccumulators; i++) {
-            _currentAccumulators.push_back(vpAccumulatorFactory[i]());
-            _currentAccumulators.back()->injectExpressionContext(pExpCtx);
+    for (auto&& group : *_groups) {
+        auto& writer = _partitionWriters[getSpillPartition(group.first, level)];
+        if (!writer) {
+            // Partition files are only created once they have data, since the sorter cannot read
+            // back an empty file.
+            writer = stdx::make_unique<SortedFileWriter<Value, Value>>(
+                SortOptions().TempDir(pExpCtx->tempDir).FileStats(_spillFileStats));
         }
 
-        verify(_sorterIterator->more());  // we put data in, we should get something out.
-        _firstPartOfNextGroup = _sorterIterator->next();
-    } else {
-        // start the group iterator
-        groupsIterator = _groups->begin();
+        Value state = getSpillState(group.second);
+
+        // Groups within a partition are read back into a hash table, so their order on disk does
+        // not matter.
+        writer->addAlreadySorted(group.first, state);
     }
+
+    ++_spillStats.spills;
+    _spillStats.maxPartitionLevel = std::max(_spillStats.maxPartitionLevel, level);
+    _groups->clear();
 }
 
-shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill() {
-    vector<const GroupsMap::value_type*> ptrs;  // using pointers to speed sorting
-    ptrs.reserve(_groups->size());
-    for (GroupsMap::const_iterator it = _groups->begin(), end = _groups->end(); it != end; ++it) {
-        ptrs.push_back(&*it);
+void DocumentSourceGroup::finishSpilledPartitions(int level) {
+    for (auto&& writer : _partitionWriters) {
+        if (writer) {
+            _spilledPartitions.push_back(
+                {shared_ptr<Sorter<Value, Value>::Iterator>(writer->done()), level});
+        }
     }
+    _partitionWriters.clear();
+}
 
-    stable_sort(ptrs.begin(), ptrs.end(), SpillSTLComparator(pExpCtx->getValueComparator()));
+void DocumentSourceGroup::loadSpilledPartition(const SpilledPartition& partition) {
+    invariant(_groups->empty());
+    invariant(_partitionWriters.empty());
+    ++_spillStats.partitionsProcessed;
 
-    SortedFileWriter<Value, Value> writer(SortOptions().TempDir(pExpCtx->tempDir));
-    switch (vpAccumulatorFactory.size()) {  // same as ptrs[i]->second.size() for all i.
-        case 0:                             // no values, essentially a distinct
-            for (size_t i = 0; i < ptrs.size(); i++) {
-                writer.addAlreadySorted(ptrs[i]->first, Value());
+    const size_t numAccumulators = vpAccumulatorFactory.size();
+    const int nextLevel = partition.level + 1;
+    int memoryUsageBytes = 0;
+
+    while (partition.iterator->more()) {
+        pExpCtx->checkForInterrupt();
+
+        if (memoryUsageBytes > _maxMemoryUsageBytes && nextLevel <= kMaxSpillPartitionLevel) {
+            // The groups in this partition don't fit in memory either. Split them up further
+            // with a differently seeded hash; the sub-partitions are returned before any of the
+            // remaining partitions at this level.
+            spill(nextLevel);
+            memoryUsageBytes = 0;
+        }
+
+        auto spilledGroup = partition.iterator->next();
+
+        const size_t oldSize = _groups->size();
+        Accumulators& group = (*_groups)[spilledGroup.first];
+        const bool inserted = _groups->size() != oldSize;
+
+        if (inserted) {
+            memoryUsageBytes += spilledGroup.first.getApproximateSize();
+
+            group.reserve(numAccumulators);
+            for (size_t i = 0; i < numAccumulators; i++) {
+                group.push_back(vpAccumulatorFactory[i]());
+                group.back()->injectExpressionContext(pExpCtx);
             }
-            break;
+        } else {
+            for (size_t i = 0; i < numAccumulators; i++) {
+                memoryUsageBytes -= group[i]->memUsageForSorter();
+            }
+        }
+
+        mergeSpillState(spilledGroup.second, group);
+        for (size_t i = 0; i < numAccumulators; i++) {
+            memoryUsageBytes += group[i]->memUsageForSorter();
+        }
+    }
+
+    if (!_partitionWriters.empty()) {
+        // We split this partition, so what is left in memory must join the sub-partitions.
+        if (!_groups->empty()) {
+            spill(nextLevel);
+        }
+        finishSpilledPartitions(nextLevel);
+    }
+}
+
+size_t DocumentSourceGroup::getSpillPartition(const Value& id, int level) const {
+    // The partitions at each level must be independent of those at the levels above it, or all
+    // the groups of an oversized partition would land in the same sub-partition. Mix the level
+    // into the comparator-aware hash and scramble the result with the MurmurHash3 finalizer.
+    uint64_t hash = pExpCtx->getValueComparator().hash(id);
+    hash += static_cast<uint64_t>(level) * 0x9e3779b97f4a7c15ULL;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash % kNumSpillPartitions;
+}
+
+Value DocumentSourceGroup::getSpillState(const Accumulators& accums) const {
+    switch (accums.size()) {
+        case 0:  // no values, essentially a distinct
+            return Value();
 
         case 1:  // just one value, use optimized serialization as single Value
-            for (size_t i = 0; i < ptrs.size(); i++) {
-                writer.addAlreadySorted(ptrs[i]->first,
-                                        ptrs[i]->second[0]->getValue(/*toBeMerged=*/true));
-            }
-            break;
+            return accums[0]->getValue(/*toBeMerged=*/true);
 
-        default:  // multiple values, serialize as array-typed Value
-            for (size_t i = 0; i < ptrs.size(); i++) {
-                vector<Value> accums;
-                for (size_t j = 0; j < ptrs[i]->second.size(); j++) {
-                    accums.push_back(ptrs[i]->second[j]->getValue(/*toBeMerged=*/true));
-                }
-                writer.addAlreadySorted(ptrs[i]->first, Value(std::move(accums)));
+        default: {  // multiple values, serialize as array-typed Value
+            vector<Value> states;
+            states.reserve(accums.size());
+            for (auto&& accum : accums) {
+                states.push_back(accum->getValue(/*toBeMerged=*/true));
             }
-            break;
+            return Value(std::move(states));
+        }
     }
+}
 
-    _groups->clear();
+void DocumentSourceGroup::mergeSpillState(const Value& state, const Accumulators& accums) const {
+    switch (accums.size()) {  // mirrors switch in getSpillState()
+        case 0:               // No accumulators so no Values.
+            break;
 
-    return shared_ptr<Sorter<Value, Value>::Iterator>(writer.done());
+        case 1:  // Single accumulators serialize as a single Value.
+            accums[0]->process(state, true);
+            break;
+
+        default: {  // Multiple accumulators serialize as an array of Values.
+            const vector<Value>& states = state.getArray();
+            invariant(states.size() == accums.size());
+            for (size_t i = 0; i < accums.size(); i++) {
+                accums[i]->process(states[i], true);
+            }
+        }
+    }
 }
 
 boost::optional<BSONObj> DocumentSourceGroup::findRelevantInputSort() const {
@@ -657,27 +763,23 @@ BSONObjSet DocumentSourceGroup::getOutputSorts() {
         initialize();
     }
 
-    if (!(_streaming || _spilled)) {
+    // A blocking $group returns its groups in hash order, whether or not it spilled to disk.
+    if (!_streaming) {
         return BSONObjSet();
     }
 
     BSONObjBuilder sortOrder;
 
     if (_idFieldNames.empty()) {
-        if (_spilled) {
-            sortOrder.append("_id", 1);
-        } else {
-            // We have an expression like {_id: "$a"}. Check if this is a FieldPath, and if it is,
-            // get the sort order out of it.
-            if (auto obj = dynamic_cast<ExpressionFieldPath*>(_idExpressions[0].get())) {
-                FieldPath _idSort = obj->getFieldPath();
-
-                sortOrder.append(
-                    "_id",
-                    _inputSort.getIntField(_idSort.getFieldName(_idSort.getPathLength() - 1)));
-            }
+        // We have an expression like {_id: "$a"}. Check if this is a FieldPath, and if it is,
+        // get the sort order out of it.
+        if (auto obj = dynamic_cast<ExpressionFieldPath*>(_idExpressions[0].get())) {
+            FieldPath _idSort = obj->getFieldPath();
+
+            sortOrder.append(
+                "_id", _inputSort.getIntField(_idSort.getFieldName(_idSort.getPathLength() - 1)));
         }
-    } else if (_streaming) {
+    } else {
         // At this point, we know that _streaming is true, so _id must have only contained
         // ExpressionObjects, ExpressionConstants or ExpressionFieldPaths. We now process each
         // '_idExpression'.
@@ -711,21 +813,6 @@ BSONObjSet DocumentSourceGroup::getOutputSorts() {
 
             sortOrder.append(itr->second, _inputSort.getIntField(sortString));
         }
-    } else {
-        // We are blocking and have spilled to disk.
-        std::vector<std::string> outputSort;
-        for (size_t i = 0; i < _idFieldNames.size(); i++) {
-            intrusive_ptr<Expression> exp = _idExpressions[i];
-            if (auto obj = dynamic_cast<ExpressionObject*>(exp.get())) {
-                // _id is an object containing a nested document, such as: {_id: {x: {y: "$b"}}}.
-                getFieldPathListForSpilled(obj, "_id." + _idFieldNames[i], &outputSort);
-            } else {
-                outputSort.push_back("_id." + _idFieldNames[i]);
-            }
-        }
-        for (auto&& field : outputSort) {
-            sortOrder.append(field, 1);
-        }
     }
 
     return allPrefixes(sortOrder.obj());
@@ -821,6 +908,25 @@ Document DocumentSourceGroup::makeDocument(const Value& id,
     return out.freeze();
 }
 
+bool DocumentSourceGroup::accumulatorsIgnoreInputOrder() const {
+    // $first, $last and $push depend on the input order. $addToSet does not, since the order of the
+    // set it returns is unspecified anyway.
+    static const std::set<StringData> kOrderInsensitiveOps = {"$sum"_sd,
+                                                              "$avg"_sd,
+                                                              "$min"_sd,
+                                                              "$max"_sd,
+                                                              "$stdDevPop"_sd,
+                                                              "$stdDevSamp"_sd,
+                                                              "$addToSet"_sd};
+
+    for (auto&& factory : vpAccumulatorFactory) {
+        if (!kOrderInsensitiveOps.count(factory()->getOpName())) {
+            return false;
+        }
+    }
+    return true;
+}
+
 intrusive_ptr<DocumentSource> DocumentSourceGroup::getShardSource() {
     return this;  // No modifications necessary when on shard
 }
@@ -37,7 +37,9 @@
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/stdx/memory.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -83,6 +85,60 @@ BSONObj buildEqualityOrQuery(const std::string& fieldName, const vector<Value>&
     return orBuilder.obj();
 }
 
+/**
+ * Returns whether an equality query on 'value' matches exactly the documents with a value equal to
+ * it at the foreign field, or an array containing such a value there. This excludes null, which
+ * also matches missing fields; arrays, which also match themselves as a whole; regular
+ * expressions; and undefined.
+ */
+bool isHashJoinable(const Value& value) {
+    switch (value.getType()) {
+        case jstNULL:
+        case Undefined:
+        case EOO:
+        case Array:
+        case RegEx:
+            return false;
+        default:
+            return true;
+    }
+}
+
+/**
+ * Adds to 'keys' each value an equality query on 'path' compares with in 'value', traversing arrays
+ * along the path the way the query does: an array of objects is traversed for the next path
+ * component, and the elements of an array at the end of the path are compared individually.
+ */
+void addHashJoinKeys(const Value& value,
+                     const FieldPath& path,
+                     size_t pathIndex,
+                     std::vector<Value>* keys) {
+    if (pathIndex == path.getPathLength()) {
+        if (value.isArray()) {
+            for (auto&& elem : value.getArray()) {
+                keys->push_back(elem);
+            }
+        } else if (!value.missing()) {
+            keys->push_back(value);
+        }
+        return;
+    }
+
+    if (value.getType() == Object) {
+        addHashJoinKeys(
+            value.getDocument().getField(path.getFieldName(pathIndex)), path, pathIndex + 1, keys);
+    } else if (value.isArray()) {
+        for (auto&& elem : value.getArray()) {
+            if (elem.getType() == Object) {
+                addHashJoinKeys(elem.getDocument().getField(path.getFieldName(pathIndex)),
+                                path,
+                                pathIndex + 1,
+                                keys);
+            }
+        }
+    }
+}
+
 }  // namespace
 
 boost::optional<Document> DocumentSourceLookUp::getNext() {
@@ -98,20 +154,234 @@ boost::optional<Document> DocumentSourceLookUp::getNext() {
                                 ->getQuery();
     }
 
+    if (!_madeIndexProbe) {
+        _indexProbe = makeIndexProbe(_additionalFilter.value_or(BSONObj()));
+        _madeIndexProbe = true;
+    }
+
     if (_handlingUnwind) {
         return unwindResult();
     }
 
+    // If we have not absorbed a $unwind, we cannot absorb a $match. If we have absorbed a $unwind,
+    // '_handlingUnwind' would be set to true, and we would not have made it here.
+    invariant(!_matchSrc);
+
+    if (_probedResults.empty()) {
+        maybeBuildHashJoinTable();
+        if (_hashJoinTable) {
+            return hashJoinResult();
+        }
+    }
+
+    if (_indexProbe) {
+        return probedResult();
+    }
+
     boost::optional<Document> input = pSource->getNext();
     if (!input)
         return {};
 
-    // If we have not absorbed a $unwind, we cannot absorb a $match. If we have absorbed a $unwind,
-    // '_handlingUnwind' would be set to true, and we would not have made it here.
-    invariant(!_matchSrc);
+    return queryResult(std::move(*input));
+}
 
+std::unique_ptr<DocumentSourceNeedsMongod::MongodInterface::LookupIndexProbe>
+DocumentSourceLookUp::makeIndexProbe(const BSONObj& filter) const {
+    // The index can only answer for the foreign collection itself, not for a view on it.
+    if (!internalDocumentSourceLookupUseIndexProbe.load() || _fromPipeline.size() != 1) {
+        return nullptr;
+    }
+    return _mongod->makeLookupIndexProbe(_fromExpCtx, _foreignField, filter);
+}
+
+boost::optional<Document> DocumentSourceLookUp::probedResult() {
+    if (_probedResults.empty()) {
+        // Read ahead so that the index is seeked once for the whole batch, in key order.
+        const size_t batchSize =
+            std::max(1, internalDocumentSourceLookupIndexProbeBatchSize.load());
+        std::vector<Document> inputs;
+        std::vector<Value> values;
+        while (inputs.size() < batchSize) {
+            boost::optional<Document> input = pSource->getNext();
+            if (!input)
+                break;
+            values.push_back(input->getNestedField(_localField));
+            inputs.push_back(std::move(*input));
+        }
+
+        if (inputs.empty())
+            return {};
+
+        Timer timer;
+        auto matches = _indexProbe->lookup(values);
+        _lookupMicros += timer.micros();
+
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (!matches[i]) {
+                _probedResults.push_back(queryResult(std::move(inputs[i])));
+                continue;
+            }
+
+            ++_numLookups;
+            ++_numIndexLookups;
+            _probedResults.push_back(joinResult(std::move(inputs[i]), std::move(*matches[i])));
+        }
+    }
+
+    Document next = std::move(_probedResults.front());
+    _probedResults.pop_front();
+    return std::move(next);
+}
+
+boost::optional<Document> DocumentSourceLookUp::hashJoinResult() {
+    boost::optional<Document> input = pSource->getNext();
+    if (!input)
+        return {};
+
+    Timer timer;
+    auto matches = hashJoinMatches(input->getNestedField(_localField));
+    if (!matches) {
+        return queryResult(std::move(*input));
+    }
+
+    ++_numLookups;
+    ++_numHashJoinLookups;
+    Document output = joinResult(std::move(*input), std::move(*matches));
+    _lookupMicros += timer.micros();
+    return std::move(output);
+}
+
+Document DocumentSourceLookUp::joinResult(Document input, std::vector<Document> matches) const {
+    std::vector<Value> results;
+    int objsize = 0;
+    for (auto&& match : matches) {
+        objsize += match.getApproximateSize();
+        uassert(4568,
+                str::stream() << "Total size of documents in " << _fromNs.coll() << " matching "
+                              << makeMatchStageFromInput(
+                                     input, _localField, _foreignFieldFieldName, BSONObj())
+                              << " exceeds maximum document size",
+                objsize <= BSONObjMaxInternalSize);
+        results.emplace_back(std::move(match));
+    }
+
+    MutableDocument output(std::move(input));
+    output.setNestedField(_as, Value(std::move(results)));
+    return output.freeze();
+}
+
+void DocumentSourceLookUp::maybeBuildHashJoinTable() {
+    if (_hashJoinTable || _hashJoinRejected) {
+        return;
+    }
+
+    // A numeric path component may refer to an array position, which addHashJoinKeys() does not
+    // know about.
+    for (size_t i = 0; i < _foreignField.getPathLength(); ++i) {
+        const std::string& part = _foreignField.getFieldName(i);
+        if (std::all_of(part.begin(), part.end(), [](char c) { return isdigit(c); })) {
+            _hashJoinRejected = true;
+            return;
+        }
+    }
+
+    const size_t maxMemoryUsageBytes =
+        std::max(0, internalDocumentSourceLookupHashJoinMaxMemoryBytes.load());
+    if (!internalDocumentSourceLookupForceHashJoin.load()) {
+        if (!_foreignCollectionSize) {
+            _foreignCollectionSize = _mongod->getCollectionSize(_fromExpCtx->ns);
+            if (static_cast<size_t>(_foreignCollectionSize->second) > maxMemoryUsageBytes) {
+                _hashJoinRejected = true;
+                return;
+            }
+        }
+
+        if (_numLookups < internalDocumentSourceLookupHashJoinMinLookupRatio.load() *
+                _foreignCollectionSize->first) {
+            return;
+        }
+    }
+
+    Timer timer;
+    std::vector<BSONObj> buildPipeline = _fromPipeline;
+    buildPipeline.back() = BSON("$match" << _additionalFilter.value_or(BSONObj()));
+    auto pipeline = uassertStatusOK(_mongod->makePipeline(buildPipeline, _fromExpCtx));
+
+    auto table = stdx::make_unique<HashJoinTable>(_fromExpCtx->getValueComparator());
+
+    std::vector<Value> keys;
+    while (auto foreignDoc = pipeline->output()->getNext()) {
+        const size_t position = table->documents.size();
+        table->memoryUsageBytes += foreignDoc->getApproximateSize();
+
+        keys.clear();
+        addHashJoinKeys(Value(*foreignDoc), _foreignField, 0, &keys);
+        for (auto&& key : keys) {
+            auto& bucket = table->buckets[key];
+            if (bucket.empty()) {
+                table->memoryUsageBytes += key.getApproximateSize() + sizeof(bucket);
+            }
+            // Keys which are equal under the collation may repeat within a document.
+            if (bucket.empty() || bucket.back() != position) {
+                bucket.push_back(position);
+                table->memoryUsageBytes += sizeof(position);
+            }
+        }
+
+        if (table->memoryUsageBytes > maxMemoryUsageBytes) {
+            // Keep looking up input documents one at a time.
+            _hashJoinRejected = true;
+            return;
+        }
+        table->documents.push_back(std::move(*foreignDoc));
+    }
+
+    _hashJoinTable = std::move(table);
+    _hashJoinBuildMicros = timer.micros();
+}
+
+boost::optional<std::vector<Document>> DocumentSourceLookUp::hashJoinMatches(
+    const Value& localValue) const {
+    invariant(_hashJoinTable);
+
+    std::vector<size_t> positions;
+    auto addBucket = [this, &positions](const Value& key) {
+        auto it = _hashJoinTable->buckets.find(key);
+        if (it != _hashJoinTable->buckets.end()) {
+            positions.insert(positions.end(), it->second.begin(), it->second.end());
+        }
+    };
+
+    if (localValue.isArray()) {
+        // An array is looked up as {$in: <array>}, which matches a document once if it matches any
+        // of the elements.
+        for (auto&& elem : localValue.getArray()) {
+            if (!isHashJoinable(elem)) {
+                return boost::none;
+            }
+            addBucket(elem);
+        }
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+    } else {
+        if (!isHashJoinable(localValue)) {
+            return boost::none;
+        }
+        addBucket(localValue);
+    }
+
+    std::vector<Document> matches;
+    matches.reserve(positions.size());
+    for (auto position : positions) {
+        matches.push_back(_hashJoinTable->documents[position]);
+    }
+    return std::move(matches);
+}
+
+Document DocumentSourceLookUp::queryResult(Document input) {
+    Timer timer;
     auto matchStage =
-        makeMatchStageFromInput(*input, _localField, _foreignFieldFieldName, BSONObj());
+        makeMatchStageFromInput(input, _localField, _foreignFieldFieldName, BSONObj());
     // We've already allocated space for the trailing $match stage in '_fromPipeline'.
     _fromPipeline.back() = matchStage;
     auto pipeline = uassertStatusOK(_mongod->makePipeline(_fromPipeline, _fromExpCtx));
@@ -127,8 +397,10 @@ boost::optional<Document> DocumentSourceLookUp::getNext() {
                 objsize <= BSONObjMaxInternalSize);
         results.emplace_back(std::move(*result));
     }
+    ++_numLookups;
+    _lookupMicros += timer.micros();
 
-    MutableDocument output(std::move(*input));
+    MutableDocument output(std::move(input));
     output.setNestedField(_as, Value(std::move(results)));
     return output.freeze();
 }
@@ -267,6 +539,9 @@ Pipeline::SourceContainer::iterator DocumentSourceLookUp::optimizeAt(
 
 void DocumentSourceLookUp::dispose() {
     _pipeline.reset();
+    _probedMatches.clear();
+    _probedResults.clear();
+    _hashJoinTable.reset();
     pSource->dispose();
 }
 
@@ -351,20 +626,48 @@ boost::optional<Document> DocumentSourceLookUp::unwindResult() {
     // Loop until we get a document that has at least one match.
     // Note we may return early from this loop if our source stage is exhausted or if the unwind
     // source was asked to return empty arrays and we get a document without a match.
-    while (!_pipeline || !_nextValue) {
+    while (!_nextValue) {
         _input = pSource->getNext();
         if (!_input)
             return {};
 
-        BSONObj filter = _additionalFilter.value_or(BSONObj());
-        auto matchStage =
-            makeMatchStageFromInput(*_input, _localField, _foreignFieldFieldName, filter);
-        // We've already allocated space for the trailing $match stage in '_fromPipeline'.
-        _fromPipeline.back() = matchStage;
-        _pipeline = uassertStatusOK(_mongod->makePipeline(_fromPipeline, _fromExpCtx));
+        Timer timer;
+        _pipeline.reset();
+        _probedMatches.clear();
+        _probedMatchIndex = 0;
+
+        maybeBuildHashJoinTable();
+
+        const Value localValue = _input->getNestedField(_localField);
+        boost::optional<std::vector<Document>> probed;
+        if (_hashJoinTable) {
+            probed = hashJoinMatches(localValue);
+            if (probed) {
+                ++_numHashJoinLookups;
+            }
+        }
+        if (!probed && _indexProbe) {
+            probed = std::move(_indexProbe->lookup({localValue}).front());
+            if (probed) {
+                ++_numIndexLookups;
+            }
+        }
+
+        if (probed) {
+            _probedMatches = std::move(*probed);
+        } else {
+            BSONObj filter = _additionalFilter.value_or(BSONObj());
+            auto matchStage =
+                makeMatchStageFromInput(*_input, _localField, _foreignFieldFieldName, filter);
+            // We've already allocated space for the trailing $match stage in '_fromPipeline'.
+            _fromPipeline.back() = matchStage;
+            _pipeline = uassertStatusOK(_mongod->makePipeline(_fromPipeline, _fromExpCtx));
+        }
 
         _cursorIndex = 0;
-        _nextValue = _pipeline->output()->getNext();
+        _nextValue = nextMatch();
+        ++_numLookups;
+        _lookupMicros += timer.micros();
 
         if (_unwindSrc->preserveNullAndEmptyArrays() && !_nextValue) {
             // There were no results for this cursor, but the $unwind was asked to preserve empty
@@ -382,7 +685,7 @@ boost::optional<Document> DocumentSourceLookUp::unwindResult() {
 
     invariant(bool(_input) && bool(_nextValue));
     auto currentValue = *_nextValue;
-    _nextValue = _pipeline->output()->getNext();
+    _nextValue = nextMatch();
 
     // Move input document into output if this is the last or only result, otherwise perform a copy.
     MutableDocument output(_nextValue ? *_input : std::move(*_input));
@@ -396,6 +699,16 @@ boost::optional<Document> DocumentSourceLookUp::unwindResult() {
     return output.freeze();
 }
 
+boost::optional<Document> DocumentSourceLookUp::nextMatch() {
+    if (_pipeline) {
+        return _pipeline->output()->getNext();
+    }
+    if (_probedMatchIndex < _probedMatches.size()) {
+        return std::move(_probedMatches[_probedMatchIndex++]);
+    }
+    return {};
+}
+
 void DocumentSourceLookUp::serializeToArray(std::vector<Value>& array, bool explain) const {
     MutableDocument output(DOC(
         getSourceName() << DOC("from" << _fromNs.coll() << "as" << _as.fullPath() << "localField"
@@ -421,6 +734,51 @@ void DocumentSourceLookUp::serializeToArray(std::vector<Value>& array, bool expl
                           ->getQuery());
         }
 
+        if (_mongod) {
+            // Explain may run before the first call to getNext(), which makes the probe.
+            std::unique_ptr<MongodInterface::LookupIndexProbe> probe;
+            if (!_madeIndexProbe) {
+                BSONObj filter = _matchSrc ? DocumentSourceMatch::descendMatchOnPath(
+                                                 _matchSrc->getMatchExpression(),
+                                                 _as.fullPath(),
+                                                 pExpCtx)
+                                                 ->getQuery()
+                                           : BSONObj();
+                probe = makeIndexProbe(filter);
+            }
+            const auto* indexProbe = _madeIndexProbe ? _indexProbe.get() : probe.get();
+
+            MutableDocument stats;
+            stats["strategy"] =
+                Value(_hashJoinTable ? "hashJoin" : indexProbe ? "indexProbe" : "query");
+            if (_hashJoinTable) {
+                stats["hashJoin"] =
+                    Value(DOC("nDocuments" << static_cast<long long>(
+                                                  _hashJoinTable->documents.size())
+                                           << "nKeys"
+                                           << static_cast<long long>(
+                                                  _hashJoinTable->buckets.size())
+                                           << "memoryUsageBytes"
+                                           << static_cast<long long>(
+                                                  _hashJoinTable->memoryUsageBytes)
+                                           << "buildMicros"
+                                           << _hashJoinBuildMicros));
+            }
+            if (indexProbe) {
+                stats["indexName"] = Value(indexProbe->getIndexName());
+                stats["keysExamined"] = Value(indexProbe->keysExamined);
+                stats["docsExamined"] = Value(indexProbe->docsExamined);
+            }
+            stats["nLookups"] = Value(_numLookups);
+            stats["nIndexLookups"] = Value(_numIndexLookups);
+            stats["nHashJoinLookups"] = Value(_numHashJoinLookups);
+            stats["nQueries"] = Value(_numLookups - _numIndexLookups - _numHashJoinLookups);
+            stats["lookupMicros"] = Value(_lookupMicros);
+            stats["avgMicrosPerLookup"] =
+                Value(_numLookups ? static_cast<double>(_lookupMicros) / _numLookups : 0.0);
+            output[getSourceName()]["lookupStats"] = stats.freezeToValue();
+        }
+
         array.push_back(Value(output.freeze()));
     } else {
         array.push_back(Value(output.freeze()));
@@ -0,0 +1,383 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/document_source_parallel.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "mongo/db/client.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/pipeline.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/service_context.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+using std::vector;
+
+namespace {
+
+/**
+ * Returns true if 'stage' transforms or filters each document on its own, so that any worker can
+ * run it on any subset of the input.
+ */
+bool canRunOnWorker(DocumentSource* stage) {
+    if (auto match = dynamic_cast<DocumentSourceMatch*>(stage)) {
+        return !match->isTextQuery();
+    }
+    return dynamic_cast<DocumentSourceSingleDocumentTransformation*>(stage) ||
+        dynamic_cast<DocumentSourceUnwind*>(stage);
+}
+
+}  // namespace
+
+class DocumentSourceParallel::WorkerInput final : public DocumentSource {
+public:
+    WorkerInput(DocumentSourceParallel* exchange, const intrusive_ptr<ExpressionContext>& expCtx)
+        : DocumentSource(expCtx), _exchange(exchange) {}
+
+    boost::optional<Document> getNext() final {
+        pExpCtx->checkForInterrupt();
+
+        while (_position == _batch.size()) {
+            _batch.clear();
+            _position = 0;
+            if (!_exchange->nextBatch(&_batch)) {
+                return boost::none;
+            }
+        }
+        return std::move(_batch[_position++]);
+    }
+
+    const char* getSourceName() const final {
+        return "$_internalParallelInput";
+    }
+
+    bool isValidInitialSource() const final {
+        return true;
+    }
+
+private:
+    Value serialize(bool explain = false) const final {
+        return Value();
+    }
+
+    DocumentSourceParallel* const _exchange;
+    Batch _batch;
+    size_t _position = 0;
+};
+
+DocumentSourceParallel::DocumentSourceParallel(vector<BSONObj> workerStages,
+                                               int parallelism,
+                                               const intrusive_ptr<ExpressionContext>& pExpCtx)
+    : DocumentSource(pExpCtx), _workerStages(std::move(workerStages)), _parallelism(parallelism) {}
+
+DocumentSourceParallel::~DocumentSourceParallel() {
+    stopWorkers(Status(ErrorCodes::Interrupted, "aggregation abandoned"));
+}
+
+Pipeline::SourceContainer::iterator DocumentSourceParallel::parallelizeLeadingStages(
+    Pipeline::SourceContainer::iterator itr,
+    Pipeline::SourceContainer* container,
+    const intrusive_ptr<ExpressionContext>& expCtx) {
+    if (expCtx->parallelism <= 1 || itr == container->end()) {
+        return container->end();
+    }
+
+    // A sorted input, e.g. from an index scan, may let the $group stream, and the workers would
+    // lose the order.
+    if (itr != container->begin() && !(*std::prev(itr))->getOutputSorts().empty()) {
+        return container->end();
+    }
+
+    auto groupItr = itr;
+    for (; groupItr != container->end(); ++groupItr) {
+        if (dynamic_cast<DocumentSourceGroup*>(groupItr->get())) {
+            break;
+        }
+        if (!canRunOnWorker(groupItr->get())) {
+            return container->end();
+        }
+    }
+    if (groupItr == container->end()) {
+        return container->end();
+    }
+
+    auto group = static_cast<DocumentSourceGroup*>(groupItr->get());
+    if (group->isDoingMerge() || !group->accumulatorsIgnoreInputOrder()) {
+        return container->end();
+    }
+
+    const auto afterGroup = std::next(groupItr);
+    vector<Value> serializedStages;
+    for (auto stageItr = itr; stageItr != afterGroup; ++stageItr) {
+        (*stageItr)->serializeToArray(serializedStages);
+    }
+    vector<BSONObj> workerStages;
+    for (auto&& stage : serializedStages) {
+        workerStages.push_back(stage.getDocument().toBson());
+    }
+
+    intrusive_ptr<DocumentSource> merger = group->getMergeSource();
+    intrusive_ptr<DocumentSource> parallel(
+        new DocumentSourceParallel(std::move(workerStages), expCtx->parallelism, expCtx));
+
+    container->erase(itr, afterGroup);
+    auto parallelItr = container->insert(afterGroup, parallel);
+    container->insert(afterGroup, merger);
+    return parallelItr;
+}
+
+boost::optional<Document> DocumentSourceParallel::getNext() {
+    pExpCtx->checkForInterrupt();
+
+    try {
+        if (!_started) {
+            _started = true;
+            run();
+        }
+
+        boost::optional<Document> next = nextResult();
+        if (!next) {
+            stopWorkers(Status::OK());
+            uassertStatusOK(_status);
+        }
+        return next;
+    } catch (...) {
+        stopWorkers(Status(ErrorCodes::Interrupted, "aggregation abandoned"));
+        throw;
+    }
+}
+
+void DocumentSourceParallel::dispose() {
+    stopWorkers(Status(ErrorCodes::Interrupted, "aggregation abandoned"));
+    _workers.clear();
+    _results.clear();
+    DocumentSource::dispose();
+}
+
+Value DocumentSourceParallel::serialize(bool explain) const {
+    vector<Value> stages(_workerStages.begin(), _workerStages.end());
+    return Value(DOC(getSourceName() << DOC("parallelism" << _parallelism << "pipeline"
+                                                          << Value(std::move(stages)))));
+}
+
+void DocumentSourceParallel::run() {
+    startWorkers();
+    while (boost::optional<Document> next = pSource->getNext()) {
+        _batch.push_back(std::move(*next));
+        if (_batch.size() >= static_cast<size_t>(kMaxBatchDocs)) {
+            queueBatch();
+        }
+    }
+    if (!_batch.empty()) {
+        queueBatch();
+    }
+
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _noMoreBatches = true;
+    }
+    _workAvailable.notify_all();
+}
+
+void DocumentSourceParallel::startWorkers() {
+    // The workers share the memory budget of the $group.
+    const int maxMemoryUsageBytes =
+        std::max(1, internalDocumentSourceGroupMaxMemoryBytes.load() / _parallelism);
+
+    for (int i = 0; i < _parallelism; i++) {
+        // Each worker needs its own ExpressionContext, whose interrupt check counter is not shared.
+        // The workers build partial groups, as the shards of a sharded aggregation do.
+        auto workerExpCtx = pExpCtx->copyWith(pExpCtx->ns);
+        workerExpCtx->inShard = true;
+        workerExpCtx->mergerAcceptsArrayPartials = true;
+
+        auto pipeline = uassertStatusOK(Pipeline::parse(_workerStages, workerExpCtx));
+        pipeline->injectExpressionContext(workerExpCtx);
+        pipeline->optimizePipeline();
+        pipeline->addInitialSource(new WorkerInput(this, workerExpCtx));
+
+        auto group = dynamic_cast<DocumentSourceGroup*>(pipeline->output());
+        invariant(group);
+        group->setMaxMemoryUsageBytes(maxMemoryUsageBytes);
+
+        // The worker attaches the pipeline to an OperationContext of its own.
+        pipeline->detachFromOperationContext();
+
+        auto worker = stdx::make_unique<Worker>();
+        worker->pipeline = std::move(pipeline);
+        _workers.push_back(std::move(worker));
+    }
+
+    ServiceContext* serviceContext = pExpCtx->opCtx->getServiceContext();
+    _runningWorkers = _workers.size();
+    for (size_t i = 0; i < _workers.size(); i++) {
+        Worker* worker = _workers[i].get();
+        worker->thread = stdx::thread([this, worker, i, serviceContext] {
+            const std::string name = str::stream() << "aggParallel-" << i;
+            Client::initThread(name.c_str(), serviceContext, nullptr);
+            {
+                auto opCtx = cc().makeOperationContext();
+                worker->pipeline->reattachToOperationContext(opCtx.get());
+                runWorker(worker);
+                worker->pipeline->detachFromOperationContext();
+            }
+            Client::destroy();
+        });
+    }
+}
+
+void DocumentSourceParallel::runWorker(Worker* worker) {
+    Status status = Status::OK();
+    try {
+        DocumentSource* output = worker->pipeline->output();
+        while (boost::optional<Document> next = output->getNext()) {
+            queueResult(std::move(*next));
+        }
+    } catch (const DBException& ex) {
+        status = ex.toStatus();
+    } catch (const std::exception& ex) {
+        status = Status(ErrorCodes::InternalError,
+                        str::stream() << "parallel aggregation worker failed: " << ex.what());
+    } catch (...) {
+        status = Status(ErrorCodes::InternalError,
+                        "parallel aggregation worker failed with an unknown exception");
+    }
+
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _runningWorkers--;
+        if (_status.isOK()) {
+            _status = std::move(status);
+        }
+    }
+    _workAvailable.notify_all();
+    _spaceAvailable.notify_all();
+    _resultAvailable.notify_all();
+    _resultSpaceAvailable.notify_all();
+}
+
+void DocumentSourceParallel::waitAndCheckForInterrupt(stdx::condition_variable& cond,
+                                                      stdx::unique_lock<stdx::mutex>& lk) {
+    cond.wait_for(lk, Milliseconds(100).toSystemDuration());
+    lk.unlock();
+    pExpCtx->opCtx->checkForInterrupt();
+    lk.lock();
+}
+
+void DocumentSourceParallel::queueBatch() {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    while (_status.isOK() && _queue.size() >= 2 * _workers.size()) {
+        waitAndCheckForInterrupt(_spaceAvailable, lk);
+    }
+    uassertStatusOK(_status);
+
+    _queue.push_back(std::move(_batch));
+    lk.unlock();
+    _workAvailable.notify_one();
+
+    _batch = Batch();
+    _batch.reserve(kMaxBatchDocs);
+}
+
+bool DocumentSourceParallel::nextBatch(Batch* batch) {
+    {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _workAvailable.wait(
+            lk, [this] { return !_status.isOK() || !_queue.empty() || _noMoreBatches; });
+        uassertStatusOK(_status);
+        if (_queue.empty()) {
+            return false;
+        }
+
+        *batch = std::move(_queue.front());
+        _queue.pop_front();
+    }
+    _spaceAvailable.notify_one();
+    return true;
+}
+
+boost::optional<Document> DocumentSourceParallel::nextResult() {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    while (_status.isOK() && _results.empty() && _runningWorkers > 0) {
+        waitAndCheckForInterrupt(_resultAvailable, lk);
+    }
+    uassertStatusOK(_status);
+    if (_results.empty()) {
+        return boost::none;
+    }
+
+    Document next = std::move(_results.front());
+    _results.pop_front();
+    lk.unlock();
+    _resultSpaceAvailable.notify_one();
+    return std::move(next);
+}
+
+void DocumentSourceParallel::queueResult(Document result) {
+    {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _resultSpaceAvailable.wait(lk, [this] {
+            return !_status.isOK() || _results.size() < static_cast<size_t>(kMaxQueuedResults);
+        });
+        uassertStatusOK(_status);
+        _results.push_back(std::move(result));
+    }
+    _resultAvailable.notify_one();
+}
+
+void DocumentSourceParallel::stopWorkers(Status status) {
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _noMoreBatches = true;
+        if (_status.isOK()) {
+            _status = std::move(status);
+        }
+    }
+    _workAvailable.notify_all();
+    _spaceAvailable.notify_all();
+    _resultSpaceAvailable.notify_all();
+
+    for (auto&& worker : _workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+}  // namespace mongo
@@ -0,0 +1,185 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/intrusive_ptr.hpp>
+#include <boost/optional.hpp>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/db/pipeline/document_source.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+
+namespace mongo {
+
+/**
+ * Runs the leading stages of a pipeline, ending in a $group, on several threads at once.
+ *
+ * The thread executing the pipeline reads the documents of its input, normally the collection
+ * scan of a $cursor stage, and queues them in batches. Each of a fixed number of worker threads
+ * runs its own copy of the stages over the batches it takes from the queue, and its $group emits
+ * partial aggregates as it would on a shard. Once the input is exhausted, the workers pass their
+ * partial groups back through a second bounded queue, from which this stage returns them. It must
+ * be followed by the merging half of the $group.
+ *
+ * Each worker runs on its own Client and OperationContext. Only the thread executing the pipeline
+ * checks the OperationContext of the aggregation for interrupts, and stops the workers if it is
+ * interrupted. The workers are stopped at the latest by dispose() or the destructor.
+ */
+class DocumentSourceParallel final : public DocumentSource {
+    MONGO_DISALLOW_COPYING(DocumentSourceParallel);
+
+public:
+    static const int kMaxBatchDocs = 1000;
+
+    // The most partial groups the workers may queue for the merging $group.
+    static const int kMaxQueuedResults = 1000;
+
+    ~DocumentSourceParallel() final;
+
+    /**
+     * Looks for a run of stages starting at 'itr' in 'container' which can be split between
+     * 'expCtx->parallelism' threads: any number of $match, $project, $addFields, $replaceRoot and
+     * $unwind stages followed by a $group whose accumulators ignore the order of their input. The
+     * input of the run must not be sorted. Replaces such a run with a DocumentSourceParallel
+     * followed by the merging half of the $group, and returns an iterator to the new stage.
+     * Otherwise leaves 'container' alone and returns 'container->end()'.
+     *
+     * The caller must stitch the pipeline back together.
+     */
+    static Pipeline::SourceContainer::iterator parallelizeLeadingStages(
+        Pipeline::SourceContainer::iterator itr,
+        Pipeline::SourceContainer* container,
+        const boost::intrusive_ptr<ExpressionContext>& expCtx);
+
+    boost::optional<Document> getNext() final;
+    void dispose() final;
+
+    const char* getSourceName() const final {
+        return "$_internalParallel";
+    }
+
+    int getParallelism() const {
+        return _parallelism;
+    }
+
+private:
+    /**
+     * The initial source of the pipeline run by each worker. Returns the documents of the batches
+     * the worker takes from the queue, until the queue is drained.
+     */
+    class WorkerInput;
+
+    using Batch = std::vector<Document>;
+
+    struct Worker {
+        boost::intrusive_ptr<Pipeline> pipeline;
+        stdx::thread thread;
+    };
+
+    DocumentSourceParallel(std::vector<BSONObj> workerStages,
+                           int parallelism,
+                           const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
+
+    Value serialize(bool explain = false) const final;
+
+    /**
+     * Starts the workers and feeds them the whole input.
+     */
+    void run();
+
+    void startWorkers();
+    void runWorker(Worker* worker);
+
+    /**
+     * Queues '_batch' for the workers. Blocks while they are too far behind. Throws the error of
+     * the first worker which failed, if any.
+     */
+    void queueBatch();
+
+    /**
+     * Returns the next partial group produced by the workers, or boost::none once all of them
+     * have finished. Throws the error of the first worker which failed, if any.
+     */
+    boost::optional<Document> nextResult();
+
+    /**
+     * Queues a partial group of a worker for nextResult(). Blocks while the queue is full. Throws
+     * if the work has been abandoned.
+     */
+    void queueResult(Document result);
+
+    /**
+     * Waits on 'cond' for at most a short period, then checks the OperationContext of the
+     * aggregation for interrupts. Only called by the thread executing the pipeline.
+     */
+    void waitAndCheckForInterrupt(stdx::condition_variable& cond,
+                                  stdx::unique_lock<stdx::mutex>& lk);
+
+    /**
+     * Takes the next batch off the queue for a worker. Returns false once the queue is drained and
+     * no more batches will be queued. Throws if the work has been abandoned.
+     */
+    bool nextBatch(Batch* batch);
+
+    /**
+     * Stops the workers, if they are running, and waits for them to exit. 'status' is reported to
+     * any worker waiting for a batch.
+     */
+    void stopWorkers(Status status);
+
+    // The serialized stages each worker parses into its own pipeline.
+    const std::vector<BSONObj> _workerStages;
+    const int _parallelism;
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    bool _started = false;
+
+    // Only used by the thread executing the pipeline.
+    Batch _batch;
+
+    // Protects the members below.
+    stdx::mutex _mutex;
+    stdx::condition_variable _workAvailable;
+    stdx::condition_variable _spaceAvailable;
+    std::deque<Batch> _queue;
+    bool _noMoreBatches = false;
+    stdx::condition_variable _resultAvailable;
+    stdx::condition_variable _resultSpaceAvailable;
+    std::deque<Document> _results;
+    int _runningWorkers = 0;
+    Status _status = Status::OK();
+};
+
+}  // namespace mongo
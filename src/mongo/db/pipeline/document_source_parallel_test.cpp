@@ -0,0 +1,243 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/document_source_parallel.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "mongo/bson/bsonmisc.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/json.h"
+#include "mongo/db/pipeline/aggregation_context_fixture.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/document_value_test_util.h"
+#include "mongo/db/pipeline/pipeline.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+// Crutch.
+bool isMongos() {
+    return false;
+}
+
+namespace {
+
+using boost::intrusive_ptr;
+using std::deque;
+using std::vector;
+
+using DocumentSourceParallelTest = AggregationContextFixture;
+
+Pipeline::SourceContainer parseStages(const vector<BSONObj>& rawPipeline,
+                                      const intrusive_ptr<ExpressionContext>& expCtx) {
+    auto pipeline = uassertStatusOK(Pipeline::parse(rawPipeline, expCtx));
+    pipeline->injectExpressionContext(expCtx);
+    return Pipeline::SourceContainer(pipeline->getSources().begin(),
+                                     pipeline->getSources().end());
+}
+
+/**
+ * Returns 'numDocs' documents of the form {_id: i, a: i % 7, b: i}.
+ */
+deque<Document> makeInput(int numDocs) {
+    deque<Document> input;
+    for (int i = 0; i < numDocs; i++) {
+        input.push_back(Document{{"_id", i}, {"a", i % 7}, {"b", i}});
+    }
+    return input;
+}
+
+TEST_F(DocumentSourceParallelTest, ShouldReplaceLeadingStagesAndGroup) {
+    auto expCtx = getExpCtx();
+    expCtx->parallelism = 4;
+    auto sources = parseStages({fromjson("{$match: {b: {$gte: 0}}}"),
+                                fromjson("{$project: {a: 1, b: 1}}"),
+                                fromjson("{$group: {_id: '$a', total: {$sum: '$b'}}}"),
+                                fromjson("{$sort: {_id: 1}}")},
+                               expCtx);
+
+    auto itr =
+        DocumentSourceParallel::parallelizeLeadingStages(sources.begin(), &sources, expCtx);
+    ASSERT(itr == sources.begin());
+    ASSERT_EQ(sources.size(), 3UL);
+
+    auto parallel = dynamic_cast<DocumentSourceParallel*>(itr->get());
+    ASSERT(parallel);
+    ASSERT_EQ(parallel->getParallelism(), 4);
+    ASSERT(dynamic_cast<DocumentSourceGroup*>(std::next(itr)->get()));
+    ASSERT(dynamic_cast<DocumentSourceSort*>(std::next(itr, 2)->get()));
+
+    vector<Value> serialized;
+    parallel->serializeToArray(serialized);
+    ASSERT_EQ(serialized.size(), 1UL);
+    ASSERT_VALUE_EQ(serialized[0]["$_internalParallel"]["parallelism"], Value(4));
+    ASSERT_EQ(serialized[0]["$_internalParallel"]["pipeline"].getArray().size(), 3UL);
+}
+
+TEST_F(DocumentSourceParallelTest, ShouldNotReplaceStagesWithoutParallelism) {
+    auto expCtx = getExpCtx();
+    expCtx->parallelism = 1;
+    auto sources = parseStages({fromjson("{$group: {_id: '$a', total: {$sum: '$b'}}}")}, expCtx);
+    ASSERT(DocumentSourceParallel::parallelizeLeadingStages(sources.begin(), &sources, expCtx) ==
+           sources.end());
+    ASSERT_EQ(sources.size(), 1UL);
+}
+
+TEST_F(DocumentSourceParallelTest, ShouldNotReplaceGroupWithOrderSensitiveAccumulators) {
+    auto expCtx = getExpCtx();
+    expCtx->parallelism = 4;
+    for (auto&& accumulator : {"$first", "$last", "$push"}) {
+        auto sources =
+            parseStages({BSON("$group" << BSON("_id"
+                                               << "$a"
+                                               << "x"
+                                               << BSON(accumulator << "$b")))},
+                        expCtx);
+        ASSERT(DocumentSourceParallel::parallelizeLeadingStages(
+                   sources.begin(), &sources, expCtx) == sources.end());
+        ASSERT_EQ(sources.size(), 1UL);
+    }
+}
+
+TEST_F(DocumentSourceParallelTest, ShouldNotReplaceStagesWhichDependOnOtherDocuments) {
+    auto expCtx = getExpCtx();
+    expCtx->parallelism = 4;
+    auto sources = parseStages({fromjson("{$sort: {b: 1}}"),
+                                fromjson("{$limit: 10}"),
+                                fromjson("{$group: {_id: '$a', total: {$sum: '$b'}}}")},
+                               expCtx);
+    ASSERT(DocumentSourceParallel::parallelizeLeadingStages(sources.begin(), &sources, expCtx) ==
+           sources.end());
+
+    sources = parseStages({fromjson("{$project: {a: 1}}")}, expCtx);
+    ASSERT(DocumentSourceParallel::parallelizeLeadingStages(sources.begin(), &sources, expCtx) ==
+           sources.end());
+}
+
+TEST_F(DocumentSourceParallelTest, ShouldNotReplaceStagesOverSortedInput) {
+    auto expCtx = getExpCtx();
+    expCtx->parallelism = 4;
+    auto mock = DocumentSourceMock::create();
+    mock->sorts = {BSON("a" << 1)};
+
+    auto sources = parseStages({fromjson("{$group: {_id: '$a', total: {$sum: '$b'}}}")}, expCtx);
+    sources.push_front(mock);
+    ASSERT(DocumentSourceParallel::parallelizeLeadingStages(
+               std::next(sources.begin()), &sources, expCtx) == sources.end());
+    ASSERT_EQ(sources.size(), 2UL);
+}
+
+TEST_F(DocumentSourceParallelTest, ShouldProduceTheSameGroupsAsOneThread) {
+    const int kNumDocs = 10 * DocumentSourceParallel::kMaxBatchDocs + 17;
+    auto expCtx = getExpCtx();
+    expCtx->parallelism = 4;
+    auto sources =
+        parseStages({fromjson("{$match: {b: {$mod: [3, 0]}}}"),
+                     fromjson("{$addFields: {c: {$multiply: ['$b', 2]}}}"),
+                     fromjson("{$group: {_id: '$a', total: {$sum: '$c'}, count: {$sum: 1}, "
+                              "avg: {$avg: '$b'}, min: {$min: '$b'}, max: {$max: '$b'}}}")},
+                    expCtx);
+    auto itr =
+        DocumentSourceParallel::parallelizeLeadingStages(sources.begin(), &sources, expCtx);
+    ASSERT(itr != sources.end());
+
+    auto mock = DocumentSourceMock::create(makeInput(kNumDocs));
+    sources.push_front(mock);
+    for (auto stage = std::next(sources.begin()); stage != sources.end(); ++stage) {
+        (*stage)->setSource(std::prev(stage)->get());
+    }
+
+    std::map<int, vector<long long>> expected;
+    for (int i = 0; i < kNumDocs; i += 3) {
+        expected[i % 7].push_back(i);
+    }
+
+    size_t numGroups = 0;
+    while (auto next = sources.back()->getNext()) {
+        ++numGroups;
+        const auto& values = expected[next->getField("_id").getInt()];
+        long long total = 0;
+        for (auto value : values) {
+            total += value;
+        }
+        ASSERT_VALUE_EQ(next->getField("total"), Value(2 * total));
+        ASSERT_VALUE_EQ(next->getField("count"), Value(static_cast<int>(values.size())));
+        ASSERT_VALUE_EQ(next->getField("avg"),
+                        Value(static_cast<double>(total) / values.size()));
+        ASSERT_VALUE_EQ(next->getField("min"), Value(static_cast<int>(values.front())));
+        ASSERT_VALUE_EQ(next->getField("max"), Value(static_cast<int>(values.back())));
+    }
+    ASSERT_EQ(numGroups, expected.size());
+}
+
+// There are many more partial groups than fit in the queue between the workers and the merging
+// $group, so the workers must stream them.
+TEST_F(DocumentSourceParallelTest, ShouldStreamMorePartialGroupsThanTheQueueHolds) {
+    const int kNumDocs = 5 * DocumentSourceParallel::kMaxQueuedResults;
+    auto expCtx = getExpCtx();
+    expCtx->parallelism = 4;
+    auto sources = parseStages({fromjson("{$group: {_id: '$_id', count: {$sum: 1}}}")}, expCtx);
+    ASSERT(DocumentSourceParallel::parallelizeLeadingStages(sources.begin(), &sources, expCtx) !=
+           sources.end());
+
+    auto mock = DocumentSourceMock::create(makeInput(kNumDocs));
+    sources.front()->setSource(mock.get());
+    sources.back()->setSource(sources.front().get());
+
+    int numGroups = 0;
+    while (auto next = sources.back()->getNext()) {
+        ++numGroups;
+        ASSERT_VALUE_EQ(next->getField("count"), Value(1));
+    }
+    ASSERT_EQ(numGroups, kNumDocs);
+}
+
+TEST_F(DocumentSourceParallelTest, ShouldReportTheErrorOfAWorker) {
+    auto expCtx = getExpCtx();
+    expCtx->parallelism = 4;
+    auto sources = parseStages(
+        {fromjson("{$group: {_id: {$divide: ['$b', '$a']}, count: {$sum: 1}}}")}, expCtx);
+    ASSERT(DocumentSourceParallel::parallelizeLeadingStages(sources.begin(), &sources, expCtx) !=
+           sources.end());
+
+    auto mock = DocumentSourceMock::create(makeInput(10 * DocumentSourceParallel::kMaxBatchDocs));
+    sources.front()->setSource(mock.get());
+    sources.back()->setSource(sources.front().get());
+
+    // Every seventh document divides by zero.
+    ASSERT_THROWS_CODE(sources.back()->getNext(), UserException, 16608);
+}
+
+}  // namespace
+}  // namespace mongo
@@ -46,7 +46,11 @@ using std::string;
 using std::vector;
 
 DocumentSourceSort::DocumentSourceSort(const intrusive_ptr<ExpressionContext>& pExpCtx)
-    : DocumentSource(pExpCtx), populated(false), _mergingPresorted(false) {}
+    : DocumentSource(pExpCtx),
+      populated(false),
+      _mergingPresorted(false),
+      _spillFileStats(std::make_shared<SorterFileStats>()),
+      _topKStats(std::make_shared<SorterTopKStats>()) {}
 
 REGISTER_DOCUMENT_SOURCE(sort, DocumentSourceSort::createFromBson);
 
@@ -73,12 +77,29 @@ boost::optional<Document> DocumentSourceSort::getNext() {
 
 void DocumentSourceSort::serializeToArray(vector<Value>& array, bool explain) const {
     if (explain) {  // always one Value for combined $sort + $limit
+        Value spillStats;
+        if (_spillFileStats->blocksWritten > 0) {
+            spillStats = Value(DOC("spilledBytes" << _spillFileStats->bytesSpilled << "bytesWritten"
+                                                  << _spillFileStats->bytesWritten
+                                                  << "bytesRead"
+                                                  << _spillFileStats->bytesRead));
+        }
+        Value topKStats;
+        if (_topKStats->discardedOnAdd > 0 || _topKStats->discardedOnSpill > 0) {
+            topKStats = Value(DOC("discardedOnAdd" << _topKStats->discardedOnAdd
+                                                   << "discardedOnSpill"
+                                                   << _topKStats->discardedOnSpill));
+        }
         array.push_back(
             Value(DOC(getSourceName()
                       << DOC("sortKey" << serializeSortKey(explain) << "mergePresorted"
                                        << (_mergingPresorted ? Value(true) : Value())
                                        << "limit"
-                                       << (limitSrc ? Value(limitSrc->getLimit()) : Value())))));
+                                       << (limitSrc ? Value(limitSrc->getLimit()) : Value())
+                                       << "spillStats"
+                                       << spillStats
+                                       << "topKStats"
+                                       << topKStats))));
     } else {  // one Value for $sort and maybe a Value for $limit
         MutableDocument inner(serializeSortKey(explain));
         if (_mergingPresorted)
@@ -227,13 +248,16 @@ SortOptions DocumentSourceSort::makeSortOptions() const {
     verify(vSortKey.size());
 
     SortOptions opts;
-    if (limitSrc)
+    if (limitSrc) {
         opts.limit = limitSrc->getLimit();
+        opts.topKStats = _topKStats;
+    }
 
     opts.maxMemoryUsageBytes = 100 * 1024 * 1024;
     if (pExpCtx->extSortAllowed && !pExpCtx->inRouter) {
         opts.extSortAllowed = true;
         opts.tempDir = pExpCtx->tempDir;
+        opts.fileStats = _spillFileStats;
     }
 
     return opts;
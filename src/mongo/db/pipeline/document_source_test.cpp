@@ -37,6 +37,7 @@
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/pipeline/value_comparator.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/service_context_noop.h"
 #include "mongo/db/storage/storage_options.h"
@@ -1354,6 +1355,89 @@ public:
     }
 };
 
+/**
+ * A $group whose groups don't fit in memory spills them to hash partitions, and splits any
+ * partition which still doesn't fit when it is read back. Each group must be returned exactly
+ * once, with the contributions of every spill merged together.
+ */
+class SpillsToHashPartitions : public Mock::Base {
+public:
+    SpillsToHashPartitions()
+        : _tempDir("DocumentSourceGroupSpillTest"),
+          _oldMaxMemoryBytes(internalDocumentSourceGroupMaxMemoryBytes.load()) {}
+
+    ~SpillsToHashPartitions() {
+        internalDocumentSourceGroupMaxMemoryBytes.store(_oldMaxMemoryBytes);
+    }
+
+    void run() {
+        intrusive_ptr<ExpressionContext> expCtx =
+            new ExpressionContext(_opCtx.get(), AggregationRequest(NamespaceString(ns), {}));
+        expCtx->extSortAllowed = true;
+        expCtx->tempDir = _tempDir.path();
+
+        // Small enough that only a couple of groups fit in memory at once.
+        internalDocumentSourceGroupMaxMemoryBytes.store(200);
+
+        const int numGroups = 200;
+        const int docsPerGroup = 5;
+        std::deque<Document> inputs;
+        for (int i = 0; i < numGroups * docsPerGroup; ++i) {
+            inputs.push_back(DOC("a" << (i % numGroups) << "b" << i));
+        }
+        auto source = DocumentSourceMock::create(inputs);
+
+        BSONObj spec = fromjson("{$group: {_id: '$a', count: {$sum: 1}, bs: {$push: '$b'}}}");
+        auto group = DocumentSourceGroup::createFromBson(spec.firstElement(), expCtx);
+        group->injectExpressionContext(expCtx);
+        group->setSource(source.get());
+
+        std::set<int> seenIds;
+        while (boost::optional<Document> next = group->getNext()) {
+            const int id = next->getField("_id").getInt();
+            ASSERT(seenIds.insert(id).second);
+            ASSERT_VALUE_EQ(next->getField("count"), Value(docsPerGroup));
+
+            std::vector<Value> bs = next->getField("bs").getArray();
+            ASSERT_EQ(bs.size(), static_cast<size_t>(docsPerGroup));
+            std::set<int> seenBs;
+            for (auto&& b : bs) {
+                ASSERT_EQ(b.getInt() % numGroups, id);
+                seenBs.insert(b.getInt());
+            }
+            ASSERT_EQ(seenBs.size(), static_cast<size_t>(docsPerGroup));
+        }
+        ASSERT_EQ(seenIds.size(), static_cast<size_t>(numGroups));
+        assertExhausted(group);
+
+        auto groupStage = static_cast<DocumentSourceGroup*>(group.get());
+        const DocumentSourceGroup::SpillStats stats = groupStage->getSpillStats();
+        ASSERT_GT(stats.spills, 0);
+        ASSERT_GT(stats.spilledBytes, 0);
+        ASSERT_GT(stats.bytesWritten, 0);
+        ASSERT_EQ(stats.bytesRead, stats.bytesWritten);
+        ASSERT_GT(stats.partitionsProcessed, 0);
+        ASSERT_GTE(stats.maxPartitionLevel, 1);
+
+        vector<Value> explained;
+        group->serializeToArray(explained, true);
+        ASSERT_EQ(explained.size(), 1UL);
+        Document spillStats = explained[0]["$group"]["$spillStats"].getDocument();
+        ASSERT_VALUE_EQ(spillStats["spills"], Value(stats.spills));
+        ASSERT_VALUE_EQ(spillStats["spilledBytes"], Value(stats.spilledBytes));
+        ASSERT_VALUE_EQ(spillStats["bytesWritten"], Value(stats.bytesWritten));
+    }
+
+private:
+    void assertExhausted(const intrusive_ptr<DocumentSource>& source) const {
+        ASSERT(!source->getNext());
+        ASSERT(!source->getNext());
+    }
+
+    TempDir _tempDir;
+    const int _oldMaxMemoryBytes;
+};
+
 }  // namespace DocumentSourceGroup
 
 namespace DocumentSourceProject {
@@ -4929,6 +5013,7 @@ public:
         add<DocumentSourceGroup::StreamingWithRootSubfield>();
         add<DocumentSourceGroup::StreamingWithConstantAndFieldPath>();
         add<DocumentSourceGroup::StreamingWithFieldRepeated>();
+        add<DocumentSourceGroup::SpillsToHashPartitions>();
 #endif
 
         add<DocumentSourceSort::Empty>();
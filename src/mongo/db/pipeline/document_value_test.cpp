@@ -545,6 +545,178 @@ TEST(MetaFields, BadSerialization) {
 }
 }  // namespace MetaFields
 
+namespace LazyDocument {
+using mongo::Document;
+
+const DocumentStorage& storageOf(const Document& doc) {
+    return *static_cast<const DocumentStorage*>(doc.getPtr());
+}
+
+size_t numConvertedFields(const Document& doc) {
+    size_t count = 0;
+    for (auto it = storageOf(doc).convertedIterator(); !it.atEnd(); it.advance()) {
+        ++count;
+    }
+    return count;
+}
+
+BSONObj wideObj() {
+    return BSON("a" << 1 << "b"
+                    << "two"
+                    << "c"
+                    << BSON("x" << 3)
+                    << "d"
+                    << BSON_ARRAY(4 << 5)
+                    << "e"
+                    << 6.5
+                    << "f"
+                    << BSONNULL);
+}
+
+TEST(LazyDocument, LookupConvertsFieldsOnlyUpToTheOneRequested) {
+    Document doc = Document::fromBsonLazily(wideObj());
+    ASSERT_EQUALS(0U, numConvertedFields(doc));
+
+    ASSERT_EQUALS("two", doc["b"].getString());
+    ASSERT_EQUALS(2U, numConvertedFields(doc));
+    ASSERT_TRUE(storageOf(doc).hasLazyFields());
+
+    // Fields already converted are found without converting more.
+    ASSERT_EQUALS(1, doc["a"].getInt());
+    ASSERT_EQUALS(2U, numConvertedFields(doc));
+
+    ASSERT_VALUE_EQ(Value(BSON("x" << 3)), doc.getNestedField(FieldPath("c")));
+    ASSERT_EQUALS(3, doc.getNestedField(FieldPath("c.x")).getInt());
+    ASSERT_EQUALS(3U, numConvertedFields(doc));
+}
+
+TEST(LazyDocument, LookupOfMissingFieldConvertsNothing) {
+    Document doc = Document::fromBsonLazily(wideObj());
+    ASSERT_TRUE(doc["z"].missing());
+    ASSERT_TRUE(doc.getNestedField(FieldPath("z.y")).missing());
+    ASSERT_EQUALS(0U, numConvertedFields(doc));
+    ASSERT_TRUE(storageOf(doc).hasLazyFields());
+}
+
+TEST(LazyDocument, MatchesEagerlyConvertedDocument) {
+    Document eager(wideObj());
+    Document lazy = Document::fromBsonLazily(wideObj());
+    ASSERT_EQUALS("two", lazy["b"].getString());
+
+    ASSERT_EQUALS(eager.size(), lazy.size());
+    ASSERT_DOCUMENT_EQ(eager, lazy);
+    for (size_t i = 0; i < eager.size(); ++i) {
+        ASSERT_EQUALS(getNthField(eager, i).first, getNthField(lazy, i).first);
+    }
+    ASSERT_FALSE(storageOf(lazy).hasLazyFields());
+    ASSERT_EQUALS(eager.toBson(), lazy.toBson());
+}
+
+TEST(LazyDocument, PositionsStayValidWhenRemainingFieldsAreConverted) {
+    Document doc = Document::fromBsonLazily(wideObj());
+    const Position pos = doc.positionOf("c");
+    ASSERT_TRUE(storageOf(doc).hasLazyFields());
+
+    ASSERT_EQUALS(6U, doc.size());
+    ASSERT_FALSE(storageOf(doc).hasLazyFields());
+    ASSERT_VALUE_EQ(Value(BSON("x" << 3)), doc[pos]);
+
+    MutableDocument md(doc);
+    md.setNestedField(std::vector<Position>{pos, md.peek()["c"].getDocument().positionOf("x")},
+                      Value(7));
+    ASSERT_EQUALS(7, md.peek().getNestedField(FieldPath("c.x")).getInt());
+}
+
+TEST(LazyDocument, ToBsonCopiesUnconvertedObject) {
+    const BSONObj obj = wideObj();
+    Document doc = Document::fromBsonLazily(obj);
+    ASSERT_EQUALS(1, doc["a"].getInt());
+    ASSERT_EQUALS(obj, doc.toBson());
+    ASSERT_TRUE(storageOf(doc).hasLazyFields());
+}
+
+TEST(LazyDocument, ModifyingConvertsAllFields) {
+    Document doc = Document::fromBsonLazily(wideObj());
+    ASSERT_EQUALS(1, doc["a"].getInt());
+
+    MutableDocument md(doc);
+    md.setField("b", Value(2));
+    md.addField("g", Value(8));
+    Document modified = md.freeze();
+
+    ASSERT_EQUALS(7U, modified.size());
+    ASSERT_EQUALS("b", getNthField(modified, 1).first.toString());
+    ASSERT_EQUALS(2, getNthField(modified, 1).second.getInt());
+    ASSERT_EQUALS("g", getNthField(modified, 6).first.toString());
+    ASSERT_EQUALS(2, modified.toBson()["b"].numberInt());
+    ASSERT_EQUALS("two", doc["b"].getString());
+}
+
+TEST(LazyDocument, OutlivesUnownedSource) {
+    Document doc;
+    {
+        BSONObj outer = BSON("inner" << wideObj());
+        doc = Document::fromBsonLazily(outer["inner"].Obj());
+    }
+    ASSERT_EQUALS(6.5, doc["e"].getDouble());
+    ASSERT_DOCUMENT_EQ(Document(wideObj()), doc);
+}
+
+TEST(LazyDocument, DuplicateFieldLookupFindsFirst) {
+    Document doc = Document::fromBsonLazily(BSON("a" << 1 << "b" << 2 << "a" << 3));
+    ASSERT_EQUALS(1, doc["a"].getInt());
+    ASSERT_EQUALS(3U, doc.size());
+    ASSERT_EQUALS(1, doc["a"].getInt());
+}
+
+TEST(LazyDocument, ApproximateSizeDoesNotConvertFields) {
+    Document doc = Document::fromBsonLazily(wideObj());
+    ASSERT_GREATER_THAN_OR_EQUALS(doc.getApproximateSize(), size_t(wideObj().objsize()));
+    ASSERT_EQUALS(0U, numConvertedFields(doc));
+}
+
+TEST(LazyDocument, ApproximateSizeCountsConvertedFieldsOnce) {
+    Document doc = Document::fromBsonLazily(wideObj());
+    ASSERT_EQUALS(6.5, doc["e"].getDouble());
+    ASSERT_TRUE(storageOf(doc).hasLazyFields());
+    const size_t partiallyConvertedSize = doc.getApproximateSize();
+
+    // Converting the last field only adds to the size, since a converted field takes more space
+    // than its BSON.
+    ASSERT_EQUALS(6U, doc.size());
+    ASSERT_FALSE(storageOf(doc).hasLazyFields());
+    ASSERT_LESS_THAN(partiallyConvertedSize, doc.getApproximateSize());
+}
+
+TEST(LazyDocument, MetadataIsStripped) {
+    BSONObj obj = BSON("a" << 1 << Document::metaFieldTextScore << 2.5 << "b" << 3
+                           << Document::metaFieldRandVal
+                           << 4.5);
+    Document doc = Document::fromBsonWithMetaDataLazily(obj);
+    ASSERT_TRUE(doc.hasTextScore());
+    ASSERT_EQUALS(2.5, doc.getTextScore());
+    ASSERT_TRUE(doc.hasRandMetaField());
+    ASSERT_EQUALS(4.5, doc.getRandMetaField());
+    ASSERT_TRUE(doc[Document::metaFieldTextScore].missing());
+    ASSERT_EQUALS(3, doc["b"].getInt());
+
+    ASSERT_EQUALS(BSON("a" << 1 << "b" << 3), doc.toBson());
+    ASSERT_EQUALS(2U, doc.size());
+    ASSERT_EQUALS(BSON("a" << 1 << "b" << 3), doc.toBson());
+    ASSERT_DOCUMENT_EQ(Document::fromBsonWithMetaData(obj), doc);
+
+    // Without metadata stripping, those are ordinary fields.
+    ASSERT_EQUALS(4U, Document::fromBsonLazily(obj).size());
+}
+
+TEST(LazyDocument, EmptyObject) {
+    Document doc = Document::fromBsonLazily(BSONObj());
+    ASSERT_TRUE(doc.empty());
+    ASSERT_TRUE(doc["a"].missing());
+    ASSERT_EQUALS(BSONObj(), doc.toBson());
+}
+}  // namespace LazyDocument
+
 namespace Value {
 
 using mongo::Value;
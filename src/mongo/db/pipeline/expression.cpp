@@ -734,7 +734,10 @@ static const CmpLookup cmpLookup[7] = {
 Value ExpressionCompare::evaluateInternal(Variables* vars) const {
     Value pLeft(vpOperand[0]->evaluateInternal(vars));
     Value pRight(vpOperand[1]->evaluateInternal(vars));
+    return apply(pLeft, pRight);
+}
 
+Value ExpressionCompare::apply(const Value& pLeft, const Value& pRight) const {
     int cmp = getExpressionContext()->getValueComparator().compare(pLeft, pRight);
 
     // Make cmp one of 1, 0, or -1.
@@ -1139,7 +1142,11 @@ const char* ExpressionDayOfYear::getOpName() const {
 Value ExpressionDivide::evaluateInternal(Variables* vars) const {
     Value lhs = vpOperand[0]->evaluateInternal(vars);
     Value rhs = vpOperand[1]->evaluateInternal(vars);
+    return apply(lhs, rhs);
+}
 
+// static
+Value ExpressionDivide::apply(const Value& lhs, const Value& rhs) {
     auto assertNonZero = [](bool nonZero) { uassert(16608, "can't $divide by zero", nonZero); };
 
     if (lhs.numeric() && rhs.numeric()) {
@@ -3505,7 +3512,11 @@ const char* ExpressionStrLenCP::getOpName() const {
 Value ExpressionSubtract::evaluateInternal(Variables* vars) const {
     Value lhs = vpOperand[0]->evaluateInternal(vars);
     Value rhs = vpOperand[1]->evaluateInternal(vars);
+    return apply(lhs, rhs);
+}
 
+// static
+Value ExpressionSubtract::apply(const Value& lhs, const Value& rhs) {
     BSONType diffType = Value::getWidestNumeric(rhs.getType(), lhs.getType());
 
     if (diffType == NumberDecimal) {
@@ -324,6 +324,10 @@ public:
     */
     virtual void addOperand(const boost::intrusive_ptr<Expression>& pExpression);
 
+    const std::vector<boost::intrusive_ptr<Expression>>& getOperandList() const {
+        return vpOperand;
+    }
+
     virtual bool isAssociative() const {
         return false;
     }
@@ -596,6 +600,15 @@ public:
     Value evaluateInternal(Variables* vars) const final;
     const char* getOpName() const final;
 
+    /**
+     * Compares the already evaluated operands 'lhs' and 'rhs'.
+     */
+    Value apply(const Value& lhs, const Value& rhs) const;
+
+    CmpOp getOp() const {
+        return cmpOp;
+    }
+
     static boost::intrusive_ptr<Expression> parse(BSONElement bsonExpr,
                                                   const VariablesParseState& vps,
                                                   CmpOp cmpOp);
@@ -737,6 +750,11 @@ class ExpressionDivide final : public ExpressionFixedArity<ExpressionDivide, 2>
 public:
     Value evaluateInternal(Variables* vars) const final;
     const char* getOpName() const final;
+
+    /**
+     * Divides the already evaluated operands 'lhs' and 'rhs'.
+     */
+    static Value apply(const Value& lhs, const Value& rhs);
 };
 
 
@@ -776,6 +794,10 @@ public:
         return _fieldPath;
     }
 
+    Variables::Id getVariableId() const {
+        return _variable;
+    }
+
 private:
     ExpressionFieldPath(const std::string& fieldPath, Variables::Id variable);
 
@@ -1277,6 +1299,11 @@ class ExpressionSubtract final : public ExpressionFixedArity<ExpressionSubtract,
 public:
     Value evaluateInternal(Variables* vars) const final;
     const char* getOpName() const final;
+
+    /**
+     * Subtracts the already evaluated operand 'rhs' from 'lhs'.
+     */
+    static Value apply(const Value& lhs, const Value& rhs);
 };
 
 
@@ -42,6 +42,7 @@ ExpressionContext::ResolvedNamespace::ResolvedNamespace(NamespaceString ns,
 ExpressionContext::ExpressionContext(OperationContext* opCtx, const AggregationRequest& request)
     : isExplain(request.isExplain()),
       inShard(request.isFromRouter()),
+      mergerAcceptsArrayPartials(request.mergerAcceptsArrayPartials()),
       extSortAllowed(request.shouldAllowDiskUse()),
       bypassDocumentValidation(request.shouldBypassDocumentValidation()),
       ns(request.getNamespaceString()),
@@ -77,8 +78,10 @@ intrusive_ptr<ExpressionContext> ExpressionContext::copyWith(NamespaceString ns)
     expCtx->isExplain = isExplain;
     expCtx->inShard = inShard;
     expCtx->inRouter = inRouter;
+    expCtx->mergerAcceptsArrayPartials = mergerAcceptsArrayPartials;
     expCtx->extSortAllowed = extSortAllowed;
     expCtx->bypassDocumentValidation = bypassDocumentValidation;
+    expCtx->compileExpressions = compileExpressions;
 
     expCtx->ns = std::move(ns);
     expCtx->tempDir = tempDir;
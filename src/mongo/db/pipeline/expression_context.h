@@ -88,9 +88,21 @@ public:
     bool isExplain = false;
     bool inShard = false;
     bool inRouter = false;
+
+    // Whether the merger of a split pipeline understands the positional array form of the $avg and
+    // $stdDev partial aggregates. Mergers from earlier versions only accept the document form.
+    bool mergerAcceptsArrayPartials = false;
+
     bool extSortAllowed = false;
     bool bypassDocumentValidation = false;
 
+    // Whether stages compile their expressions into CompiledExpression programs when optimized.
+    bool compileExpressions = false;
+
+    // Number of threads which may run the leading stages of the pipeline over the documents of the
+    // collection scan. Not carried over by copyWith(), since the copies run on a single thread.
+    int parallelism = 1;
+
     NamespaceString ns;
     std::string tempDir;  // Defaults to empty to prevent external sorting in mongos.
 
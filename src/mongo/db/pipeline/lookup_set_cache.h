@@ -36,6 +36,7 @@
 #include <boost/multi_index_container.hpp>
 #include <boost/optional.hpp>
 #include <iostream>
+#include <unordered_map>
 #include <vector>
 
 #include "mongo/base/string_data_comparator_interface.h"
@@ -58,7 +59,9 @@ using boost::multi_index::indexed_by;
  * A least-recently-used cache from key to a vector of values. It does not implement any default
  * size limit, but includes the ability to evict down to both a specific number of elements, and
  * down to a specific amount of memory. Memory usage includes only the size of the elements in the
- * cache at the time of insertion, not the overhead incurred by the data structures in use.
+ * cache at the time of insertion, not the overhead incurred by the data structures in use. A value
+ * which shares its buffer with a value already in the cache, such as the same document cached
+ * under several keys, is only counted once.
  */
 class LookupSetCache {
 public:
@@ -114,7 +117,7 @@ public:
         } else {
             _memoryUsage += key.getApproximateSize();
         }
-        _memoryUsage += static_cast<size_t>(value.objsize());
+        addValueReference(value);
     }
 
     /**
@@ -132,9 +135,7 @@ public:
         _memoryUsage -= keySize;
 
         for (auto&& elem : pair.second) {
-            size_t valueSize = static_cast<size_t>(elem.objsize());
-            invariant(valueSize <= _memoryUsage);
-            _memoryUsage -= valueSize;
+            removeValueReference(elem);
         }
         _container.erase(std::prev(_container.end()));
     }
@@ -169,9 +170,17 @@ public:
      */
     void clear() {
         _container.clear();
+        _valueReferences.clear();
         _memoryUsage = 0;
     }
 
+    /**
+     * Returns the memory used by the keys and values in the cache.
+     */
+    size_t getMemoryUsage() const {
+        return _memoryUsage;
+    }
+
     /**
      * Retrieve the vector of values with key "key". If not found, returns boost::none.
      */
@@ -207,10 +216,36 @@ private:
                                                 valueComparator.getEqualTo())));
     }
 
+    /**
+     * Counts the memory of 'value' unless its buffer is already in the cache.
+     */
+    void addValueReference(const BSONObj& value) {
+        if (++_valueReferences[value.objdata()] == 1) {
+            _memoryUsage += static_cast<size_t>(value.objsize());
+        }
+    }
+
+    /**
+     * Stops counting the memory of 'value' once no value in the cache uses its buffer.
+     */
+    void removeValueReference(const BSONObj& value) {
+        auto it = _valueReferences.find(value.objdata());
+        invariant(it != _valueReferences.end());
+        if (--it->second == 0) {
+            size_t valueSize = static_cast<size_t>(value.objsize());
+            invariant(valueSize <= _memoryUsage);
+            _memoryUsage -= valueSize;
+            _valueReferences.erase(it);
+        }
+    }
+
     ValueComparator _valueComparator;
 
     IndexedContainer _container;
 
+    // The number of values in the cache using each buffer.
+    std::unordered_map<const char*, size_t> _valueReferences;
+
     size_t _memoryUsage = 0;
 };
 
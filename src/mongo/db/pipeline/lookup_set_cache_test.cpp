@@ -131,6 +131,27 @@ TEST(LookupSetCacheTest, EvictDoesRespectMemoryUsage) {
     ASSERT_FALSE(cache[Value(0)]);
 }
 
+TEST(LookupSetCacheTest, ValueCachedUnderSeveralKeysIsCountedOnce) {
+    const StringData::ComparatorInterface* stringComparator = nullptr;
+    LookupSetCache cache(stringComparator);
+
+    BSONObj shared = intToObj(0);
+    cache.insert(Value(0), shared);
+    cache.insert(Value(1), shared);
+    cache.insert(Value(1), intToObj(0));
+
+    const size_t keySize = Value(0).getApproximateSize();
+    const size_t valueSize = static_cast<size_t>(shared.objsize());
+    ASSERT_EQ(cache.getMemoryUsage(), 2 * keySize + 2 * valueSize);
+
+    // Evicting one of the keys keeps the shared value, which is still cached under the other.
+    cache.evictUntilSize(1);
+    ASSERT_EQ(cache.getMemoryUsage(), keySize + 2 * valueSize);
+
+    cache.evictUntilSize(0);
+    ASSERT_EQ(cache.getMemoryUsage(), 0U);
+}
+
 TEST(LookupSetCacheTest, ComplexAccessPatternDoesBehaveCorrectly) {
     const StringData::ComparatorInterface* stringComparator = nullptr;
     LookupSetCache cache(stringComparator);
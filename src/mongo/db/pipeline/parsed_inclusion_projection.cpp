@@ -46,8 +46,14 @@ using std::unique_ptr;
 InclusionNode::InclusionNode(std::string pathToNode) : _pathToNode(std::move(pathToNode)) {}
 
 void InclusionNode::optimize() {
+    _compiledExpressions.clear();
     for (auto&& expressionIt : _expressions) {
         _expressions[expressionIt.first] = expressionIt.second->optimize();
+        if (_compileExpressions) {
+            if (auto compiled = CompiledExpression::compile(expressionIt.second)) {
+                _compiledExpressions[expressionIt.first] = std::move(compiled);
+            }
+        }
     }
     for (auto&& childPair : _children) {
         childPair.second->optimize();
@@ -55,6 +61,7 @@ void InclusionNode::optimize() {
 }
 
 void InclusionNode::injectExpressionContext(const boost::intrusive_ptr<ExpressionContext>& expCtx) {
+    _compileExpressions = expCtx->compileExpressions;
     for (auto&& expressionIt : _expressions) {
         expressionIt.second->injectExpressionContext(expCtx);
     }
@@ -87,7 +94,11 @@ void InclusionNode::serialize(MutableDocument* output, bool explain) const {
         } else {
             auto expressionIt = _expressions.find(field);
             invariant(expressionIt != _expressions.end());
-            output->addField(field, expressionIt->second->serialize(explain));
+            Value serialized = expressionIt->second->serialize(explain);
+            if (explain && _compiledExpressions.count(field)) {
+                serialized = Value(Document{{"$compiled", serialized}});
+            }
+            output->addField(field, serialized);
         }
     }
 }
@@ -157,6 +168,12 @@ void InclusionNode::addComputedFields(MutableDocument* outputDoc, Variables* var
             outputDoc->setField(field,
                                 childIt->second->addComputedFields(outputDoc->peek()[field], vars));
         } else {
+            auto compiledIt = _compiledExpressions.find(field);
+            if (compiledIt != _compiledExpressions.end()) {
+                outputDoc->setField(field, compiledIt->second->evaluate(vars));
+                continue;
+            }
+
             auto expressionIt = _expressions.find(field);
             invariant(expressionIt != _expressions.end());
             outputDoc->setField(field, expressionIt->second->evaluate(vars));
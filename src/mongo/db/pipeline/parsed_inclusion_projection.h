@@ -32,6 +32,7 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "mongo/db/pipeline/compiled_expression.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/parsed_aggregation_projection.h"
@@ -55,12 +56,13 @@ public:
     InclusionNode(std::string pathToNode = "");
 
     /**
-     * Optimize any computed expressions.
+     * Optimize any computed expressions, then compile them if the ExpressionContext asks for it.
      */
     void optimize();
 
     /**
-     * Serialize this projection.
+     * Serialize this projection. When explaining, compiled expressions are shown wrapped in
+     * {$compiled: <expression>}.
      */
     void serialize(MutableDocument* output, bool explain) const;
 
@@ -157,6 +159,11 @@ private:
     StringMap<boost::intrusive_ptr<Expression>> _expressions;
     std::unordered_set<std::string> _inclusions;
 
+    // Programs for the expressions in '_expressions' which could be compiled, rebuilt by each call
+    // to optimize() if '_compileExpressions' is set.
+    bool _compileExpressions = false;
+    std::unordered_map<std::string, std::unique_ptr<CompiledExpression>> _compiledExpressions;
+
     // TODO use StringMap once SERVER-23700 is resolved.
     std::unordered_map<std::string, std::unique_ptr<InclusionNode>> _children;
 };
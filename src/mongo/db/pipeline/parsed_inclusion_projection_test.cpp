@@ -174,6 +174,31 @@ TEST(InclusionProjection, ShouldOptimizeNestedExpressions) {
     ASSERT_DOCUMENT_EQ(expectedSerialization, inclusion.serialize(true));
 }
 
+TEST(InclusionProjection, ShouldShowCompiledExpressionsInExplain) {
+    ParsedInclusionProjection inclusion;
+    inclusion.parse(BSON("a" << BSON("$add" << BSON_ARRAY("$b" << 1)) << "c"
+                             << BSON("$concat" << BSON_ARRAY("$d"
+                                                             << "x"))));
+    boost::intrusive_ptr<ExpressionContext> expCtx(new ExpressionContext());
+    expCtx->compileExpressions = true;
+    inclusion.injectExpressionContext(expCtx);
+    inclusion.optimize();
+
+    auto addExpression =
+        Document{{"$add", vector<Value>{Value("$b"_sd), Value(Document{{"$const", 1}})}}};
+    auto concatExpression =
+        Document{{"$concat", vector<Value>{Value("$d"_sd), Value(Document{{"$const", "x"_sd}})}}};
+    ASSERT_DOCUMENT_EQ(Document({{"_id", true}, {"a", addExpression}, {"c", concatExpression}}),
+                       inclusion.serialize(false));
+    ASSERT_DOCUMENT_EQ(Document({{"_id", true},
+                                 {"a", Document{{"$compiled", addExpression}}},
+                                 {"c", concatExpression}}),
+                       inclusion.serialize(true));
+
+    auto result = inclusion.applyProjection(Document{{"b", 2}, {"d", "y"_sd}});
+    ASSERT_DOCUMENT_EQ(result, (Document{{"a", 3}, {"c", "yx"_sd}}));
+}
+
 //
 // Top-level only.
 //
@@ -46,12 +46,18 @@
 #include "mongo/db/exec/shard_filter.h"
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/index/index_access_method.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/index_names.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/db/matcher/extensions_callback_disallow_extensions.h"
 #include "mongo/db/matcher/extensions_callback_real.h"
 #include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/pipeline/document_source_parallel.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/query/collation/collator_interface.h"
 #include "mongo/db/query/get_executor.h"
 #include "mongo/db/query/plan_summary_stats.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/s/collection_sharding_state.h"
 #include "mongo/db/s/sharded_connection_info.h"
@@ -60,8 +66,10 @@
 #include "mongo/db/stats/top.h"
 #include "mongo/db/storage/record_store.h"
 #include "mongo/db/storage/sorted_data_interface.h"
+#include "mongo/platform/unordered_set.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/stdx/memory.h"
+#include "mongo/util/elapsed_tracker.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
@@ -72,6 +80,195 @@ using std::string;
 using std::unique_ptr;
 
 namespace {
+
+using LookupIndexProbe = DocumentSourceNeedsMongod::MongodInterface::LookupIndexProbe;
+
+/**
+ * A LookupIndexProbe over a btree index whose first field is the looked up field. Each call to
+ * lookup() reacquires the collection, checks that the index is still the one which was chosen and
+ * then repositions a single cursor over it for every distinct value, in key order.
+ *
+ * The collection lock is held for no more work than a query does between yields. Values which are
+ * not looked up by then are left to the caller to query, which yields.
+ */
+class IndexLookupProbe final : public LookupIndexProbe {
+public:
+    IndexLookupProbe(intrusive_ptr<ExpressionContext> expCtx,
+                     const IndexDescriptor* desc,
+                     unique_ptr<MatchExpression> filter)
+        : _expCtx(std::move(expCtx)),
+          _indexName(desc->indexName()),
+          _keyPattern(desc->keyPattern().getOwned()),
+          _ordering(Ordering::make(_keyPattern)),
+          _filter(std::move(filter)) {}
+
+    std::vector<boost::optional<std::vector<Document>>> lookup(
+        const std::vector<Value>& values) final {
+        std::vector<boost::optional<std::vector<Document>>> results(values.size());
+
+        AutoGetCollectionForRead autoColl(_expCtx->opCtx, _expCtx->ns);
+        Collection* collection = autoColl.getCollection();
+        if (!collection) {
+            // A query against a collection which does not exist returns no documents.
+            for (auto&& result : results) {
+                result.emplace();
+            }
+            return results;
+        }
+
+        const IndexDescriptor* desc =
+            collection->getIndexCatalog()->findIndexByName(_expCtx->opCtx, _indexName);
+        if (!desc || desc->keyPattern().woCompare(_keyPattern) != 0) {
+            return results;
+        }
+
+        // Seek in key order so that the cursor only moves forward, and only once for each group of
+        // values which are equal in the index.
+        std::vector<std::pair<BSONObj, size_t>> seekKeys;
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (canSeek(values[i])) {
+                seekKeys.emplace_back(makeSeekKey(values[i]), i);
+            }
+        }
+        std::sort(seekKeys.begin(),
+                  seekKeys.end(),
+                  [this](const std::pair<BSONObj, size_t>& lhs,
+                         const std::pair<BSONObj, size_t>& rhs) {
+                      return lhs.first.woCompare(rhs.first, _ordering, false) < 0;
+                  });
+
+        const bool isMultikey = desc->isMultikey(_expCtx->opCtx);
+        auto cursor = collection->getIndexCatalog()->getIndex(desc)->newCursor(_expCtx->opCtx);
+        ElapsedTracker budget(_expCtx->opCtx->getServiceContext()->getFastClockSource(),
+                              internalQueryExecYieldIterations.load(),
+                              Milliseconds(internalQueryExecYieldPeriodMS.load()));
+        for (size_t begin = 0; begin < seekKeys.size();) {
+            size_t end = begin + 1;
+            while (end < seekKeys.size() &&
+                   seekKeys[end].first.woCompare(seekKeys[begin].first, _ordering, false) == 0) {
+                ++end;
+            }
+
+            bool outOfBudget = false;
+            auto documents = _scan(
+                collection, cursor.get(), seekKeys[begin].first, isMultikey, &budget, &outOfBudget);
+            if (outOfBudget) {
+                break;
+            }
+            for (size_t i = begin; i < end; ++i) {
+                results[seekKeys[i].second] = documents;
+            }
+            begin = end;
+        }
+
+        return results;
+    }
+
+    const std::string& getIndexName() const final {
+        return _indexName;
+    }
+
+private:
+    /**
+     * Returns whether an equality query on 'value' matches exactly the documents with an index key
+     * equal to 'value'. This excludes values which the query planner would build special bounds
+     * for: null, which also matches missing fields; arrays, which also match themselves as a
+     * whole; regular expressions; and undefined.
+     */
+    static bool canSeek(const Value& value) {
+        switch (value.getType()) {
+            case NumberInt:
+            case NumberLong:
+            case NumberDouble:
+            case NumberDecimal:
+            case String:
+            case Object:
+            case jstOID:
+            case Bool:
+            case Date:
+            case bsonTimestamp:
+            case BinData:
+            case MinKey:
+            case MaxKey:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Returns the smallest key in index order whose first field is 'value'.
+     */
+    BSONObj makeSeekKey(const Value& value) const {
+        BSONObjBuilder bob;
+        value.addToBsonObj(&bob, "");
+
+        BSONObjIterator it(_keyPattern);
+        it.next();
+        while (it.more()) {
+            if (it.next().number() >= 0) {
+                bob.appendMinKey("");
+            } else {
+                bob.appendMaxKey("");
+            }
+        }
+        return bob.obj();
+    }
+
+    /**
+     * Returns the documents which match the filter and whose key has the same first field as
+     * 'seekKey', or boost::none if they would not fit in a single document. Also returns
+     * boost::none, setting '*outOfBudget', if 'budget' runs out before the scan is complete. Every
+     * index entry examined counts against 'budget', whether or not its document matches.
+     */
+    boost::optional<std::vector<Document>> _scan(Collection* collection,
+                                                 SortedDataInterface::Cursor* cursor,
+                                                 const BSONObj& seekKey,
+                                                 bool isMultikey,
+                                                 ElapsedTracker* budget,
+                                                 bool* outOfBudget) {
+        const BSONElement value = seekKey.firstElement();
+        unordered_set<RecordId, RecordId::Hasher> seen;
+
+        std::vector<Document> documents;
+        int size = 0;
+        for (auto entry = cursor->seek(seekKey, true); entry; entry = cursor->next()) {
+            _expCtx->checkForInterrupt();
+            if (budget->intervalHasElapsed()) {
+                *outOfBudget = true;
+                return boost::none;
+            }
+
+            ++keysExamined;
+            if (entry->key.firstElement().woCompare(value, false) != 0) {
+                break;
+            }
+            if (isMultikey && !seen.insert(entry->loc).second) {
+                continue;
+            }
+
+            ++docsExamined;
+            BSONObj obj = collection->docFor(_expCtx->opCtx, entry->loc).value().getOwned();
+            if (_filter && !_filter->matchesBSON(obj)) {
+                continue;
+            }
+
+            size += obj.objsize();
+            if (size > BSONObjMaxInternalSize) {
+                return boost::none;
+            }
+            documents.emplace_back(obj);
+        }
+        return std::move(documents);
+    }
+
+    const intrusive_ptr<ExpressionContext> _expCtx;
+    const std::string _indexName;
+    const BSONObj _keyPattern;
+    const Ordering _ordering;
+    const unique_ptr<MatchExpression> _filter;
+};
+
 class MongodImplementation final : public DocumentSourceNeedsMongod::MongodInterface {
 public:
     MongodImplementation(const intrusive_ptr<ExpressionContext>& ctx)
@@ -173,6 +370,74 @@ public:
         return pipeline;
     }
 
+    std::pair<long long, long long> getCollectionSize(const NamespaceString& nss) final {
+        AutoGetCollectionForRead autoColl(_ctx->opCtx, nss);
+        Collection* collection = autoColl.getCollection();
+        if (!collection) {
+            return {0, 0};
+        }
+        return {static_cast<long long>(collection->numRecords(_ctx->opCtx)),
+                static_cast<long long>(collection->dataSize(_ctx->opCtx))};
+    }
+
+    unique_ptr<LookupIndexProbe> makeLookupIndexProbe(
+        const intrusive_ptr<ExpressionContext>& expCtx,
+        const FieldPath& field,
+        const BSONObj& filter) final {
+        invariant(_ctx->opCtx == expCtx->opCtx);
+
+        // Index keys are not collation aware unless the index has a collation, so only a simple
+        // comparison is answered from the index.
+        if (expCtx->getCollator()) {
+            return nullptr;
+        }
+
+        // A numeric path component may refer to an array position, which a query on the path
+        // handles differently from an index on it.
+        for (size_t i = 0; i < field.getPathLength(); ++i) {
+            const std::string& part = field.getFieldName(i);
+            if (std::all_of(part.begin(), part.end(), [](char c) { return isdigit(c); })) {
+                return nullptr;
+            }
+        }
+
+        unique_ptr<MatchExpression> filterExpr;
+        if (!filter.isEmpty()) {
+            auto parsed = MatchExpressionParser::parse(
+                filter, ExtensionsCallbackDisallowExtensions(), nullptr);
+            if (!parsed.isOK()) {
+                return nullptr;
+            }
+            filterExpr = std::move(parsed.getValue());
+        }
+
+        AutoGetCollectionForRead autoColl(expCtx->opCtx, expCtx->ns);
+        Collection* collection = autoColl.getCollection();
+        if (!collection) {
+            return nullptr;
+        }
+
+        // Prefer the index with the fewest fields, since it has the smallest keys.
+        const IndexDescriptor* best = nullptr;
+        auto it = collection->getIndexCatalog()->getIndexIterator(expCtx->opCtx, false);
+        while (it.more()) {
+            const IndexDescriptor* desc = it.next();
+            if (desc->keyPattern().firstElementFieldName() != field.fullPath() ||
+                IndexNames::findPluginName(desc->keyPattern()) != IndexNames::BTREE ||
+                desc->isPartial() || desc->infoObj().hasField("collation")) {
+                continue;
+            }
+            if (!best || desc->keyPattern().nFields() < best->keyPattern().nFields()) {
+                best = desc;
+            }
+        }
+
+        if (!best) {
+            return nullptr;
+        }
+        return stdx::make_unique<IndexLookupProbe>(expCtx, best, std::move(filterExpr));
+    }
+
 private:
     intrusive_ptr<ExpressionContext> _ctx;
     DBDirectClient _client;
@@ -560,6 +825,15 @@ void PipelineD::addCursorSource(const intrusive_ptr<Pipeline>& pipeline,
     // case the new stage can be absorbed with the first stages of the pipeline.
     pipeline->addInitialSource(pSource);
     pipeline->optimizePipeline();
+
+    // If requested, run the stages consuming the documents of the cursor on several threads. This
+    // must be the last change to the pipeline, since it moves those stages out of reach of the
+    // optimizer.
+    Pipeline::SourceContainer& sources = pipeline->_sources;
+    if (DocumentSourceParallel::parallelizeLeadingStages(
+            std::next(sources.begin()), &sources, expCtx) != sources.end()) {
+        pipeline->stitch();
+    }
 }
 
 std::string PipelineD::getPlanSummaryStr(const boost::intrusive_ptr<Pipeline>& pPipeline) {
@@ -170,6 +170,25 @@ public:
         return Status::OK();
     }
 
+    /**
+     * Removes the least recently used entry and returns it, or returns a null unique_ptr if the
+     * kv-store is empty. If 'keyOut' is not null, the key of the removed entry is stored there.
+     */
+    std::unique_ptr<V> removeLeastRecentlyUsed(K* keyOut = nullptr) {
+        if (_kvList.empty()) {
+            return std::unique_ptr<V>();
+        }
+
+        std::unique_ptr<V> removedEntry(_kvList.back().second);
+        if (keyOut) {
+            *keyOut = _kvList.back().first;
+        }
+        _kvMap.erase(_kvList.back().first);
+        _kvList.pop_back();
+        _currentSize--;
+        return removedEntry;
+    }
+
     /**
      * Deletes all entries in the kv-store.
      */
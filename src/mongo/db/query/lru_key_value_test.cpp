@@ -175,6 +175,32 @@ TEST(LRUKeyValueTest, ReplaceKeyTest) {
     assertInKVStore(cache, 4, 5);
 }
 
+/**
+ * Test that removeLeastRecentlyUsed() removes entries in LRU order.
+ */
+TEST(LRUKeyValueTest, RemoveLeastRecentlyUsedTest) {
+    LRUKeyValue<int, int> cache(10);
+    cache.add(1, new int(1));
+    cache.add(2, new int(2));
+    cache.add(3, new int(3));
+    assertInKVStore(cache, 1, 1);
+
+    int removedKey = 0;
+    std::unique_ptr<int> removed = cache.removeLeastRecentlyUsed(&removedKey);
+    ASSERT_EQUALS(removedKey, 2);
+    ASSERT_EQUALS(*removed, 2);
+    assertNotInKVStore(cache, 2);
+    ASSERT_EQUALS(cache.size(), 2U);
+
+    removed = cache.removeLeastRecentlyUsed();
+    ASSERT_EQUALS(*removed, 3);
+    removed = cache.removeLeastRecentlyUsed(&removedKey);
+    ASSERT_EQUALS(removedKey, 1);
+    ASSERT_EQUALS(cache.size(), 0U);
+
+    ASSERT(NULL == cache.removeLeastRecentlyUsed().get());
+}
+
 /**
  * Test iteration over the kv-store.
  */
@@ -40,6 +40,7 @@
 #include "mongo/db/query/plan_ranker.h"
 #include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_solution.h"
+#include "mongo/stdx/memory.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
@@ -382,6 +383,9 @@ PlanCacheEntry* PlanCacheEntry::clone() const {
         fb->score = feedback[i]->score;
         entry->feedback.push_back(fb);
     }
+
+    entry->counters = counters;
+    entry->estimatedSizeBytes = estimatedSizeBytes;
     return entry;
 }
 
@@ -481,12 +485,112 @@ std::string SolutionCacheData::toString() const {
 // PlanCache
 //
 
-PlanCache::PlanCache() : _cache(internalQueryCacheSize) {}
+namespace {
+
+size_t estimateIndexTreeSize(const PlanCacheIndexTree* tree) {
+    size_t size = sizeof(PlanCacheIndexTree);
+    if (tree->entry) {
+        size += sizeof(IndexEntry) + tree->entry->keyPattern.objsize() +
+            tree->entry->infoObj.objsize();
+    }
+    for (auto&& child : tree->children) {
+        size += estimateIndexTreeSize(child);
+    }
+    return size;
+}
+
+size_t estimateStatsSize(const PlanStageStats* stats) {
+    // Stage-specific stats are not counted, as their size depends on the stage type.
+    size_t size = sizeof(PlanStageStats) + stats->common.filter.objsize();
+    for (auto&& child : stats->children) {
+        size += estimateStatsSize(child.get());
+    }
+    return size;
+}
+
+size_t estimateEntrySize(const PlanCacheEntry& entry) {
+    size_t size = sizeof(PlanCacheEntry) + entry.query.objsize() + entry.sort.objsize() +
+        entry.projection.objsize() + entry.collation.objsize();
+
+    for (auto&& data : entry.plannerData) {
+        size += sizeof(SolutionCacheData);
+        if (data->tree) {
+            size += estimateIndexTreeSize(data->tree.get());
+        }
+    }
+
+    size += sizeof(PlanRankingDecision);
+    for (auto&& stats : entry.decision->stats.vector()) {
+        size += estimateStatsSize(stats);
+    }
+    size += entry.decision->scores.size() * sizeof(double);
+    size += entry.decision->candidateOrder.size() * sizeof(size_t);
+    return size;
+}
+
+}  // namespace
+
+PlanCache::Partition::Partition(size_t maxEntries, size_t maxBytes)
+    : maxEntries(maxEntries), maxBytes(maxBytes), cache(maxEntries) {}
+
+PlanCacheShapeCounters PlanCache::Partition::removeShape(const PlanCacheKey& key) {
+    PlanCacheEntry* entry;
+    if (cache.get(key, &entry).isOK()) {
+        const PlanCacheShapeCounters counters = entry->counters;
+        bytes -= entry->estimatedSizeBytes;
+        invariantOK(cache.remove(key));
+        return counters;
+    }
+
+    auto it = uncachedShapeCounters.find(key);
+    if (it == uncachedShapeCounters.end()) {
+        return PlanCacheShapeCounters();
+    }
+    const PlanCacheShapeCounters counters = it->second;
+    uncachedShapeCounters.erase(it);
+    return counters;
+}
 
-PlanCache::PlanCache(const std::string& ns) : _cache(internalQueryCacheSize), _ns(ns) {}
+void PlanCache::Partition::evictLeastRecentlyUsed(const std::string& ns) {
+    PlanCacheKey key;
+    std::unique_ptr<PlanCacheEntry> evictedEntry = cache.removeLeastRecentlyUsed(&key);
+    invariant(evictedEntry);
+    bytes -= evictedEntry->estimatedSizeBytes;
+
+    LOG(1) << ns << ": plan cache maximum size exceeded - "
+           << "removed least recently used entry " << evictedEntry->toString();
+
+    PlanCacheShapeCounters& counters = uncachedCounters(key);
+    counters = evictedEntry->counters;
+    counters.evictions++;
+}
+
+PlanCacheShapeCounters& PlanCache::Partition::uncachedCounters(const PlanCacheKey& key) {
+    if (uncachedShapeCounters.size() >= std::max(maxEntries, size_t(1)) &&
+        uncachedShapeCounters.find(key) == uncachedShapeCounters.end()) {
+        uncachedShapeCounters.clear();
+    }
+    return uncachedShapeCounters[key];
+}
+
+PlanCache::PlanCache() : PlanCache("") {}
+
+PlanCache::PlanCache(const std::string& ns) : _ns(ns) {
+    // Round the entry limit up so that a small limit still allows each partition an entry.
+    const size_t maxEntries = std::max(0, internalQueryCacheSize.load());
+    const size_t maxBytes = std::max(0, internalQueryCacheMaxSizeBytes.load());
+    for (size_t i = 0; i < kNumPartitions; ++i) {
+        _partitions.emplace_back(stdx::make_unique<Partition>(
+            (maxEntries + kNumPartitions - 1) / kNumPartitions, maxBytes / kNumPartitions));
+    }
+}
 
 PlanCache::~PlanCache() {}
 
+PlanCache::Partition& PlanCache::_partitionFor(const PlanCacheKey& key) const {
+    return *_partitions[std::hash<PlanCacheKey>()(key) % _partitions.size()];
+}
+
 /**
  * Traverses expression tree pre-order.
  * Appends an encoding of each node's match type and path name
@@ -659,15 +763,32 @@ Status PlanCache::add(const CanonicalQuery& query,
         projBuilder.append(elem);
     }
     entry->projection = projBuilder.obj();
+    entry->estimatedSizeBytes = estimateEntrySize(*entry);
 
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    std::unique_ptr<PlanCacheEntry> evictedEntry = _cache.add(computeKey(query), entry);
+    const PlanCacheKey key = computeKey(query);
+    Partition& partition = _partitionFor(key);
+    stdx::lock_guard<stdx::mutex> cacheLock(partition.mutex);
 
-    if (NULL != evictedEntry.get()) {
-        LOG(1) << _ns << ": plan cache maximum size exceeded - "
-               << "removed least recently used entry " << evictedEntry->toString();
+    // The new entry replaces any existing entry for the shape and continues its counters.
+    entry->counters = partition.removeShape(key);
+
+    if (partition.maxEntries == 0 || entry->estimatedSizeBytes > partition.maxBytes) {
+        LOG(1) << _ns << ": plan cache entry does not fit in the cache - not caching "
+               << entry->toString();
+        partition.uncachedCounters(key) = entry->counters;
+        delete entry;
+        return Status::OK();
+    }
+
+    while (partition.cache.size() >= partition.maxEntries ||
+           partition.bytes + entry->estimatedSizeBytes > partition.maxBytes) {
+        partition.evictLeastRecentlyUsed(_ns);
     }
 
+    partition.bytes += entry->estimatedSizeBytes;
+    std::unique_ptr<PlanCacheEntry> evictedEntry = partition.cache.add(key, entry);
+    invariant(!evictedEntry);
+
     return Status::OK();
 }
 
@@ -675,14 +796,17 @@ Status PlanCache::get(const CanonicalQuery& query, CachedSolution** crOut) const
     PlanCacheKey key = computeKey(query);
     verify(crOut);
 
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
+    Partition& partition = _partitionFor(key);
+    stdx::lock_guard<stdx::mutex> cacheLock(partition.mutex);
     PlanCacheEntry* entry;
-    Status cacheStatus = _cache.get(key, &entry);
+    Status cacheStatus = partition.cache.get(key, &entry);
     if (!cacheStatus.isOK()) {
+        partition.uncachedCounters(key).misses++;
         return cacheStatus;
     }
     invariant(entry);
 
+    entry->counters.hits++;
     *crOut = new CachedSolution(key, *entry);
 
     return Status::OK();
@@ -695,9 +819,10 @@ Status PlanCache::feedback(const CanonicalQuery& cq, PlanCacheEntryFeedback* fee
     std::unique_ptr<PlanCacheEntryFeedback> autoFeedback(feedback);
     PlanCacheKey ck = computeKey(cq);
 
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
+    Partition& partition = _partitionFor(ck);
+    stdx::lock_guard<stdx::mutex> cacheLock(partition.mutex);
     PlanCacheEntry* entry;
-    Status cacheStatus = _cache.get(ck, &entry);
+    Status cacheStatus = partition.cache.get(ck, &entry);
     if (!cacheStatus.isOK()) {
         return cacheStatus;
     }
@@ -712,13 +837,23 @@ Status PlanCache::feedback(const CanonicalQuery& cq, PlanCacheEntryFeedback* fee
 }
 
 Status PlanCache::remove(const CanonicalQuery& canonicalQuery) {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    return _cache.remove(computeKey(canonicalQuery));
+    const PlanCacheKey key = computeKey(canonicalQuery);
+    Partition& partition = _partitionFor(key);
+    stdx::lock_guard<stdx::mutex> cacheLock(partition.mutex);
+    if (!partition.cache.hasKey(key)) {
+        return Status(ErrorCodes::NoSuchKey, "no such key in LRU key-value store");
+    }
+    partition.removeShape(key);
+    return Status::OK();
 }
 
 void PlanCache::clear() {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    _cache.clear();
+    for (auto&& partition : _partitions) {
+        stdx::lock_guard<stdx::mutex> cacheLock(partition->mutex);
+        partition->cache.clear();
+        partition->bytes = 0;
+        partition->uncachedShapeCounters.clear();
+    }
     _writeOperations.store(0);
 }
 
@@ -734,9 +869,10 @@ Status PlanCache::getEntry(const CanonicalQuery& query, PlanCacheEntry** entryOu
     PlanCacheKey key = computeKey(query);
     verify(entryOut);
 
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
+    Partition& partition = _partitionFor(key);
+    stdx::lock_guard<stdx::mutex> cacheLock(partition.mutex);
     PlanCacheEntry* entry;
-    Status cacheStatus = _cache.get(key, &entry);
+    Status cacheStatus = partition.cache.get(key, &entry);
     if (!cacheStatus.isOK()) {
         return cacheStatus;
     }
@@ -748,25 +884,40 @@ Status PlanCache::getEntry(const CanonicalQuery& query, PlanCacheEntry** entryOu
 }
 
 std::vector<PlanCacheEntry*> PlanCache::getAllEntries() const {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
     std::vector<PlanCacheEntry*> entries;
-    typedef std::list<std::pair<PlanCacheKey, PlanCacheEntry*>>::const_iterator ConstIterator;
-    for (ConstIterator i = _cache.begin(); i != _cache.end(); i++) {
-        PlanCacheEntry* entry = i->second;
-        entries.push_back(entry->clone());
+    for (auto&& partition : _partitions) {
+        stdx::lock_guard<stdx::mutex> cacheLock(partition->mutex);
+        for (auto&& keyAndEntry : partition->cache) {
+            entries.push_back(keyAndEntry.second->clone());
+        }
     }
 
     return entries;
 }
 
 bool PlanCache::contains(const CanonicalQuery& cq) const {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    return _cache.hasKey(computeKey(cq));
+    const PlanCacheKey key = computeKey(cq);
+    Partition& partition = _partitionFor(key);
+    stdx::lock_guard<stdx::mutex> cacheLock(partition.mutex);
+    return partition.cache.hasKey(key);
 }
 
 size_t PlanCache::size() const {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    return _cache.size();
+    size_t size = 0;
+    for (auto&& partition : _partitions) {
+        stdx::lock_guard<stdx::mutex> cacheLock(partition->mutex);
+        size += partition->cache.size();
+    }
+    return size;
+}
+
+size_t PlanCache::estimatedSizeBytes() const {
+    size_t bytes = 0;
+    for (auto&& partition : _partitions) {
+        stdx::lock_guard<stdx::mutex> cacheLock(partition->mutex);
+        bytes += partition->bytes;
+    }
+    return bytes;
 }
 
 void PlanCache::notifyOfIndexEntries(const std::vector<IndexEntry>& indexEntries) {
@@ -38,6 +38,7 @@
 #include "mongo/db/query/plan_cache_indexability.h"
 #include "mongo/db/query/query_planner_params.h"
 #include "mongo/platform/atomic_word.h"
+#include "mongo/platform/unordered_map.h"
 #include "mongo/stdx/mutex.h"
 
 namespace mongo {
@@ -65,6 +66,21 @@ struct PlanCacheEntryFeedback {
 // TODO: Replace with opaque type.
 typedef std::string PlanID;
 
+/**
+ * Lookup statistics for one query shape. They are kept while the shape is not cached, and so
+ * carry over when it is evicted and cached again.
+ */
+struct PlanCacheShapeCounters {
+    // Number of get() calls which found the shape in the cache.
+    long long hits = 0;
+
+    // Number of get() calls which did not find the shape in the cache.
+    long long misses = 0;
+
+    // Number of times the shape was evicted to make room for other entries.
+    long long evictions = 0;
+};
+
 /**
  * A PlanCacheIndexTree is the meaty component of the data
  * stored in SolutionCacheData. It is a tree structure with
@@ -264,6 +280,12 @@ public:
     // Annotations from cached runs.  The CachedPlanStage provides these stats about its
     // runs when they complete.
     std::vector<PlanCacheEntryFeedback*> feedback;
+
+    PlanCacheShapeCounters counters;
+
+    // Approximate memory used by this entry, computed when it is added to the cache. Charged
+    // against internalQueryCacheMaxSizeBytes.
+    size_t estimatedSizeBytes = 0;
 };
 
 /**
@@ -271,6 +293,11 @@ public:
  * mapping, the cache contains information on why that mapping was made and statistics on the
  * cache entry's actual performance on subsequent runs.
  *
+ * The cache is split into partitions by a hash of the cache key, each an LRU cache with its own
+ * mutex, so that queries of different shapes rarely wait for each other. The entry count limit
+ * (internalQueryCacheSize) and the memory limit (internalQueryCacheMaxSizeBytes) are divided
+ * evenly between the partitions, and each partition evicts its least recently used entries to
+ * stay within its share.
  */
 class PlanCache {
 private:
@@ -387,6 +414,11 @@ public:
      */
     size_t size() const;
 
+    /**
+     * Returns the sum of the estimated sizes of the entries in the cache.
+     */
+    size_t estimatedSizeBytes() const;
+
     /**
      * Updates internal state kept about the collection's indexes.  Must be called when the set
      * of indexes on the associated collection have changed.
@@ -400,10 +432,40 @@ private:
     void encodeKeyForSort(const BSONObj& sortObj, StringBuilder* keyBuilder) const;
     void encodeKeyForProj(const BSONObj& projObj, StringBuilder* keyBuilder) const;
 
-    LRUKeyValue<PlanCacheKey, PlanCacheEntry> _cache;
+    static const size_t kNumPartitions = 16;
+
+    struct Partition {
+        Partition(size_t maxEntries, size_t maxBytes);
+
+        // Removes the entry for 'key' if there is one and returns its counters, or else returns
+        // the counters kept for 'key' while it was not cached and forgets them.
+        PlanCacheShapeCounters removeShape(const PlanCacheKey& key);
+
+        // Evicts the least recently used entry, keeping its counters in 'uncachedShapeCounters'.
+        void evictLeastRecentlyUsed(const std::string& ns);
+
+        // Returns the counters kept for 'key' while it is not cached, creating them if needed.
+        PlanCacheShapeCounters& uncachedCounters(const PlanCacheKey& key);
+
+        const size_t maxEntries;
+        const size_t maxBytes;
+
+        // Protects all members below.
+        stdx::mutex mutex;
+
+        LRUKeyValue<PlanCacheKey, PlanCacheEntry> cache;
+
+        // Sum of the estimatedSizeBytes of the entries in 'cache'.
+        size_t bytes = 0;
+
+        // Counters of shapes which have been looked up or evicted but are not in 'cache'. Holds
+        // at most as many shapes as 'cache' may; it is cleared when full.
+        unordered_map<PlanCacheKey, PlanCacheShapeCounters> uncachedShapeCounters;
+    };
+
+    Partition& _partitionFor(const PlanCacheKey& key) const;
 
-    // Protects _cache.
-    mutable stdx::mutex _cacheMutex;
+    std::vector<std::unique_ptr<Partition>> _partitions;
 
     // Counter for write notifications since initialization or last clear() invocation.  Starts
     // at 0.
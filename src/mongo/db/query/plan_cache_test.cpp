@@ -422,6 +422,121 @@ TEST(PlanCacheTest, AddValidSolution) {
     ASSERT_EQUALS(planCache.size(), 1U);
 }
 
+/**
+ * Adds a collection scan solution for 'cq' to 'planCache'.
+ */
+void addCollScan(PlanCache* planCache, const CanonicalQuery& cq) {
+    GenerateQuerySolution generator;
+    unique_ptr<QuerySolution> qs(generator());
+    std::vector<QuerySolution*> solns;
+    solns.push_back(qs.get());
+    ASSERT_OK(planCache->add(cq, solns, createDecision(1U)));
+}
+
+unique_ptr<PlanCacheEntry> getEntry(const PlanCache& planCache, const CanonicalQuery& cq) {
+    PlanCacheEntry* entry;
+    ASSERT_OK(planCache.getEntry(cq, &entry));
+    return unique_ptr<PlanCacheEntry>(entry);
+}
+
+TEST(PlanCacheTest, CountersTrackHitsAndMisses) {
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+
+    CachedSolution* rawCS;
+    ASSERT_NOT_OK(planCache.get(*cq, &rawCS));
+    addCollScan(&planCache, *cq);
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_OK(planCache.get(*cq, &rawCS));
+        delete rawCS;
+    }
+
+    unique_ptr<PlanCacheEntry> entry = getEntry(planCache, *cq);
+    ASSERT_EQUALS(entry->counters.hits, 2);
+    ASSERT_EQUALS(entry->counters.misses, 1);
+    ASSERT_EQUALS(entry->counters.evictions, 0);
+
+    // Replacing the entry for a shape keeps its counters.
+    addCollScan(&planCache, *cq);
+    entry = getEntry(planCache, *cq);
+    ASSERT_EQUALS(entry->counters.hits, 2);
+    ASSERT_EQUALS(entry->counters.misses, 1);
+
+    // Removing the shape forgets them.
+    ASSERT_OK(planCache.remove(*cq));
+    addCollScan(&planCache, *cq);
+    entry = getEntry(planCache, *cq);
+    ASSERT_EQUALS(entry->counters.hits, 0);
+    ASSERT_EQUALS(entry->counters.misses, 0);
+}
+
+TEST(PlanCacheTest, EstimatedSizeBytesIsSumOfEntrySizes) {
+    PlanCache planCache;
+    ASSERT_EQUALS(planCache.estimatedSizeBytes(), 0U);
+
+    for (int i = 0; i < 10; ++i) {
+        addCollScan(&planCache, *canonicalize(BSON(std::string(str::stream() << "a" << i) << 1)));
+    }
+
+    size_t sum = 0;
+    for (auto&& entry : planCache.getAllEntries()) {
+        ASSERT_GREATER_THAN(entry->estimatedSizeBytes, 0U);
+        sum += entry->estimatedSizeBytes;
+        delete entry;
+    }
+    ASSERT_EQUALS(planCache.estimatedSizeBytes(), sum);
+
+    planCache.clear();
+    ASSERT_EQUALS(planCache.estimatedSizeBytes(), 0U);
+}
+
+TEST(PlanCacheTest, EvictsWhenMaxSizeBytesIsExceeded) {
+    size_t entrySize;
+    {
+        PlanCache planCache;
+        addCollScan(&planCache, *canonicalize("{a0: 1}"));
+        entrySize = planCache.estimatedSizeBytes();
+    }
+
+    // Leave room for one entry per partition.
+    const int oldMaxSizeBytes = internalQueryCacheMaxSizeBytes.load();
+    ON_BLOCK_EXIT([oldMaxSizeBytes] { internalQueryCacheMaxSizeBytes.store(oldMaxSizeBytes); });
+    internalQueryCacheMaxSizeBytes.store(16 * (entrySize + entrySize / 2));
+
+    PlanCache planCache;
+    for (int i = 0; i < 100; ++i) {
+        addCollScan(&planCache, *canonicalize(BSON(std::string(str::stream() << "a" << i) << 1)));
+        ASSERT_LESS_THAN_OR_EQUALS(planCache.estimatedSizeBytes(),
+                                   static_cast<size_t>(internalQueryCacheMaxSizeBytes.load()));
+    }
+    ASSERT_LESS_THAN_OR_EQUALS(planCache.size(), 16U);
+    ASSERT_GREATER_THAN(planCache.size(), 0U);
+}
+
+TEST(PlanCacheTest, CountersSurviveEviction) {
+    // Allow one entry per partition.
+    const int oldCacheSize = internalQueryCacheSize.load();
+    ON_BLOCK_EXIT([oldCacheSize] { internalQueryCacheSize.store(oldCacheSize); });
+    internalQueryCacheSize.store(1);
+
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+    addCollScan(&planCache, *cq);
+    CachedSolution* rawCS;
+    ASSERT_OK(planCache.get(*cq, &rawCS));
+    delete rawCS;
+
+    for (int i = 0; planCache.contains(*cq); ++i) {
+        ASSERT_LESS_THAN(i, 1000);
+        addCollScan(&planCache, *canonicalize(BSON(std::string(str::stream() << "b" << i) << 1)));
+    }
+
+    addCollScan(&planCache, *cq);
+    unique_ptr<PlanCacheEntry> entry = getEntry(planCache, *cq);
+    ASSERT_EQUALS(entry->counters.hits, 1);
+    ASSERT_EQUALS(entry->counters.evictions, 1);
+}
+
 /**
  * Each test in the CachePlanSelectionTest suite goes through
  * the following flow:
@@ -65,6 +65,9 @@ extern std::atomic<bool> internalQueryPlannerEnableHashIntersection;  // NOLINT
 // How many entries in the cache?
 extern std::atomic<int> internalQueryCacheSize;  // NOLINT
 
+// Approximately how much memory may the entries in a collection's cache use?
+extern std::atomic<int> internalQueryCacheMaxSizeBytes;  // NOLINT
+
 // How many feedback entries do we collect before possibly evicting from the cache based on bad
 // performance?
 extern std::atomic<int> internalQueryCacheFeedbacksStored;  // NOLINT
@@ -105,6 +108,87 @@ extern std::atomic<int> internalQueryExecYieldIterations;  // NOLINT
 // Yield if it's been at least this many milliseconds since we last yielded.
 extern std::atomic<int> internalQueryExecYieldPeriodMS;  // NOLINT
 
+// Whether a collection scan compiles its filter into a CompiledMatchExpression.
+extern std::atomic<bool> internalQueryExecCompileCollScanFilter;  // NOLINT
+
+//
+// $group
+//
+
+// Approximate memory used by a blocking $group before it must spill its groups to disk.
+extern std::atomic<int> internalDocumentSourceGroupMaxMemoryBytes;  // NOLINT
+
+//
+// $cursor
+//
+
+// Whether documents read from the collection convert their fields from BSON only when a later
+// stage looks them up.
+extern std::atomic<bool> internalDocumentSourceCursorLazyDocuments;  // NOLINT
+
+//
+// Aggregation expressions
+//
+
+// Whether $project and $addFields compile their expressions, unless the aggregate command's
+// 'compileExpressions' option says otherwise.
+extern std::atomic<bool> internalQueryCompileAggregationExpressions;  // NOLINT
+
+//
+// Aggregation parallelism
+//
+
+// Number of threads which run the leading $match, $project and $group stages of an aggregation,
+// unless the aggregate command's 'parallelism' option says otherwise. 1 runs the whole pipeline on
+// the thread executing the command.
+extern std::atomic<int> internalQueryAggregationParallelism;  // NOLINT
+
+//
+// $lookup
+//
+
+// Whether $lookup answers equality lookups by seeking an index on the foreign field, rather than
+// running a query against the foreign collection for every input document.
+extern std::atomic<bool> internalDocumentSourceLookupUseIndexProbe;  // NOLINT
+
+// How many input documents $lookup reads ahead so that their foreign keys can be probed together,
+// in index order.
+extern std::atomic<int> internalDocumentSourceLookupIndexProbeBatchSize;  // NOLINT
+
+// Approximate memory $lookup may use for a hash table of the whole foreign side. A $lookup whose
+// foreign side does not fit keeps querying the foreign collection for every input document.
+extern std::atomic<int> internalDocumentSourceLookupHashJoinMaxMemoryBytes;  // NOLINT
+
+// $lookup switches to a hash join once it has looked up at least this many input documents per
+// document in the foreign collection, since building the hash table reads every foreign document.
+extern AtomicDouble internalDocumentSourceLookupHashJoinMinLookupRatio;  // NOLINT
+
+// Whether $lookup builds a hash table of the foreign side before looking up any input document,
+// regardless of the size of the foreign collection.
+extern std::atomic<bool> internalDocumentSourceLookupForceHashJoin;  // NOLINT
+
+//
+// $graphLookup
+//
+
+// Approximate memory used by the documents $graphLookup has found for an input document, its search
+// frontier and its cache of query results. Found documents are spilled to disk past this limit if
+// the aggregation allows it.
+extern std::atomic<int> internalDocumentSourceGraphLookupMaxMemoryBytes;  // NOLINT
+
+// The most frontier values $graphLookup queries the foreign collection for at once. Fewer are used
+// when the values each match many documents.
+extern std::atomic<int> internalDocumentSourceGraphLookupMaxBatchSize;  // NOLINT
+
+//
+// Sharded aggregation
+//
+
+// Whether mongos merges the shards' results of a split aggregation itself when the merging half of
+// the pipeline only sorts, limits, skips, reshapes or re-groups documents, rather than sending it
+// to a shard.
+extern std::atomic<bool> internalQueryAggMergeOnMongos;  // NOLINT
+
 // Limit the size that we write without yielding to 16MB / 64 (max expected number of indexes)
 const int64_t insertVectorMaxBytes = 256 * 1024;
 
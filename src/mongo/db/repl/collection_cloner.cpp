@@ -190,7 +190,9 @@ void CollectionCloner::shutdown() {
 
 CollectionCloner::Stats CollectionCloner::getStats() const {
     stdx::unique_lock<stdx::mutex> lk(_mutex);
-    return _stats;
+    Stats stats = _stats;
+    stats.now = _executor->now();
+    return stats;
 }
 
 void CollectionCloner::join() {
@@ -382,6 +384,9 @@ void CollectionCloner::_insertDocumentsCallback(const executor::TaskExecutor::Ca
 
     _documents.swap(docs);
     _stats.documents += docs.size();
+    for (auto&& doc : docs) {
+        _stats.bytes += doc.objsize();
+    }
     ++_stats.fetchBatches;
     invariant(_collLoader);
     const auto status = _collLoader->insertDocuments(docs.cbegin(), docs.cend());
@@ -410,7 +415,15 @@ void CollectionCloner::_finishCallback(const Status& status) {
     lk.unlock();
     if (callCollectionLoader) {
         if (finalStatus.isOK()) {
+            lk.lock();
+            _stats.startBuildingIndexes = _executor->now();
+            lk.unlock();
+
             const auto loaderStatus = _collLoader->commit();
+
+            lk.lock();
+            _stats.endBuildingIndexes = _executor->now();
+            lk.unlock();
             if (!loaderStatus.isOK()) {
                 warning() << "Failed to commit changes to collection " << _destNss.ns() << ": "
                           << loaderStatus;
@@ -443,6 +456,7 @@ BSONObj CollectionCloner::Stats::toBSON() const {
 
 void CollectionCloner::Stats::append(BSONObjBuilder* builder) const {
     builder->appendNumber("documents", documents);
+    builder->appendNumber("bytes", bytes);
     builder->appendNumber("indexes", indexes);
     builder->appendNumber("fetchedBatches", fetchBatches);
     if (start != Date_t()) {
@@ -453,6 +467,22 @@ void CollectionCloner::Stats::append(BSONObjBuilder* builder) const {
             long long elapsedMillis = duration_cast<Milliseconds>(elapsed).count();
             builder->appendNumber("elapsedMillis", elapsedMillis);
         }
+
+        // Throughput over the whole clone once it is done, or so far while it is in progress.
+        const Date_t until = (end != Date_t()) ? end : now;
+        const long long throughputMillis =
+            (until > start) ? duration_cast<Milliseconds>(until - start).count() : 0;
+        if (throughputMillis > 0) {
+            builder->appendNumber("documentsPerSecond",
+                                  static_cast<long long>(documents * 1000 / throughputMillis));
+            builder->appendNumber("bytesPerSecond",
+                                  static_cast<long long>(bytes * 1000 / throughputMillis));
+        }
+    }
+    if (startBuildingIndexes != Date_t() && endBuildingIndexes != Date_t()) {
+        auto indexElapsed = endBuildingIndexes - startBuildingIndexes;
+        long long indexElapsedMillis = duration_cast<Milliseconds>(indexElapsed).count();
+        builder->appendNumber("indexBuildElapsedMillis", indexElapsedMillis);
     }
 }
 }  // namespace repl
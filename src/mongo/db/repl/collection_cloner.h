@@ -64,7 +64,13 @@ public:
         std::string ns;
         Date_t start;
         Date_t end;
+        // When these stats were taken. Used for the throughput of a clone still in progress.
+        Date_t now;
+        // Time spent building the indexes once all the documents were inserted.
+        Date_t startBuildingIndexes;
+        Date_t endBuildingIndexes;
         size_t documents{0};
+        size_t bytes{0};
         size_t indexes{0};
         size_t fetchBatches{0};
 
@@ -1386,9 +1386,10 @@ TEST_F(InitialSyncTest, InitialSyncStateIsResetAfterFailure) {
                   fromjson(str::stream() << "{databasesCloned: 1, a: {collections: 1, "
                                             "clonedCollections: 1, start: new Date(1406851200000), "
                                             "end: new Date(1406851200000), elapsedMillis: 0, "
-                                            "'a.a': {documents: 1, indexes: 1, fetchedBatches: 1, "
-                                            "start: new Date(1406851200000), end: new "
-                                            "Date(1406851200000), elapsedMillis: 0}}}"));
+                                            "'a.a': {documents: 1, bytes: 21, indexes: 1, "
+                                            "fetchedBatches: 1, start: new Date(1406851200000), "
+                                            "end: new Date(1406851200000), elapsedMillis: 0, "
+                                            "indexBuildElapsedMillis: 0}}}"));
 
     attempts = progress["initialSyncAttempts"].Obj();
     ASSERT_EQUALS(attempts.nFields(), 1);
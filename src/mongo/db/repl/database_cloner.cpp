@@ -215,6 +215,12 @@ void DatabaseCloner::setScheduleDbWorkFn_forTest(const CollectionCloner::Schedul
     _scheduleDbWorkFn = work;
 }
 
+void DatabaseCloner::setMaxConcurrentCollectionCloners(size_t maxConcurrentCollectionCloners) {
+    invariant(maxConcurrentCollectionCloners > 0);
+    LockGuard lk(_mutex);
+    _maxConcurrentCollectionCloners = maxConcurrentCollectionCloners;
+}
+
 void DatabaseCloner::setStartCollectionClonerFn(
     const StartCollectionClonerFn& startCollectionCloner) {
     _startCollectionCloner = startCollectionCloner;
@@ -345,18 +351,10 @@ void DatabaseCloner::_listCollectionsCallback(const StatusWith<Fetcher::QueryRes
         }
     }
 
-    // Start first collection cloner.
-    _currentCollectionClonerIter = _collectionCloners.begin();
-
-    LOG(1) << "    cloning collection " << _currentCollectionClonerIter->getSourceNamespace();
-
-    Status startStatus = _startCollectionCloner(*_currentCollectionClonerIter);
-    if (!startStatus.isOK()) {
-        LOG(1) << "    failed to start collection cloning on "
-               << _currentCollectionClonerIter->getSourceNamespace() << ": " << startStatus;
-        _finishCallback_inlock(lk, startStatus);
-        return;
-    }
+    // Start the first batch of collection cloners.
+    _nextCollectionClonerIter = _collectionCloners.begin();
+    _startCollectionCloners_inlock();
+    _finishIfDone_inlock(lk);
 }
 
 void DatabaseCloner::_collectionClonerCallback(const Status& status, const NamespaceString& nss) {
@@ -379,16 +377,44 @@ void DatabaseCloner::_collectionClonerCallback(const Status& status, const Names
     lk.unlock();
     _collectionWork(newStatus, nss);
     lk.lock();
-    _currentCollectionClonerIter++;
+    invariant(_activeCollectionCloners > 0);
+    --_activeCollectionCloners;
+
+    _startCollectionCloners_inlock();
+    _finishIfDone_inlock(lk);
+}
+
+void DatabaseCloner::_startCollectionCloners_inlock() {
+    while (_startCollectionClonerStatus.isOK() &&
+           _nextCollectionClonerIter != _collectionCloners.end() &&
+           _activeCollectionCloners < _maxConcurrentCollectionCloners) {
+        auto&& cloner = *_nextCollectionClonerIter;
+        ++_nextCollectionClonerIter;
 
-    if (_currentCollectionClonerIter != _collectionCloners.end()) {
-        Status startStatus = _startCollectionCloner(*_currentCollectionClonerIter);
+        LOG(1) << "    cloning collection " << cloner.getSourceNamespace();
+
+        Status startStatus = _startCollectionCloner(cloner);
         if (!startStatus.isOK()) {
-            LOG(1) << "    failed to start collection cloning on "
-                   << _currentCollectionClonerIter->getSourceNamespace() << ": " << startStatus;
-            _finishCallback_inlock(lk, startStatus);
+            LOG(1) << "    failed to start collection cloning on " << cloner.getSourceNamespace()
+                   << ": " << startStatus;
+            _startCollectionClonerStatus = startStatus;
             return;
         }
+        ++_activeCollectionCloners;
+    }
+}
+
+void DatabaseCloner::_finishIfDone_inlock(UniqueLock& lk) {
+    if (_activeCollectionCloners > 0) {
+        return;
+    }
+
+    if (!_startCollectionClonerStatus.isOK()) {
+        _finishCallback_inlock(lk, _startCollectionClonerStatus);
+        return;
+    }
+
+    if (_nextCollectionClonerIter != _collectionCloners.end()) {
         return;
     }
 
@@ -143,6 +143,14 @@ public:
 
     std::string getDBName() const;
 
+    /**
+     * Sets how many collections of this database may be cloned at the same time. Collection
+     * cloners are started in listCollections order. Defaults to 1 (serial cloning).
+     *
+     * Must be called before startup().
+     */
+    void setMaxConcurrentCollectionCloners(size_t maxConcurrentCollectionCloners);
+
     //
     // Testing only functions below.
     //
@@ -175,6 +183,18 @@ private:
      */
     void _collectionClonerCallback(const Status& status, const NamespaceString& nss);
 
+    /**
+     * Starts collection cloners until '_maxConcurrentCollectionCloners' are active or every
+     * collection has been started. Stops starting cloners after the first failure to start one,
+     * which is then reported when the last active cloner completes.
+     */
+    void _startCollectionCloners_inlock();
+
+    /**
+     * Finishes the database cloner once no collection cloner is active and none is left to start.
+     */
+    void _finishIfDone_inlock(UniqueLock& lk);
+
     /**
      * Reports completion status.
      * Sets cloner to inactive.
@@ -218,11 +238,14 @@ private:
     //     options: <collection options>
     // }
     // Holds all collection infos from listCollections.
-    std::vector<BSONObj> _collectionInfos;                               // (M)
-    std::vector<NamespaceString> _collectionNamespaces;                  // (M)
-    std::list<CollectionCloner> _collectionCloners;                      // (M)
-    std::list<CollectionCloner>::iterator _currentCollectionClonerIter;  // (M)
-    std::vector<std::pair<Status, NamespaceString>> _failedNamespaces;   // (M)
+    std::vector<BSONObj> _collectionInfos;                              // (M)
+    std::vector<NamespaceString> _collectionNamespaces;                 // (M)
+    std::list<CollectionCloner> _collectionCloners;                     // (M)
+    std::list<CollectionCloner>::iterator _nextCollectionClonerIter;    // (M) Next one to start.
+    size_t _activeCollectionCloners = 0;                                // (M)
+    size_t _maxConcurrentCollectionCloners = 1;                         // (M)
+    Status _startCollectionClonerStatus = Status::OK();                 // (M) First start failure.
+    std::vector<std::pair<Status, NamespaceString>> _failedNamespaces;  // (M)
     CollectionCloner::ScheduleDbWorkFn
         _scheduleDbWorkFn;  // (RT) Function for scheduling database work using the executor.
     StartCollectionClonerFn _startCollectionCloner;  // (RT)
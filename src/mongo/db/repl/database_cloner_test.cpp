@@ -659,4 +659,74 @@ TEST_F(DatabaseClonerTest, CreateCollections) {
     stats.commitCalled = true;
 }
 
+TEST_F(DatabaseClonerTest, CollectionClonersRunConcurrentlyUpToLimit) {
+    _databaseCloner->setMaxConcurrentCollectionCloners(2);
+    ASSERT_OK(_databaseCloner->startup());
+
+    const std::vector<BSONObj> sourceInfos = {BSON("name"
+                                                   << "a"
+                                                   << "options"
+                                                   << BSONObj()),
+                                              BSON("name"
+                                                   << "b"
+                                                   << "options"
+                                                   << BSONObj()),
+                                              BSON("name"
+                                                   << "c"
+                                                   << "options"
+                                                   << BSONObj())};
+    {
+        executor::NetworkInterfaceMock::InNetworkGuard guard(getNet());
+        processNetworkResponse(createListCollectionsResponse(
+            0, BSON_ARRAY(sourceInfos[0] << sourceInfos[1] << sourceInfos[2])));
+    }
+    ASSERT_EQUALS(getDetectableErrorStatus(), getStatus());
+    ASSERT_TRUE(_databaseCloner->isActive());
+
+    // The cloners for "a" and "b" are started together. "c" waits for one of them to finish.
+    {
+        executor::NetworkInterfaceMock::InNetworkGuard guard(getNet());
+        auto net = getNet();
+
+        ASSERT_TRUE(net->hasReadyRequests());
+        auto noi = net->getNextReadyRequest();
+        ASSERT_EQUALS(BSON("listIndexes"
+                           << "a"),
+                      noi->getRequest().cmdObj);
+        scheduleNetworkResponse(noi, createListIndexesResponse(0, BSON_ARRAY(idIndexSpec)));
+
+        ASSERT_TRUE(net->hasReadyRequests());
+        noi = net->getNextReadyRequest();
+        ASSERT_EQUALS(BSON("listIndexes"
+                           << "b"),
+                      noi->getRequest().cmdObj);
+        scheduleNetworkResponse(noi, createListIndexesResponse(0, BSON_ARRAY(idIndexSpec)));
+
+        ASSERT_FALSE(net->hasReadyRequests());
+        net->runReadyNetworkOperations();
+    }
+    ASSERT_TRUE(_databaseCloner->isActive());
+
+    {
+        executor::NetworkInterfaceMock::InNetworkGuard guard(getNet());
+        // find on "a" and "b".
+        processNetworkResponse(createCursorResponse(0, BSONArray()));
+        processNetworkResponse(createCursorResponse(0, BSONArray()));
+        // listIndexes and find on "c".
+        processNetworkResponse(createListIndexesResponse(0, BSON_ARRAY(idIndexSpec)));
+        processNetworkResponse(createCursorResponse(0, BSONArray()));
+    }
+
+    _databaseCloner->join();
+    ASSERT_OK(getStatus());
+    ASSERT_FALSE(_databaseCloner->isActive());
+
+    ASSERT_EQUALS(3U, _collections.size());
+    for (auto&& nss : {"db.a", "db.b", "db.c"}) {
+        auto collInfo = _collections[NamespaceString{nss}];
+        ASSERT_OK(collInfo.status);
+        ASSERT_TRUE(collInfo.stats.commitCalled);
+    }
+}
+
 }  // namespace
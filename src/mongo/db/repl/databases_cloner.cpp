@@ -40,6 +40,7 @@
 #include "mongo/db/catalog/collection_options.h"
 #include "mongo/db/client.h"
 #include "mongo/db/repl/storage_interface.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/rpc/get_status_from_command_result.h"
 #include "mongo/rpc/metadata/server_selection_metadata.h"
 #include "mongo/stdx/functional.h"
@@ -60,6 +61,30 @@ using UniqueLock = stdx::unique_lock<stdx::mutex>;
 
 const size_t numListDatabasesRetries = 1;
 
+// The number of collections of a database which are cloned at the same time. Each one uses a
+// thread of the db worker thread pool while inserting documents and building its indexes, so the
+// limit is also capped below the size of that pool.
+std::atomic<int> initialSyncMaxConcurrentCollectionClones(4);  // NOLINT
+
+class ExportedInitialSyncMaxConcurrentCollectionClonesParameter
+    : public ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime> {
+public:
+    ExportedInitialSyncMaxConcurrentCollectionClonesParameter()
+        : ExportedServerParameter<int, ServerParameterType::kStartupAndRuntime>(
+              ServerParameterSet::getGlobal(),
+              "initialSyncMaxConcurrentCollectionClones",
+              &initialSyncMaxConcurrentCollectionClones) {}
+
+    virtual Status validate(const int& potentialNewValue) {
+        if (potentialNewValue < 1 || potentialNewValue > 256) {
+            return Status(ErrorCodes::BadValue,
+                          "initialSyncMaxConcurrentCollectionClones must be between 1 and 256");
+        }
+
+        return Status::OK();
+    }
+} exportedInitialSyncMaxConcurrentCollectionClonesParam;
+
 }  // namespace
 
 
@@ -276,6 +301,13 @@ void DatabasesCloner::_onListDatabaseFinish(const CommandCallbackArgs& cbd) {
             if (_scheduleDbWorkFn) {
                 dbCloner->setScheduleDbWorkFn_forTest(_scheduleDbWorkFn);
             }
+            // Every active collection cloner can hold a db worker thread while it waits for
+            // locks, so leave at least one thread free for the others to make progress.
+            const size_t poolThreads = _dbWorkThreadPool->getNumThreads();
+            const size_t maxCloners = poolThreads > 1
+                ? std::min<size_t>(initialSyncMaxConcurrentCollectionClones.load(), poolThreads - 1)
+                : 1;
+            dbCloner->setMaxConcurrentCollectionCloners(maxCloners);
             // Start first database cloner.
             if (_databaseCloners.empty()) {
                 startStatus = dbCloner->startup();
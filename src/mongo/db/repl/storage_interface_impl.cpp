@@ -253,23 +253,32 @@ StorageInterfaceImpl::createCollectionForBulkLoading(
 
         // Retry if WCE.
         MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
-            // Get locks and create the collection.
             ScopedTransaction transaction(txn, MODE_IX);
+            {
+                // Creating the database, and the collection in it, needs the database lock in
+                // MODE_X. Only hold it for the creation, so that the collections of a new
+                // database can be loaded concurrently.
+                AutoGetOrCreateDb db(txn, nss.db(), MODE_X);
+                if (db.getDb()->getCollection(nss)) {
+                    return {ErrorCodes::NamespaceExists, "Collection already exists."};
+                }
+
+                WriteUnitOfWork wunit(txn);
+                invariant(db.getDb()->createCollection(txn, nss.ns(), options, false));
+                wunit.commit();
+            }
+
+            // The loader holds the database in MODE_IX and the collection in MODE_X until it
+            // finishes.
             auto db = stdx::make_unique<AutoGetOrCreateDb>(txn, nss.db(), MODE_IX);
-            auto coll = stdx::make_unique<AutoGetCollection>(txn, nss, MODE_X);
+            auto coll = stdx::make_unique<AutoGetCollection>(txn, nss, MODE_IX, MODE_X);
             Collection* collection = coll->getCollection();
-
-            if (collection) {
-                return {ErrorCodes::NamespaceExists, "Collection already exists."};
+            if (!collection) {
+                return {ErrorCodes::NamespaceNotFound,
+                        str::stream() << "Collection " << nss.ns()
+                                      << " was dropped while being created for bulk loading"};
             }
 
-            // Create the collection.
-            WriteUnitOfWork wunit(txn);
-            collection = db->getDb()->createCollection(txn, nss.ns(), options, false);
-            invariant(collection);
-            wunit.commit();
-            coll = stdx::make_unique<AutoGetCollection>(txn, nss, MODE_IX);
-
             // Move locks into loader, so it now controls their lifetime.
             auto loader = stdx::make_unique<CollectionBulkLoaderImpl>(txn,
                                                                       collection,
@@ -448,6 +448,41 @@ TEST_F(StorageInterfaceImplWithReplCoordTest, CreateCollectionWithIDIndexCommits
     ASSERT_EQ(count, 2LL);
 }
 
+// The first loader of a new database must not keep the database locked exclusively, or a second
+// loader for the same database would wait for it forever.
+TEST_F(StorageInterfaceImplWithReplCoordTest, BulkLoadTwoCollectionsOfANewDatabaseConcurrently) {
+    auto txn = getOperationContext();
+    StorageInterfaceImpl storage;
+    storage.startup();
+    NamespaceString nss1("newdb.coll1");
+    NamespaceString nss2("newdb.coll2");
+    CollectionOptions opts;
+    std::vector<BSONObj> indexes;
+
+    auto loader1 = unittest::assertGet(
+        storage.createCollectionForBulkLoading(nss1, opts, makeIdIndexSpec(nss1), indexes));
+    auto loader2 = unittest::assertGet(
+        storage.createCollectionForBulkLoading(nss2, opts, makeIdIndexSpec(nss2), indexes));
+
+    std::vector<BSONObj> docs1 = {BSON("_id" << 1), BSON("_id" << 2)};
+    std::vector<BSONObj> docs2 = {BSON("_id" << 1), BSON("_id" << 2), BSON("_id" << 3)};
+    ASSERT_OK(loader2->insertDocuments(docs2.begin(), docs2.end()));
+    ASSERT_OK(loader1->insertDocuments(docs1.begin(), docs1.end()));
+    ASSERT_OK(loader1->commit());
+    ASSERT_OK(loader2->commit());
+
+    {
+        AutoGetCollectionForRead autoColl(txn, nss1);
+        ASSERT(autoColl.getCollection());
+        ASSERT_EQ(autoColl.getCollection()->getRecordStore()->numRecords(txn), 2LL);
+    }
+    {
+        AutoGetCollectionForRead autoColl(txn, nss2);
+        ASSERT(autoColl.getCollection());
+        ASSERT_EQ(autoColl.getCollection()->getRecordStore()->numRecords(txn), 3LL);
+    }
+}
+
 TEST_F(StorageInterfaceImplWithReplCoordTest, CreateCollectionThatAlreadyExistsFails) {
     auto txn = getOperationContext();
     StorageInterfaceImpl storage;
@@ -67,6 +67,7 @@
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/stats/timer_stats.h"
+#include "mongo/platform/unordered_map.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/fail_point_service.h"
@@ -602,6 +603,44 @@ private:
     StringMap<CollectionProperties> _cache;
 };
 
+/**
+ * Assigns the ops of a batch to writer threads. Ops which may conflict share a conflict key: ops on
+ * the same document for doc-locking engines, or on the same namespace otherwise. All the ops with a
+ * given key go to one writer, which applies them in oplog order. Ops with different keys don't
+ * depend on each other, so each key is given to the least loaded writer the first time it shows up
+ * in the batch. Unlike a plain 'hash % numWriters', this keeps the writers evenly loaded when a few
+ * keys account for most of the batch.
+ */
+class WriterAssigner {
+public:
+    explicit WriterAssigner(std::vector<MultiApplier::OperationPtrs>* writerVectors)
+        : _writerVectors(writerVectors) {}
+
+    MultiApplier::OperationPtrs& getWriterFor(uint32_t conflictKey) {
+        auto it = _writerByConflictKey.find(conflictKey);
+        if (it == _writerByConflictKey.end()) {
+            it = _writerByConflictKey.emplace(conflictKey, _leastLoadedWriter()).first;
+        }
+        return (*_writerVectors)[it->second];
+    }
+
+private:
+    size_t _leastLoadedWriter() const {
+        size_t best = 0;
+        for (size_t i = 1; i < _writerVectors->size(); ++i) {
+            if ((*_writerVectors)[i].size() < (*_writerVectors)[best].size()) {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    std::vector<MultiApplier::OperationPtrs>* const _writerVectors;
+
+    // A hash collision between two keys only makes them share a writer, which is always safe.
+    unordered_map<uint32_t, size_t> _writerByConflictKey;
+};
+
 // This only modifies the isForCappedCollection field on each op. It does not alter the ops vector
 // in any other way.
 void fillWriterVectors(OperationContext* txn,
@@ -609,9 +648,9 @@ void fillWriterVectors(OperationContext* txn,
                        std::vector<MultiApplier::OperationPtrs>* writerVectors) {
     const bool supportsDocLocking =
         getGlobalServiceContext()->getGlobalStorageEngine()->supportsDocLocking();
-    const uint32_t numWriters = writerVectors->size();
 
     CachedCollectionProperties collPropertiesCache;
+    WriterAssigner writerAssigner(writerVectors);
 
     for (auto&& op : *ops) {
         StringMapTraits::HashedKey hashedNs(op.ns);
@@ -643,7 +682,7 @@ void fillWriterVectors(OperationContext* txn,
             }
         }
 
-        auto& writer = (*writerVectors)[hash % numWriters];
+        auto& writer = writerAssigner.getWriterFor(hash);
         if (writer.empty())
             writer.reserve(8);  // skip a few growth rounds.
         writer.push_back(&op);
@@ -33,6 +33,7 @@
 #include <utility>
 #include <vector>
 
+#include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/collection_options.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/catalog/database_holder.h"
@@ -57,6 +58,7 @@
 #include "mongo/unittest/unittest.h"
 #include "mongo/util/concurrency/old_thread_pool.h"
 #include "mongo/util/string_map.h"
+#include "mongo/util/timer.h"
 
 namespace {
 
@@ -597,6 +599,103 @@ TEST_F(SyncTailTest, MultiApplyAssignsOperationsToWriterThreadsBasedOnNamespaceH
     ASSERT_EQUALS(op2.raw, operationsWrittenToOplog[1]);
 }
 
+TEST_F(SyncTailTest, MultiApplyBalancesNamespacesAcrossWriterThreadsAndKeepsTheirOrder) {
+    // The ephemeralForTest engine doesn't support document locking, so conflicts are tracked per
+    // namespace. With 4 threads and few enough ops to write the oplog on one thread, 3 writers
+    // apply ops.
+    OldThreadPool writerPool(4);
+    const size_t numNamespaces = 3;
+    const int numOpsPerNamespace = 5;
+
+    stdx::mutex mutex;
+    std::vector<MultiApplier::Operations> operationsApplied;
+    auto applyOperationFn = [&mutex, &operationsApplied](
+        MultiApplier::OperationPtrs* operationsForWriterThreadToApply) {
+        stdx::lock_guard<stdx::mutex> lock(mutex);
+        operationsApplied.emplace_back();
+        for (auto&& opPtr : *operationsForWriterThreadToApply) {
+            operationsApplied.back().push_back(*opPtr);
+        }
+    };
+
+    // Interleave the ops on each namespace, so that a new namespace always shows up while the
+    // writers it could collide with by hash already have work.
+    MultiApplier::Operations ops;
+    int seconds = 0;
+    for (int i = 0; i < numOpsPerNamespace; i++) {
+        for (size_t j = 0; j < numNamespaces; j++) {
+            NamespaceString nss("test.t" + std::to_string(j));
+            ops.push_back(makeInsertDocumentOplogEntry(
+                {Timestamp(Seconds(++seconds), 0), 1LL}, nss, BSON("_id" << i)));
+        }
+    }
+
+    auto lastOpTime =
+        unittest::assertGet(multiApply(_txn.get(), &writerPool, ops, applyOperationFn));
+    ASSERT_EQUALS(ops.back().getOpTime(), lastOpTime);
+
+    // Each writer applies all the ops of exactly one namespace, in oplog order.
+    stdx::lock_guard<stdx::mutex> lock(mutex);
+    ASSERT_EQUALS(numNamespaces, operationsApplied.size());
+    std::vector<std::string> seen;
+    for (auto&& operationsAppliedByThread : operationsApplied) {
+        ASSERT_EQUALS(size_t(numOpsPerNamespace), operationsAppliedByThread.size());
+        const auto& ns = operationsAppliedByThread.front().ns;
+        ASSERT_TRUE(std::find(seen.cbegin(), seen.cend(), ns.toString()) == seen.cend());
+        seen.push_back(ns.toString());
+        for (size_t i = 0; i < operationsAppliedByThread.size(); i++) {
+            ASSERT_EQUALS(ns, operationsAppliedByThread[i].ns);
+            if (i > 0) {
+                ASSERT_LESS_THAN(operationsAppliedByThread[i - 1].getOpTime(),
+                                 operationsAppliedByThread[i].getOpTime());
+            }
+        }
+    }
+}
+
+TEST_F(SyncTailTest, MultiApplyThroughputBenchmark) {
+    const int numNamespaces = 8;
+    const int numOps = 20000;
+    auto writerPool = SyncTail::makeWriterPool();
+
+    std::vector<NamespaceString> namespaces;
+    for (int i = 0; i < numNamespaces; i++) {
+        namespaces.emplace_back("test." + _agent.getSuiteName() + "_" + _agent.getTestName() +
+                                "_" + std::to_string(i));
+        createCollection(_txn.get(), namespaces.back(), CollectionOptions());
+    }
+
+    // Half of the ops go to the first collection, the rest are spread over the others.
+    MultiApplier::Operations ops;
+    ops.reserve(numOps);
+    for (int i = 0; i < numOps; i++) {
+        const auto& nss =
+            (i % 2 == 0) ? namespaces[0] : namespaces[1 + (i / 2) % (numNamespaces - 1)];
+        ops.push_back(makeInsertDocumentOplogEntry(
+            {Timestamp(Seconds(i + 1), 0), 1LL}, nss, BSON("_id" << i << "x" << i)));
+    }
+
+    auto applyOperationFn = [](MultiApplier::OperationPtrs* ops) { multiSyncApply(ops, nullptr); };
+
+    Timer timer;
+    auto lastOpTime =
+        unittest::assertGet(multiApply(_txn.get(), writerPool.get(), ops, applyOperationFn));
+    const long long micros = std::max(timer.micros(), 1LL);
+    ASSERT_EQUALS(ops.back().getOpTime(), lastOpTime);
+
+    long long numRecords = 0;
+    for (auto&& nss : namespaces) {
+        AutoGetCollectionForRead autoColl(_txn.get(), nss);
+        ASSERT_TRUE(autoColl.getCollection());
+        numRecords += autoColl.getCollection()->numRecords(_txn.get());
+    }
+    ASSERT_EQUALS(numOps, numRecords);
+
+    unittest::log() << "applied " << numOps << " inserts on " << numNamespaces
+                    << " collections with " << writerPool->getNumThreads() << " writer threads in "
+                    << micros / 1000 << "ms (" << (numOps * 1000 * 1000LL / micros) << " ops/sec)";
+}
+
 TEST_F(SyncTailTest, MultiSyncApplyUsesSyncApplyToApplyOperation) {
     NamespaceString nss("local." + _agent.getSuiteName() + "_" + _agent.getTestName());
     ASSERT_TRUE(_txn->writesAreReplicated());
@@ -50,6 +50,7 @@
 #include <boost/filesystem/operations.hpp>
 #include <snappy.h>
 #include <vector>
+#include <zlib.h>
 
 #include "mongo/base/string_data.h"
 #include "mongo/config.h"
@@ -120,6 +121,22 @@ void dassertCompIsSane(const Comparator& comp, const Data& lhs, const Data& rhs)
 #endif
 }
 
+/**
+ * Every block of a spill file starts with a header made of
+ *   int32_t  size of the payload on disk,
+ *   int32_t  size of the payload once unprotected and decompressed,
+ *   uint8_t  SorterSpillCompressor used for the payload,
+ *   uint32_t CRC-32 of the payload as stored on disk,
+ * which is followed by the payload itself.
+ */
+const size_t kBlockHeaderSize = sizeof(int32_t) + sizeof(int32_t) + sizeof(uint8_t) +
+    sizeof(uint32_t);
+
+inline uint32_t blockChecksum(const char* data, size_t size) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    return crc32(crc, reinterpret_cast<const Bytef*>(data), size);
+}
+
 /** Ensures a named file is deleted when this object goes out of scope */
 class FileDeleter {
 public:
@@ -172,8 +189,10 @@ public:
 
     FileIterator(const std::string& fileName,
                  const Settings& settings,
-                 std::shared_ptr<FileDeleter> fileDeleter)
+                 std::shared_ptr<FileDeleter> fileDeleter,
+                 std::shared_ptr<SorterFileStats> stats)
         : _settings(settings),
+          _stats(std::move(stats)),
           _done(false),
           _fileName(fileName),
           _fileDeleter(fileDeleter),
@@ -213,19 +232,34 @@ private:
     }
 
     void fill() {
-        int32_t rawSize;
-        read(&rawSize, sizeof(rawSize));
+        char header[kBlockHeaderSize];
+        read(header, sizeof(header));
         if (_done)
             return;
 
-        // negative size means compressed
-        const bool compressed = rawSize < 0;
-        int32_t blockSize = std::abs(rawSize);
+        BufReader headerReader(header, sizeof(header));
+        int32_t blockSize = headerReader.read<LittleEndian<int32_t>>();
+        const int32_t uncompressedSize = headerReader.read<LittleEndian<int32_t>>();
+        const auto compressor = static_cast<SorterSpillCompressor>(headerReader.read<uint8_t>());
+        const uint32_t checksum = headerReader.read<LittleEndian<uint32_t>>();
+        massert(40400,
+                str::stream() << "corrupt block header in file \"" << _fileName << "\"",
+                blockSize >= 0 && uncompressedSize >= 0 &&
+                    compressor <= SorterSpillCompressor::kZlib);
 
         _buffer.reset(new char[blockSize]);
         read(_buffer.get(), blockSize);
         massert(16816, "file too short?", !_done);
 
+        if (_stats) {
+            _stats->bytesRead += kBlockHeaderSize + blockSize;
+        }
+
+        massert(40401,
+                str::stream() << "checksum mismatch reading block from file \"" << _fileName
+                              << "\"",
+                blockChecksum(_buffer.get(), blockSize) == checksum);
+
         auto hooks = WiredTigerCustomizationHooks::get(getGlobalServiceContext());
         if (hooks->enabled()) {
             std::unique_ptr<char[]> out(new char[blockSize]);
@@ -242,25 +276,48 @@ private:
             _buffer.swap(out);
         }
 
-        if (!compressed) {
-            _reader.reset(new BufReader(_buffer.get(), blockSize));
-            return;
-        }
+        switch (compressor) {
+            case SorterSpillCompressor::kNone:
+                _reader.reset(new BufReader(_buffer.get(), blockSize));
+                return;
+
+            case SorterSpillCompressor::kSnappy: {
+                dassert(snappy::IsValidCompressedBuffer(_buffer.get(), blockSize));
 
-        dassert(snappy::IsValidCompressedBuffer(_buffer.get(), blockSize));
+                size_t snappySize;
+                massert(17061,
+                        "couldn't get uncompressed length",
+                        snappy::GetUncompressedLength(_buffer.get(), blockSize, &snappySize) &&
+                            snappySize == size_t(uncompressedSize));
 
-        size_t uncompressedSize;
-        massert(17061,
-                "couldn't get uncompressed length",
-                snappy::GetUncompressedLength(_buffer.get(), blockSize, &uncompressedSize));
+                std::unique_ptr<char[]> decompressionBuffer(new char[uncompressedSize]);
+                massert(17062,
+                        "decompression failed",
+                        snappy::RawUncompress(
+                            _buffer.get(), blockSize, decompressionBuffer.get()));
 
-        std::unique_ptr<char[]> decompressionBuffer(new char[uncompressedSize]);
-        massert(17062,
-                "decompression failed",
-                snappy::RawUncompress(_buffer.get(), blockSize, decompressionBuffer.get()));
+                // hold on to decompressed data and throw out compressed data at block exit
+                _buffer.swap(decompressionBuffer);
+                break;
+            }
+
+            case SorterSpillCompressor::kZlib: {
+                std::unique_ptr<char[]> decompressionBuffer(new char[uncompressedSize]);
+                uLongf zlibSize = uncompressedSize;
+                const int ret =
+                    uncompress(reinterpret_cast<Bytef*>(decompressionBuffer.get()),
+                               &zlibSize,
+                               reinterpret_cast<const Bytef*>(_buffer.get()),
+                               blockSize);
+                massert(40402,
+                        str::stream() << "zlib decompression failed with code " << ret,
+                        ret == Z_OK && zlibSize == uLongf(uncompressedSize));
+
+                _buffer.swap(decompressionBuffer);
+                break;
+            }
+        }
 
-        // hold on to decompressed data and throw out compressed data at block exit
-        _buffer.swap(decompressionBuffer);
         _reader.reset(new BufReader(_buffer.get(), uncompressedSize));
     }
 
@@ -281,6 +338,7 @@ private:
     }
 
     const Settings _settings;
+    const std::shared_ptr<SorterFileStats> _stats;  // May be null
     bool _done;
     std::unique_ptr<char[]> _buffer;
     std::unique_ptr<BufReader> _reader;
@@ -525,7 +583,7 @@ public:
     typedef SortIteratorInterface<Key, Value> Iterator;
 
     LimitOneSorter(const SortOptions& opts, const Comparator& comp)
-        : _comp(comp), _haveData(false) {
+        : _comp(comp), _topKStats(opts.topKStats), _haveData(false) {
         verify(opts.limit == 1);
     }
 
@@ -533,6 +591,10 @@ public:
         Data contender(key, val);
 
         if (_haveData) {
+            // Either the contender or the old best is discarded.
+            if (_topKStats)
+                _topKStats->discardedOnAdd++;
+
             dassertCompIsSane(_comp, _best, contender);
             if (_comp(_best, contender) <= 0)
                 return;  // not good enough
@@ -561,6 +623,7 @@ public:
 
 private:
     const Comparator _comp;
+    const std::shared_ptr<SorterTopKStats> _topKStats;
     Data _best;
     bool _haveData;  // false at start, set to true on first call to add()
 };
@@ -600,8 +663,10 @@ public:
         Data contender(key, val);
 
         if (_data.size() < _opts.limit) {
-            if (_haveCutoff && !less(contender, _cutoff))
+            if (_haveCutoff && !less(contender, _cutoff)) {
+                countDiscarded(1, 0);
                 return;
+            }
 
             _data.push_back(contender);
 
@@ -619,6 +684,9 @@ public:
 
         verify(_data.size() == _opts.limit);
 
+        // Either the contender or the old worst pair is discarded.
+        countDiscarded(1, 0);
+
         if (!less(contender, _data.front()))
             return;  // not good enough
 
@@ -755,6 +823,35 @@ private:
             }
             _medianCount = 0;
         }
+
+        // A candidate that is no better than the cutoff can never be promoted, so stop counting
+        // towards it and pick a new one on the next spill.
+        if (_haveCutoff && _worstCount != 0 && !less(_worstSeen, _cutoff)) {
+            _worstCount = 0;
+        }
+        if (_haveCutoff && _medianCount != 0 && !less(_lastMedian, _cutoff)) {
+            _medianCount = 0;
+        }
+    }
+
+    // Can only be called after _data is sorted. Drops the pairs that are worse than _cutoff, so
+    // that they are never serialized. There are at least K pairs equal to or better than _cutoff.
+    void trimToCutoff() {
+        if (!_haveCutoff)
+            return;
+
+        STLComparator less(_comp);
+        typename std::vector<Data>::iterator firstWorseThanCutoff =
+            std::upper_bound(_data.begin(), _data.end(), _cutoff, less);
+        countDiscarded(0, std::distance(firstWorseThanCutoff, _data.end()));
+        _data.erase(firstWorseThanCutoff, _data.end());
+    }
+
+    void countDiscarded(long long onAdd, long long onSpill) {
+        if (_opts.topKStats) {
+            _opts.topKStats->discardedOnAdd += onAdd;
+            _opts.topKStats->discardedOnSpill += onSpill;
+        }
     }
 
     void spill() {
@@ -779,6 +876,7 @@ private:
 
         sort();
         updateCutoff();
+        trimToCutoff();
 
         SortedFileWriter<Key, Value> writer(_opts, _settings);
         for (size_t i = 0; i < _data.size(); i++) {
@@ -823,7 +921,7 @@ inline unsigned nextFileNumber() {
 
 template <typename Key, typename Value>
 SortedFileWriter<Key, Value>::SortedFileWriter(const SortOptions& opts, const Settings& settings)
-    : _settings(settings) {
+    : _settings(settings), _compressor(opts.spillCompressor), _stats(opts.fileStats) {
     namespace str = mongoutils::str;
 
     // This should be checked by consumers, but if we get here don't allow writes.
@@ -867,17 +965,38 @@ template <typename Key, typename Value>
 void SortedFileWriter<Key, Value>::spill() {
     namespace str = mongoutils::str;
 
-    int32_t size = _buffer.len();
+    const int32_t uncompressedSize = _buffer.len();
+    int32_t size = uncompressedSize;
     char* outBuffer = _buffer.buf();
 
     if (size == 0)
         return;
 
     std::string compressed;
-    snappy::Compress(outBuffer, size, &compressed);
+    switch (_compressor) {
+        case SorterSpillCompressor::kNone:
+            break;
+
+        case SorterSpillCompressor::kSnappy:
+            snappy::Compress(outBuffer, size, &compressed);
+            break;
+
+        case SorterSpillCompressor::kZlib: {
+            uLongf compressedSize = compressBound(size);
+            compressed.resize(compressedSize);
+            const int ret = compress(reinterpret_cast<Bytef*>(&compressed[0]),
+                                     &compressedSize,
+                                     reinterpret_cast<const Bytef*>(outBuffer),
+                                     size);
+            massert(40403, str::stream() << "zlib compression failed with code " << ret, ret == Z_OK);
+            compressed.resize(compressedSize);
+            break;
+        }
+    }
     verify(compressed.size() <= size_t(std::numeric_limits<int32_t>::max()));
 
-    const bool shouldCompress = compressed.size() < size_t(_buffer.len() / 10 * 9);
+    const bool shouldCompress =
+        !compressed.empty() && compressed.size() < size_t(_buffer.len() / 10 * 9);
     if (shouldCompress) {
         size = compressed.size();
         outBuffer = const_cast<char*>(compressed.data());
@@ -901,11 +1020,17 @@ void SortedFileWriter<Key, Value>::spill() {
         size = resultLen;
     }
 
-    // negative size means compressed
-    size = shouldCompress ? -size : size;
+    BufBuilder header(sorter::kBlockHeaderSize);
+    header.appendNum(size);
+    header.appendNum(uncompressedSize);
+    header.appendUChar(static_cast<uint8_t>(shouldCompress ? _compressor
+                                                           : SorterSpillCompressor::kNone));
+    header.appendNum(sorter::blockChecksum(outBuffer, size));
+    invariant(size_t(header.len()) == sorter::kBlockHeaderSize);
+
     try {
-        _file.write(reinterpret_cast<const char*>(&size), sizeof(size));
-        _file.write(outBuffer, std::abs(size));
+        _file.write(header.buf(), header.len());
+        _file.write(outBuffer, size);
 
     } catch (const std::exception&) {
         msgasserted(16821,
@@ -913,6 +1038,12 @@ void SortedFileWriter<Key, Value>::spill() {
                                   << sorter::myErrnoWithDescription());
     }
 
+    if (_stats) {
+        _stats->blocksWritten++;
+        _stats->bytesSpilled += uncompressedSize;
+        _stats->bytesWritten += header.len() + size;
+    }
+
     _buffer.reset();
 }
 
@@ -920,7 +1051,7 @@ template <typename Key, typename Value>
 SortIteratorInterface<Key, Value>* SortedFileWriter<Key, Value>::done() {
     spill();
     _file.close();
-    return new sorter::FileIterator<Key, Value>(_fileName, _settings, _fileDeleter);
+    return new sorter::FileIterator<Key, Value>(_fileName, _settings, _fileDeleter, _stats);
 }
 
 //
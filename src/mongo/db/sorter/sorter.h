@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <deque>
 #include <fstream>
 #include <memory>
@@ -89,6 +90,32 @@ namespace sorter {
 class FileDeleter;
 }
 
+/**
+ * Block compression applied to the files the Sorter spills to. Blocks which compression would not
+ * shrink by at least 10% are stored uncompressed regardless.
+ */
+enum class SorterSpillCompressor : uint8_t { kNone = 0, kSnappy = 1, kZlib = 2 };
+
+/**
+ * Running totals of the I/O done on the spill files of a sort. Share one instance between all the
+ * files of a sort by passing it in SortOptions.
+ */
+struct SorterFileStats {
+    long long blocksWritten = 0;
+    long long bytesSpilled = 0;  /// Serialized data handed to the spill files, before compression.
+    long long bytesWritten = 0;  /// Written to disk, including block headers.
+    long long bytesRead = 0;     /// Read back from disk, including block headers.
+};
+
+/**
+ * Running totals of the pairs a sort with a limit threw away because they could not be among its
+ * results. Pass one instance in SortOptions to collect them.
+ */
+struct SorterTopKStats {
+    long long discardedOnAdd = 0;    /// Rejected by add() without being buffered.
+    long long discardedOnSpill = 0;  /// Buffered, but dropped instead of being spilled.
+};
+
 /**
  * Runtime options that control the Sorter's behavior
  */
@@ -98,8 +125,15 @@ struct SortOptions {
     bool extSortAllowed;         /// If false, uassert if more mem needed than allowed.
     std::string tempDir;         /// Directory to directly place files in.
                                  /// Must be explicitly set if extSortAllowed is true.
+    SorterSpillCompressor spillCompressor;     /// Compression of the blocks in spill files.
+    std::shared_ptr<SorterFileStats> fileStats;  /// If set, counts the I/O on spill files.
+    std::shared_ptr<SorterTopKStats> topKStats;  /// If set, counts pairs discarded by the limit.
 
-    SortOptions() : limit(0), maxMemoryUsageBytes(64 * 1024 * 1024), extSortAllowed(false) {}
+    SortOptions()
+        : limit(0),
+          maxMemoryUsageBytes(64 * 1024 * 1024),
+          extSortAllowed(false),
+          spillCompressor(SorterSpillCompressor::kSnappy) {}
 
     /// Fluent API to support expressions like SortOptions().Limit(1000).ExtSortAllowed(true)
 
@@ -122,6 +156,21 @@ struct SortOptions {
         tempDir = newTempDir;
         return *this;
     }
+
+    SortOptions& SpillCompressor(SorterSpillCompressor newSpillCompressor) {
+        spillCompressor = newSpillCompressor;
+        return *this;
+    }
+
+    SortOptions& FileStats(std::shared_ptr<SorterFileStats> newFileStats) {
+        fileStats = std::move(newFileStats);
+        return *this;
+    }
+
+    SortOptions& TopKStats(std::shared_ptr<SorterTopKStats> newTopKStats) {
+        topKStats = std::move(newTopKStats);
+        return *this;
+    }
 };
 
 /// This is the output from the sorting framework
@@ -200,6 +249,8 @@ private:
     void spill();
 
     const Settings _settings;
+    const SorterSpillCompressor _compressor;
+    const std::shared_ptr<SorterFileStats> _stats;  // May be null
     std::string _fileName;
     std::shared_ptr<sorter::FileDeleter> _fileDeleter;  // Must outlive _file
     std::ofstream _file;
@@ -279,6 +279,65 @@ public:
 };
 
 
+class SpillCompressionAndChecksumTests {
+public:
+    void run() {
+        unittest::TempDir tempDir("spillCompressionTests");
+        const int kNumItems = 100 * 1000;
+
+        for (auto compressor : {SorterSpillCompressor::kNone,
+                                SorterSpillCompressor::kSnappy,
+                                SorterSpillCompressor::kZlib}) {
+            auto stats = std::make_shared<SorterFileStats>();
+            const SortOptions opts =
+                SortOptions().TempDir(tempDir.path()).SpillCompressor(compressor).FileStats(stats);
+
+            // Runs of equal keys, so that the data is compressible.
+            std::vector<IWPair> data;
+            for (int i = 0; i < kNumItems; i++)
+                data.push_back(IWPair(i / 64, 7));
+
+            SortedFileWriter<IntWrapper, IntWrapper> sorter(opts);
+            for (const auto& pair : data)
+                sorter.addAlreadySorted(pair.first, pair.second);
+
+            std::shared_ptr<IWIterator> iter(sorter.done());
+            ASSERT_GREATER_THAN(stats->blocksWritten, 1);
+            ASSERT_EQUALS(stats->bytesSpilled, 2LL * kNumItems * sizeof(int));
+            if (compressor == SorterSpillCompressor::kNone) {
+                ASSERT_GREATER_THAN(stats->bytesWritten, stats->bytesSpilled);
+            } else {
+                ASSERT_LESS_THAN(stats->bytesWritten, stats->bytesSpilled);
+            }
+
+            std::shared_ptr<IWIterator> expected(new InMemIterator<IntWrapper, IntWrapper>(data));
+            ASSERT_ITERATORS_EQUIVALENT(iter, expected);
+            ASSERT_EQUALS(stats->bytesRead, stats->bytesWritten);
+        }
+
+        {  // a corrupted block fails its checksum
+            SortedFileWriter<IntWrapper, IntWrapper> sorter(SortOptions().TempDir(tempDir.path()));
+            for (int i = 0; i < kNumItems; i++)
+                sorter.addAlreadySorted(i, -i);
+            std::shared_ptr<IWIterator> iter(sorter.done());
+
+            boost::filesystem::directory_iterator file(tempDir.path());
+            ASSERT(file != boost::filesystem::directory_iterator());
+            {
+                std::fstream f(file->path().string().c_str(),
+                               std::ios::in | std::ios::out | std::ios::binary);
+                f.seekp(kBlockHeaderSize + 10);
+                f.put('\xff');
+            }
+
+            ASSERT_THROWS(iter->more(), MsgAssertionException);
+        }
+
+        ASSERT(boost::filesystem::is_empty(tempDir.path()));
+    }
+};
+
+
 class MergeIteratorTests {
 public:
     void run() {
@@ -549,6 +608,62 @@ class LotsOfDataWithLimit : public LotsOfDataLittleMemory<Random> {
     }
     enum { MEM_LIMIT = 32 * 1024 };
 };
+
+class TopKDiscards {
+public:
+    void run() {
+        unittest::TempDir tempDir("topKDiscardsTests");
+        const int kNumItems = 100 * 1000;
+
+        std::vector<int> values;
+        for (int i = 0; i < kNumItems; i++)
+            values.push_back(i);
+        std::random_shuffle(values.begin(), values.end());
+
+        {  // the limit fits in memory: every pair past the limit displaces or is displaced
+            auto stats = std::make_shared<SorterTopKStats>();
+            std::shared_ptr<IWSorter> sorter(
+                IWSorter::make(SortOptions().Limit(100).TopKStats(stats), IWComparator(ASC)));
+            for (int value : values)
+                sorter->add(value, -value);
+
+            ASSERT_ITERATORS_EQUIVALENT(
+                std::shared_ptr<IWIterator>(sorter->done()),
+                make_shared<LimitIterator>(100, make_shared<IntIterator>(0, kNumItems)));
+            ASSERT_EQUALS(stats->discardedOnAdd, kNumItems - 100);
+            ASSERT_EQUALS(stats->discardedOnSpill, 0);
+        }
+
+        {  // the limit spills: the cutoff rejects pairs on add() and trims the spilled runs
+            auto stats = std::make_shared<SorterTopKStats>();
+            auto fileStats = std::make_shared<SorterFileStats>();
+            const SortOptions opts = SortOptions()
+                                         .TempDir(tempDir.path())
+                                         .MaxMemoryUsageBytes(32 * 1024)
+                                         .ExtSortAllowed()
+                                         .Limit(5000)
+                                         .TopKStats(stats)
+                                         .FileStats(fileStats);
+            std::shared_ptr<IWSorter> sorter(IWSorter::make(opts, IWComparator(ASC)));
+            for (int value : values)
+                sorter->add(value, -value);
+
+            ASSERT_ITERATORS_EQUIVALENT(
+                std::shared_ptr<IWIterator>(sorter->done()),
+                make_shared<LimitIterator>(5000, make_shared<IntIterator>(0, kNumItems)));
+            ASSERT_GREATER_THAN(stats->discardedOnAdd, 0);
+            ASSERT_GREATER_THAN(stats->discardedOnSpill, 0);
+
+            // Only the pairs that were neither rejected nor trimmed were written out.
+            const long long numSpilled =
+                kNumItems - stats->discardedOnAdd - stats->discardedOnSpill;
+            ASSERT_EQUALS(fileStats->bytesSpilled,
+                          numSpilled * static_cast<long long>(2 * sizeof(int)));
+        }
+
+        ASSERT(boost::filesystem::is_empty(tempDir.path()));
+    }
+};
 }
 
 class SorterSuite : public mongo::unittest::Suite {
@@ -558,6 +673,7 @@ public:
     void setupTests() {
         add<InMemIterTests>();
         add<SortedFileWriterAndFileIteratorTests>();
+        add<SpillCompressionAndChecksumTests>();
         add<MergeIteratorTests>();
         add<SorterTests::Basic>();
         add<SorterTests::Limit>();
@@ -570,6 +686,7 @@ public:
         add<SorterTests::LotsOfDataWithLimit<100, /*random=*/true>>();    // fits in mem
         add<SorterTests::LotsOfDataWithLimit<5000, /*random=*/false>>();  // spills
         add<SorterTests::LotsOfDataWithLimit<5000, /*random=*/true>>();   // spills
+        add<SorterTests::TopKDiscards>();
     }
 };
 
@@ -0,0 +1,75 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/service_context.h"
+#include "mongo/db/stats/top.h"
+
+namespace mongo {
+
+/**
+ * Server status section for the latencies of the operations run by clients.
+ *
+ * Sample format:
+ *
+ * opLatencies: {
+ *   reads: {latency: 1000, ops: 10, percentiles: {p50: 64, p99: 255, p999: 255}},
+ *   writes: {...},
+ *   commands: {...},
+ *   commandTypes: {find: {latency: 800, ops: 8, percentiles: {...}}, ...}
+ * }
+ *
+ * The bucket counts of each histogram are included with 'opLatencies: {histograms: true}'. They
+ * are left out by default, since the number of non-empty buckets changes with nearly every sample.
+ * The section still changes shape whenever a command runs for the first time and gains an entry
+ * in 'commandTypes'.
+ */
+class OpLatenciesServerStatusSection : public ServerStatusSection {
+public:
+    OpLatenciesServerStatusSection() : ServerStatusSection("opLatencies") {}
+
+    bool includeByDefault() const {
+        return true;
+    }
+
+    BSONObj generateSection(OperationContext* txn, const BSONElement& configElement) const {
+        bool includeHistograms = false;
+        if (configElement.type() == Object) {
+            includeHistograms = configElement.Obj()["histograms"].trueValue();
+        }
+
+        BSONObjBuilder builder;
+        Top::get(txn->getServiceContext()).appendGlobalLatencyStats(&builder, includeHistograms);
+        return builder.obj();
+    }
+
+} opLatenciesServerStatusSection;
+}  // namespace mongo
@@ -31,9 +31,12 @@
 #include "mongo/db/stats/operation_latency_histogram.h"
 
 #include <algorithm>
+#include <cmath>
+#include <utility>
 
 #include "mongo/bson/bsonobjbuilder.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/platform/bits.h"
 
 namespace mongo {
@@ -91,35 +94,203 @@ const std::array<uint64_t, OperationLatencyHistogram::kMaxBuckets>
                                                549755813888,
                                                1099511627776};
 
-void OperationLatencyHistogram::_append(const HistogramData& data,
-                                        const char* key,
-                                        BSONObjBuilder* builder) const {
+int operationLatencyHistogramPrecisionBits = 3;
 
-    BSONObjBuilder histogramBuilder(builder->subobjStart(key));
-    BSONArrayBuilder arrayBuilder(histogramBuilder.subarrayStart("histogram"));
-    for (int i = 0; i < kMaxBuckets; i++) {
-        if (data.buckets[i] == 0)
+namespace {
+
+class ExportedPrecisionBitsParameter
+    : public ExportedServerParameter<int, ServerParameterType::kStartupOnly> {
+public:
+    ExportedPrecisionBitsParameter()
+        : ExportedServerParameter<int, ServerParameterType::kStartupOnly>(
+              ServerParameterSet::getGlobal(),
+              "operationLatencyHistogramPrecisionBits",
+              &operationLatencyHistogramPrecisionBits) {}
+
+    virtual Status validate(const int& potentialNewValue) {
+        if (potentialNewValue < LatencyHistogram::kMinPrecisionBits ||
+            potentialNewValue > LatencyHistogram::kMaxPrecisionBits) {
+            return Status(ErrorCodes::BadValue,
+                          "operationLatencyHistogramPrecisionBits must be between 1 and 5");
+        }
+
+        return Status::OK();
+    }
+
+} exportedPrecisionBitsParam;
+
+// Percentiles reported for every histogram, with the names they are reported under.
+const std::array<std::pair<double, const char*>, 3> kReportedPercentiles = {
+    {{50.0, "p50"}, {99.0, "p99"}, {99.9, "p999"}}};
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram() : LatencyHistogram(operationLatencyHistogramPrecisionBits) {}
+
+LatencyHistogram::LatencyHistogram(int precisionBits) : _precisionBits(precisionBits) {
+    invariant(precisionBits >= kMinPrecisionBits && precisionBits <= kMaxPrecisionBits);
+    _groupSlots.fill(-1);
+}
+
+int LatencyHistogram::_getBucket(uint64_t latency) const {
+    const uint64_t subBuckets = 1ULL << _precisionBits;
+    if (latency < subBuckets) {
+        return static_cast<int>(latency);
+    }
+
+    const int log2 = 63 - countLeadingZeros64(latency);
+    if (log2 > kMaxLatencyLog2) {
+        return static_cast<int>((kMaxLatencyLog2 - _precisionBits + 2) * subBuckets - 1);
+    }
+
+    // The top '_precisionBits' bits below the leading one select the bucket within the range
+    // [2^log2, 2^(log2 + 1)).
+    const uint64_t subBucket = (latency >> (log2 - _precisionBits)) - subBuckets;
+    return static_cast<int>((log2 - _precisionBits + 1) * subBuckets + subBucket);
+}
+
+uint64_t LatencyHistogram::_getBucketMaxLatency(int bucket) const {
+    const uint64_t subBuckets = 1ULL << _precisionBits;
+    if (static_cast<uint64_t>(bucket) < subBuckets) {
+        return bucket;
+    }
+
+    const int shift = bucket / subBuckets - 1;
+    const uint64_t lowerBound = (subBuckets + bucket % subBuckets) << shift;
+    return lowerBound + (1ULL << shift) - 1;
+}
+
+const uint64_t* LatencyHistogram::_getGroup(int group) const {
+    const int slot = _groupSlots[group];
+    return slot < 0 ? nullptr : &_buckets[static_cast<size_t>(slot) << _precisionBits];
+}
+
+uint64_t* LatencyHistogram::_getOrAllocateGroup(int group) {
+    const size_t subBuckets = 1ULL << _precisionBits;
+    if (_groupSlots[group] < 0) {
+        _groupSlots[group] = static_cast<int8_t>(_buckets.size() / subBuckets);
+        // Grow by exactly one group, rather than letting the vector double its capacity.
+        _buckets.reserve(_buckets.size() + subBuckets);
+        _buckets.resize(_buckets.size() + subBuckets);
+    }
+    return &_buckets[static_cast<size_t>(_groupSlots[group]) << _precisionBits];
+}
+
+void LatencyHistogram::increment(uint64_t latency) {
+    const int bucket = _getBucket(latency);
+    _getOrAllocateGroup(bucket >> _precisionBits)[bucket & ((1 << _precisionBits) - 1)]++;
+    _count++;
+    _sum += latency;
+    _max = std::max(_max, latency);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    invariant(_precisionBits == other._precisionBits);
+    const int subBuckets = 1 << _precisionBits;
+    for (int group = 0; group < _getNumGroups(); group++) {
+        const uint64_t* otherCounts = other._getGroup(group);
+        if (!otherCounts) {
             continue;
-        BSONObjBuilder entryBuilder(arrayBuilder.subobjStart());
-        entryBuilder.append("micros", static_cast<long long>(kLowerBounds[i]));
-        entryBuilder.append("count", static_cast<long long>(data.buckets[i]));
-        entryBuilder.doneFast();
+        }
+        uint64_t* counts = _getOrAllocateGroup(group);
+        for (int i = 0; i < subBuckets; i++) {
+            counts[i] += otherCounts[i];
+        }
+    }
+    _count += other._count;
+    _sum += other._sum;
+    _max = std::max(_max, other._max);
+}
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const {
+    if (_count == 0) {
+        return 0;
     }
 
-    arrayBuilder.doneFast();
-    histogramBuilder.append("latency", static_cast<long long>(data.sum));
-    histogramBuilder.append("ops", static_cast<long long>(data.entryCount));
-    histogramBuilder.doneFast();
+    const uint64_t rank = std::max(
+        uint64_t(1), static_cast<uint64_t>(std::ceil(_count * std::min(percentile, 100.0) / 100)));
+    const int subBuckets = 1 << _precisionBits;
+    uint64_t seen = 0;
+    for (int group = 0; group < _getNumGroups(); group++) {
+        const uint64_t* counts = _getGroup(group);
+        if (!counts) {
+            continue;
+        }
+        for (int i = 0; i < subBuckets; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(_getBucketMaxLatency((group << _precisionBits) + i), _max);
+            }
+        }
+    }
+    return _max;
 }
 
-void OperationLatencyHistogram::append(BSONObjBuilder* builder) const {
-    _append(_reads, "reads", builder);
-    _append(_writes, "writes", builder);
-    _append(_commands, "commands", builder);
+void LatencyHistogram::append(bool includeHistogram, BSONObjBuilder* builder) const {
+    if (includeHistogram) {
+        std::array<uint64_t, OperationLatencyHistogram::kMaxBuckets> reportedBuckets{};
+        const int subBuckets = 1 << _precisionBits;
+        for (int group = 0; group < _getNumGroups(); group++) {
+            const uint64_t* counts = _getGroup(group);
+            if (!counts) {
+                continue;
+            }
+            for (int i = 0; i < subBuckets; i++) {
+                if (counts[i] != 0) {
+                    reportedBuckets[OperationLatencyHistogram::getReportedBucket(
+                        _getBucketMaxLatency((group << _precisionBits) + i))] += counts[i];
+                }
+            }
+        }
+
+        BSONArrayBuilder arrayBuilder(builder->subarrayStart("histogram"));
+        for (int i = 0; i < OperationLatencyHistogram::kMaxBuckets; i++) {
+            if (reportedBuckets[i] == 0)
+                continue;
+            BSONObjBuilder entryBuilder(arrayBuilder.subobjStart());
+            entryBuilder.append("micros",
+                                static_cast<long long>(OperationLatencyHistogram::kLowerBounds[i]));
+            entryBuilder.append("count", static_cast<long long>(reportedBuckets[i]));
+            entryBuilder.doneFast();
+        }
+        arrayBuilder.doneFast();
+    }
+
+    builder->append("latency", static_cast<long long>(_sum));
+    builder->append("ops", static_cast<long long>(_count));
+
+    BSONObjBuilder percentilesBuilder(builder->subobjStart("percentiles"));
+    for (auto&& percentile : kReportedPercentiles) {
+        percentilesBuilder.append(percentile.second,
+                                  static_cast<long long>(getPercentile(percentile.first)));
+    }
+    percentilesBuilder.doneFast();
+}
+
+OperationLatencyHistogram::OperationLatencyHistogram()
+    : OperationLatencyHistogram(operationLatencyHistogramPrecisionBits) {}
+
+OperationLatencyHistogram::OperationLatencyHistogram(int precisionBits)
+    : _reads(precisionBits), _writes(precisionBits), _commands(precisionBits) {}
+
+void OperationLatencyHistogram::append(BSONObjBuilder* builder, bool includeHistograms) const {
+    for (auto&& pair : {std::make_pair(&_reads, "reads"),
+                        std::make_pair(&_writes, "writes"),
+                        std::make_pair(&_commands, "commands")}) {
+        BSONObjBuilder histogramBuilder(builder->subobjStart(pair.second));
+        pair.first->append(includeHistograms, &histogramBuilder);
+        histogramBuilder.doneFast();
+    }
+}
+
+void OperationLatencyHistogram::merge(const OperationLatencyHistogram& other) {
+    _reads.merge(other._reads);
+    _writes.merge(other._writes);
+    _commands.merge(other._commands);
 }
 
 // Computes the log base 2 of value, and checks for cases of split buckets.
-int OperationLatencyHistogram::_getBucket(uint64_t value) {
+int OperationLatencyHistogram::getReportedBucket(uint64_t value) {
     // Zero is a special case since log(0) is undefined.
     if (value == 0) {
         return 0;
@@ -145,23 +316,16 @@ int OperationLatencyHistogram::_getBucket(uint64_t value) {
     }
 }
 
-void OperationLatencyHistogram::_incrementData(uint64_t latency, int bucket, HistogramData* data) {
-    data->buckets[bucket]++;
-    data->entryCount++;
-    data->sum += latency;
-}
-
 void OperationLatencyHistogram::increment(uint64_t latency, Command::ReadWriteType type) {
-    int bucket = _getBucket(latency);
     switch (type) {
         case Command::ReadWriteType::kRead:
-            _incrementData(latency, bucket, &_reads);
+            _reads.increment(latency);
             break;
         case Command::ReadWriteType::kWrite:
-            _incrementData(latency, bucket, &_writes);
+            _writes.increment(latency);
             break;
         case Command::ReadWriteType::kCommand:
-            _incrementData(latency, bucket, &_commands);
+            _commands.increment(latency);
             break;
         default:
             MONGO_UNREACHABLE;
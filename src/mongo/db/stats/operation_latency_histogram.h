@@ -28,6 +28,7 @@
 #pragma once
 
 #include <array>
+#include <vector>
 
 #include "mongo/db/commands.h"
 
@@ -35,6 +36,100 @@ namespace mongo {
 
 class BSONObjBuilder;
 
+/**
+ * Precision of newly created latency histograms, as the number of bits of each latency which are
+ * kept. Settable at startup only, since histograms of different precisions cannot be merged.
+ */
+extern int operationLatencyHistogramPrecisionBits;
+
+/**
+ * Stores a log-linear histogram of latencies in microseconds. Latencies below 2^precisionBits get
+ * a bucket each. Above that, the range between each two consecutive powers of two is split into
+ * 2^precisionBits equal buckets, so that a bucket is never wider than 1/2^precisionBits of the
+ * latencies it holds. Percentiles are therefore accurate to within that fraction, however large
+ * the latencies are.
+ *
+ * The buckets are stored in groups of 2^precisionBits, one group per power of two. A group is only
+ * allocated once a latency falls into it, so a histogram only pays for the range of latencies it
+ * has actually seen.
+ *
+ * Note: This class is not thread-safe.
+ */
+class LatencyHistogram {
+public:
+    static const int kMinPrecisionBits = 1;
+    static const int kMaxPrecisionBits = 5;
+
+    // Latencies of 2^(kMaxLatencyLog2 + 1) microseconds or more are counted in the last bucket.
+    static const int kMaxLatencyLog2 = 40;
+
+    /**
+     * Creates a histogram with a precision of operationLatencyHistogramPrecisionBits.
+     */
+    LatencyHistogram();
+    explicit LatencyHistogram(int precisionBits);
+
+    void increment(uint64_t latency);
+
+    /**
+     * Adds the counts of 'other', which must have the same precision, to this histogram.
+     */
+    void merge(const LatencyHistogram& other);
+
+    uint64_t getCount() const {
+        return _count;
+    }
+
+    uint64_t getSum() const {
+        return _sum;
+    }
+
+    /**
+     * Returns the smallest recorded latency such that 'percentile' percent of the recorded
+     * latencies are at most that large, up to the precision of the histogram, or 0 if the
+     * histogram is empty. The result never exceeds the largest recorded latency.
+     */
+    uint64_t getPercentile(double percentile) const;
+
+    /**
+     * Appends the total latency, the operation count and the p50, p99 and p99.9 latencies. If
+     * 'includeHistogram' is true, also appends the counts of the non-empty buckets of the
+     * OperationLatencyHistogram::kLowerBounds scale.
+     */
+    void append(bool includeHistogram, BSONObjBuilder* builder) const;
+
+private:
+    // Upper bound on the number of groups of buckets: one for the latencies below
+    // 2^precisionBits, then one per power of two up to 2^kMaxLatencyLog2.
+    static const int kMaxGroups = kMaxLatencyLog2 - kMinPrecisionBits + 2;
+
+    int _getBucket(uint64_t latency) const;
+
+    // Returns the largest latency counted in 'bucket'.
+    uint64_t _getBucketMaxLatency(int bucket) const;
+
+    int _getNumGroups() const {
+        return kMaxLatencyLog2 - _precisionBits + 2;
+    }
+
+    // Returns the counts of the buckets of 'group', or nullptr if it has not been allocated.
+    const uint64_t* _getGroup(int group) const;
+
+    // Returns the counts of the buckets of 'group', allocating them if needed.
+    uint64_t* _getOrAllocateGroup(int group);
+
+    int _precisionBits;
+
+    // The allocated groups of buckets, in the order they were first needed.
+    std::vector<uint64_t> _buckets;
+
+    // For each group, its index within '_buckets' in units of groups, or -1 if not allocated.
+    std::array<int8_t, kMaxGroups> _groupSlots;
+    uint64_t _count = 0;
+    uint64_t _sum = 0;
+    uint64_t _max = 0;
+};
+
 /**
  * Stores statistics for latencies of read, write, and command operations.
  *
@@ -44,34 +139,35 @@ class OperationLatencyHistogram {
 public:
     static const int kMaxBuckets = 51;
 
-    // Inclusive lower bounds of the histogram buckets.
+    // Inclusive lower bounds of the buckets in which histograms are reported. Each bucket of a
+    // LatencyHistogram falls within one of these.
     static const std::array<uint64_t, kMaxBuckets> kLowerBounds;
 
+    OperationLatencyHistogram();
+    explicit OperationLatencyHistogram(int precisionBits);
+
     /**
      * Increments the bucket of the histogram based on the operation type.
      */
     void increment(uint64_t latency, Command::ReadWriteType type);
 
     /**
-     * Appends the three histograms with latency totals and operation counts.
+     * Adds the counts of 'other' to this histogram.
      */
-    void append(BSONObjBuilder* builder) const;
-
-private:
-    struct HistogramData {
-        std::array<uint64_t, kMaxBuckets> buckets{};
-        uint64_t entryCount = 0;
-        uint64_t sum = 0;
-    };
-
-    static int _getBucket(uint64_t latency);
-
-    static uint64_t _getBucketMicros(int bucket);
+    void merge(const OperationLatencyHistogram& other);
 
-    void _append(const HistogramData& data, const char* key, BSONObjBuilder* builder) const;
+    /**
+     * Appends the three histograms with latency totals, operation counts and percentiles. The
+     * bucket counts are only appended if 'includeHistograms' is true.
+     */
+    void append(BSONObjBuilder* builder, bool includeHistograms = true) const;
 
-    void _incrementData(uint64_t latency, int bucket, HistogramData* data);
+    /**
+     * Returns the index of the kLowerBounds bucket which 'latency' falls into.
+     */
+    static int getReportedBucket(uint64_t latency);
 
-    HistogramData _reads, _writes, _commands;
+private:
+    LatencyHistogram _reads, _writes, _commands;
 };
 }  // namespace mongo
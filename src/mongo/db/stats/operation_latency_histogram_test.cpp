@@ -89,4 +89,121 @@ TEST(OperationLatencyHistogram, CheckBucketCountsAndTotalLatency) {
         ASSERT_EQUALS(bucket["count"].Long(), (i < kMaxBuckets - 1) ? 3 : 2);
     }
 }
+
+TEST(OperationLatencyHistogram, MergeAddsCountsAndLatencies) {
+    OperationLatencyHistogram first, second, both;
+    for (int i = 0; i < kMaxBuckets; i++) {
+        first.increment(kLowerBounds[i], Command::ReadWriteType::kRead);
+        both.increment(kLowerBounds[i], Command::ReadWriteType::kRead);
+        if (i % 2 == 0) {
+            second.increment(kLowerBounds[i], Command::ReadWriteType::kWrite);
+            both.increment(kLowerBounds[i], Command::ReadWriteType::kWrite);
+        }
+        second.increment(kLowerBounds[i], Command::ReadWriteType::kRead);
+        both.increment(kLowerBounds[i], Command::ReadWriteType::kRead);
+    }
+    first.merge(second);
+
+    BSONObjBuilder mergedBuilder, bothBuilder;
+    first.append(&mergedBuilder);
+    both.append(&bothBuilder);
+    ASSERT_EQUALS(mergedBuilder.obj(), bothBuilder.obj());
+}
+
+TEST(OperationLatencyHistogram, ReportedBucketsDoNotDependOnPrecision) {
+    BSONObj expected;
+    for (int bits = LatencyHistogram::kMinPrecisionBits;
+         bits <= LatencyHistogram::kMaxPrecisionBits;
+         bits++) {
+        OperationLatencyHistogram hist(bits);
+        for (int i = 0; i < kMaxBuckets; i++) {
+            hist.increment(kLowerBounds[i], Command::ReadWriteType::kWrite);
+            hist.increment(kLowerBounds[i] + 1, Command::ReadWriteType::kWrite);
+            if (i > 0) {
+                hist.increment(kLowerBounds[i] - 1, Command::ReadWriteType::kWrite);
+            }
+        }
+        hist.increment(1ULL << 50, Command::ReadWriteType::kWrite);
+
+        BSONObjBuilder outBuilder;
+        hist.append(&outBuilder);
+        BSONObj histogram = outBuilder.obj()["writes"]["histogram"].wrap();
+        if (expected.isEmpty()) {
+            expected = histogram.getOwned();
+        }
+        ASSERT_EQUALS(histogram, expected);
+    }
+}
+
+TEST(LatencyHistogram, PercentilesAreWithinPrecision) {
+    for (int bits = LatencyHistogram::kMinPrecisionBits;
+         bits <= LatencyHistogram::kMaxPrecisionBits;
+         bits++) {
+        LatencyHistogram hist(bits);
+        const uint64_t kMaxLatency = 100000;
+        for (uint64_t latency = 1; latency <= kMaxLatency; latency++) {
+            hist.increment(latency);
+        }
+
+        for (double percentile : {1.0, 50.0, 90.0, 99.0, 99.9}) {
+            const uint64_t exact = static_cast<uint64_t>(kMaxLatency * percentile / 100);
+            const uint64_t reported = hist.getPercentile(percentile);
+            ASSERT_GTE(reported, exact);
+            ASSERT_LTE(reported, exact + (exact >> bits));
+        }
+        ASSERT_EQUALS(hist.getPercentile(100), kMaxLatency);
+    }
+}
+
+TEST(LatencyHistogram, MergeOfHistogramsWithGroupsAllocatedInDifferentOrders) {
+    LatencyHistogram first(3), second(3);
+    first.increment(1000000);
+    first.increment(5);
+    second.increment(5);
+    second.increment(300);
+    second.increment(5);
+    first.merge(second);
+
+    ASSERT_EQUALS(first.getCount(), 5ULL);
+    ASSERT_EQUALS(first.getPercentile(60), 5ULL);
+    ASSERT_EQUALS(first.getPercentile(80), 319ULL);
+    ASSERT_EQUALS(first.getPercentile(100), 1000000ULL);
+
+    BSONObjBuilder outBuilder;
+    first.append(true, &outBuilder);
+    ASSERT_EQUALS(outBuilder.obj()["histogram"].wrap(),
+                  BSON("histogram" << BSON_ARRAY(BSON("micros" << 4LL << "count" << 3LL)
+                                                 << BSON("micros" << 256LL << "count" << 1LL)
+                                                 << BSON("micros" << 786432LL << "count" << 1LL))));
+}
+
+TEST(LatencyHistogram, PercentilesOfEmptyAndSingleValueHistograms) {
+    LatencyHistogram hist(3);
+    ASSERT_EQUALS(hist.getPercentile(50), 0ULL);
+
+    hist.increment(12345);
+    ASSERT_EQUALS(hist.getPercentile(0), 12345ULL);
+    ASSERT_EQUALS(hist.getPercentile(99.9), 12345ULL);
+
+    // Latencies beyond the range of the buckets are still reported as the largest one seen.
+    hist.increment(1ULL << 60);
+    ASSERT_EQUALS(hist.getPercentile(100), 1ULL << 60);
+}
+
+TEST(LatencyHistogram, AppendReportsPercentiles) {
+    LatencyHistogram hist(3);
+    for (int i = 0; i < 999; i++) {
+        hist.increment(10);
+    }
+    hist.increment(100000);
+
+    BSONObjBuilder outBuilder;
+    hist.append(false, &outBuilder);
+    BSONObj out = outBuilder.obj();
+    ASSERT_FALSE(out.hasField("histogram"));
+    ASSERT_EQUALS(out["ops"].Long(), 1000);
+    ASSERT_EQUALS(out["percentiles"]["p50"].Long(), 10);
+    ASSERT_EQUALS(out["percentiles"]["p99"].Long(), 10);
+    ASSERT_EQUALS(out["percentiles"]["p999"].Long(), 10);
+}
 }  // namespace mongo
@@ -33,9 +33,13 @@
 
 #include "mongo/db/stats/top.h"
 
-#include "mongo/db/commands/server_status_metric.h"
+#include <algorithm>
+#include <boost/optional.hpp>
+
 #include "mongo/db/jsobj.h"
 #include "mongo/db/service_context.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
@@ -49,6 +53,12 @@ namespace {
 
 const auto getTop = ServiceContext::declareDecoration<Top>();
 
+// Hands out Top shards to threads in round-robin order.
+AtomicUInt32 nextThreadShard;
+
+// One more than the shard index assigned to this thread, or 0 if none has been assigned yet.
+MONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL uint32_t threadShard;
+
 }  // namespace
 
 Top::UsageData::UsageData(const UsageData& older, const UsageData& newer) {
@@ -68,6 +78,19 @@ Top::CollectionData::CollectionData(const CollectionData& older, const Collectio
       remove(older.remove, newer.remove),
       commands(older.commands, newer.commands) {}
 
+void Top::CollectionData::add(const CollectionData& other) {
+    total.add(other.total);
+    readLock.add(other.readLock);
+    writeLock.add(other.writeLock);
+    queries.add(other.queries);
+    getmore.add(other.getmore);
+    insert.add(other.insert);
+    update.add(other.update);
+    remove.add(other.remove);
+    commands.add(other.commands);
+    opLatencyHistogram.merge(other.opLatencyHistogram);
+}
+
 // static
 Top& Top::get(ServiceContext* service) {
     return getTop(service);
@@ -86,14 +109,15 @@ void Top::record(OperationContext* txn,
     auto hashedNs = UsageMap::HashedKey(ns);
 
     // cout << "record: " << ns << "\t" << op << "\t" << command << endl;
-    stdx::lock_guard<SimpleMutex> lk(_lock);
+    Shard& shard = _getShardForThread();
+    stdx::lock_guard<SimpleMutex> lk(shard.lock);
 
-    if ((command || logicalOp == LogicalOp::opQuery) && ns == _lastDropped) {
-        _lastDropped = "";
+    if ((command || logicalOp == LogicalOp::opQuery) && ns == shard.lastDropped) {
+        shard.lastDropped = "";
         return;
     }
 
-    CollectionData& coll = _usage[hashedNs];
+    CollectionData& coll = shard.usage[hashedNs];
     _record(txn, coll, logicalOp, lockType, micros, readWriteType);
 }
 
@@ -143,19 +167,47 @@ void Top::_record(OperationContext* txn,
 }
 
 void Top::collectionDropped(StringData ns) {
-    stdx::lock_guard<SimpleMutex> lk(_lock);
-    _usage.erase(ns);
-    _lastDropped = ns.toString();
+    Shard& droppingShard = _getShardForThread();
+    for (auto&& shard : _shards) {
+        stdx::lock_guard<SimpleMutex> lk(shard.lock);
+        shard.usage.erase(ns);
+    }
+
+    // The drop is recorded afterwards by the same thread, and therefore into the same shard.
+    stdx::lock_guard<SimpleMutex> lk(droppingShard.lock);
+    droppingShard.lastDropped = ns.toString();
 }
 
 void Top::cloneMap(Top::UsageMap& out) const {
-    stdx::lock_guard<SimpleMutex> lk(_lock);
-    out = _usage;
+    out = _mergeUsage();
 }
 
 void Top::append(BSONObjBuilder& b) {
-    stdx::lock_guard<SimpleMutex> lk(_lock);
-    _appendToUsageMap(b, _usage);
+    _appendToUsageMap(b, _mergeUsage());
+}
+
+Top::Shard& Top::_getShardForThread() {
+    if (!threadShard) {
+        threadShard = nextThreadShard.fetchAndAdd(1) % kNumShards + 1;
+    }
+    return _shards[threadShard - 1];
+}
+
+Top::UsageMap Top::_mergeUsage() const {
+    UsageMap merged;
+    for (auto&& shard : _shards) {
+        stdx::lock_guard<SimpleMutex> lk(shard.lock);
+        for (auto&& entry : shard.usage) {
+            // Copy the first entry for a namespace rather than adding it to a default-constructed
+            // one, so that the merged histograms keep the precision the entries were created with.
+            if (merged.find(entry.first) == merged.end()) {
+                merged[entry.first] = entry.second;
+            } else {
+                merged[entry.first].add(entry.second);
+            }
+        }
+    }
+    return merged;
 }
 
 void Top::_appendToUsageMap(BSONObjBuilder& b, const UsageMap& map) const {
@@ -198,23 +250,76 @@ void Top::_appendStatsEntry(BSONObjBuilder& b, const char* statsName, const Usag
 
 void Top::appendLatencyStats(StringData ns, BSONObjBuilder* builder) {
     auto hashedNs = UsageMap::HashedKey(ns);
-    stdx::lock_guard<SimpleMutex> lk(_lock);
+    boost::optional<OperationLatencyHistogram> histogram;
+    for (auto&& shard : _shards) {
+        stdx::lock_guard<SimpleMutex> lk(shard.lock);
+        auto it = shard.usage.find(hashedNs);
+        if (it == shard.usage.end()) {
+            continue;
+        }
+        if (histogram) {
+            histogram->merge(it->second.opLatencyHistogram);
+        } else {
+            histogram = it->second.opLatencyHistogram;
+        }
+    }
+
     BSONObjBuilder latencyStatsBuilder;
-    _usage[hashedNs].opLatencyHistogram.append(&latencyStatsBuilder);
+    (histogram ? *histogram : OperationLatencyHistogram()).append(&latencyStatsBuilder);
     builder->append("ns", ns);
     builder->append("latencyStats", latencyStatsBuilder.obj());
 }
 
 void Top::incrementGlobalLatencyStats(OperationContext* txn,
                                       uint64_t latency,
-                                      Command::ReadWriteType readWriteType) {
-    stdx::lock_guard<SimpleMutex> guard(_lock);
-    _incrementHistogram(txn, latency, &_globalHistogramStats, readWriteType);
+                                      Command::ReadWriteType readWriteType,
+                                      StringData commandName) {
+    Shard& shard = _getShardForThread();
+    stdx::lock_guard<SimpleMutex> guard(shard.lock);
+    _incrementHistogram(txn, latency, &shard.globalHistogramStats, readWriteType);
+
+    Client* client = txn->getClient();
+    if (!commandName.empty() && client->isFromUserConnection() && !client->isInDirectClient()) {
+        shard.commandHistograms[commandName].increment(latency);
+    }
 }
 
-void Top::appendGlobalLatencyStats(BSONObjBuilder* builder) {
-    stdx::lock_guard<SimpleMutex> guard(_lock);
-    _globalHistogramStats.append(builder);
+void Top::appendGlobalLatencyStats(BSONObjBuilder* builder, bool includeHistograms) {
+    // Merge into copies of the first histograms found, so that the merged histograms keep the
+    // precision the recorded ones were created with.
+    boost::optional<OperationLatencyHistogram> histogram;
+    StringMap<LatencyHistogram> commandHistograms;
+    for (auto&& shard : _shards) {
+        stdx::lock_guard<SimpleMutex> guard(shard.lock);
+        if (histogram) {
+            histogram->merge(shard.globalHistogramStats);
+        } else {
+            histogram = shard.globalHistogramStats;
+        }
+
+        for (auto&& entry : shard.commandHistograms) {
+            if (commandHistograms.find(entry.first) == commandHistograms.end()) {
+                commandHistograms[entry.first] = entry.second;
+            } else {
+                commandHistograms[entry.first].merge(entry.second);
+            }
+        }
+    }
+    histogram->append(builder, includeHistograms);
+
+    std::vector<std::string> names;
+    for (auto&& entry : commandHistograms) {
+        names.push_back(entry.first);
+    }
+    std::sort(names.begin(), names.end());
+
+    BSONObjBuilder commandsBuilder(builder->subobjStart("commandTypes"));
+    for (auto&& name : names) {
+        BSONObjBuilder commandBuilder(commandsBuilder.subobjStart(name));
+        commandHistograms.find(name)->second.append(includeHistograms, &commandBuilder);
+        commandBuilder.doneFast();
+    }
+    commandsBuilder.doneFast();
 }
 
 void Top::_incrementHistogram(OperationContext* txn,
@@ -228,16 +333,4 @@ void Top::_incrementHistogram(OperationContext* txn,
     }
 }
 
-/**
- * Appends the global histogram to the server status.
- */
-class GlobalHistogramServerStatusMetric : public ServerStatusMetric {
-public:
-    GlobalHistogramServerStatusMetric() : ServerStatusMetric(".metrics.latency") {}
-    virtual void appendAtLeaf(BSONObjBuilder& builder) const {
-        BSONObjBuilder latencyBuilder;
-        Top::get(getGlobalServiceContext()).appendGlobalLatencyStats(&latencyBuilder);
-        builder.append("latency", latencyBuilder.obj());
-    }
-} globalHistogramServerStatusMetric;
 }  // namespace mongo
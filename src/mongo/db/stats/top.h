@@ -29,6 +29,7 @@
 
 #pragma once
 
+#include <array>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include "mongo/db/commands.h"
@@ -44,6 +45,11 @@ class ServiceContext;
 
 /**
  * tracks usage by collection
+ *
+ * Operations are recorded into one of a fixed number of shards, each with its own mutex, usage
+ * map and global latency histogram. A thread always records into the same shard, so recording an
+ * operation only contends with the few other threads assigned to that shard. The shards are
+ * merged whenever the statistics are read.
  */
 class Top {
 public:
@@ -61,6 +67,11 @@ public:
             count++;
             time += micros;
         }
+
+        void add(const UsageData& other) {
+            count += other.count;
+            time += other.time;
+        }
     };
 
     struct CollectionData {
@@ -70,6 +81,11 @@ public:
         CollectionData() {}
         CollectionData(const CollectionData& older, const CollectionData& newer);
 
+        /**
+         * Adds the counters and latency histogram of 'other' to this.
+         */
+        void add(const CollectionData& other);
+
         UsageData total;
 
         UsageData readLock;
@@ -107,18 +123,42 @@ public:
     void appendLatencyStats(StringData ns, BSONObjBuilder* builder);
 
     /**
-     * Increments the global histogram.
+     * Increments the global histogram, and the histogram of 'commandName' unless it is empty.
      */
     void incrementGlobalLatencyStats(OperationContext* txn,
                                      uint64_t latency,
-                                     Command::ReadWriteType readWriteType);
+                                     Command::ReadWriteType readWriteType,
+                                     StringData commandName = StringData());
 
     /**
-     * Appends the global latency statistics.
+     * Appends the global latency statistics, followed by a "commandTypes" subobject with the
+     * latency statistics of each command which has run. The bucket counts are only appended if
+     * 'includeHistograms' is true.
      */
-    void appendGlobalLatencyStats(BSONObjBuilder* builder);
+    void appendGlobalLatencyStats(BSONObjBuilder* builder, bool includeHistograms = true);
 
 private:
+    static const size_t kNumShards = 16;
+
+    struct Shard {
+        // Protects all of the members below.
+        mutable SimpleMutex lock;
+        OperationLatencyHistogram globalHistogramStats;
+        StringMap<LatencyHistogram> commandHistograms;
+        UsageMap usage;
+        std::string lastDropped;
+    };
+
+    /**
+     * Returns the shard the calling thread records its operations into.
+     */
+    Shard& _getShardForThread();
+
+    /**
+     * Returns the usage of every collection, summed over all shards.
+     */
+    UsageMap _mergeUsage() const;
+
     void _appendToUsageMap(BSONObjBuilder& b, const UsageMap& map) const;
 
     void _appendStatsEntry(BSONObjBuilder& b, const char* statsName, const UsageData& map) const;
@@ -135,10 +175,7 @@ private:
                              OperationLatencyHistogram* histogram,
                              Command::ReadWriteType readWriteType);
 
-    mutable SimpleMutex _lock;
-    OperationLatencyHistogram _globalHistogramStats;
-    UsageMap _usage;
-    std::string _lastDropped;
+    std::array<Shard, kNumShards> _shards;
 };
 
 }  // namespace mongo
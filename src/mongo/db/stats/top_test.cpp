@@ -29,14 +29,108 @@
 #include "mongo/platform/basic.h"
 
 #include "mongo/db/stats/top.h"
+
+#include "mongo/db/operation_context_noop.h"
+#include "mongo/db/service_context_noop.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/unittest/unittest.h"
 
 namespace {
 
 using namespace mongo;
 
+/**
+ * Runs 'fn' on a new thread. Top assigns shards to threads round-robin, so threads started one
+ * after the other record into different shards.
+ */
+void runOnNewThread(ServiceContext* service, stdx::function<void(OperationContext*)> fn) {
+    stdx::thread thread([&] {
+        auto client = service->makeClient("top_test");
+        OperationContextNoop txn(client.get(), 0);
+        fn(&txn);
+    });
+    thread.join();
+}
+
+void recordQuery(Top* top, OperationContext* txn, StringData ns) {
+    top->record(txn, ns, LogicalOp::opQuery, -1, 10, false, Command::ReadWriteType::kRead);
+}
+
+void recordInsert(Top* top, OperationContext* txn, StringData ns) {
+    top->record(txn, ns, LogicalOp::opInsert, 1, 10, false, Command::ReadWriteType::kWrite);
+}
+
+BSONObj appendTop(Top* top) {
+    BSONObjBuilder builder;
+    top->append(builder);
+    return builder.obj();
+}
+
 TEST(TopTest, CollectionDropped) {
     Top().collectionDropped("coll");
 }
 
+TEST(TopTest, AppendMergesTheUsageOfAllThreads) {
+    ServiceContextNoop service;
+    Top top;
+    for (int i = 0; i < 5; i++) {
+        runOnNewThread(&service, [&](OperationContext* txn) {
+            recordQuery(&top, txn, "test.coll");
+            recordInsert(&top, txn, "test.coll");
+        });
+    }
+
+    BSONObj coll = appendTop(&top)["test.coll"].Obj();
+    ASSERT_EQUALS(coll["total"]["count"].numberLong(), 10);
+    ASSERT_EQUALS(coll["total"]["time"].numberLong(), 100);
+    ASSERT_EQUALS(coll["readLock"]["count"].numberLong(), 5);
+    ASSERT_EQUALS(coll["writeLock"]["count"].numberLong(), 5);
+    ASSERT_EQUALS(coll["queries"]["count"].numberLong(), 5);
+    ASSERT_EQUALS(coll["insert"]["count"].numberLong(), 5);
+    ASSERT_EQUALS(coll["insert"]["time"].numberLong(), 50);
+}
+
+TEST(TopTest, CollectionDroppedErasesTheUsageOfAllThreads) {
+    ServiceContextNoop service;
+    Top top;
+    for (int i = 0; i < 3; i++) {
+        runOnNewThread(&service, [&](OperationContext* txn) {
+            recordInsert(&top, txn, "test.coll");
+            recordInsert(&top, txn, "test.other");
+        });
+    }
+
+    runOnNewThread(&service, [&](OperationContext*) { top.collectionDropped("test.coll"); });
+
+    BSONObj out = appendTop(&top);
+    ASSERT_FALSE(out.hasField("test.coll"));
+    ASSERT_EQUALS(out["test.other"]["insert"]["count"].numberLong(), 3);
+
+    Top::UsageMap usage;
+    top.cloneMap(usage);
+    ASSERT(usage.find("test.coll") == usage.end());
+    ASSERT_EQUALS(usage.find("test.other")->second.insert.count, 3);
+}
+
+TEST(TopTest, OnlyTheDroppingThreadSkipsItsNextQuery) {
+    ServiceContextNoop service;
+    Top top;
+    runOnNewThread(&service, [&](OperationContext* txn) {
+        recordInsert(&top, txn, "test.coll");
+        top.collectionDropped("test.coll");
+
+        // The drop command itself is recorded after the collection is gone, and is not counted.
+        recordQuery(&top, txn, "test.coll");
+        recordQuery(&top, txn, "test.coll");
+    });
+
+    // A thread recording into another shard is not affected by the drop.
+    runOnNewThread(&service, [&](OperationContext* txn) { recordQuery(&top, txn, "test.coll"); });
+
+    BSONObj coll = appendTop(&top)["test.coll"].Obj();
+    ASSERT_EQUALS(coll["queries"]["count"].numberLong(), 2);
+    ASSERT_EQUALS(coll["insert"]["count"].numberLong(), 0);
+}
+
 }  // namespace
@@ -61,7 +61,9 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_size_storer.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_ticket_controller.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/condition_variable.h"
 #include "mongo/util/background.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/exit.h"
@@ -124,12 +126,20 @@ private:
 
 namespace {
 
+/**
+ * Exposes the size of a ticket pool as a server parameter. Setting the size of a pool managed by
+ * 'controller' pins it to that size.
+ */
 class TicketServerParameter : public ServerParameter {
     MONGO_DISALLOW_COPYING(TicketServerParameter);
 
 public:
-    TicketServerParameter(TicketHolder* holder, const std::string& name)
-        : ServerParameter(ServerParameterSet::getGlobal(), name, true, true), _holder(holder) {}
+    TicketServerParameter(TicketHolder* holder,
+                          const std::string& name,
+                          WiredTigerTicketController* controller = nullptr)
+        : ServerParameter(ServerParameterSet::getGlobal(), name, true, true),
+          _holder(holder),
+          _controller(controller) {}
 
     virtual void append(OperationContext* txn, BSONObjBuilder& b, const std::string& name) {
         b.append(name, _holder->outof());
@@ -154,23 +164,114 @@ public:
             return Status(ErrorCodes::BadValue, str::stream() << name() << " has to be > 0");
         }
 
+        if (_controller)
+            return _controller->pin(_holder, newNum);
         return _holder->resize(newNum);
     }
 
 private:
     TicketHolder* _holder;
+    WiredTigerTicketController* _controller;
 };
 
 TicketHolder openWriteTransaction(128);
-TicketServerParameter openWriteTransactionParam(&openWriteTransaction,
-                                                "wiredTigerConcurrentWriteTransactions");
-
 TicketHolder openReadTransaction(128);
+WiredTigerTicketController ticketController(&openReadTransaction, &openWriteTransaction);
+
+TicketServerParameter openWriteTransactionParam(&openWriteTransaction,
+                                                "wiredTigerConcurrentWriteTransactions",
+                                                &ticketController);
 TicketServerParameter openReadTransactionParam(&openReadTransaction,
-                                               "wiredTigerConcurrentReadTransactions");
+                                               "wiredTigerConcurrentReadTransactions",
+                                               &ticketController);
+
+// Extra tickets, shared by readers and writers, for internal operations which find their regular
+// pool exhausted.
+TicketHolder openPriorityTransaction(16);
+TicketServerParameter openPriorityTransactionParam(&openPriorityTransaction,
+                                                   "wiredTigerConcurrentPriorityTransactions");
+
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerAdaptiveConcurrency, bool, true);
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(wiredTigerTicketPriorityLane, bool, true);
+
+uint64_t getConnectionStatistic(WT_SESSION* session, int statisticsKey) {
+    StatusWith<uint64_t> result = WiredTigerUtil::getStatisticsValue(
+        session, "statistics:", "statistics=(fast)", statisticsKey);
+    return result.isOK() ? result.getValue() : 0;
+}
+
+void appendTicketStats(const char* name, const TicketHolder& holder, BSONObjBuilder* builder) {
+    BSONObjBuilder bbb(builder->subobjStart(name));
+    bbb.append("out", holder.used());
+    bbb.append("available", holder.available());
+    bbb.append("totalTickets", holder.outof());
+    bbb.append("queued", holder.queued());
+    bbb.appendNumber("totalQueued", holder.totalQueued());
+    bbb.appendNumber("totalQueueMicros", holder.totalQueueMicros());
+    bbb.done();
+}
 
 }  // namespace
 
+/**
+ * Feeds the WiredTiger cache statistics to the ticket controller once per period.
+ */
+class WiredTigerKVEngine::WiredTigerTicketAdjuster : public BackgroundJob {
+public:
+    explicit WiredTigerTicketAdjuster(WT_CONNECTION* conn)
+        : BackgroundJob(false /* deleteSelf */), _conn(conn) {}
+
+    virtual string name() const {
+        return "WTTicketAdjuster";
+    }
+
+    virtual void run() {
+        Client::initThread(name().c_str());
+
+        LOG(1) << "starting " << name() << " thread";
+
+        WiredTigerSession session(_conn);
+        const Milliseconds period(WiredTigerTicketController::kPeriodMillis);
+        while (true) {
+            {
+                stdx::unique_lock<stdx::mutex> lk(_mutex);
+                _shutdownRequested.wait_for(
+                    lk, period.toSystemDuration(), [this] { return _shuttingDown; });
+                if (_shuttingDown)
+                    break;
+            }
+
+            if (!wiredTigerAdaptiveConcurrency.load())
+                continue;
+
+            WT_SESSION* s = session.getSession();
+            WiredTigerTicketController::CacheStats cache;
+            cache.bytesMax = getConnectionStatistic(s, WT_STAT_CONN_CACHE_BYTES_MAX);
+            cache.bytesInUse = getConnectionStatistic(s, WT_STAT_CONN_CACHE_BYTES_INUSE);
+            cache.bytesDirty = getConnectionStatistic(s, WT_STAT_CONN_CACHE_BYTES_DIRTY);
+            cache.appEvictions = getConnectionStatistic(s, WT_STAT_CONN_CACHE_EVICTION_APP);
+            ticketController.adjust(cache);
+        }
+        LOG(1) << "stopping " << name() << " thread";
+    }
+
+    void shutdown() {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _shuttingDown = true;
+        }
+        _shutdownRequested.notify_one();
+        wait();
+    }
+
+private:
+    WT_CONNECTION* _conn;
+
+    stdx::mutex _mutex;
+    stdx::condition_variable _shutdownRequested;
+    bool _shuttingDown = false;
+};
+
 WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
                                        const std::string& path,
                                        ClockSource* cs,
@@ -275,7 +376,12 @@ WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
     _sizeStorer.reset(new WiredTigerSizeStorer(_conn, _sizeStorerUri));
     _sizeStorer->fillCache();
 
-    Locker::setGlobalThrottling(&openReadTransaction, &openWriteTransaction);
+    _ticketAdjuster = stdx::make_unique<WiredTigerTicketAdjuster>(_conn);
+    _ticketAdjuster->go();
+
+    Locker::setGlobalThrottling(&openReadTransaction,
+                                &openWriteTransaction,
+                                wiredTigerTicketPriorityLane ? &openPriorityTransaction : nullptr);
 }
 
 
@@ -289,18 +395,13 @@ WiredTigerKVEngine::~WiredTigerKVEngine() {
 
 void WiredTigerKVEngine::appendGlobalStats(BSONObjBuilder& b) {
     BSONObjBuilder bb(b.subobjStart("concurrentTransactions"));
+    appendTicketStats("write", openWriteTransaction, &bb);
+    appendTicketStats("read", openReadTransaction, &bb);
+    appendTicketStats("priority", openPriorityTransaction, &bb);
     {
-        BSONObjBuilder bbb(bb.subobjStart("write"));
-        bbb.append("out", openWriteTransaction.used());
-        bbb.append("available", openWriteTransaction.available());
-        bbb.append("totalTickets", openWriteTransaction.outof());
-        bbb.done();
-    }
-    {
-        BSONObjBuilder bbb(bb.subobjStart("read"));
-        bbb.append("out", openReadTransaction.used());
-        bbb.append("available", openReadTransaction.available());
-        bbb.append("totalTickets", openReadTransaction.outof());
+        BSONObjBuilder bbb(bb.subobjStart("adaptive"));
+        bbb.append("enabled", wiredTigerAdaptiveConcurrency.load());
+        ticketController.appendStats(&bbb);
         bbb.done();
     }
     bb.done();
@@ -314,6 +415,8 @@ void WiredTigerKVEngine::cleanShutdown() {
         // these must be the last things we do before _conn->close();
         if (_journalFlusher)
             _journalFlusher->shutdown();
+        if (_ticketAdjuster)
+            _ticketAdjuster->shutdown();
         _sizeStorer.reset();
         _sessionCache->shuttingDown();
 
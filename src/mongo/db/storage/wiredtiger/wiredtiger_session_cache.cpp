@@ -35,13 +35,18 @@
 
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 
+#include <algorithm>
+
 #include "mongo/base/error_codes.h"
+#include "mongo/bson/bsonobjbuilder.h"
 #include "mongo/db/storage/journal_listener.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/stdx/thread.h"
+#include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/log.h"
+#include "mongo/util/processinfo.h"
 #include "mongo/util/scopeguard.h"
 
 namespace mongo {
@@ -144,11 +149,33 @@ uint64_t WiredTigerSession::genTableId() {
 
 // -----------------------
 
+namespace {
+const size_t kMaxPartitions = 64;
+
+// Hands out session cache partitions to threads in round-robin order.
+AtomicUInt32 nextThreadPartition;
+
+// One more than the partition index assigned to this thread, or 0 if none has been assigned yet.
+MONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL uint32_t threadPartition;
+
+size_t numPartitions() {
+    ProcessInfo p;
+    return std::max(size_t(1), std::min(kMaxPartitions, size_t(p.getNumCores())));
+}
+}  // namespace
+
 WiredTigerSessionCache::WiredTigerSessionCache(WiredTigerKVEngine* engine)
-    : _engine(engine), _conn(engine->getConnection()), _snapshotManager(_conn), _shuttingDown(0) {}
+    : WiredTigerSessionCache(engine->getConnection()) {
+    _engine = engine;
+}
 
 WiredTigerSessionCache::WiredTigerSessionCache(WT_CONNECTION* conn)
-    : _engine(NULL), _conn(conn), _snapshotManager(_conn), _shuttingDown(0) {}
+    : _engine(NULL), _conn(conn), _snapshotManager(_conn), _shuttingDown(0) {
+    const size_t partitions = numPartitions();
+    for (size_t i = 0; i < partitions; i++) {
+        _partitions.emplace_back(stdx::make_unique<Partition>());
+    }
+}
 
 WiredTigerSessionCache::~WiredTigerSessionCache() {
     shuttingDown();
@@ -233,21 +260,36 @@ void WiredTigerSessionCache::closeAllCursors() {
     // Increment the cursor epoch so that all cursors from this epoch are closed.
     _cursorEpoch.fetchAndAdd(1);
 
-    stdx::lock_guard<stdx::mutex> lock(_cacheLock);
-    for (SessionCache::iterator i = _sessions.begin(); i != _sessions.end(); i++) {
-        (*i)->closeAllCursors();
+    auto closeCursors = [](Partition* partition) {
+        stdx::lock_guard<stdx::mutex> lock(partition->mutex);
+        for (SessionCache::iterator i = partition->sessions.begin();
+             i != partition->sessions.end();
+             i++) {
+            (*i)->closeAllCursors();
+        }
+    };
+    for (auto&& partition : _partitions) {
+        closeCursors(partition.get());
     }
+    closeCursors(&_sharedPool);
 }
 
 void WiredTigerSessionCache::closeAll() {
-    // Increment the epoch as we are now closing all sessions with this epoch.
-    SessionCache swap;
+    // Increment the epoch as we are now closing all sessions with this epoch. This happens before
+    // any partition is emptied, so that releaseSession, which rechecks the epoch under the
+    // partition's mutex, cannot cache an old session in a partition which was already emptied.
+    _epoch.fetchAndAdd(1);
 
-    {
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
-        _epoch.fetchAndAdd(1);
-        _sessions.swap(swap);
+    SessionCache swap;
+    auto takeSessions = [&swap](Partition* partition) {
+        stdx::lock_guard<stdx::mutex> lock(partition->mutex);
+        swap.insert(swap.end(), partition->sessions.begin(), partition->sessions.end());
+        partition->sessions.clear();
+    };
+    for (auto&& partition : _partitions) {
+        takeSessions(partition.get());
     }
+    takeSessions(&_sharedPool);
 
     for (SessionCache::iterator i = swap.begin(); i != swap.end(); i++) {
         delete (*i);
@@ -263,18 +305,22 @@ UniqueWiredTigerSession WiredTigerSessionCache::getSession() {
     // operations should be allowed to start.
     invariant(!(_shuttingDown.loadRelaxed() & kShuttingDownMask));
 
-    {
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
-        if (!_sessions.empty()) {
+    // Prefer the calling thread's own partition, whose sessions are most likely to have its
+    // cursors cached, and fall back to the shared pool.
+    for (Partition* partition : {_getPartitionForThread(), &_sharedPool}) {
+        auto lock = _lockPartition(partition);
+        if (!partition->sessions.empty()) {
             // Get the most recently used session so that if we discard sessions, we're
             // discarding older ones
-            WiredTigerSession* cachedSession = _sessions.back();
-            _sessions.pop_back();
+            WiredTigerSession* cachedSession = partition->sessions.back();
+            partition->sessions.pop_back();
+            partition->sessionsReused++;
             return UniqueWiredTigerSession(cachedSession);
         }
     }
 
     // Outside of the cache partition lock, but on release will be put back on the cache
+    _sessionsCreated.fetchAndAdd(1);
     return UniqueWiredTigerSession(
         new WiredTigerSession(_conn, this, _epoch.load(), _cursorEpoch.load()));
 }
@@ -312,10 +358,18 @@ void WiredTigerSessionCache::releaseSession(WiredTigerSession* session) {
     uint64_t currentEpoch = _epoch.load();
 
     if (session->_getEpoch() == currentEpoch) {  // check outside of lock to reduce contention
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
-        if (session->_getEpoch() == _epoch.load()) {  // recheck inside the lock for correctness
-            returnedToCache = true;
-            _sessions.push_back(session);
+        // Keep the session in this thread's partition unless it is full.
+        for (Partition* partition : {_getPartitionForThread(), &_sharedPool}) {
+            auto lock = _lockPartition(partition);
+            if (session->_getEpoch() != _epoch.load()) {  // recheck inside the lock
+                break;
+            }
+            if (partition == &_sharedPool ||
+                partition->sessions.size() < kMaxSessionsPerPartition) {
+                returnedToCache = true;
+                partition->sessions.push_back(session);
+                break;
+            }
         }
     } else
         invariant(session->_getEpoch() < currentEpoch);
@@ -328,6 +382,50 @@ void WiredTigerSessionCache::releaseSession(WiredTigerSession* session) {
 }
 
 
+WiredTigerSessionCache::Partition* WiredTigerSessionCache::_getPartitionForThread() {
+    if (!threadPartition) {
+        threadPartition = nextThreadPartition.fetchAndAdd(1) % kMaxPartitions + 1;
+    }
+    return _partitions[(threadPartition - 1) % _partitions.size()].get();
+}
+
+stdx::unique_lock<stdx::mutex> WiredTigerSessionCache::_lockPartition(Partition* partition) {
+    stdx::unique_lock<stdx::mutex> lock(partition->mutex, stdx::try_to_lock);
+    if (!lock.owns_lock()) {
+        lock.lock();
+        partition->lockWaits++;
+    }
+    return lock;
+}
+
+void WiredTigerSessionCache::appendStats(BSONObjBuilder* builder) const {
+    long long partitionSessions = 0;
+    long long sessionsReused = 0;
+    long long partitionLockWaits = 0;
+    for (auto&& partition : _partitions) {
+        stdx::lock_guard<stdx::mutex> lock(partition->mutex);
+        partitionSessions += partition->sessions.size();
+        sessionsReused += partition->sessionsReused;
+        partitionLockWaits += partition->lockWaits;
+    }
+
+    BSONObjBuilder bob(builder->subobjStart("session cache"));
+    bob.append("partitions", static_cast<int>(_partitions.size()));
+    bob.append("sessions cached in partitions", partitionSessions);
+    bob.append("sessions reused from partitions", sessionsReused);
+    bob.append("partition lock waits", partitionLockWaits);
+    {
+        stdx::lock_guard<stdx::mutex> lock(_sharedPool.mutex);
+        bob.append("sessions cached in shared pool",
+                   static_cast<long long>(_sharedPool.sessions.size()));
+        bob.append("sessions reused from shared pool",
+                   static_cast<long long>(_sharedPool.sessionsReused));
+        bob.append("shared pool lock waits", static_cast<long long>(_sharedPool.lockWaits));
+    }
+    bob.append("sessions opened", static_cast<long long>(_sessionsCreated.load()));
+    bob.done();
+}
+
 void WiredTigerSessionCache::setJournalListener(JournalListener* jl) {
     stdx::unique_lock<stdx::mutex> lk(_journalListenerMutex);
     _journalListener = jl;
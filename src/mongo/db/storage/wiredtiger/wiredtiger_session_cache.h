@@ -32,7 +32,9 @@
 #pragma once
 
 #include <list>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <boost/thread/shared_mutex.hpp>
 #include <wiredtiger.h>
@@ -45,6 +47,7 @@
 
 namespace mongo {
 
+class BSONObjBuilder;
 class WiredTigerKVEngine;
 class WiredTigerSessionCache;
 
@@ -138,6 +141,12 @@ private:
 /**
  *  This cache implements a shared pool of WiredTiger sessions with the goal to amortize the
  *  cost of session creation and destruction over multiple uses.
+ *
+ *  Released sessions are kept in one partition per core, each with its own mutex. A thread is
+ *  assigned a partition the first time it uses the cache and always takes sessions from and
+ *  returns them to that partition, so that a session and its cached cursors tend to be reused by
+ *  the same threads. Partitions hold a bounded number of sessions; the overflow goes to a shared
+ *  pool, which is also consulted when a thread's own partition is empty.
  */
 class WiredTigerSessionCache {
 public:
@@ -204,7 +213,39 @@ public:
         return _cursorEpoch.load();
     }
 
+    /**
+     * Appends the number of cached sessions and the counters of how sessions were obtained and
+     * how often the cache mutexes were contended. Used by serverStatus.
+     */
+    void appendStats(BSONObjBuilder* builder) const;
+
+    /**
+     * The most sessions a single partition keeps before releasing to the shared pool.
+     */
+    static const size_t kMaxSessionsPerPartition = 16;
+
 private:
+    typedef std::vector<WiredTigerSession*> SessionCache;
+
+    struct Partition {
+        // Protects all of the members below.
+        mutable stdx::mutex mutex;
+        SessionCache sessions;
+        uint64_t sessionsReused = 0;
+        uint64_t lockWaits = 0;
+    };
+
+    /**
+     * Returns the partition assigned to the calling thread.
+     */
+    Partition* _getPartitionForThread();
+
+    /**
+     * Locks the mutex of 'partition', counting in its 'lockWaits' whether another thread held it.
+     */
+    static stdx::unique_lock<stdx::mutex> _lockPartition(Partition* partition);
+
+
     WiredTigerKVEngine* _engine;  // not owned, might be NULL
     WT_CONNECTION* _conn;         // not owned
     WiredTigerSnapshotManager _snapshotManager;
@@ -215,9 +256,12 @@ private:
     AtomicUInt32 _shuttingDown;
     static const uint32_t kShuttingDownMask = 1 << 31;
 
-    stdx::mutex _cacheLock;
-    typedef std::vector<WiredTigerSession*> SessionCache;
-    SessionCache _sessions;
+    // Each partition is allocated separately so that their mutexes do not share cache lines.
+    std::vector<std::unique_ptr<Partition>> _partitions;
+    Partition _sharedPool;
+
+    // Number of sessions opened because no cached session was available.
+    AtomicUInt64 _sessionsCreated;
 
     // Bumped when all open sessions need to be closed
     AtomicUInt64 _epoch;  // atomic so we can check it outside of the lock
@@ -0,0 +1,191 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/log.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+namespace {
+
+class WiredTigerConnection {
+public:
+    WiredTigerConnection(StringData dbpath) : _conn(NULL) {
+        int ret = wiredtiger_open(
+            dbpath.toString().c_str(), NULL, "create,session_max=2000", &_conn);
+        ASSERT_OK(wtRCToStatus(ret));
+        ASSERT(_conn);
+    }
+    ~WiredTigerConnection() {
+        _conn->close(_conn, NULL);
+    }
+    WT_CONNECTION* getConnection() const {
+        return _conn;
+    }
+
+private:
+    WT_CONNECTION* _conn;
+};
+
+class WiredTigerSessionCacheTest : public unittest::Test {
+public:
+    WiredTigerSessionCacheTest()
+        : _dbpath("wt_session_cache_test"),
+          _connection(_dbpath.path()),
+          _sessionCache(_connection.getConnection()) {}
+
+protected:
+    WiredTigerSessionCache* getSessionCache() {
+        return &_sessionCache;
+    }
+
+    BSONObj getStats() {
+        BSONObjBuilder bob;
+        _sessionCache.appendStats(&bob);
+        return bob.obj().getObjectField("session cache").getOwned();
+    }
+
+private:
+    unittest::TempDir _dbpath;
+    WiredTigerConnection _connection;
+    WiredTigerSessionCache _sessionCache;
+};
+
+TEST_F(WiredTigerSessionCacheTest, ReleasedSessionIsReusedBySameThread) {
+    WiredTigerSession* first;
+    {
+        auto session = getSessionCache()->getSession();
+        first = session.get();
+    }
+    auto session = getSessionCache()->getSession();
+    ASSERT_EQ(first, session.get());
+
+    BSONObj stats = getStats();
+    ASSERT_EQ(stats["sessions opened"].numberLong(), 1);
+    ASSERT_EQ(stats["sessions reused from partitions"].numberLong(), 1);
+    ASSERT_EQ(stats["sessions reused from shared pool"].numberLong(), 0);
+}
+
+TEST_F(WiredTigerSessionCacheTest, FullPartitionOverflowsToSharedPool) {
+    const size_t numSessions = WiredTigerSessionCache::kMaxSessionsPerPartition + 3;
+    {
+        std::vector<UniqueWiredTigerSession> sessions;
+        for (size_t i = 0; i < numSessions; i++) {
+            sessions.push_back(getSessionCache()->getSession());
+        }
+    }
+
+    BSONObj stats = getStats();
+    ASSERT_EQ(stats["sessions opened"].numberLong(), static_cast<long long>(numSessions));
+    ASSERT_EQ(stats["sessions cached in partitions"].numberLong(),
+              static_cast<long long>(WiredTigerSessionCache::kMaxSessionsPerPartition));
+    ASSERT_EQ(stats["sessions cached in shared pool"].numberLong(), 3);
+
+    // Another thread, whatever partition it is assigned, can reuse the sessions in the shared pool
+    // instead of opening new ones.
+    stdx::thread([this] {
+        std::vector<UniqueWiredTigerSession> sessions;
+        for (int i = 0; i < 3; i++) {
+            sessions.push_back(getSessionCache()->getSession());
+        }
+    }).join();
+    stats = getStats();
+    ASSERT_EQ(stats["sessions opened"].numberLong(), static_cast<long long>(numSessions));
+}
+
+TEST_F(WiredTigerSessionCacheTest, CloseAllEmptiesEveryPartition) {
+    {
+        std::vector<UniqueWiredTigerSession> sessions;
+        for (size_t i = 0; i < 2 * WiredTigerSessionCache::kMaxSessionsPerPartition; i++) {
+            sessions.push_back(getSessionCache()->getSession());
+        }
+    }
+    getSessionCache()->closeAll();
+
+    BSONObj stats = getStats();
+    ASSERT_EQ(stats["sessions cached in partitions"].numberLong(), 0);
+    ASSERT_EQ(stats["sessions cached in shared pool"].numberLong(), 0);
+
+    // Sessions from before closeAll() are not cached again when they are released.
+    auto session = getSessionCache()->getSession();
+    getSessionCache()->closeAll();
+    session.reset();
+    ASSERT_EQ(getStats()["sessions cached in partitions"].numberLong(), 0);
+}
+
+/**
+ * Measures getSession() and the release of the session from many threads at once, which is what
+ * every operation does at least once.
+ */
+TEST_F(WiredTigerSessionCacheTest, ConcurrentGetAndRelease) {
+    const int kThreads = 32;
+    const int kIterations = 20000;
+
+    Timer timer;
+    std::vector<stdx::thread> threads;
+    for (int i = 0; i < kThreads; i++) {
+        threads.emplace_back([this, kIterations] {
+            for (int j = 0; j < kIterations; j++) {
+                auto session = getSessionCache()->getSession();
+                ASSERT(session->getSession());
+            }
+        });
+    }
+    for (auto&& thread : threads) {
+        thread.join();
+    }
+    const int ms = timer.millis();
+
+    BSONObj stats = getStats();
+    log() << "session cache ConcurrentGetAndRelease: " << kThreads * kIterations
+          << " sessions in " << ms << "ms, " << stats;
+
+    ASSERT_LTE(stats["sessions opened"].numberLong(), kThreads);
+    ASSERT_EQ(stats["sessions opened"].numberLong() +
+                  stats["sessions reused from partitions"].numberLong() +
+                  stats["sessions reused from shared pool"].numberLong(),
+              kThreads * kIterations);
+}
+
+}  // namespace
+}  // namespace mongo
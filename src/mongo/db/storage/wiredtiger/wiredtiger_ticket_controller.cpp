@@ -0,0 +1,176 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_ticket_controller.h"
+
+#include <algorithm>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+namespace {
+
+// WiredTiger's default eviction_dirty_trigger and eviction_trigger, as fractions of the cache.
+const double kDirtyTrigger = 0.20;
+const double kFullTrigger = 0.95;
+
+// An increase is backed off if the next period handed out fewer tickets than this fraction of the
+// period before it.
+const double kThroughputTolerance = 0.95;
+
+const int kHoldPeriods = 10;
+
+}  // namespace
+
+const int WiredTigerTicketController::kPeriodMillis;
+const int WiredTigerTicketController::kMinTickets;
+const int WiredTigerTicketController::kMaxTickets;
+
+WiredTigerTicketController::WiredTigerTicketController(TicketHolder* reading,
+                                                       TicketHolder* writing)
+    : _read(reading), _write(writing) {}
+
+void WiredTigerTicketController::adjust(const CacheStats& cache) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+
+    const bool appEvicted = _haveCacheSample && cache.appEvictions > _lastAppEvictions;
+    _lastAppEvictions = cache.appEvictions;
+    _haveCacheSample = true;
+
+    const double max = std::max<double>(cache.bytesMax, 1);
+    _writePressure = appEvicted || cache.bytesDirty > kDirtyTrigger * max;
+    _readPressure = appEvicted && cache.bytesInUse > kFullTrigger * max;
+
+    _adjustPool(&_write, _writePressure);
+    _adjustPool(&_read, _readPressure);
+}
+
+void WiredTigerTicketController::_adjustPool(Pool* pool, bool underPressure) {
+    TicketHolder* holder = pool->holder;
+
+    const long long acquired = holder->totalAcquired();
+    const long long queued = holder->totalQueued();
+    const long long queueMicros = holder->totalQueueMicros();
+
+    const long long throughput = acquired - pool->lastAcquired;
+    const long long periodQueued = queued - pool->lastQueued;
+    pool->averageQueueMicros =
+        periodQueued ? (queueMicros - pool->lastQueueMicros) / periodQueued : 0;
+
+    pool->lastAcquired = acquired;
+    pool->lastQueued = queued;
+    pool->lastQueueMicros = queueMicros;
+
+    const long long previousThroughput = pool->lastThroughput;
+    const int previousChange = pool->lastChange;
+    pool->lastThroughput = throughput;
+    pool->lastChange = 0;
+
+    if (pool->pinned)
+        return;
+
+    const int size = holder->outof();
+    int newSize = size;
+    if (underPressure) {
+        newSize = std::max(kMinTickets, size - size / 4);
+        pool->holdPeriods = 0;
+    } else if (pool->holdPeriods > 0) {
+        pool->holdPeriods--;
+    } else if (periodQueued > 0) {
+        if (previousChange > 0 && throughput < kThroughputTolerance * previousThroughput) {
+            newSize = size - previousChange;
+            pool->holdPeriods = kHoldPeriods;
+        } else {
+            newSize = std::min(kMaxTickets, size + std::max(kMinTickets / 2, size / 8));
+        }
+    }
+
+    if (newSize == size)
+        return;
+
+    // Shrinking does not wait for tickets in use. They are retired as they are released.
+    Status status = holder->resize(newSize);
+    if (!status.isOK()) {
+        warning() << "Failed to resize WiredTiger ticket pool from " << size << " to " << newSize
+                  << ": " << status;
+        return;
+    }
+
+    LOG(2) << "Resized WiredTiger ticket pool from " << size << " to " << newSize;
+    pool->lastChange = newSize - size;
+    if (newSize > size) {
+        pool->increases++;
+    } else {
+        pool->decreases++;
+    }
+}
+
+Status WiredTigerTicketController::pin(TicketHolder* holder, int newSize) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+
+    Pool* pool = holder == _read.holder ? &_read : &_write;
+    invariant(holder == pool->holder);
+
+    Status status = holder->resize(newSize);
+    if (!status.isOK())
+        return status;
+
+    pool->pinned = true;
+    pool->lastChange = 0;
+    return Status::OK();
+}
+
+void WiredTigerTicketController::appendStats(BSONObjBuilder* builder) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+
+    builder->append("writeCachePressure", _writePressure);
+    builder->append("readCachePressure", _readPressure);
+    _appendPoolStats("write", _write, builder);
+    _appendPoolStats("read", _read, builder);
+}
+
+void WiredTigerTicketController::_appendPoolStats(const char* name,
+                                                  const Pool& pool,
+                                                  BSONObjBuilder* builder) {
+    BSONObjBuilder poolBuilder(builder->subobjStart(name));
+    poolBuilder.append("pinned", pool.pinned);
+    poolBuilder.appendNumber("throughput", pool.lastThroughput);
+    poolBuilder.appendNumber("averageQueueMicros", pool.averageQueueMicros);
+    poolBuilder.appendNumber("increases", pool.increases);
+    poolBuilder.appendNumber("decreases", pool.decreases);
+}
+
+}  // namespace mongo
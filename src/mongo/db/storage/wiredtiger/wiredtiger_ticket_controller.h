@@ -0,0 +1,130 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+class BSONObjBuilder;
+class TicketHolder;
+
+/**
+ * Sizes the WiredTiger read and write ticket pools from feedback sampled once per period: the
+ * number of tickets each pool handed out, how many of those had to queue, and the state of the
+ * WiredTiger cache.
+ *
+ * Write tickets are cut by a quarter whenever the cache holds more dirty data than WiredTiger's
+ * eviction dirty trigger or application threads had to evict pages, because more concurrent
+ * writers only make eviction fall further behind. Read tickets are only cut when application
+ * threads evict from a full cache. Otherwise a pool whose operations queued during the period
+ * grows by an eighth, and gives the tickets back if the increase cost throughput.
+ *
+ * A pool whose size is set explicitly through pin() is no longer adjusted.
+ */
+class WiredTigerTicketController {
+    MONGO_DISALLOW_COPYING(WiredTigerTicketController);
+
+public:
+    /**
+     * Connection statistics of the WiredTiger cache.
+     */
+    struct CacheStats {
+        uint64_t bytesMax = 0;
+        uint64_t bytesInUse = 0;
+        uint64_t bytesDirty = 0;
+
+        // Cumulative number of pages evicted by application threads.
+        uint64_t appEvictions = 0;
+    };
+
+    // adjust() compares the throughput of consecutive samples, so it must be called at this
+    // fixed interval.
+    static const int kPeriodMillis = 1000;
+
+    static const int kMinTickets = 16;
+    static const int kMaxTickets = 1024;
+
+    WiredTigerTicketController(TicketHolder* reading, TicketHolder* writing);
+
+    /**
+     * Takes a sample of both pools and of 'cache' and resizes the pools that are not pinned.
+     */
+    void adjust(const CacheStats& cache);
+
+    /**
+     * Resizes 'holder', which must be one of the controlled pools, to 'newSize' and stops
+     * adjusting it.
+     */
+    Status pin(TicketHolder* holder, int newSize);
+
+    void appendStats(BSONObjBuilder* builder) const;
+
+private:
+    struct Pool {
+        explicit Pool(TicketHolder* holder) : holder(holder) {}
+
+        TicketHolder* const holder;
+        bool pinned = false;
+
+        // Counters of 'holder' at the previous sample.
+        long long lastAcquired = 0;
+        long long lastQueued = 0;
+        long long lastQueueMicros = 0;
+
+        // Tickets handed out during the previous period, and the size change made after it.
+        long long lastThroughput = 0;
+        int lastChange = 0;
+
+        // Number of periods to leave the size alone after backing off an increase.
+        int holdPeriods = 0;
+
+        long long averageQueueMicros = 0;
+        long long increases = 0;
+        long long decreases = 0;
+    };
+
+    void _adjustPool(Pool* pool, bool underPressure);
+
+    static void _appendPoolStats(const char* name, const Pool& pool, BSONObjBuilder* builder);
+
+    mutable stdx::mutex _mutex;
+    Pool _read;
+    Pool _write;
+    bool _writePressure = false;
+    bool _readPressure = false;
+    bool _haveCacheSample = false;
+    uint64_t _lastAppEvictions = 0;
+};
+
+}  // namespace mongo
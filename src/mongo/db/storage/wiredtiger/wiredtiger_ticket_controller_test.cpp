@@ -0,0 +1,251 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_ticket_controller.h"
+
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+namespace {
+
+using CacheStats = WiredTigerTicketController::CacheStats;
+
+CacheStats healthyCache() {
+    CacheStats cache;
+    cache.bytesMax = 100;
+    cache.bytesInUse = 50;
+    cache.bytesDirty = 1;
+    return cache;
+}
+
+/**
+ * Hands out every ticket of 'holder' so that one waitForTicket call has to queue, then returns
+ * all of them.
+ */
+void queueOneAcquisition(TicketHolder* holder) {
+    int taken = 0;
+    while (holder->tryAcquire()) {
+        taken++;
+    }
+
+    stdx::thread waiter([holder] {
+        holder->waitForTicket();
+        holder->release();
+    });
+    while (holder->queued() == 0) {
+        sleepmillis(1);
+    }
+    holder->release();
+    waiter.join();
+
+    for (int i = 1; i < taken; i++) {
+        holder->release();
+    }
+}
+
+void acquireAndRelease(TicketHolder* holder, int count) {
+    for (int i = 0; i < count; i++) {
+        ASSERT(holder->tryAcquire());
+        holder->release();
+    }
+}
+
+class WiredTigerTicketControllerTest : public unittest::Test {
+public:
+    WiredTigerTicketControllerTest() : _read(128), _write(128), _controller(&_read, &_write) {}
+
+protected:
+    TicketHolder* read() {
+        return &_read;
+    }
+
+    TicketHolder* write() {
+        return &_write;
+    }
+
+    WiredTigerTicketController* controller() {
+        return &_controller;
+    }
+
+private:
+    TicketHolder _read;
+    TicketHolder _write;
+    WiredTigerTicketController _controller;
+};
+
+TEST(TicketHolderTest, CountsQueuedAcquisitions) {
+    TicketHolder holder(2);
+    acquireAndRelease(&holder, 5);
+    ASSERT_EQ(holder.totalAcquired(), 5);
+    ASSERT_EQ(holder.totalQueued(), 0);
+
+    queueOneAcquisition(&holder);
+    ASSERT_EQ(holder.totalAcquired(), 8);
+    ASSERT_EQ(holder.totalQueued(), 1);
+    ASSERT_EQ(holder.queued(), 0);
+    ASSERT_EQ(holder.available(), 2);
+}
+
+TEST_F(WiredTigerTicketControllerTest, IdlePoolsAreLeftAlone) {
+    acquireAndRelease(read(), 100);
+    acquireAndRelease(write(), 100);
+    controller()->adjust(healthyCache());
+    ASSERT_EQ(read()->outof(), 128);
+    ASSERT_EQ(write()->outof(), 128);
+}
+
+TEST_F(WiredTigerTicketControllerTest, QueuedPoolGrows) {
+    queueOneAcquisition(write());
+    controller()->adjust(healthyCache());
+    ASSERT_EQ(write()->outof(), 144);
+    ASSERT_EQ(read()->outof(), 128);
+}
+
+TEST_F(WiredTigerTicketControllerTest, DirtyCacheShrinksWrites) {
+    CacheStats cache = healthyCache();
+    cache.bytesDirty = 30;
+    queueOneAcquisition(read());
+    queueOneAcquisition(write());
+    controller()->adjust(cache);
+    ASSERT_EQ(write()->outof(), 96);
+    ASSERT_EQ(read()->outof(), 144);
+}
+
+TEST(TicketHolderTest, ShrinkingRetiresTicketsInUseWhenReleased) {
+    TicketHolder holder(8);
+    for (int i = 0; i < 7; i++) {
+        ASSERT(holder.tryAcquire());
+    }
+
+    // Takes the one available ticket and retires two of those in use, without waiting.
+    ASSERT_OK(holder.resize(5));
+    ASSERT_EQ(holder.outof(), 5);
+    ASSERT_EQ(holder.available(), 0);
+    ASSERT_EQ(holder.used(), 7);
+
+    // Growing before the surplus is retired keeps a ticket in use rather than adding a new one.
+    ASSERT_OK(holder.resize(6));
+    ASSERT_EQ(holder.available(), 0);
+
+    holder.release();
+    ASSERT_EQ(holder.available(), 0);
+    holder.release();
+    ASSERT_EQ(holder.available(), 1);
+
+    for (int i = 0; i < 5; i++) {
+        holder.release();
+    }
+    ASSERT_EQ(holder.available(), 6);
+    ASSERT_EQ(holder.used(), 0);
+}
+
+TEST_F(WiredTigerTicketControllerTest, ShrinkingDoesNotWaitForTicketsInUse) {
+    CacheStats cache = healthyCache();
+    cache.bytesDirty = 30;
+    int taken = 0;
+    while (write()->tryAcquire()) {
+        taken++;
+    }
+
+    controller()->adjust(cache);
+    ASSERT_EQ(write()->outof(), 96);
+    ASSERT_EQ(write()->available(), 0);
+
+    for (int i = 0; i < taken; i++) {
+        write()->release();
+    }
+    ASSERT_EQ(write()->available(), 96);
+}
+
+TEST_F(WiredTigerTicketControllerTest, ApplicationEvictionFromFullCacheShrinksBothPools) {
+    controller()->adjust(healthyCache());
+
+    CacheStats cache = healthyCache();
+    cache.bytesInUse = 99;
+    cache.appEvictions = 5;
+    controller()->adjust(cache);
+    ASSERT_EQ(write()->outof(), 96);
+    ASSERT_EQ(read()->outof(), 96);
+
+    // Only new evictions count as pressure.
+    controller()->adjust(cache);
+    ASSERT_EQ(write()->outof(), 96);
+    ASSERT_EQ(read()->outof(), 96);
+}
+
+TEST_F(WiredTigerTicketControllerTest, ShrinksNoFurtherThanTheMinimum) {
+    CacheStats cache = healthyCache();
+    cache.bytesDirty = 50;
+    for (int i = 0; i < 20; i++) {
+        controller()->adjust(cache);
+    }
+    ASSERT_EQ(write()->outof(), WiredTigerTicketController::kMinTickets);
+}
+
+TEST_F(WiredTigerTicketControllerTest, IncreaseIsBackedOffWhenThroughputDrops) {
+    acquireAndRelease(write(), 1000);
+    queueOneAcquisition(write());
+    controller()->adjust(healthyCache());
+    ASSERT_EQ(write()->outof(), 144);
+
+    queueOneAcquisition(write());
+    controller()->adjust(healthyCache());
+    ASSERT_EQ(write()->outof(), 128);
+
+    // Having just backed off, the controller waits before trying to grow the pool again.
+    queueOneAcquisition(write());
+    controller()->adjust(healthyCache());
+    ASSERT_EQ(write()->outof(), 128);
+}
+
+TEST_F(WiredTigerTicketControllerTest, PinnedPoolIsNotAdjusted) {
+    ASSERT_OK(controller()->pin(write(), 64));
+    ASSERT_EQ(write()->outof(), 64);
+
+    CacheStats cache = healthyCache();
+    cache.bytesDirty = 50;
+    controller()->adjust(cache);
+    ASSERT_EQ(write()->outof(), 64);
+
+    BSONObjBuilder builder;
+    controller()->appendStats(&builder);
+    BSONObj stats = builder.obj();
+    ASSERT(stats["writeCachePressure"].trueValue());
+    ASSERT(stats["write"]["pinned"].trueValue());
+    ASSERT(!stats["read"]["pinned"].trueValue());
+}
+
+}  // namespace
+}  // namespace mongo
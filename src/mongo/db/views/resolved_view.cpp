@@ -101,6 +101,13 @@ StatusWith<BSONObj> ResolvedView::asExpandedViewAggregation(
     if (request.isExplain())
         aggregationBuilder.append("explain", true);
 
+    if (request.getCompileExpressions())
+        aggregationBuilder.append(AggregationRequest::kCompileExpressionsName,
+                                  *request.getCompileExpressions());
+
+    if (request.getParallelism())
+        aggregationBuilder.append(AggregationRequest::kParallelismName, *request.getParallelism());
+
     return aggregationBuilder.obj();
 }
 
@@ -67,7 +67,7 @@ public:
             _chunkMap[mySplitPoints[i]] = chunk;
         }
 
-        _chunkRangeMap = _constructRanges(_chunkMap);
+        _constructRoutingTable(nullptr);
     }
 };
 
@@ -39,9 +39,11 @@
 #include "mongo/db/db_raii.h"
 #include "mongo/db/dbdirectclient.h"
 #include "mongo/db/dbhelpers.h"
+#include "mongo/db/index/index_access_method.h"
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/service_context_d.h"
+#include "mongo/db/storage/record_store.h"
 #include "mongo/dbtests/dbtests.h"
 
 namespace IndexUpdateTests {
@@ -439,6 +441,114 @@ public:
     }
 };
 
+/**
+ * Sets the number of index build key generation threads for the lifetime of the object and
+ * restores the previous value on destruction.
+ */
+class KeyGenerationThreadsSetting {
+public:
+    explicit KeyGenerationThreadsSetting(int numThreads)
+        : _oldNumThreads(indexBuildKeyGenerationThreads.load()) {
+        indexBuildKeyGenerationThreads.store(numThreads);
+    }
+    ~KeyGenerationThreadsSetting() {
+        indexBuildKeyGenerationThreads.store(_oldNumThreads);
+    }
+
+private:
+    const int _oldNumThreads;
+};
+
+/** A foreground index build generating keys on several threads indexes every document. */
+class InsertBuildParallelKeyGeneration : public IndexBuildBase {
+public:
+    void run() {
+        const int numDocs = 5000;
+        Database* db = _ctx.db();
+        Collection* coll;
+        {
+            WriteUnitOfWork wunit(&_txn);
+            db->dropCollection(&_txn, _ns);
+            coll = db->createCollection(&_txn, _ns);
+
+            OpDebug* const nullOpDebug = nullptr;
+            for (int i = 0; i < numDocs; i++) {
+                coll->insertDocument(
+                    &_txn, BSON("_id" << i << "a" << BSON_ARRAY(i << -i)), nullOpDebug, true);
+            }
+            wunit.commit();
+        }
+
+        KeyGenerationThreadsSetting setting(4);
+
+        MultiIndexBlock indexer(&_txn, coll);
+        const BSONObj spec = BSON("name"
+                                  << "a"
+                                  << "ns"
+                                  << coll->ns().ns()
+                                  << "key"
+                                  << BSON("a" << 1));
+
+        ASSERT_OK(indexer.init(spec));
+        ASSERT_OK(indexer.insertAllDocumentsInCollection());
+
+        WriteUnitOfWork wunit(&_txn);
+        indexer.commit();
+        wunit.commit();
+
+        IndexCatalog* catalog = coll->getIndexCatalog();
+        IndexDescriptor* desc = catalog->findIndexByName(&_txn, "a");
+        ASSERT(desc);
+        ASSERT(catalog->isMultikey(&_txn, desc));
+
+        // Document 0 generates the key 0 twice.
+        int64_t numKeys;
+        ValidateResults results;
+        ASSERT_OK(catalog->getIndex(desc)->validate(&_txn, &numKeys, &results));
+        ASSERT_EQUALS(2 * numDocs - 1, numKeys);
+    }
+};
+
+/** Duplicate keys found by different key generation threads still fail a unique index build. */
+class InsertBuildParallelKeyGenerationEnforceUnique : public IndexBuildBase {
+public:
+    void run() {
+        const int numDocs = 5000;
+        Database* db = _ctx.db();
+        Collection* coll;
+        {
+            WriteUnitOfWork wunit(&_txn);
+            db->dropCollection(&_txn, _ns);
+            coll = db->createCollection(&_txn, _ns);
+
+            // The only duplicate is between the first and the last document, which are in
+            // different batches.
+            OpDebug* const nullOpDebug = nullptr;
+            for (int i = 0; i < numDocs; i++) {
+                const int a = (i == numDocs - 1) ? 0 : i;
+                coll->insertDocument(&_txn, BSON("_id" << i << "a" << a), nullOpDebug, true);
+            }
+            wunit.commit();
+        }
+
+        KeyGenerationThreadsSetting setting(4);
+
+        MultiIndexBlock indexer(&_txn, coll);
+        const BSONObj spec = BSON("name"
+                                  << "a"
+                                  << "ns"
+                                  << coll->ns().ns()
+                                  << "key"
+                                  << BSON("a" << 1)
+                                  << "unique"
+                                  << true);
+
+        ASSERT_OK(indexer.init(spec));
+        const Status status = indexer.insertAllDocumentsInCollection();
+        ASSERT_EQUALS(status.code(), ErrorCodes::DuplicateKey);
+    }
+};
+
 /** Index creation fills a passed-in set of dups rather than failing. */
 template <bool background>
 class InsertBuildFillDups : public IndexBuildBase {
@@ -993,6 +1103,8 @@ public:
         add<InsertBuildEnforceUnique<false>>();
         add<InsertBuildFillDups<true>>();
         add<InsertBuildFillDups<false>>();
+        add<InsertBuildParallelKeyGeneration>();
+        add<InsertBuildParallelKeyGenerationEnforceUnique>();
         add<InsertBuildIndexInterrupt>();
         add<InsertBuildIndexInterruptDisallowed>();
         add<InsertBuildIdIndexInterrupt>();
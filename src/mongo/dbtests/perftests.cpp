@@ -48,16 +48,20 @@
 
 #include "mongo/config.h"
 #include "mongo/db/bson/dotted_path_support.h"
+#include "mongo/db/catalog/cursor_manager.h"
 #include "mongo/db/client.h"
+#include "mongo/db/clientcursor.h"
 #include "mongo/db/db.h"
 #include "mongo/db/dbdirectclient.h"
 #include "mongo/db/lasterror.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/storage/mmap_v1/dur_stats.h"
 #include "mongo/db/storage/mmap_v1/mmap.h"
 #include "mongo/db/storage/storage_options.h"
 #include "mongo/dbtests/dbtests.h"
 #include "mongo/dbtests/framework_options.h"
 #include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/memory.h"
 #include "mongo/stdx/thread.h"
 #include "mongo/util/log.h"
 #include "mongo/util/timer.h"
@@ -450,6 +454,309 @@ public:
     }
 };
 
+/**
+ * Simulates the cursor traffic of find and getMore: each iteration registers a cursor, pins and
+ * unpins it a few times, and then deletes it. The threaded phase measures how well the
+ * CursorManager scales when many clients use cursors on the same collection.
+ */
+class cursormanagergetmore : public B {
+public:
+    string name() {
+        return "cursormanager-getmore";
+    }
+    string name2() {
+        return "cursormanager-getmore2";
+    }
+    virtual int howLongMillis() {
+        return 500;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    virtual bool testThreaded() {
+        return true;
+    }
+    void prep() {
+        _cursorManager = stdx::make_unique<CursorManager>(ns());
+    }
+    void timed() {
+        CursorManager* cursorManager = _cursorManager.get();
+        ClientCursor* cc = new ClientCursor(cursorManager, nullptr, ns(), false);
+        const CursorId id = cc->cursorid();
+        for (int i = 0; i < 4; i++) {
+            ClientCursorPin pin(cursorManager, id);
+        }
+        ClientCursorPin pin(cursorManager, id);
+        pin.deleteUnderlying();
+    }
+    void timed2(DBClientBase*) {
+        timed();
+    }
+
+private:
+    std::unique_ptr<CursorManager> _cursorManager;
+};
+
+/**
+ * Counts the documents of a collection which match a filter on several fields, which runs the
+ * filter against every document in a COLLSCAN. The first phase uses the compiled filter and the
+ * second phase evaluates the MatchExpression directly.
+ */
+class collscanfilter : public B {
+    const int kNumDocs = 10000;
+    // Documents with i % 10 == 3 and i % 7 < 3.
+    const unsigned long long kNumMatches = 428;
+
+public:
+    string name() {
+        return "collscan-filter-compiled";
+    }
+    string name2() {
+        return "collscan-filter-interpreted";
+    }
+    virtual int howLongMillis() {
+        return 2000;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    virtual unsigned batchSize() {
+        return 1;
+    }
+    void prep() {
+        for (int i = 0; i < kNumDocs; i++) {
+            BSONObjBuilder doc;
+            doc.append("_id", i);
+            doc.append("a", i);
+            doc.append("b", std::string(str::stream() << "s" << i % 10));
+            doc.append("c", BSON("d" << i % 7 << "e" << static_cast<double>(i)));
+            doc.append("f", true);
+            client()->insert(ns(), doc.obj());
+        }
+        _filter = BSON("a" << BSON("$gte" << 0) << "b"
+                           << "s3"
+                           << "c.d"
+                           << BSON("$lt" << 3)
+                           << "c.e"
+                           << BSON("$gte" << 0.0)
+                           << "f"
+                           << BSON("$exists" << true));
+    }
+    void timed() {
+        ASSERT_EQUALS(kNumMatches, client()->count(ns(), _filter));
+    }
+    void timed2(DBClientBase* c) {
+        internalQueryExecCompileCollScanFilter.store(false);
+        ASSERT_EQUALS(kNumMatches, c->count(ns(), _filter));
+        internalQueryExecCompileCollScanFilter.store(true);
+    }
+
+private:
+    BSONObj _filter;
+};
+
+/**
+ * Aggregates over documents with many fields, of which the pipeline only looks up a few near the
+ * start of each document and keeps a few documents whole. The first phase reads documents lazily
+ * from the collection and the second phase converts all of their fields up front.
+ */
+class aggwidedocuments : public B {
+    const int kNumDocs = 2000;
+    const int kNumFields = 200;
+    const int kNumGroups = 10;
+
+public:
+    string name() {
+        return "agg-wide-documents-lazy";
+    }
+    string name2() {
+        return "agg-wide-documents-eager";
+    }
+    virtual int howLongMillis() {
+        return 2000;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    virtual unsigned batchSize() {
+        return 1;
+    }
+    void prep() {
+        for (int i = 0; i < kNumDocs; i++) {
+            BSONObjBuilder doc;
+            doc.append("_id", i);
+            doc.append("group", i % kNumGroups);
+            for (int field = 0; field < kNumFields; field++) {
+                doc.append(std::string(str::stream() << "field" << field),
+                           std::string(str::stream() << "value " << i << " " << field));
+            }
+            client()->insert(ns(), doc.obj());
+        }
+        _command =
+            BSON("aggregate" << nsToCollectionSubstring(ns()) << "pipeline"
+                             << BSON_ARRAY(BSON("$group" << BSON("_id"
+                                                                 << "$group"
+                                                                 << "count"
+                                                                 << BSON("$sum" << 1)
+                                                                 << "first"
+                                                                 << BSON("$first"
+                                                                         << "$$ROOT"))))
+                             << "cursor"
+                             << BSONObj());
+    }
+    void timed() {
+        BSONObj result;
+        ASSERT(client()->runCommand(nsToDatabase(ns()), _command, result));
+    }
+    void timed2(DBClientBase* c) {
+        internalDocumentSourceCursorLazyDocuments.store(false);
+        BSONObj result;
+        ASSERT(c->runCommand(nsToDatabase(ns()), _command, result));
+        internalDocumentSourceCursorLazyDocuments.store(true);
+    }
+
+private:
+    BSONObj _command;
+};
+
+/**
+ * Aggregates with a $project of many arithmetic and comparison expressions over a few numeric
+ * fields. The first phase compiles the expressions and the second phase evaluates the expression
+ * trees, as selected by the aggregate command's 'compileExpressions' option.
+ */
+class aggcompiledexpressions : public B {
+    const int kNumDocs = 2000;
+    const int kNumComputedFields = 30;
+
+public:
+    string name() {
+        return "agg-expressions-compiled";
+    }
+    string name2() {
+        return "agg-expressions-interpreted";
+    }
+    virtual int howLongMillis() {
+        return 2000;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    virtual unsigned batchSize() {
+        return 1;
+    }
+    void prep() {
+        for (int i = 0; i < kNumDocs; i++) {
+            client()->insert(ns(), BSON("_id" << i << "a" << i << "b" << i * 0.5 << "c" << 7LL));
+        }
+
+        BSONObjBuilder projection;
+        for (int field = 0; field < kNumComputedFields; field++) {
+            const std::string name = str::stream() << "f" << field;
+            if (field % 3 == 2) {
+                BSONObj product = BSON("$multiply" << BSON_ARRAY("$b" << field));
+                projection.append(name, BSON("$gt" << BSON_ARRAY("$a" << product)));
+            } else {
+                projection.append(
+                    name,
+                    BSON("$add" << BSON_ARRAY(BSON("$multiply" << BSON_ARRAY("$a" << field))
+                                              << BSON("$subtract" << BSON_ARRAY("$b"
+                                                                                << "$c")))));
+            }
+        }
+        _pipeline = BSON_ARRAY(BSON("$project" << projection.obj()));
+    }
+    void runAggregate(DBClientBase* c, bool compileExpressions) {
+        BSONObj result;
+        ASSERT(c->runCommand(nsToDatabase(ns()),
+                             BSON("aggregate" << nsToCollectionSubstring(ns()) << "pipeline"
+                                              << _pipeline
+                                              << "cursor"
+                                              << BSON("batchSize" << kNumDocs)
+                                              << "compileExpressions"
+                                              << compileExpressions),
+                             result));
+    }
+    void timed() {
+        runAggregate(client(), true);
+    }
+    void timed2(DBClientBase* c) {
+        runAggregate(c, false);
+    }
+
+private:
+    BSONArray _pipeline;
+};
+
+/**
+ * Joins every document with a $lookup on an indexed dimension collection. The first phase builds a
+ * hash table of the dimension collection once and the second phase looks up each document in the
+ * dimension collection's index.
+ */
+class agglookuphashjoin : public B {
+    const int kNumDocs = 2000;
+    const int kNumDimensionDocs = 10000;
+
+public:
+    string name() {
+        return "agg-lookup-hash-join";
+    }
+    string name2() {
+        return "agg-lookup-nested-loop";
+    }
+    virtual int howLongMillis() {
+        return 2000;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    virtual unsigned batchSize() {
+        return 1;
+    }
+    void prep() {
+        const std::string dimensionNs = ns() + std::string("_dim");
+        client()->dropCollection(dimensionNs);
+        for (int i = 0; i < kNumDimensionDocs; i++) {
+            client()->insert(dimensionNs,
+                             BSON("_id" << i << "key" << i << "name"
+                                        << "dimension"));
+        }
+        client()->createIndex(dimensionNs, BSON("key" << 1));
+        for (int i = 0; i < kNumDocs; i++) {
+            client()->insert(ns(), BSON("_id" << i << "key" << (i * 7) % kNumDimensionDocs));
+        }
+
+        _command = BSON(
+            "aggregate" << nsToCollectionSubstring(ns()) << "pipeline"
+                        << BSON_ARRAY(BSON("$lookup" << BSON("from"
+                                                             << nsToCollectionSubstring(dimensionNs)
+                                                             << "localField"
+                                                             << "key"
+                                                             << "foreignField"
+                                                             << "key"
+                                                             << "as"
+                                                             << "dimension")))
+                        << "cursor"
+                        << BSON("batchSize" << kNumDocs));
+    }
+    void runAggregate(DBClientBase* c, bool hashJoin) {
+        internalDocumentSourceLookupForceHashJoin.store(hashJoin);
+        internalDocumentSourceLookupHashJoinMaxMemoryBytes.store(hashJoin ? 100 * 1024 * 1024 : 0);
+        BSONObj result;
+        ASSERT(c->runCommand(nsToDatabase(ns()), _command, result));
+        internalDocumentSourceLookupForceHashJoin.store(false);
+        internalDocumentSourceLookupHashJoinMaxMemoryBytes.store(100 * 1024 * 1024);
+    }
+    void timed() {
+        runAggregate(client(), true);
+    }
+    void timed2(DBClientBase* c) {
+        runAggregate(c, false);
+    }
+
+private:
+    BSONObj _command;
+};
+
 
 class All : public Suite {
 public:
@@ -463,6 +770,11 @@ public:
         add<boosttimed_mutexspeed>();
         add<stdmutexspeed>();
         add<stdtimed_mutexspeed>();
+        add<cursormanagergetmore>();
+        add<collscanfilter>();
+        add<aggwidedocuments>();
+        add<aggcompiledexpressions>();
+        add<agglookuphashjoin>();
     }
 } myall;
 }
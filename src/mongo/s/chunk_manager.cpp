@@ -32,7 +32,9 @@
 
 #include "mongo/s/chunk_manager.h"
 
+#include <cstring>
 #include <iterator>
+#include <limits>
 #include <map>
 #include <set>
 
@@ -47,6 +49,7 @@
 #include "mongo/db/query/index_bounds_builder.h"
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/query/query_planner_common.h"
+#include "mongo/db/storage/key_string.h"
 #include "mongo/rpc/get_status_from_command_result.h"
 #include "mongo/s/balancer/balancer_configuration.h"
 #include "mongo/s/catalog/catalog_cache.h"
@@ -213,7 +216,7 @@ void ChunkManager::loadExistingRanges(OperationContext* txn, const ChunkManager*
                 _chunkMap.swap(chunkMap);
                 _shardIds.swap(shardIds);
                 _shardVersions.swap(shardVersions);
-                _chunkRangeMap = _constructRanges(_chunkMap);
+                _constructRoutingTable(oldManager);
                 return;
             }
         }
@@ -474,13 +477,14 @@ shared_ptr<Chunk> ChunkManager::findIntersectingChunk(OperationContext* txn,
             }
         }
 
-        BSONObj chunkMin;
         shared_ptr<Chunk> chunk;
         {
-            ChunkMap::const_iterator it = _chunkMap.upper_bound(shardKey);
-            if (it != _chunkMap.end()) {
-                chunkMin = it->first;
-                chunk = it->second;
+            KeyString key(KeyString::Version::V1);
+            _encodeShardKey(shardKey, &key);
+
+            const size_t pos = _chunkMaxKeys.upperBound(key);
+            if (pos != _chunks.size()) {
+                chunk = _chunks[pos];
             }
         }
 
@@ -489,7 +493,7 @@ shared_ptr<Chunk> ChunkManager::findIntersectingChunk(OperationContext* txn,
                 return chunk;
             }
 
-            log() << redact(chunkMin.toString());
+            log() << redact(chunk->getMax().toString());
             log() << redact((*chunk).toString());
             log() << redact(shardKey);
 
@@ -580,26 +584,31 @@ void ChunkManager::getShardIdsForQuery(OperationContext* txn,
     // For now, we satisfy that assumption by adding a shard with no matches rather than returning
     // an empty set of shards.
     if (shardIds->empty()) {
-        shardIds->insert(_chunkRangeMap.begin()->second.getShardId());
+        shardIds->insert(_chunkRanges.front().getShardId());
     }
 }
 
 void ChunkManager::getShardIdsForRange(set<ShardId>& shardIds,
                                        const BSONObj& min,
                                        const BSONObj& max) const {
-    auto it = _chunkRangeMap.upper_bound(min);
-    auto end = _chunkRangeMap.upper_bound(max);
+    KeyString key(KeyString::Version::V1);
+
+    _encodeShardKey(min, &key);
+    size_t it = _chunkRangeMaxKeys.upperBound(key);
+
+    _encodeShardKey(max, &key);
+    size_t end = _chunkRangeMaxKeys.upperBound(key);
 
-    // The chunk range map must always cover the entire key space
-    invariant(it != _chunkRangeMap.end());
+    // The chunk ranges must always cover the entire key space
+    invariant(it != _chunkRanges.size());
 
     // We need to include the last chunk
-    if (end != _chunkRangeMap.cend()) {
+    if (end != _chunkRanges.size()) {
         ++end;
     }
 
     for (; it != end; ++it) {
-        shardIds.insert(it->second.getShardId());
+        shardIds.insert(_chunkRanges[it].getShardId());
 
         // No need to iterate through the rest of the ranges, because we already know we need to use
         // all shards.
@@ -757,41 +766,126 @@ string ChunkManager::toString() const {
     return sb.str();
 }
 
-ChunkManager::ChunkRangeMap ChunkManager::_constructRanges(const ChunkMap& chunkMap) {
-    ChunkRangeMap chunkRangeMap;
+void ChunkManager::KeyStringIndex::clear() {
+    _ends.clear();
+    _buffer.clear();
+}
 
-    if (chunkMap.empty()) {
-        return chunkRangeMap;
+void ChunkManager::KeyStringIndex::reserve(size_t numKeys) {
+    _ends.reserve(numKeys);
+}
+
+void ChunkManager::KeyStringIndex::append(const char* key, size_t size) {
+    invariant(_buffer.size() + size <= std::numeric_limits<uint32_t>::max());
+    _buffer.append(key, size);
+    _ends.push_back(static_cast<uint32_t>(_buffer.size()));
+}
+
+size_t ChunkManager::KeyStringIndex::upperBound(const KeyString& key) const {
+    const char* const keyBuf = key.getBuffer();
+    const size_t keyLen = key.getSize();
+
+    // Same ordering as KeyString::compare().
+    size_t low = 0;
+    size_t high = size();
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        const size_t midLen = keySize(mid);
+        int cmp = memcmp(keyData(mid), keyBuf, std::min(midLen, keyLen));
+        if (cmp == 0) {
+            cmp = midLen < keyLen ? -1 : (midLen > keyLen ? 1 : 0);
+        }
+
+        if (cmp <= 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
     }
 
-    ChunkMap::const_iterator current = chunkMap.cbegin();
+    return low;
+}
+
+void ChunkManager::_encodeShardKey(const BSONObj& shardKey, KeyString* out) {
+    // Shard key ranges are always compared in ascending order.
+    static const Ordering kAllAscending = Ordering::make(BSONObj());
+    out->resetToKey(shardKey, kAllAscending);
+}
 
-    while (current != chunkMap.cend()) {
-        const auto rangeFirst = current;
-        current = std::find_if(
-            current, chunkMap.cend(), [&rangeFirst](const ChunkMap::value_type& chunkMapEntry) {
-                return chunkMapEntry.second->getShardId() != rangeFirst->second->getShardId();
-            });
-        const auto rangeLast = std::prev(current);
+void ChunkManager::_constructRoutingTable(const ChunkManager* oldManager) {
+    _chunkMaxKeys.clear();
+    _chunks.clear();
+    _chunkRangeMaxKeys.clear();
+    _chunkRanges.clear();
 
-        const BSONObj rangeMin = rangeFirst->second->getMin();
-        const BSONObj rangeMax = rangeLast->second->getMax();
+    if (_chunkMap.empty()) {
+        return;
+    }
 
-        auto insertResult = chunkRangeMap.insert(std::make_pair(
-            rangeMax, ShardAndChunkRange(rangeMin, rangeMax, rangeFirst->second->getShardId())));
-        invariant(insertResult.second);
-        if (insertResult.first != chunkRangeMap.begin()) {
-            // Make sure there are no gaps in the ranges
-            insertResult.first--;
-            invariant(insertResult.first->first == rangeMin);
+    _chunkMaxKeys.reserve(_chunkMap.size());
+    _chunks.reserve(_chunkMap.size());
+
+    // Both _chunkMap and the old routing table are sorted by max key, so walk them in step. Chunks
+    // which were not touched by the diff have a binary identical max key in the old table.
+    const std::vector<shared_ptr<Chunk>> noChunks;
+    const std::vector<shared_ptr<Chunk>>& oldChunks = oldManager ? oldManager->_chunks : noChunks;
+    size_t oldPos = 0;
+    size_t numEncoded = 0;
+
+    KeyString key(KeyString::Version::V1);
+
+    for (const auto& chunkMapEntry : _chunkMap) {
+        const BSONObj& max = chunkMapEntry.first;
+
+        if (oldPos < oldChunks.size() && !oldChunks[oldPos]->getMax().binaryEqual(max)) {
+            while (oldPos < oldChunks.size() && oldChunks[oldPos]->getMax().woCompare(max) < 0) {
+                ++oldPos;
+            }
+        }
+
+        if (oldPos < oldChunks.size() && oldChunks[oldPos]->getMax().binaryEqual(max)) {
+            const KeyStringIndex& oldKeys = oldManager->_chunkMaxKeys;
+            _chunkMaxKeys.append(oldKeys.keyData(oldPos), oldKeys.keySize(oldPos));
+            ++oldPos;
+        } else {
+            _encodeShardKey(max, &key);
+            _chunkMaxKeys.append(key.getBuffer(), key.getSize());
+            ++numEncoded;
         }
+
+        _chunks.push_back(chunkMapEntry.second);
     }
 
-    invariant(!chunkRangeMap.empty());
-    invariant(allOfType(MinKey, chunkRangeMap.begin()->second.getMin()));
-    invariant(allOfType(MaxKey, chunkRangeMap.rbegin()->first));
+    LOG(2) << "built routing table for " << _ns << " with " << _chunks.size() << " chunks, "
+           << numEncoded << " of which needed their key encoded";
+
+    // Merge consecutive chunks, which reside on the same shard into a single range. The max key of
+    // a range is the max key of its last chunk, so its encoding can be taken from the chunk table.
+    size_t current = 0;
+    while (current < _chunks.size()) {
+        const size_t rangeFirst = current;
+        const ShardId& shardId = _chunks[rangeFirst]->getShardId();
+        while (current < _chunks.size() && _chunks[current]->getShardId() == shardId) {
+            ++current;
+        }
+        const size_t rangeLast = current - 1;
+
+        const BSONObj rangeMin = _chunks[rangeFirst]->getMin();
+        const BSONObj rangeMax = _chunks[rangeLast]->getMax();
+
+        // Make sure there are no gaps in the ranges
+        if (!_chunkRanges.empty()) {
+            invariant(_chunkRanges.back().getMax().woCompare(rangeMin) == 0);
+        }
+
+        _chunkRanges.push_back(ShardAndChunkRange(rangeMin, rangeMax, shardId));
+        _chunkRangeMaxKeys.append(_chunkMaxKeys.keyData(rangeLast),
+                                  _chunkMaxKeys.keySize(rangeLast));
+    }
 
-    return chunkRangeMap;
+    invariant(!_chunkRanges.empty());
+    invariant(allOfType(MinKey, _chunkRanges.front().getMin()));
+    invariant(allOfType(MaxKey, _chunkRanges.back().getMax()));
 }
 
 uint64_t ChunkManager::getCurrentDesiredChunkSize() const {
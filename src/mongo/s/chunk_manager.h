@@ -48,6 +48,7 @@ class CanonicalQuery;
 class Chunk;
 class ChunkManager;
 class CollectionType;
+class KeyString;
 struct QuerySolutionNode;
 class OperationContext;
 
@@ -229,15 +230,59 @@ private:
         ShardId _shardId;
     };
 
-    // Contains a compressed map of what range of keys resides on which shard. The index is the max
-    // key of the respective range and the union of all ranges in a such constructed map must cover
-    // the complete space from [MinKey, MaxKey).
-    using ChunkRangeMap = std::map<BSONObj, ShardAndChunkRange, BSONObjCmp>;
+    /**
+     * Sorted array of KeyString-encoded shard keys, stored back to back in a single buffer. Used for
+     * routing instead of a BSONObj-keyed std::map, so that a lookup is a binary search over
+     * contiguous memory comparing keys with memcmp, rather than a tree walk doing full BSON
+     * comparisons.
+     */
+    class KeyStringIndex {
+    public:
+        void clear();
+        void reserve(size_t numKeys);
+
+        /**
+         * Appends a key, which must not be less than the last key appended.
+         */
+        void append(const char* key, size_t size);
+
+        size_t size() const {
+            return _ends.size();
+        }
+
+        const char* keyData(size_t i) const {
+            return _buffer.data() + _begin(i);
+        }
+
+        size_t keySize(size_t i) const {
+            return _ends[i] - _begin(i);
+        }
+
+        /**
+         * Returns the position of the first key which is strictly greater than 'key', or size() if
+         * there is no such key.
+         */
+        size_t upperBound(const KeyString& key) const;
+
+    private:
+        uint32_t _begin(size_t i) const {
+            return i == 0 ? 0 : _ends[i - 1];
+        }
+
+        // Offset one past the end of each key in '_buffer'.
+        std::vector<uint32_t> _ends;
+        std::string _buffer;
+    };
 
     /**
-     * If load was successful, returns true and it is guaranteed that the _chunkMap and
-     * _chunkRangeMap are consistent with each other. If false is returned, it is not safe to use
-     * the chunk manager anymore.
+     * Encodes a shard key the way it is stored in the routing table.
+     */
+    static void _encodeShardKey(const BSONObj& shardKey, KeyString* out);
+
+    /**
+     * If load was successful, returns true and it is guaranteed that the _chunkMap is valid. The
+     * caller must then rebuild the routing table from it using _constructRoutingTable. If false is
+     * returned, it is not safe to use the chunk manager anymore.
      */
     bool _load(OperationContext* txn,
                ChunkMap& chunks,
@@ -246,9 +291,11 @@ private:
                const ChunkManager* oldManager);
 
     /**
-     * Merges consecutive chunks, which reside on the same shard into a single range.
+     * Rebuilds the routing table and the shard ranges from _chunkMap. If 'oldManager' is given, the
+     * encoded keys of chunks which did not change since it was loaded are copied from its routing
+     * table, so only the chunks which came in with the diff need to be encoded.
      */
-    static ChunkRangeMap _constructRanges(const ChunkMap& chunkMap);
+    void _constructRoutingTable(const ChunkManager* oldManager);
 
     // All members should be const for thread-safety
     const std::string _ns;
@@ -262,7 +309,17 @@ private:
     const unsigned long long _sequenceNumber;
 
     ChunkMap _chunkMap;
-    ChunkRangeMap _chunkRangeMap;
+
+    // Flat routing table built from _chunkMap. Position i of '_chunkMaxKeys' holds the encoded max
+    // key of '_chunks[i]'.
+    KeyStringIndex _chunkMaxKeys;
+    std::vector<std::shared_ptr<Chunk>> _chunks;
+
+    // Consecutive chunks which reside on the same shard, merged into a single range. Position i of
+    // '_chunkRangeMaxKeys' holds the encoded max key of '_chunkRanges[i]'. The union of all ranges
+    // covers the complete space from [MinKey, MaxKey).
+    KeyStringIndex _chunkRangeMaxKeys;
+    std::vector<ShardAndChunkRange> _chunkRanges;
 
     std::set<ShardId> _shardIds;
 
@@ -39,6 +39,8 @@
 #include "mongo/s/chunk_manager.h"
 #include "mongo/s/write_ops/batched_command_request.h"
 #include "mongo/s/write_ops/batched_command_response.h"
+#include "mongo/util/log.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -243,6 +245,120 @@ TEST_F(ChunkManagerTests, Basic) {
     std::cout << "completely done";
 }
 
+/**
+ * Tests that routing through the flat routing table finds the right chunk for every key, both for a
+ * freshly loaded ChunkManager and for one built incrementally from an old ChunkManager, and reports
+ * the routing throughput of the insert targeting path.
+ */
+TEST_F(ChunkManagerTests, RoutingTableLookup) {
+    OperationContextNoop txn;
+    string keyName = "_id";
+    vector<BSONObj> splitKeys;
+    genUniqueRandomSplitKeys(keyName, &splitKeys);
+    ShardKeyPattern shardKeyPattern(BSON(keyName << 1));
+    std::unique_ptr<CollatorInterface> defaultCollator;
+
+    std::vector<BSONObj> shards{
+        BSON(ShardType::name() << _shardId << ShardType::host()
+                               << ConnectionString(HostAndPort("hostFooBar:27017")).toString())};
+
+    std::vector<BSONObj> chunks;
+    auto future = launchAsync([&] {
+        ChunkManager manager(_collName, shardKeyPattern, std::move(defaultCollator), false);
+        auto status = manager.createFirstChunks(operationContext(), _shardId, &splitKeys, NULL);
+        ASSERT_OK(status);
+    });
+
+    for (int i = 0; i < static_cast<int>(splitKeys.size()) + 1; i++) {
+        expectInsertOnConfigSaveChunkAndReturnOk(chunks);
+    }
+
+    future.timed_get(kFutureTimeout);
+
+    ChunkVersion version = ChunkVersion::fromBSON(chunks.back(), ChunkType::DEPRECATED_lastmod());
+
+    CollectionType collType;
+    collType.setNs(NamespaceString{_collName});
+    collType.setEpoch(version.epoch());
+    collType.setUpdatedAt(jsTime());
+    collType.setKeyPattern(BSON(keyName << 1));
+    collType.setUnique(false);
+    collType.setDropped(false);
+
+    // Every split key is the min of exactly one chunk, and the key just below it lives in the
+    // preceding chunk.
+    auto checkLookups = [&](const ChunkManager& manager) {
+        for (const auto& splitKey : splitKeys) {
+            auto chunk = manager.findIntersectingChunkWithSimpleCollation(&txn, splitKey);
+            ASSERT_EQ(splitKey, chunk->getMin());
+
+            BSONObj below = BSON(keyName << splitKey[keyName].numberInt() - 1);
+            chunk = manager.findIntersectingChunkWithSimpleCollation(&txn, below);
+            ASSERT_EQ(splitKey, chunk->getMax());
+        }
+
+        auto chunk =
+            manager.findIntersectingChunkWithSimpleCollation(&txn, BSON(keyName << MINKEY));
+        ASSERT_EQ(shardKeyPattern.getKeyPattern().globalMin(), chunk->getMin());
+
+        std::set<ShardId> shardIds;
+        manager.getShardIdsForRange(shardIds,
+                                    shardKeyPattern.getKeyPattern().globalMin(),
+                                    shardKeyPattern.getKeyPattern().globalMax());
+        ASSERT_EQ(1U, shardIds.size());
+        ASSERT_EQ(_shardId, *shardIds.begin());
+    };
+
+    ChunkManager manager(&txn, collType);
+    future = launchAsync([&] {
+        manager.loadExistingRanges(operationContext(), nullptr);
+        checkLookups(manager);
+
+        // Time the work ChunkManagerTargeter::targetInsert does to route a document.
+        const int kNumLookups = 100 * 1000;
+        Timer t;
+        for (int i = 0; i < kNumLookups; i++) {
+            BSONObj doc = BSON(keyName << rand(numSplitPoints * 10) << "x" << i);
+            BSONObj shardKey = manager.getShardKeyPattern().extractShardKeyFromDoc(doc);
+            auto chunk = manager.findIntersectingChunkWithSimpleCollation(&txn, shardKey);
+            ASSERT_EQ(_shardId, chunk->getShardId());
+        }
+        log() << "routed " << kNumLookups << " inserts over " << manager.numChunks()
+              << " chunks in " << t.micros() << " micros";
+    });
+    expectFindOnConfigSendBSONObjVector(chunks);
+    expectFindOnConfigSendBSONObjVector(shards);
+    future.timed_get(kFutureTimeout);
+
+    // Bump the version of one chunk, so that the new ChunkManager has to merge a diff into the
+    // routing table of the old one.
+    ChunkVersion laterVersion = ChunkVersion(2, 1, version.epoch());
+    BSONObj oldChunk = chunks.front();
+    BSONObjBuilder newChunk;
+    newChunk.append("_id", oldChunk.getStringField("_id"));
+    newChunk.append("ns", oldChunk.getStringField("ns"));
+    newChunk.append("min", oldChunk.getObjectField("min"));
+    newChunk.append("max", oldChunk.getObjectField("max"));
+    newChunk.append("shard", oldChunk.getStringField("shard"));
+    laterVersion.addToBSON(newChunk, ChunkType::DEPRECATED_lastmod());
+    newChunk.append("lastmodEpoch", oldChunk.getField("lastmodEpoch").OID());
+
+    future = launchAsync([&] {
+        ChunkManager newManager(manager.getns(),
+                                manager.getShardKeyPattern(),
+                                manager.getDefaultCollator() ? manager.getDefaultCollator()->clone()
+                                                             : nullptr,
+                                manager.isUnique());
+        newManager.loadExistingRanges(operationContext(), &manager);
+
+        ASSERT_EQ(manager.numChunks(), newManager.numChunks());
+        ASSERT_EQ(laterVersion.toString(), newManager.getVersion().toString());
+        checkLookups(newManager);
+    });
+    expectFindOnConfigSendBSONObjVector(std::vector<BSONObj>{chunks.back(), newChunk.obj()});
+    future.timed_get(kFutureTimeout);
+}
+
 /**
  * Tests that chunk metadata is created correctly when using ChunkManager to create chunks for the
  * first time. Creating chunks on multiple shards is not tested here since there are unresolved
@@ -44,6 +44,9 @@
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/query/collation/collator_factory_interface.h"
+#include "mongo/db/query/cursor_response.h"
+#include "mongo/db/query/find_common.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/views/resolved_view.h"
 #include "mongo/db/views/view.h"
 #include "mongo/executor/task_executor_pool.h"
@@ -57,8 +60,13 @@
 #include "mongo/s/commands/sharded_command_processing.h"
 #include "mongo/s/config.h"
 #include "mongo/s/grid.h"
+#include "mongo/s/query/cluster_client_cursor_impl.h"
+#include "mongo/s/query/cluster_cursor_manager.h"
+#include "mongo/s/query/router_stage_aggregation.h"
+#include "mongo/s/query/router_stage_merge.h"
 #include "mongo/s/query/store_possible_cursor.h"
 #include "mongo/s/stale_exception.h"
+#include "mongo/stdx/memory.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
@@ -71,6 +79,78 @@ using std::vector;
 
 namespace {
 
+/**
+ * Returns true if the merging half of a split pipeline, 'mergePipeline', can run on mongos. That is
+ * the case when it only merges the shards' sorted results and limits, skips, reshapes or
+ * re-groups them, without ever needing to spill to disk.
+ */
+bool canMergeOnMongos(Pipeline* mergePipeline) {
+    if (!internalQueryAggMergeOnMongos.load()) {
+        return false;
+    }
+
+    const auto& expCtx = mergePipeline->getContext();
+    for (auto&& source : mergePipeline->getSources()) {
+        if (auto sort = dynamic_cast<DocumentSourceSort*>(source.get())) {
+            // The AsyncResultsMerger can only merge streams which are already sorted, and compares
+            // sort keys as BSON, so neither collations nor computed sort keys can be honored.
+            if (source != mergePipeline->getSources().front() || !sort->isMergingPresorted() ||
+                expCtx->getCollator()) {
+                return false;
+            }
+            for (auto&& elem : sort->serializeSortKey(false).toBson()) {
+                if (!elem.isNumber()) {
+                    return false;
+                }
+            }
+            continue;
+        }
+
+        const StringData sourceName = source->getSourceName();
+        if (sourceName == "$group") {
+            // A $group on mongos cannot spill to disk.
+            if (expCtx->extSortAllowed) {
+                return false;
+            }
+            continue;
+        }
+
+        if (sourceName != "$limit" && sourceName != "$skip" && sourceName != "$project" &&
+            sourceName != "$addFields" && sourceName != "$unwind") {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns the key of 'obj' under 'sort', which has 'numComponents' components, as an object with
+ * one element per component for an AsyncResultsMerger to compare. Missing components become
+ * undefined, which sorts the same way.
+ */
+BSONObj extractSortKeyForMerge(const DocumentSourceSort& sort,
+                               int numComponents,
+                               const BSONObj& obj) {
+    BSONObjBuilder keyBuilder;
+    auto appendComponent = [&keyBuilder](const Value& component) {
+        if (component.missing()) {
+            keyBuilder.appendUndefined("");
+        } else {
+            component.addToBsonObj(&keyBuilder, "");
+        }
+    };
+
+    const Value key = sort.extractKey(Document(obj));
+    if (numComponents == 1) {
+        appendComponent(key);
+    } else {
+        for (auto&& component : key.getArray()) {
+            appendComponent(component);
+        }
+    }
+    return keyBuilder.obj();
+}
+
 /**
  * Implements the aggregation (pipeline command for sharding).
  */
@@ -198,6 +278,11 @@ public:
         intrusive_ptr<Pipeline> shardPipeline(needSplit ? pipeline.getValue()->splitForSharded()
                                                         : pipeline.getValue());
 
+        // Merge on this mongos rather than on a shard if the merger side is simple enough, saving
+        // a network hop and keeping merging work off the shards.
+        const bool mergeOnMongos = needSplit && !needPrimaryShardMerger &&
+            request.getValue().isCursorCommand() && canMergeOnMongos(pipeline.getValue().get());
+
         // Create the command for the shards. The 'fromRouter' field means produce output to be
         // merged.
         MutableDocument commandBuilder(request.getValue().serializeToCommandObj());
@@ -208,6 +293,12 @@ public:
                 Value(DOC(AggregationRequest::kBatchSizeName << 0));
         }
 
+        // Only this mongos is known to read the array form of the $avg and $stdDev partial
+        // aggregates. A merging shard may still run an earlier version during a rolling upgrade.
+        if (mergeOnMongos) {
+            commandBuilder[AggregationRequest::kMergerAcceptsArrayPartialsName] = Value(true);
+        }
+
         // These fields are not part of the AggregationRequest since they are not handled by the
         // aggregation subsystem, so we serialize them separately.
         const std::initializer_list<StringData> fieldsToPropagateToShards = {
@@ -237,7 +328,10 @@ public:
             uassertAllShardsSupportExplain(shardResults);
 
             if (needSplit) {
-                result << "needsPrimaryShardMerger" << needPrimaryShardMerger << "splitPipeline"
+                result << "needsPrimaryShardMerger" << needPrimaryShardMerger << "mergeType"
+                       << (mergeOnMongos ? "mongos" : needPrimaryShardMerger ? "primaryShard"
+                                                                             : "anyShard")
+                       << "splitPipeline"
                        << DOC("shardsPart" << shardPipeline->writeExplainOps() << "mergerPart"
                                            << pipeline.getValue()->writeExplainOps());
             } else {
@@ -267,6 +361,11 @@ public:
             return reply["ok"].trueValue();
         }
 
+        if (mergeOnMongos) {
+            return runMergeOnMongos(
+                txn, request.getValue(), pipeline.getValue(), shardResults, result);
+        }
+
         pipeline.getValue()->addInitialSource(
             DocumentSourceMergeCursors::create(parseCursors(shardResults), mergeCtx));
 
@@ -330,6 +429,16 @@ private:
     std::vector<DocumentSourceMergeCursors::CursorDescriptor> parseCursors(
         const vector<Strategy::CommandResult>& shardResults);
 
+    /**
+     * Runs 'mergePipeline' on this mongos over the cursors the shards returned in 'shardResults',
+     * and appends the first batch of its results and a cursor for the rest to 'result'.
+     */
+    bool runMergeOnMongos(OperationContext* txn,
+                          const AggregationRequest& request,
+                          intrusive_ptr<Pipeline> mergePipeline,
+                          const vector<Strategy::CommandResult>& shardResults,
+                          BSONObjBuilder& result);
+
     void killAllCursors(const vector<Strategy::CommandResult>& shardResults);
     void uassertAllShardsSupportExplain(const vector<Strategy::CommandResult>& shardResults);
 
@@ -404,6 +513,86 @@ std::vector<DocumentSourceMergeCursors::CursorDescriptor> PipelineCommand::parse
     }
 }
 
+bool PipelineCommand::runMergeOnMongos(OperationContext* txn,
+                                       const AggregationRequest& request,
+                                       intrusive_ptr<Pipeline> mergePipeline,
+                                       const vector<Strategy::CommandResult>& shardResults,
+                                       BSONObjBuilder& result) {
+    const NamespaceString& nss = request.getNamespaceString();
+
+    ClusterClientCursorParams params(nss);
+    params.txn = txn;
+    for (auto&& cursor : parseCursors(shardResults)) {
+        invariant(cursor.connectionString.getServers().size() == 1);
+        params.remotes.emplace_back(cursor.connectionString.getServers()[0], cursor.cursorId);
+    }
+
+    // A leading $sort merges the sorted streams of the shards. The AsyncResultsMerger does that as
+    // batches arrive, computing the sort keys itself since the shards don't attach them to
+    // aggregation results. A limit the $sort absorbed becomes a $limit stage.
+    Pipeline::SourceContainer mergeSources = mergePipeline->getSources();
+    if (!mergeSources.empty()) {
+        if (auto sort = dynamic_cast<DocumentSourceSort*>(mergeSources.front().get())) {
+            intrusive_ptr<DocumentSourceSort> sortStage(sort);
+            params.sort = sortStage->serializeSortKey(false).toBson();
+            const int numComponents = params.sort.nFields();
+            params.sortKeyGenerator = [sortStage, numComponents](const BSONObj& obj) {
+                return extractSortKeyForMerge(*sortStage, numComponents, obj);
+            };
+
+            mergeSources.pop_front();
+            if (sortStage->getLimit() > 0) {
+                mergeSources.push_front(DocumentSourceLimit::create(mergePipeline->getContext(),
+                                                                    sortStage->getLimit()));
+            }
+        }
+    }
+    auto pipelineOnMongos =
+        uassertStatusOK(Pipeline::create(std::move(mergeSources), mergePipeline->getContext()));
+
+    auto executorPool = grid.getExecutorPool();
+    auto ccc = ClusterClientCursorImpl::make(stdx::make_unique<RouterStageAggregation>(
+        stdx::make_unique<RouterStageMerge>(executorPool->getArbitraryExecutor(),
+                                            std::move(params)),
+        std::move(pipelineOnMongos)));
+
+    const long long batchSize =
+        request.getBatchSize().value_or(AggregationRequest::kDefaultBatchSize);
+    BSONArrayBuilder firstBatch;
+    long long numResults = 0;
+    int bytesBuffered = 0;
+    auto cursorState = ClusterCursorManager::CursorState::NotExhausted;
+    while (numResults < batchSize) {
+        auto next = uassertStatusOK(ccc->next());
+        if (next.isEOF()) {
+            cursorState = ClusterCursorManager::CursorState::Exhausted;
+            break;
+        }
+
+        BSONObj nextObj = *next.getResult();
+        if (!FindCommon::haveSpaceForNext(nextObj, numResults, bytesBuffered)) {
+            ccc->queueResult(nextObj);
+            break;
+        }
+
+        bytesBuffered += nextObj.objsize();
+        firstBatch.append(nextObj);
+        ++numResults;
+    }
+
+    CursorId cursorId = 0;
+    if (cursorState == ClusterCursorManager::CursorState::NotExhausted) {
+        cursorId = uassertStatusOK(grid.getCursorManager()->registerCursor(
+            ccc.releaseCursor(),
+            nss,
+            ClusterCursorManager::CursorType::NamespaceSharded,
+            ClusterCursorManager::CursorLifetime::Mortal));
+    }
+
+    appendCursorResponseObject(cursorId, nss.ns(), firstBatch.arr(), &result);
+    return true;
+}
+
 void PipelineCommand::uassertAllShardsSupportExplain(
     const vector<Strategy::CommandResult>& shardResults) {
     for (size_t i = 0; i < shardResults.size(); i++) {
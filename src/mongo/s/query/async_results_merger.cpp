@@ -57,7 +57,8 @@ AsyncResultsMerger::AsyncResultsMerger(executor::TaskExecutor* executor,
                                        ClusterClientCursorParams&& params)
     : _executor(executor),
       _params(std::move(params)),
-      _mergeQueue(MergingComparator(_remotes, _params.sort)) {
+      _mergeQueue(MergingComparator(
+          _remotes, _params.sort, static_cast<bool>(_params.sortKeyGenerator))) {
     for (const auto& remote : _params.remotes) {
         if (remote.shardId) {
             invariant(remote.cmdObj);
@@ -218,6 +219,9 @@ ClusterQueryResult AsyncResultsMerger::nextReadySorted() {
 
     ClusterQueryResult front = _remotes[smallestRemote].docBuffer.front();
     _remotes[smallestRemote].docBuffer.pop();
+    if (_params.sortKeyGenerator) {
+        _remotes[smallestRemote].sortKeyBuffer.pop();
+    }
 
     // Re-populate the merging queue with the next result from 'smallestRemote', if it has a
     // next result.
@@ -513,6 +517,8 @@ void AsyncResultsMerger::handleBatchResponse(
             // Clear the results buffer and cursor id.
             std::queue<ClusterQueryResult> emptyBuffer;
             std::swap(remote.docBuffer, emptyBuffer);
+            std::queue<BSONObj> emptySortKeyBuffer;
+            std::swap(remote.sortKeyBuffer, emptySortKeyBuffer);
             remote.cursorId = 0;
         }
 
@@ -525,9 +531,12 @@ void AsyncResultsMerger::handleBatchResponse(
     remote.initialCmdObj = boost::none;
 
     for (const auto& obj : cursorResponse.getBatch()) {
-        // If there's a sort, we're expecting the remote node to give us back a sort key.
-        if (!_params.sort.isEmpty() &&
-            obj[ClusterClientCursorParams::kSortKeyField].type() != BSONType::Object) {
+        // If there's a sort, we're expecting the remote node to give us back a sort key, unless we
+        // were asked to generate the sort keys ourselves.
+        if (!_params.sort.isEmpty() && _params.sortKeyGenerator) {
+            remote.sortKeyBuffer.push(_params.sortKeyGenerator(obj));
+        } else if (!_params.sort.isEmpty() &&
+                   obj[ClusterClientCursorParams::kSortKeyField].type() != BSONType::Object) {
             remote.status = Status(ErrorCodes::InternalError,
                                    str::stream() << "Missing field '"
                                                  << ClusterClientCursorParams::kSortKeyField
@@ -710,15 +719,21 @@ std::shared_ptr<Shard> AsyncResultsMerger::RemoteCursorData::getShard() {
 //
 
 bool AsyncResultsMerger::MergingComparator::operator()(const size_t& lhs, const size_t& rhs) {
-    const ClusterQueryResult& leftDoc = _remotes[lhs].docBuffer.front();
-    const ClusterQueryResult& rightDoc = _remotes[rhs].docBuffer.front();
-
-    BSONObj leftDocKey = (*leftDoc.getResult())[ClusterClientCursorParams::kSortKeyField].Obj();
-    BSONObj rightDocKey = (*rightDoc.getResult())[ClusterClientCursorParams::kSortKeyField].Obj();
+    BSONObj leftDocKey = frontSortKey(lhs);
+    BSONObj rightDocKey = frontSortKey(rhs);
 
     // This does not need to sort with a collator, since mongod has already mapped strings to their
     // ICU comparison keys as part of the $sortKey meta projection.
     return leftDocKey.woCompare(rightDocKey, _sort, false /*considerFieldName*/) > 0;
 }
 
+BSONObj AsyncResultsMerger::MergingComparator::frontSortKey(size_t index) const {
+    if (_hasGeneratedSortKeys) {
+        return _remotes[index].sortKeyBuffer.front();
+    }
+
+    const ClusterQueryResult& doc = _remotes[index].docBuffer.front();
+    return (*doc.getResult())[ClusterClientCursorParams::kSortKeyField].Obj();
+}
+
 }  // namespace mongo
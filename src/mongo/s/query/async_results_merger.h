@@ -236,6 +236,11 @@ private:
         boost::optional<CursorId> cursorId;
 
         std::queue<ClusterQueryResult> docBuffer;
+
+        // When the merge computes sort keys itself with 'sortKeyGenerator', holds the sort key of
+        // each buffered result, in the same order as 'docBuffer'.
+        std::queue<BSONObj> sortKeyBuffer;
+
         executor::TaskExecutor::CallbackHandle cbHandle;
         Status status = Status::OK();
 
@@ -256,15 +261,25 @@ private:
 
     class MergingComparator {
     public:
-        MergingComparator(const std::vector<RemoteCursorData>& remotes, const BSONObj& sort)
-            : _remotes(remotes), _sort(sort) {}
+        MergingComparator(const std::vector<RemoteCursorData>& remotes,
+                          const BSONObj& sort,
+                          bool hasGeneratedSortKeys)
+            : _remotes(remotes), _sort(sort), _hasGeneratedSortKeys(hasGeneratedSortKeys) {}
 
         bool operator()(const size_t& lhs, const size_t& rhs);
 
     private:
+        /**
+         * Returns the sort key of the next buffered result of the remote at 'index'.
+         */
+        BSONObj frontSortKey(size_t index) const;
+
         const std::vector<RemoteCursorData>& _remotes;
 
         const BSONObj& _sort;
+
+        // Whether the sort keys come from 'sortKeyBuffer' rather than from the results themselves.
+        const bool _hasGeneratedSortKeys;
     };
 
     enum LifecycleState { kAlive, kKillStarted, kKillComplete };
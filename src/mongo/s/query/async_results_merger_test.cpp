@@ -649,6 +649,41 @@ TEST_F(AsyncResultsMergerTest, ExistingCursors) {
 }
 
 
+TEST_F(AsyncResultsMergerTest, ExistingCursorsSortedWithGeneratedSortKeys) {
+    ClusterClientCursorParams params = ClusterClientCursorParams(_nss);
+    params.remotes.emplace_back(kTestShardHosts[0], 5);
+    params.remotes.emplace_back(kTestShardHosts[1], 6);
+    params.sort = BSON("a" << -1);
+    params.sortKeyGenerator = [](const BSONObj& obj) { return BSON("" << obj["a"]); };
+    arm = stdx::make_unique<AsyncResultsMerger>(executor(), std::move(params));
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+    ASSERT_FALSE(arm->ready());
+
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {fromjson("{a: 4}"), fromjson("{a: 1}")};
+    responses.emplace_back(_nss, CursorId(0), batch1);
+    std::vector<BSONObj> batch2 = {fromjson("{a: 3}"), fromjson("{a: 2}")};
+    responses.emplace_back(_nss, CursorId(0), batch2);
+    scheduleNetworkResponses(std::move(responses), CursorResponse::ResponseType::InitialResponse);
+
+    executor()->waitForEvent(readyEvent);
+
+    // The results are merged by the generated sort keys and returned unchanged.
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{a: 4}"), *unittest::assertGet(arm->nextReady()).getResult());
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{a: 3}"), *unittest::assertGet(arm->nextReady()).getResult());
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{a: 2}"), *unittest::assertGet(arm->nextReady()).getResult());
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{a: 1}"), *unittest::assertGet(arm->nextReady()).getResult());
+    ASSERT_TRUE(arm->ready());
+    ASSERT(unittest::assertGet(arm->nextReady()).isEOF());
+}
+
+
 TEST_F(AsyncResultsMergerTest, StreamResultsFromOneShardIfOtherDoesntRespond) {
     BSONObj findCmd = fromjson("{find: 'testcoll', batchSize: 2}");
     makeCursorFromFindCmd(findCmd, {kTestShardIds[0], kTestShardIds[0]});
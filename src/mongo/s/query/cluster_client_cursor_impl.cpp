@@ -65,6 +65,11 @@ ClusterClientCursorGuard ClusterClientCursorImpl::make(executor::TaskExecutor* e
     return ClusterClientCursorGuard(std::move(cursor));
 }
 
+ClusterClientCursorGuard ClusterClientCursorImpl::make(std::unique_ptr<RouterExecStage> root) {
+    std::unique_ptr<ClusterClientCursor> cursor(new ClusterClientCursorImpl(std::move(root)));
+    return ClusterClientCursorGuard(std::move(cursor));
+}
+
 ClusterClientCursorImpl::ClusterClientCursorImpl(executor::TaskExecutor* executor,
                                                  ClusterClientCursorParams&& params)
     : _isTailable(params.isTailable), _root(buildMergerPlan(executor, std::move(params))) {}
@@ -72,6 +77,9 @@ ClusterClientCursorImpl::ClusterClientCursorImpl(executor::TaskExecutor* executo
 ClusterClientCursorImpl::ClusterClientCursorImpl(std::unique_ptr<RouterStageMock> root)
     : _root(std::move(root)) {}
 
+ClusterClientCursorImpl::ClusterClientCursorImpl(std::unique_ptr<RouterExecStage> root)
+    : _root(std::move(root)) {}
+
 StatusWith<ClusterQueryResult> ClusterClientCursorImpl::next() {
     // First return stashed results, if there are any.
     if (!_stash.empty()) {
@@ -87,6 +87,12 @@ public:
     static ClusterClientCursorGuard make(executor::TaskExecutor* executor,
                                          ClusterClientCursorParams&& params);
 
+    /**
+     * Constructs a CCC whose safe cleanup is ensured by an RAII object, returning the results of
+     * an already built execution plan, such as the merging half of a sharded aggregation.
+     */
+    static ClusterClientCursorGuard make(std::unique_ptr<RouterExecStage> root);
+
     /**
      * Constructs a CCC whose result set is generated by a mock execution stage.
      */
@@ -114,6 +120,11 @@ private:
      */
     ClusterClientCursorImpl(executor::TaskExecutor* executor, ClusterClientCursorParams&& params);
 
+    /**
+     * Constructs a cluster client cursor which returns the results of 'root'.
+     */
+    ClusterClientCursorImpl(std::unique_ptr<RouterExecStage> root);
+
     /**
      * Constructs the pipeline of MergerPlanStages which will be used to answer the query.
      */
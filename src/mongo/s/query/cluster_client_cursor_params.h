@@ -37,6 +37,7 @@
 #include "mongo/db/cursor_id.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/s/client/shard.h"
+#include "mongo/stdx/functional.h"
 #include "mongo/util/net/hostandport.h"
 
 namespace mongo {
@@ -112,6 +113,12 @@ struct ClusterClientCursorParams {
     // The sort specification. Leave empty if there is no sort.
     BSONObj sort;
 
+    // Computes the sort key of a result document when the remotes cannot attach one under
+    // 'kSortKeyField', as is the case for the merging half of a sharded aggregation. The returned
+    // key is compared against 'sort' without considering field names. Only consulted when 'sort'
+    // is non-empty, and called from the executor thread, so it must not throw.
+    stdx::function<BSONObj(const BSONObj&)> sortKeyGenerator;
+
     // The number of results to skip. Optional. Should not be forwarded to the remote hosts in
     // 'cmdObj'.
     boost::optional<long long> skip;
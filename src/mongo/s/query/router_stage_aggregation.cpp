@@ -0,0 +1,127 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kQuery
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/s/query/router_stage_aggregation.h"
+
+#include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/pipeline/pipeline.h"
+
+namespace mongo {
+
+namespace {
+
+/**
+ * Makes the results of a RouterExecStage available as the initial source of a pipeline.
+ */
+class DocumentSourceRouterAdapter final : public DocumentSource {
+public:
+    DocumentSourceRouterAdapter(const boost::intrusive_ptr<ExpressionContext>& expCtx,
+                                RouterExecStage* child)
+        : DocumentSource(expCtx), _child(child) {}
+
+    boost::optional<Document> getNext() final {
+        pExpCtx->checkForInterrupt();
+
+        auto next = uassertStatusOK(_child->next());
+        if (next.isEOF()) {
+            return boost::none;
+        }
+        return Document::fromBsonWithMetaData(*next.getResult());
+    }
+
+    const char* getSourceName() const final {
+        return "$routerAdapter";
+    }
+
+    bool isValidInitialSource() const final {
+        return true;
+    }
+
+private:
+    Value serialize(bool explain = false) const final {
+        // This stage is only ever created on mongos to run an already-split merge pipeline, so it
+        // never needs to be sent elsewhere.
+        return Value(Document{{getSourceName(), Document()}});
+    }
+
+    // Not owned. The adapter is destroyed with the pipeline before the stage owning 'child'.
+    RouterExecStage* _child;
+};
+
+}  // namespace
+
+RouterStageAggregation::RouterStageAggregation(std::unique_ptr<RouterExecStage> child,
+                                               boost::intrusive_ptr<Pipeline> mergePipeline)
+    : RouterExecStage(std::move(child)), _mergePipeline(std::move(mergePipeline)) {
+    _mergePipeline->addInitialSource(
+        new DocumentSourceRouterAdapter(_mergePipeline->getContext(), getChildStage()));
+}
+
+RouterStageAggregation::~RouterStageAggregation() = default;
+
+StatusWith<ClusterQueryResult> RouterStageAggregation::next() {
+    boost::optional<Document> next;
+    try {
+        next = _mergePipeline->output()->getNext();
+    } catch (const DBException& ex) {
+        return ex.toStatus();
+    }
+
+    if (!next) {
+        return {ClusterQueryResult()};
+    }
+    return {ClusterQueryResult(next->toBson())};
+}
+
+void RouterStageAggregation::kill() {
+    getChildStage()->kill();
+}
+
+bool RouterStageAggregation::remotesExhausted() {
+    return getChildStage()->remotesExhausted();
+}
+
+Status RouterStageAggregation::setAwaitDataTimeout(Milliseconds awaitDataTimeout) {
+    return getChildStage()->setAwaitDataTimeout(awaitDataTimeout);
+}
+
+void RouterStageAggregation::setOperationContext(OperationContext* txn) {
+    if (_mergePipeline->getContext()->opCtx) {
+        _mergePipeline->detachFromOperationContext();
+    }
+    if (txn) {
+        _mergePipeline->reattachToOperationContext(txn);
+    }
+    getChildStage()->setOperationContext(txn);
+}
+
+}  // namespace mongo
@@ -0,0 +1,68 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/intrusive_ptr.hpp>
+
+#include "mongo/s/query/router_exec_stage.h"
+
+namespace mongo {
+
+class Pipeline;
+
+/**
+ * Runs the merging half of a sharded aggregation on mongos. The results of the child stage, which
+ * merges the shards' cursors, are fed into 'mergePipeline', and the output of the pipeline is
+ * returned as the results of this stage.
+ *
+ * The merge pipeline must only contain stages which can run on mongos, i.e. stages which neither
+ * need to read local data nor spill to disk.
+ */
+class RouterStageAggregation final : public RouterExecStage {
+public:
+    RouterStageAggregation(std::unique_ptr<RouterExecStage> child,
+                           boost::intrusive_ptr<Pipeline> mergePipeline);
+
+    ~RouterStageAggregation() final;
+
+    StatusWith<ClusterQueryResult> next() final;
+
+    void kill() final;
+
+    bool remotesExhausted() final;
+
+    Status setAwaitDataTimeout(Milliseconds awaitDataTimeout) final;
+
+    void setOperationContext(OperationContext* txn) final;
+
+private:
+    boost::intrusive_ptr<Pipeline> _mergePipeline;
+};
+
+}  // namespace mongo
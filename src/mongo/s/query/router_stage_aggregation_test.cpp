@@ -0,0 +1,154 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/s/query/router_stage_aggregation.h"
+
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/pipeline/aggregation_context_fixture.h"
+#include "mongo/db/pipeline/pipeline.h"
+#include "mongo/s/query/router_stage_mock.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+namespace {
+
+class RouterStageAggregationTest : public AggregationContextFixture {
+protected:
+    boost::intrusive_ptr<Pipeline> makeMergePipeline(const std::vector<BSONObj>& rawPipeline) {
+        getExpCtx()->inRouter = true;
+        return uassertStatusOK(Pipeline::parse(rawPipeline, getExpCtx()));
+    }
+};
+
+TEST_F(RouterStageAggregationTest, ReturnsOutputOfMergePipeline) {
+    auto mockStage = stdx::make_unique<RouterStageMock>();
+    mockStage->queueResult(BSON("a" << 1));
+    mockStage->queueResult(BSON("a" << 2));
+    mockStage->queueResult(BSON("a" << 3));
+
+    auto mergePipeline = makeMergePipeline(
+        {BSON("$skip" << 1), BSON("$project" << BSON("_id" << 0 << "b"
+                                                            << "$a"))});
+    auto aggStage =
+        stdx::make_unique<RouterStageAggregation>(std::move(mockStage), std::move(mergePipeline));
+
+    auto firstResult = aggStage->next();
+    ASSERT_OK(firstResult.getStatus());
+    ASSERT(firstResult.getValue().getResult());
+    ASSERT_EQ(*firstResult.getValue().getResult(), BSON("b" << 2));
+
+    auto secondResult = aggStage->next();
+    ASSERT_OK(secondResult.getStatus());
+    ASSERT(secondResult.getValue().getResult());
+    ASSERT_EQ(*secondResult.getValue().getResult(), BSON("b" << 3));
+
+    auto thirdResult = aggStage->next();
+    ASSERT_OK(thirdResult.getStatus());
+    ASSERT(thirdResult.getValue().isEOF());
+}
+
+TEST_F(RouterStageAggregationTest, MergesGroupPartials) {
+    auto mockStage = stdx::make_unique<RouterStageMock>();
+    mockStage->queueResult(BSON("_id" << 1 << "total" << 2));
+    mockStage->queueResult(BSON("_id" << 2 << "total" << 5));
+    mockStage->queueResult(BSON("_id" << 1 << "total" << 3));
+
+    auto mergePipeline = makeMergePipeline({BSON("$group" << BSON("_id"
+                                                                  << "$_id"
+                                                                  << "total"
+                                                                  << BSON("$sum"
+                                                                          << "$total"))),
+                                            BSON("$sort" << BSON("_id" << 1))});
+    auto aggStage =
+        stdx::make_unique<RouterStageAggregation>(std::move(mockStage), std::move(mergePipeline));
+
+    auto firstResult = aggStage->next();
+    ASSERT_OK(firstResult.getStatus());
+    ASSERT(firstResult.getValue().getResult());
+    ASSERT_EQ(*firstResult.getValue().getResult(), BSON("_id" << 1 << "total" << 5));
+
+    auto secondResult = aggStage->next();
+    ASSERT_OK(secondResult.getStatus());
+    ASSERT(secondResult.getValue().getResult());
+    ASSERT_EQ(*secondResult.getValue().getResult(), BSON("_id" << 2 << "total" << 5));
+
+    auto thirdResult = aggStage->next();
+    ASSERT_OK(thirdResult.getStatus());
+    ASSERT(thirdResult.getValue().isEOF());
+}
+
+TEST_F(RouterStageAggregationTest, PropagatesError) {
+    auto mockStage = stdx::make_unique<RouterStageMock>();
+    mockStage->queueResult(BSON("a" << 1));
+    mockStage->queueError(Status(ErrorCodes::BadValue, "bad thing happened"));
+
+    auto mergePipeline = makeMergePipeline({BSON("$limit" << 5)});
+    auto aggStage =
+        stdx::make_unique<RouterStageAggregation>(std::move(mockStage), std::move(mergePipeline));
+
+    auto firstResult = aggStage->next();
+    ASSERT_OK(firstResult.getStatus());
+    ASSERT(firstResult.getValue().getResult());
+    ASSERT_EQ(*firstResult.getValue().getResult(), BSON("a" << 1));
+
+    auto secondResult = aggStage->next();
+    ASSERT_NOT_OK(secondResult.getStatus());
+    ASSERT_EQ(secondResult.getStatus(), ErrorCodes::BadValue);
+    ASSERT_EQ(secondResult.getStatus().reason(), "bad thing happened");
+}
+
+TEST_F(RouterStageAggregationTest, RemotesExhausted) {
+    auto mockStage = stdx::make_unique<RouterStageMock>();
+    mockStage->queueResult(BSON("a" << 1));
+    mockStage->queueResult(BSON("a" << 2));
+    mockStage->markRemotesExhausted();
+
+    auto mergePipeline = makeMergePipeline({BSON("$limit" << 1)});
+    auto aggStage =
+        stdx::make_unique<RouterStageAggregation>(std::move(mockStage), std::move(mergePipeline));
+    ASSERT_TRUE(aggStage->remotesExhausted());
+
+    auto firstResult = aggStage->next();
+    ASSERT_OK(firstResult.getStatus());
+    ASSERT(firstResult.getValue().getResult());
+    ASSERT_EQ(*firstResult.getValue().getResult(), BSON("a" << 1));
+    ASSERT_TRUE(aggStage->remotesExhausted());
+
+    auto secondResult = aggStage->next();
+    ASSERT_OK(secondResult.getStatus());
+    ASSERT(secondResult.getValue().isEOF());
+}
+
+}  // namespace
+
+}  // namespace mongo
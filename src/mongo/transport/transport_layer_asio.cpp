@@ -0,0 +1,544 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kNetwork
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/transport/transport_layer_asio.h"
+
+#include <asio/system_timer.hpp>
+
+#include "mongo/base/checked_cast.h"
+#include "mongo/config.h"
+#include "mongo/db/server_options.h"
+#include "mongo/db/stats/counters.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/transport/service_entry_point.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/listen.h"
+#include "mongo/util/net/sock.h"
+#include "mongo/util/net/ssl_types.h"
+#include "mongo/util/stringutils.h"
+
+#ifdef MONGO_CONFIG_SSL
+#include "mongo/util/net/ssl_options.h"
+#endif
+
+namespace mongo {
+namespace transport {
+
+namespace {
+
+const int kHeaderSize = sizeof(MSGHEADER::Value);
+
+// Matches the backlog used by the legacy Listener.
+const int kListenBacklog = 128;
+
+Status makeSocketErrorStatus(const std::error_code& ec) {
+    if (ec == asio::error::operation_aborted) {
+        return Ticket::SessionClosedStatus;
+    }
+    return {ErrorCodes::HostUnreachable, ec.message()};
+}
+
+HostAndPort endpointToHostAndPort(const asio::ip::tcp::endpoint& endpoint) {
+    return HostAndPort(endpoint.address().to_string(), endpoint.port());
+}
+
+void closeSocket(asio::ip::tcp::socket* socket) {
+    std::error_code ec;
+    socket->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    socket->close(ec);
+}
+
+}  // namespace
+
+TransportLayerASIO::Connection::Connection(asio::ip::tcp::socket socket,
+                                           long long connectionId,
+                                           Session::TagMask tags)
+    : socket(std::move(socket)),
+      strand(this->socket.get_io_service()),
+      connectionId(connectionId),
+      tags(tags) {}
+
+TransportLayerASIO::ASIOTicket::ASIOTicket(const Session& session,
+                                           Date_t expiration,
+                                           FillHandle fill)
+    : _sessionId(session.id()), _expiration(expiration), _fill(std::move(fill)) {}
+
+Session::Id TransportLayerASIO::ASIOTicket::sessionId() const {
+    return _sessionId;
+}
+
+Date_t TransportLayerASIO::ASIOTicket::expiration() const {
+    return _expiration;
+}
+
+TransportLayerASIO::TransportLayerASIO(const TransportLayerASIO::Options& opts,
+                                       std::shared_ptr<ServiceEntryPoint> sep)
+    : _running(false), _options(opts), _sep(std::move(sep)) {}
+
+TransportLayerASIO::~TransportLayerASIO() {
+    shutdown();
+}
+
+Status TransportLayerASIO::setup() {
+#ifdef MONGO_CONFIG_SSL
+    if (sslGlobalParams.sslMode.load() != SSLParams::SSLMode_disabled) {
+        return {ErrorCodes::InvalidOptions,
+                "The ASIO transport layer does not yet support SSL connections"};
+    }
+#endif
+
+    std::vector<std::string> listenAddrs;
+    if (_options.ipList.empty()) {
+        listenAddrs.emplace_back("0.0.0.0");
+        if (IPv6Enabled()) {
+            listenAddrs.emplace_back("::");
+        }
+    } else {
+        splitStringDelim(_options.ipList, &listenAddrs, ',');
+    }
+
+    asio::ip::tcp::resolver resolver(_ioService);
+    for (const auto& ip : listenAddrs) {
+        std::error_code ec;
+        asio::ip::tcp::resolver::query query(
+            ip,
+            std::to_string(_options.port),
+            asio::ip::tcp::resolver::query::passive |
+                asio::ip::tcp::resolver::query::numeric_service);
+        auto endpoints = resolver.resolve(query, ec);
+        if (ec) {
+            return {ErrorCodes::BadValue,
+                    str::stream() << "Unable to resolve bind address " << ip << ": "
+                                  << ec.message()};
+        }
+
+        for (; endpoints != asio::ip::tcp::resolver::iterator(); ++endpoints) {
+            asio::ip::tcp::endpoint endpoint = *endpoints;
+            if (endpoint.address().is_v6() && !IPv6Enabled()) {
+                continue;
+            }
+
+            asio::ip::tcp::acceptor acceptor(_ioService);
+            acceptor.open(endpoint.protocol(), ec);
+            if (!ec) {
+                acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true), ec);
+            }
+            if (!ec && endpoint.address().is_v6()) {
+                acceptor.set_option(asio::ip::v6_only(true), ec);
+            }
+            if (!ec) {
+                acceptor.bind(endpoint, ec);
+            }
+            if (ec) {
+                error() << "Failed to bind to " << endpointToHostAndPort(endpoint) << ": "
+                        << ec.message();
+                return {ErrorCodes::SocketException,
+                        str::stream() << "Failed to set up listener on "
+                                      << endpointToHostAndPort(endpoint).toString() << ": "
+                                      << ec.message()};
+            }
+
+            _acceptors.emplace_back(std::move(acceptor));
+        }
+    }
+
+    if (_acceptors.empty()) {
+        return {ErrorCodes::BadValue, "No valid addresses to bind to"};
+    }
+
+    return Status::OK();
+}
+
+Status TransportLayerASIO::start() {
+    if (_running.swap(true)) {
+        return {ErrorCodes::InternalError, "TransportLayer is already running"};
+    }
+
+    for (auto& acceptor : _acceptors) {
+        std::error_code ec;
+        acceptor.listen(kListenBacklog, ec);
+        if (ec) {
+            return {ErrorCodes::SocketException,
+                    str::stream() << "listen() failed: " << ec.message()};
+        }
+
+        log() << "waiting for connections on "
+              << endpointToHostAndPort(acceptor.local_endpoint(ec));
+        _acceptConnection(acceptor);
+    }
+
+    // Keep run() from returning while the worker pool is idle.
+    _ioServiceWork = stdx::make_unique<asio::io_service::work>(_ioService);
+
+    size_t numWorkers = _options.numWorkerThreads;
+    if (numWorkers == 0) {
+        numWorkers = std::max(1u, stdx::thread::hardware_concurrency());
+    }
+
+    log() << "starting " << numWorkers << " transport worker threads";
+    for (size_t i = 0; i < numWorkers; ++i) {
+        _workers.emplace_back([this, i] {
+            setThreadName(std::string(str::stream() << "transport" << i));
+            while (true) {
+                try {
+                    _ioService.run();
+                    return;
+                } catch (const std::exception& e) {
+                    error() << "Uncaught exception in transport worker thread: " << e.what();
+                }
+            }
+        });
+    }
+
+    return Status::OK();
+}
+
+int TransportLayerASIO::listenerPort() const {
+    invariant(!_acceptors.empty());
+    return _acceptors.front().local_endpoint().port();
+}
+
+void TransportLayerASIO::_acceptConnection(asio::ip::tcp::acceptor& acceptor) {
+    auto socket = std::make_shared<asio::ip::tcp::socket>(_ioService);
+    acceptor.async_accept(*socket, [this, socket, &acceptor](const std::error_code& ec) {
+        if (!_running.load()) {
+            return;
+        }
+
+        if (ec == asio::error::no_descriptors) {
+            // The connection is still in the listen queue, but we can't accept it yet.
+            error() << "Out of file descriptors. Waiting one second before trying to accept "
+                       "more connections.";
+            auto timer = std::make_shared<asio::system_timer>(_ioService);
+            timer->expires_from_now(std::chrono::seconds(1));
+            timer->async_wait([this, timer, &acceptor](const std::error_code&) {
+                if (_running.load()) {
+                    _acceptConnection(acceptor);
+                }
+            });
+            return;
+        }
+
+        if (ec) {
+            log() << "Error accepting new connection on "
+                  << endpointToHostAndPort(acceptor.local_endpoint())
+                  << ": " << ec.message();
+        } else {
+            _handleNewConnection(std::move(*socket));
+        }
+
+        _acceptConnection(acceptor);
+    });
+}
+
+void TransportLayerASIO::_handleNewConnection(asio::ip::tcp::socket socket) {
+    if (!Listener::globalTicketHolder.tryAcquire()) {
+        log() << "connection refused because too many open connections: "
+              << Listener::globalTicketHolder.used();
+        closeSocket(&socket);
+        return;
+    }
+
+    std::error_code ec;
+    auto remote = socket.remote_endpoint(ec);
+    asio::ip::tcp::endpoint local;
+    if (!ec) {
+        local = socket.local_endpoint(ec);
+    }
+    if (!ec) {
+        socket.set_option(asio::ip::tcp::no_delay(true), ec);
+    }
+    if (ec) {
+        log() << "Error setting up new connection: " << ec.message();
+        Listener::globalTicketHolder.release();
+        closeSocket(&socket);
+        return;
+    }
+
+    const long long connectionId = Listener::globalConnectionNumber.addAndFetch(1);
+    if (!serverGlobalParams.quiet) {
+        int conns = Listener::globalTicketHolder.used();
+        const char* word = (conns == 1 ? " connection" : " connections");
+        log() << "connection accepted from " << endpointToHostAndPort(remote) << " #"
+              << connectionId << " (" << conns << word << " now open)";
+    }
+
+    Session session(endpointToHostAndPort(remote), endpointToHostAndPort(local), this);
+
+    {
+        stdx::lock_guard<stdx::mutex> lk(_connectionsMutex);
+        if (!_running.load()) {
+            Listener::globalTicketHolder.release();
+            closeSocket(&socket);
+            return;
+        }
+
+        _connections.emplace(
+            session.id(),
+            std::make_shared<Connection>(std::move(socket), connectionId, session.getTags()));
+    }
+
+    invariant(_sep);
+    _sep->startSession(std::move(session));
+}
+
+Ticket TransportLayerASIO::sourceMessage(Session& session, Message* message, Date_t expiration) {
+    auto& compressorMgr = session.getCompressorManager();
+    auto sourceCb = [message, &compressorMgr](ConnectionHandle conn, TicketCallback done) {
+        auto buf = SharedBuffer::allocate(kHeaderSize);
+        auto headerBuffer = asio::buffer(buf.get(), kHeaderSize);
+        asio::async_read(
+            conn->socket,
+            headerBuffer,
+            conn->strand.wrap([conn, buf, message, &compressorMgr, done](
+                const std::error_code& ec, size_t) mutable {
+                if (ec) {
+                    return done(makeSocketErrorStatus(ec));
+                }
+
+                const int msgLen = MsgData::ConstView(buf.get()).getLen();
+                if (msgLen < kHeaderSize || static_cast<size_t>(msgLen) > MaxMessageSizeBytes) {
+                    return done({ErrorCodes::ProtocolError,
+                                 str::stream() << "recv(): message len " << msgLen
+                                               << " is invalid. Min: " << kHeaderSize
+                                               << ", Max: " << MaxMessageSizeBytes});
+                }
+
+                auto finishMessage = [message, &compressorMgr](SharedBuffer buf) -> Status {
+                    message->setData(std::move(buf));
+                    networkCounter.hitPhysical(message->size(), 0);
+                    if (message->operation() == dbCompressed) {
+                        auto swm = compressorMgr.decompressMessage(*message);
+                        if (!swm.isOK())
+                            return swm.getStatus();
+                        *message = swm.getValue();
+                    }
+                    networkCounter.hitLogical(message->size(), 0);
+                    return Status::OK();
+                };
+
+                if (msgLen == kHeaderSize) {
+                    return done(finishMessage(std::move(buf)));
+                }
+
+                // asio copies handlers, so 'buf' is shared with those copies and cannot be
+                // realloc'd in place. Move the header into a buffer sized for the whole message.
+                auto msgBuf = SharedBuffer::allocate(msgLen);
+                memcpy(msgBuf.get(), buf.get(), kHeaderSize);
+                auto bodyBuffer =
+                    asio::buffer(MsgData::View(msgBuf.get()).data(), msgLen - kHeaderSize);
+                asio::async_read(
+                    conn->socket,
+                    bodyBuffer,
+                    conn->strand.wrap([conn, msgBuf, done, finishMessage](
+                        const std::error_code& ec, size_t) mutable {
+                        if (ec) {
+                            return done(makeSocketErrorStatus(ec));
+                        }
+                        done(finishMessage(std::move(msgBuf)));
+                    }));
+            }));
+    };
+
+    return Ticket(this, stdx::make_unique<ASIOTicket>(session, expiration, std::move(sourceCb)));
+}
+
+Ticket TransportLayerASIO::sinkMessage(Session& session,
+                                       const Message& message,
+                                       Date_t expiration) {
+    auto& compressorMgr = session.getCompressorManager();
+    auto sinkCb = [&message, &compressorMgr](ConnectionHandle conn, TicketCallback done) {
+        networkCounter.hitLogical(0, message.size());
+        auto swm = compressorMgr.compressMessage(message);
+        if (!swm.isOK()) {
+            return done(swm.getStatus());
+        }
+
+        // The compressed Message owns the buffer being written, so it must stay alive until the
+        // write completes.
+        Message toSend = std::move(swm.getValue());
+        auto sendBuffer = asio::buffer(toSend.buf(), toSend.size());
+        asio::async_write(
+            conn->socket,
+            sendBuffer,
+            conn->strand.wrap([conn, toSend, done](const std::error_code& ec, size_t) {
+                if (ec) {
+                    return done(makeSocketErrorStatus(ec));
+                }
+                networkCounter.hitPhysical(0, toSend.size());
+                done(Status::OK());
+            }));
+    };
+
+    return Ticket(this, stdx::make_unique<ASIOTicket>(session, expiration, std::move(sinkCb)));
+}
+
+Status TransportLayerASIO::wait(Ticket&& ticket) {
+    stdx::mutex mutex;
+    stdx::condition_variable cv;
+    boost::optional<Status> result;
+
+    asyncWait(std::move(ticket), [&](Status status) {
+        stdx::lock_guard<stdx::mutex> lk(mutex);
+        result = std::move(status);
+        cv.notify_one();
+    });
+
+    stdx::unique_lock<stdx::mutex> lk(mutex);
+    cv.wait(lk, [&] { return static_cast<bool>(result); });
+    return *result;
+}
+
+void TransportLayerASIO::asyncWait(Ticket&& ticket, TicketCallback callback) {
+    if (!_running.load()) {
+        return callback(TransportLayer::ShutdownStatus);
+    }
+
+    if (ticket.expiration() < Date_t::now()) {
+        return callback(Ticket::ExpiredStatus);
+    }
+
+    auto conn = _lookupConnection(ticket.sessionId());
+    if (!conn) {
+        return callback(TransportLayer::TicketSessionUnknownStatus);
+    }
+
+    // Start the socket operation on the Connection's strand, so that it cannot race with
+    // _endSession_inlock() closing the socket. The Ticket may be gone by then, so take its fill.
+    auto asioTicket = checked_cast<ASIOTicket*>(getTicketImpl(ticket));
+    FillHandle fill = std::move(asioTicket->_fill);
+    conn->strand.dispatch([conn, fill, callback] { fill(conn, callback); });
+}
+
+TransportLayerASIO::ConnectionHandle TransportLayerASIO::_lookupConnection(Session::Id id) const {
+    stdx::lock_guard<stdx::mutex> lk(_connectionsMutex);
+    auto conn = _connections.find(id);
+    if (conn == _connections.end()) {
+        return nullptr;
+    }
+    return conn->second;
+}
+
+SSLPeerInfo TransportLayerASIO::getX509PeerInfo(const Session& session) const {
+    // SSL is not supported by this TransportLayer, so there is never any peer information.
+    return SSLPeerInfo();
+}
+
+TransportLayer::Stats TransportLayerASIO::sessionStats() {
+    Stats stats;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_connectionsMutex);
+        stats.numOpenSessions = _connections.size();
+    }
+
+    stats.numAvailableSessions = Listener::globalTicketHolder.available();
+    stats.numCreatedSessions = Listener::globalConnectionNumber.load();
+
+    return stats;
+}
+
+void TransportLayerASIO::registerTags(const Session& session) {
+    stdx::lock_guard<stdx::mutex> lk(_connectionsMutex);
+    auto conn = _connections.find(session.id());
+    if (conn != _connections.end()) {
+        conn->second->tags = session.getTags();
+    }
+}
+
+void TransportLayerASIO::end(Session& session) {
+    stdx::lock_guard<stdx::mutex> lk(_connectionsMutex);
+    auto conn = _connections.find(session.id());
+    if (conn != _connections.end()) {
+        _endSession_inlock(conn);
+    }
+}
+
+void TransportLayerASIO::_endSession_inlock(ConnectionMap::iterator conn) {
+    // Closing the socket cancels any outstanding operations on it, which will complete their
+    // Tickets with a failed Status. Handlers that are still pending keep the Connection alive.
+    auto handle = conn->second;
+    handle->strand.dispatch([handle] { closeSocket(&handle->socket); });
+
+    Listener::globalTicketHolder.release();
+    _connections.erase(conn);
+}
+
+void TransportLayerASIO::endAllSessions(Session::TagMask tags) {
+    log() << "ASIO transport layer ending all sessions";
+    {
+        stdx::lock_guard<stdx::mutex> lk(_connectionsMutex);
+        auto conn = _connections.begin();
+        while (conn != _connections.end()) {
+            // If we erase this connection below, we invalidate our iterator, use a placeholder.
+            auto placeholder = conn;
+            placeholder++;
+
+            if (conn->second->tags & tags) {
+                log() << "Skip closing connection for connection # "
+                      << conn->second->connectionId;
+            } else {
+                _endSession_inlock(conn);
+            }
+
+            conn = placeholder;
+        }
+    }
+}
+
+void TransportLayerASIO::shutdown() {
+    if (!_running.swap(false)) {
+        return;
+    }
+
+    // Stop accepting new connections. The acceptors are only touched from the worker pool.
+    _ioService.post([this] {
+        for (auto& acceptor : _acceptors) {
+            std::error_code ec;
+            acceptor.close(ec);
+        }
+    });
+
+    // Every session must be closed here so that the worker pool runs out of work and exits.
+    endAllSessions(Session::kEmptyTagMask);
+
+    _ioServiceWork.reset();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+}
+
+}  // namespace transport
+}  // namespace mongo
@@ -0,0 +1,184 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <asio.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "mongo/base/status.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/transport/ticket_impl.h"
+#include "mongo/transport/transport_layer.h"
+
+namespace mongo {
+
+class ServiceEntryPoint;
+
+namespace transport {
+
+/**
+ * A TransportLayer implementation built on ASIO.
+ *
+ * Unlike the TransportLayerLegacy, which dedicates a blocking socket to the thread that services
+ * each connection, this TransportLayer multiplexes all of its sessions over a single
+ * asio::io_service that is run by a fixed-size pool of worker threads. Accepting connections and
+ * reading and writing Messages are all done with asynchronous socket operations, so an idle
+ * session does not occupy any worker thread while it waits for its next Message.
+ *
+ * Tickets run via asyncWait() complete on one of the worker threads. Tickets run via wait() are
+ * driven by the worker pool as well; the calling thread only blocks until the Ticket's
+ * completion is signalled. For that reason wait() must never be called from a worker thread.
+ */
+class TransportLayerASIO final : public TransportLayer {
+    MONGO_DISALLOW_COPYING(TransportLayerASIO);
+
+public:
+    struct Options {
+        int port;                 // port to bind to
+        std::string ipList;       // addresses to bind to
+        size_t numWorkerThreads;  // size of the I/O worker pool, 0 means one per core
+
+        Options() : port(0), ipList(""), numWorkerThreads(0) {}
+    };
+
+    TransportLayerASIO(const Options& opts, std::shared_ptr<ServiceEntryPoint> sep);
+
+    ~TransportLayerASIO();
+
+    Status setup();
+    Status start() override;
+
+    Ticket sourceMessage(Session& session,
+                         Message* message,
+                         Date_t expiration = Ticket::kNoExpirationDate) override;
+
+    Ticket sinkMessage(Session& session,
+                       const Message& message,
+                       Date_t expiration = Ticket::kNoExpirationDate) override;
+
+    Status wait(Ticket&& ticket) override;
+    void asyncWait(Ticket&& ticket, TicketCallback callback) override;
+
+    void registerTags(const Session& session) override;
+    SSLPeerInfo getX509PeerInfo(const Session& session) const override;
+
+    Stats sessionStats() override;
+
+    void end(Session& session) override;
+    void endAllSessions(transport::Session::TagMask tags = Session::kKeepOpen) override;
+
+    void shutdown() override;
+
+    /**
+     * Returns the port that the first acceptor is bound to. This is useful when the
+     * TransportLayer was configured to bind to an ephemeral port (port 0). Only valid after a
+     * successful call to setup().
+     */
+    int listenerPort() const;
+
+private:
+    /**
+     * The state that this TransportLayer keeps for every accepted connection. All socket
+     * operations for a connection are serialized through its strand.
+     */
+    class Connection {
+        MONGO_DISALLOW_COPYING(Connection);
+
+    public:
+        Connection(asio::ip::tcp::socket socket, long long connectionId, Session::TagMask tags);
+
+        asio::ip::tcp::socket socket;
+        asio::io_service::strand strand;
+
+        const long long connectionId;
+
+        Session::TagMask tags;
+    };
+
+    using ConnectionHandle = std::shared_ptr<Connection>;
+    using ConnectionMap = std::unordered_map<Session::Id, ConnectionHandle>;
+
+    /**
+     * A FillHandle starts the asynchronous work for a Ticket on the given Connection, and invokes
+     * the TicketCallback on a worker thread once that work has completed. It is run on the
+     * Connection's strand.
+     */
+    using FillHandle = stdx::function<void(ConnectionHandle, TicketCallback)>;
+
+    /**
+     * A TicketImpl implementation for this TransportLayer.
+     */
+    class ASIOTicket : public TicketImpl {
+        MONGO_DISALLOW_COPYING(ASIOTicket);
+
+    public:
+        ASIOTicket(const Session& session, Date_t expiration, FillHandle fill);
+
+        SessionId sessionId() const override;
+        Date_t expiration() const override;
+
+        SessionId _sessionId;
+        Date_t _expiration;
+
+        FillHandle _fill;
+    };
+
+    void _acceptConnection(asio::ip::tcp::acceptor& acceptor);
+    void _handleNewConnection(asio::ip::tcp::socket socket);
+
+    ConnectionHandle _lookupConnection(Session::Id id) const;
+
+    void _endSession_inlock(ConnectionMap::iterator conn);
+
+    asio::io_service _ioService;
+    std::unique_ptr<asio::io_service::work> _ioServiceWork;
+
+    std::vector<asio::ip::tcp::acceptor> _acceptors;
+    std::vector<stdx::thread> _workers;
+
+    mutable stdx::mutex _connectionsMutex;
+    ConnectionMap _connections;
+
+    AtomicWord<bool> _running;
+
+    Options _options;
+
+    // Declared last so that it is destroyed first: a ServiceEntryPoint may still own Sessions,
+    // which call back into this TransportLayer when they are destroyed.
+    std::shared_ptr<ServiceEntryPoint> _sep;
+};
+
+}  // namespace transport
+}  // namespace mongo
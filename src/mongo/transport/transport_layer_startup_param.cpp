@@ -0,0 +1,71 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/transport/transport_layer_startup_param.h"
+
+#include "mongo/base/init.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+namespace transport {
+
+namespace {
+
+const char kTransportLayerASIO[] = "asio";
+const char kTransportLayerLegacy[] = "legacy";
+
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(transportLayer, std::string, kTransportLayerLegacy);
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(transportLayerASIOWorkerThreads, int, 0);
+
+MONGO_INITIALIZER(transportLayer)(InitializerContext*) {
+    if ((transportLayer != kTransportLayerASIO) && (transportLayer != kTransportLayerLegacy)) {
+        return Status(ErrorCodes::BadValue, "unsupported transport layer: " + transportLayer);
+    }
+    if (transportLayerASIOWorkerThreads < 0) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "transportLayerASIOWorkerThreads must be non-negative, got "
+                                    << transportLayerASIOWorkerThreads);
+    }
+    return Status::OK();
+}
+
+}  // namespace
+
+bool isTransportLayerASIO() {
+    return transportLayer == kTransportLayerASIO;
+}
+
+size_t getTransportLayerASIOWorkerThreads() {
+    return static_cast<size_t>(transportLayerASIOWorkerThreads);
+}
+
+}  // namespace transport
+}  // namespace mongo
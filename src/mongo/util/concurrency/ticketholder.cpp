@@ -31,10 +31,11 @@
 
 #include "mongo/util/concurrency/ticketholder.h"
 
-#include <iostream>
+#include <algorithm>
 
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
@@ -58,6 +59,42 @@ TicketHolder::~TicketHolder() {
 }
 
 bool TicketHolder::tryAcquire() {
+    if (!_tryAcquire())
+        return false;
+    _totalAcquired.fetchAndAdd(1);
+    return true;
+}
+
+void TicketHolder::waitForTicket() {
+    if (!_tryAcquire()) {
+        _queued.fetchAndAdd(1);
+        const unsigned long long start = curTimeMicros64();
+        _waitForTicket();
+        _totalQueueMicros.fetchAndAdd(curTimeMicros64() - start);
+        _totalQueued.fetchAndAdd(1);
+        _queued.fetchAndSubtract(1);
+    }
+    _totalAcquired.fetchAndAdd(1);
+}
+
+bool TicketHolder::waitForTicketUntil(Date_t deadline) {
+    if (!_tryAcquire()) {
+        _queued.fetchAndAdd(1);
+        const unsigned long long start = curTimeMicros64();
+        const bool acquired = _waitForTicketUntil(deadline);
+        if (acquired) {
+            _totalQueueMicros.fetchAndAdd(curTimeMicros64() - start);
+            _totalQueued.fetchAndAdd(1);
+        }
+        _queued.fetchAndSubtract(1);
+        if (!acquired)
+            return false;
+    }
+    _totalAcquired.fetchAndAdd(1);
+    return true;
+}
+
+bool TicketHolder::_tryAcquire() {
     while (0 != sem_trywait(&_sem)) {
         switch (errno) {
             case EAGAIN:
@@ -71,7 +108,7 @@ bool TicketHolder::tryAcquire() {
     return true;
 }
 
-void TicketHolder::waitForTicket() {
+void TicketHolder::_waitForTicket() {
     while (0 != sem_wait(&_sem)) {
         switch (errno) {
             case EINTR:
@@ -82,7 +119,33 @@ void TicketHolder::waitForTicket() {
     }
 }
 
+bool TicketHolder::_waitForTicketUntil(Date_t deadline) {
+    // sem_timedwait takes an absolute time on the system clock.
+    const long long millis = deadline.toMillisSinceEpoch();
+    struct timespec ts;
+    ts.tv_sec = millis / 1000;
+    ts.tv_nsec = (millis % 1000) * 1000 * 1000;
+    while (0 != sem_timedwait(&_sem, &ts)) {
+        switch (errno) {
+            case ETIMEDOUT:
+                return false;
+            case EINTR:
+                break;
+            default:
+                _check(-1);
+        }
+    }
+    return true;
+}
+
 void TicketHolder::release() {
+    int surplus = _surplus.load();
+    while (surplus > 0) {
+        const int previous = _surplus.compareAndSwap(surplus, surplus - 1);
+        if (previous == surplus)
+            return;  // Retired by an earlier resize().
+        surplus = previous;
+    }
     _check(sem_post(&_sem));
 }
 
@@ -100,12 +163,20 @@ Status TicketHolder::resize(int newSize) {
                                     << newSize);
 
     while (_outof.load() < newSize) {
-        release();
+        // Keep a ticket that was still to be retired before adding a new one.
+        const int surplus = _surplus.load();
+        if (surplus == 0 || _surplus.compareAndSwap(surplus, surplus - 1) != surplus) {
+            _check(sem_post(&_sem));
+        }
         _outof.fetchAndAdd(1);
     }
 
     while (_outof.load() > newSize) {
-        waitForTicket();
+        // Take an available ticket out of circulation, or else retire one in use when it is
+        // released, rather than waiting for it.
+        if (!_tryAcquire()) {
+            _surplus.fetchAndAdd(1);
+        }
         _outof.subtractAndFetch(1);
     }
 
@@ -120,7 +191,7 @@ int TicketHolder::available() const {
 }
 
 int TicketHolder::used() const {
-    return outof() - available();
+    return outof() + _surplus.load() - available();
 }
 
 int TicketHolder::outof() const {
@@ -135,15 +206,46 @@ TicketHolder::~TicketHolder() = default;
 
 bool TicketHolder::tryAcquire() {
     stdx::lock_guard<stdx::mutex> lk(_mutex);
-    return _tryAcquire();
+    if (!_tryAcquire())
+        return false;
+    _totalAcquired.fetchAndAdd(1);
+    return true;
 }
 
 void TicketHolder::waitForTicket() {
     stdx::unique_lock<stdx::mutex> lk(_mutex);
 
-    while (!_tryAcquire()) {
-        _newTicket.wait(lk);
+    if (!_tryAcquire()) {
+        _queued.fetchAndAdd(1);
+        const unsigned long long start = curTimeMicros64();
+        do {
+            _newTicket.wait(lk);
+        } while (!_tryAcquire());
+        _totalQueueMicros.fetchAndAdd(curTimeMicros64() - start);
+        _totalQueued.fetchAndAdd(1);
+        _queued.fetchAndSubtract(1);
+    }
+    _totalAcquired.fetchAndAdd(1);
+}
+
+bool TicketHolder::waitForTicketUntil(Date_t deadline) {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+
+    if (!_tryAcquire()) {
+        _queued.fetchAndAdd(1);
+        const unsigned long long start = curTimeMicros64();
+        const bool acquired = _newTicket.wait_until(
+            lk, deadline.toSystemTimePoint(), [this] { return _tryAcquire(); });
+        if (acquired) {
+            _totalQueueMicros.fetchAndAdd(curTimeMicros64() - start);
+            _totalQueued.fetchAndAdd(1);
+        }
+        _queued.fetchAndSubtract(1);
+        if (!acquired)
+            return false;
     }
+    _totalAcquired.fetchAndAdd(1);
+    return true;
 }
 
 void TicketHolder::release() {
@@ -157,17 +259,9 @@ void TicketHolder::release() {
 Status TicketHolder::resize(int newSize) {
     stdx::lock_guard<stdx::mutex> lk(_mutex);
 
+    // If more tickets than 'newSize' are in use, '_num' goes negative and the surplus tickets are
+    // retired as they are released.
     int used = _outof.load() - _num;
-    if (used > newSize) {
-        std::stringstream ss;
-        ss << "can't resize since we're using (" << used << ") "
-           << "more than newSize(" << newSize << ")";
-
-        std::string errmsg = ss.str();
-        log() << errmsg;
-        return Status(ErrorCodes::BadValue, errmsg);
-    }
-
     _outof.store(newSize);
     _num = _outof.load() - used;
 
@@ -177,7 +271,7 @@ Status TicketHolder::resize(int newSize) {
 }
 
 int TicketHolder::available() const {
-    return _num;
+    return std::max(_num, 0);
 }
 
 int TicketHolder::used() const {
@@ -190,13 +284,26 @@ int TicketHolder::outof() const {
 
 bool TicketHolder::_tryAcquire() {
     if (_num <= 0) {
-        if (_num < 0) {
-            std::cerr << "DISASTER! in TicketHolder" << std::endl;
-        }
         return false;
     }
     _num--;
     return true;
 }
 #endif
+
+int TicketHolder::queued() const {
+    return _queued.load();
+}
+
+long long TicketHolder::totalAcquired() const {
+    return _totalAcquired.load();
+}
+
+long long TicketHolder::totalQueued() const {
+    return _totalQueued.load();
+}
+
+long long TicketHolder::totalQueueMicros() const {
+    return _totalQueueMicros.load();
+}
 }
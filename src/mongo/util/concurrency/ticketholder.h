@@ -31,9 +31,11 @@
 #endif
 
 #include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/mutex.h"
 #include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
@@ -48,8 +50,18 @@ public:
 
     void waitForTicket();
 
+    /**
+     * Like waitForTicket(), but gives up at 'deadline'. Returns true if a ticket was acquired.
+     */
+    bool waitForTicketUntil(Date_t deadline);
+
     void release();
 
+    /**
+     * Changes the number of tickets to 'newSize' without waiting. If more tickets than 'newSize'
+     * are in use, outof() drops right away and the surplus tickets are retired as they are
+     * released, rather than becoming available again.
+     */
     Status resize(int newSize);
 
     int available() const;
@@ -58,17 +70,50 @@ public:
 
     int outof() const;
 
+    /**
+     * Number of threads currently blocked in waitForTicket.
+     */
+    int queued() const;
+
+    /**
+     * Total number of tickets handed out by tryAcquire and waitForTicket.
+     */
+    long long totalAcquired() const;
+
+    /**
+     * Total number of waitForTicket calls which found no ticket available and had to block, and
+     * the total time in microseconds they spent blocked.
+     */
+    long long totalQueued() const;
+    long long totalQueueMicros() const;
+
 private:
+    AtomicInt32 _queued;
+    AtomicInt64 _totalAcquired;
+    AtomicInt64 _totalQueued;
+    AtomicInt64 _totalQueueMicros;
+
 #if defined(__linux__)
+    // These acquire a ticket without updating the statistics above.
+    bool _tryAcquire();
+    void _waitForTicket();
+    bool _waitForTicketUntil(Date_t deadline);
+
     mutable sem_t _sem;
 
     // You can read _outof without a lock, but have to hold _resizeMutex to change.
     AtomicInt32 _outof;
     stdx::mutex _resizeMutex;
+
+    // Number of tickets in use which release() retires instead of returning to '_sem', left over
+    // from shrinking while those tickets were in use.
+    AtomicInt32 _surplus;
 #else
     bool _tryAcquire();
 
     AtomicInt32 _outof;
+
+    // Number of available tickets. Negative after shrinking below the number of tickets in use.
     int _num;
     stdx::mutex _mutex;
     stdx::condition_variable _newTicket;